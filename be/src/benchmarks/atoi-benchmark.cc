@@ -263,6 +263,14 @@ int main(int argc, char **argv) {
   AddTestData(&data_both_space, 1000, -5, 1000, true, true);
   data_both_space.result.resize(data_trailing_space.data.size());
 
+  // Values with 9 or 10 digits. Built without AddTestData() above, which would print
+  // them in scientific notation.
+  TestData data_large;
+  for (int i = 0; i < 1000; ++i) {
+    AddTestData(&data_large, std::to_string(100000000 + rand() % 2000000000));
+  }
+  data_large.result.resize(data_large.data.size());
+
   TestData data_garbage;
   for (int i = 0; i < 1000; ++i) {
     AddTestData(&data_garbage, "sdfsfdsfasd");
@@ -286,6 +294,7 @@ int main(int argc, char **argv) {
   suite.AddBenchmark("impala_leading_space", TestImpala, &data_leading_space);
   suite.AddBenchmark("impala_trailing_space", TestImpala, &data_trailing_space);
   suite.AddBenchmark("impala_both_space", TestImpala, &data_both_space);
+  suite.AddBenchmark("impala_large", TestImpala, &data_large);
   suite.AddBenchmark("impala_garbage", TestImpala, &data_garbage);
   suite.AddBenchmark("impala_trailing_garbage", TestImpala, &data_trailing_garbage);
 
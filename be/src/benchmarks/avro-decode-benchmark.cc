@@ -0,0 +1,324 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <vector>
+
+#include "exec/read-write-util.h"
+#include "runtime/string-value.h"
+#include "util/benchmark.h"
+#include "util/cpu-info.h"
+
+#include "common/names.h"
+
+using namespace impala;
+
+// Benchmark for decoding Avro records. It compares decoding driven by a schema that is
+// interpreted for every field of every record, like HdfsAvroScanner::MaterializeTuple()
+// does, with decoding code that is specialized for the schema, like the codegen'd
+// MaterializeTuple(). 'specialized_prefix' additionally checks before each field whether
+// the file schema contains it, which is what the codegen'd function does to support
+// files whose schema is a prefix of the table schema.
+//
+// The record schema is:
+//   {long (nullable), string (nullable), double, int, string (nullable), boolean}
+
+enum FieldType {
+  FIELD_BOOLEAN,
+  FIELD_INT,
+  FIELD_LONG,
+  FIELD_DOUBLE,
+  FIELD_STRING
+};
+
+struct Field {
+  FieldType type;
+  // Position of "null" in the [type, "null"] union or -1 if the field isn't nullable.
+  int null_union_position;
+};
+
+static const Field SCHEMA[] = {
+  {FIELD_LONG, 1},
+  {FIELD_STRING, 1},
+  {FIELD_DOUBLE, -1},
+  {FIELD_INT, -1},
+  {FIELD_STRING, 1},
+  {FIELD_BOOLEAN, -1}
+};
+static const int NUM_FIELDS = sizeof(SCHEMA) / sizeof(Field);
+
+// Decoded record. Mimics a tuple with one slot per field and a null indicator byte.
+struct Row {
+  int64_t l;
+  StringValue s1;
+  double d;
+  int32_t i;
+  StringValue s2;
+  bool b;
+  uint8_t nulls;
+};
+
+struct TestData {
+  vector<uint8_t> buffer;
+  int num_records;
+  vector<Row> rows;
+};
+
+static void* SlotPtr(Row* row, int field_idx) {
+  switch (field_idx) {
+    case 0: return &row->l;
+    case 1: return &row->s1;
+    case 2: return &row->d;
+    case 3: return &row->i;
+    case 4: return &row->s2;
+    case 5: return &row->b;
+    default: DCHECK(false); return nullptr;
+  }
+}
+
+static void InitTestData(TestData* data, int num_records) {
+  data->num_records = num_records;
+  data->rows.resize(num_records);
+  data->buffer.resize(num_records * 128);
+  uint8_t* buf = data->buffer.data();
+  const char* strings[] = {"", "a", "impala", "avro-decode-benchmark",
+      "a somewhat longer string value"};
+  for (int r = 0; r < num_records; ++r) {
+    for (int f = 0; f < NUM_FIELDS; ++f) {
+      if (SCHEMA[f].null_union_position != -1) {
+        bool is_null = rand() % 10 == 0;
+        int branch = is_null ? SCHEMA[f].null_union_position
+                             : 1 - SCHEMA[f].null_union_position;
+        buf += ReadWriteUtil::PutZInt(branch, buf);
+        if (is_null) continue;
+      }
+      switch (SCHEMA[f].type) {
+        case FIELD_BOOLEAN:
+          *buf++ = rand() % 2;
+          break;
+        case FIELD_INT:
+          buf += ReadWriteUtil::PutZInt(rand() % 100000 - 50000, buf);
+          break;
+        case FIELD_LONG:
+          buf += ReadWriteUtil::PutZLong(static_cast<int64_t>(rand()) * rand(), buf);
+          break;
+        case FIELD_DOUBLE: {
+          double v = rand() / 3.0;
+          memcpy(buf, &v, sizeof(v));
+          buf += sizeof(v);
+          break;
+        }
+        case FIELD_STRING: {
+          const char* str = strings[rand() % 5];
+          int len = strlen(str);
+          buf += ReadWriteUtil::PutZLong(len, buf);
+          memcpy(buf, str, len);
+          buf += len;
+          break;
+        }
+      }
+    }
+  }
+  DCHECK_LE(buf, data->buffer.data() + data->buffer.size());
+  data->buffer.resize(buf - data->buffer.data());
+}
+
+static inline bool ReadNullUnion(int null_union_position, uint8_t** data,
+    uint8_t* data_end, bool* is_null) {
+  ReadWriteUtil::ZIntResult r = ReadWriteUtil::ReadZInt(data, data_end);
+  if (UNLIKELY(!r.ok)) return false;
+  *is_null = r.val == null_union_position;
+  return true;
+}
+
+template <FieldType TYPE>
+static inline bool ReadField(uint8_t** data, uint8_t* data_end, void* slot) {
+  switch (TYPE) {
+    case FIELD_BOOLEAN:
+      if (UNLIKELY(*data == data_end)) return false;
+      *reinterpret_cast<bool*>(slot) = **data != 0;
+      ++*data;
+      return true;
+    case FIELD_INT: {
+      ReadWriteUtil::ZIntResult r = ReadWriteUtil::ReadZInt(data, data_end);
+      *reinterpret_cast<int32_t*>(slot) = r.val;
+      return r.ok;
+    }
+    case FIELD_LONG: {
+      ReadWriteUtil::ZLongResult r = ReadWriteUtil::ReadZLong(data, data_end);
+      *reinterpret_cast<int64_t*>(slot) = r.val;
+      return r.ok;
+    }
+    case FIELD_DOUBLE:
+      if (UNLIKELY(data_end - *data < static_cast<int64_t>(sizeof(double)))) {
+        return false;
+      }
+      memcpy(slot, *data, sizeof(double));
+      *data += sizeof(double);
+      return true;
+    case FIELD_STRING: {
+      ReadWriteUtil::ZLongResult r = ReadWriteUtil::ReadZLong(data, data_end);
+      if (UNLIKELY(!r.ok || r.val < 0 || data_end - *data < r.val)) return false;
+      StringValue* sv = reinterpret_cast<StringValue*>(slot);
+      sv->ptr = reinterpret_cast<char*>(*data);
+      sv->len = r.val;
+      *data += r.val;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Equivalent of the interpreted MaterializeTuple(): switches on the schema of each field.
+static bool DecodeInterpreted(const Field* schema, int num_fields, uint8_t** data,
+    uint8_t* data_end, Row* row) {
+  row->nulls = 0;
+  for (int f = 0; f < num_fields; ++f) {
+    if (schema[f].null_union_position != -1) {
+      bool is_null;
+      if (!ReadNullUnion(schema[f].null_union_position, data, data_end, &is_null)) {
+        return false;
+      }
+      if (is_null) {
+        row->nulls |= 1 << f;
+        continue;
+      }
+    }
+    void* slot = SlotPtr(row, f);
+    bool success;
+    switch (schema[f].type) {
+      case FIELD_BOOLEAN:
+        success = ReadField<FIELD_BOOLEAN>(data, data_end, slot);
+        break;
+      case FIELD_INT:
+        success = ReadField<FIELD_INT>(data, data_end, slot);
+        break;
+      case FIELD_LONG:
+        success = ReadField<FIELD_LONG>(data, data_end, slot);
+        break;
+      case FIELD_DOUBLE:
+        success = ReadField<FIELD_DOUBLE>(data, data_end, slot);
+        break;
+      case FIELD_STRING:
+        success = ReadField<FIELD_STRING>(data, data_end, slot);
+        break;
+      default:
+        success = false;
+    }
+    if (UNLIKELY(!success)) return false;
+  }
+  return true;
+}
+
+// Decodes one field with the type and nullability known at compile time, like the code
+// emitted by HdfsAvroScanner::CodegenReadRecord(). If CHECK_PRESENT is true, the field
+// is only decoded if 'field_idx' < 'num_fields' and '*done' is set otherwise.
+template <FieldType TYPE, int NULL_UNION_POSITION, bool CHECK_PRESENT>
+static inline bool DecodeSpecializedField(int field_idx, int num_fields, uint8_t** data,
+    uint8_t* data_end, void* slot, Row* row, bool* done) {
+  if (CHECK_PRESENT && field_idx >= num_fields) {
+    *done = true;
+    return true;
+  }
+  if (NULL_UNION_POSITION != -1) {
+    bool is_null;
+    if (!ReadNullUnion(NULL_UNION_POSITION, data, data_end, &is_null)) return false;
+    if (is_null) {
+      row->nulls |= 1 << field_idx;
+      return true;
+    }
+  }
+  return ReadField<TYPE>(data, data_end, slot);
+}
+
+template <bool CHECK_PRESENT>
+static bool DecodeSpecialized(int num_fields, uint8_t** data, uint8_t* data_end,
+    Row* row) {
+  row->nulls = 0;
+  bool done = false;
+  return DecodeSpecializedField<FIELD_LONG, 1, CHECK_PRESENT>(
+             0, num_fields, data, data_end, &row->l, row, &done)
+      && (done || DecodeSpecializedField<FIELD_STRING, 1, CHECK_PRESENT>(
+             1, num_fields, data, data_end, &row->s1, row, &done))
+      && (done || DecodeSpecializedField<FIELD_DOUBLE, -1, CHECK_PRESENT>(
+             2, num_fields, data, data_end, &row->d, row, &done))
+      && (done || DecodeSpecializedField<FIELD_INT, -1, CHECK_PRESENT>(
+             3, num_fields, data, data_end, &row->i, row, &done))
+      && (done || DecodeSpecializedField<FIELD_STRING, 1, CHECK_PRESENT>(
+             4, num_fields, data, data_end, &row->s2, row, &done))
+      && (done || DecodeSpecializedField<FIELD_BOOLEAN, -1, CHECK_PRESENT>(
+             5, num_fields, data, data_end, &row->b, row, &done));
+}
+
+void TestInterpreted(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    uint8_t* buf = data->buffer.data();
+    uint8_t* buf_end = buf + data->buffer.size();
+    for (int r = 0; r < data->num_records; ++r) {
+      bool ok = DecodeInterpreted(SCHEMA, NUM_FIELDS, &buf, buf_end, &data->rows[r]);
+      DCHECK(ok);
+    }
+    DCHECK_EQ(buf, buf_end);
+  }
+}
+
+void TestSpecialized(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    uint8_t* buf = data->buffer.data();
+    uint8_t* buf_end = buf + data->buffer.size();
+    for (int r = 0; r < data->num_records; ++r) {
+      bool ok = DecodeSpecialized<false>(NUM_FIELDS, &buf, buf_end, &data->rows[r]);
+      DCHECK(ok);
+    }
+    DCHECK_EQ(buf, buf_end);
+  }
+}
+
+void TestSpecializedPrefix(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  // Read through a volatile so the number of fields isn't constant folded.
+  volatile int num_fields = NUM_FIELDS;
+  for (int i = 0; i < batch_size; ++i) {
+    uint8_t* buf = data->buffer.data();
+    uint8_t* buf_end = buf + data->buffer.size();
+    for (int r = 0; r < data->num_records; ++r) {
+      bool ok = DecodeSpecialized<true>(num_fields, &buf, buf_end, &data->rows[r]);
+      DCHECK(ok);
+    }
+    DCHECK_EQ(buf, buf_end);
+  }
+}
+
+int main(int argc, char** argv) {
+  CpuInfo::Init();
+  cout << Benchmark::GetMachineInfo() << endl;
+
+  TestData data;
+  InitTestData(&data, 1000);
+
+  Benchmark suite("Avro decode");
+  suite.AddBenchmark("interpreted", TestInterpreted, &data);
+  suite.AddBenchmark("specialized", TestSpecialized, &data);
+  suite.AddBenchmark("specialized_prefix", TestSpecializedPrefix, &data);
+  cout << suite.Measure();
+
+  return 0;
+}
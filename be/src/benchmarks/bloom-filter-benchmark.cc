@@ -18,7 +18,9 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <vector>
 
 #include "gen-cpp/data_stream_service.pb.h"
@@ -53,7 +55,9 @@ using kudu::rpc::RpcController;
 // 3. Lookups when the item is present
 // 4. Lookups when the item is absent (this is theoretically faster than when the item is
 //    present in some Bloom filter variants)
-// 5. Unions
+// 5. Batched lookups with FindBatch(), for present and absent items, in batches of the
+//    default row batch size like the scanners do
+// 6. Unions
 //
 // As in bloom-filter.h, ndv refers to the number of unique items inserted into a filter
 // and fpp is the probability of false positives.
@@ -243,12 +247,16 @@ void Benchmark(int batch_size, void* data) {
 
 namespace find {
 
+// Number of hashes per FindBatch() call. Same as the default row batch size.
+const int FIND_BATCH_SIZE = 1024;
+
 struct TestData {
   TestData(int log_bufferpool_size, BufferPool::ClientHandle* client, size_t size)
     : bf(client),
       vec_mask((1ull << static_cast<int>(floor(log2(size)))) - 1),
       present(size),
       absent(size),
+      found(new bool[FIND_BATCH_SIZE]),
       result(0) {
     CHECK(bf.Init(log_bufferpool_size, 0).ok());
     for (size_t i = 0; i < size; ++i) {
@@ -266,6 +274,8 @@ struct TestData {
   // i % present.size() invokes
   size_t vec_mask;
   vector<uint32_t> present, absent;
+  // Output of FindBatch().
+  unique_ptr<bool[]> found;
   // Used only to avoid the compiler optimizing out the results of BloomFilter::Find()
   size_t result;
 };
@@ -284,6 +294,27 @@ void Absent(int batch_size, void* data) {
   }
 }
 
+// Looks up 'batch_size' hashes from 'hashes' with FindBatch(), FIND_BATCH_SIZE at a time.
+// Since vec_mask + 1 is a power of two that is at least FIND_BATCH_SIZE, every batch is
+// contiguous in 'hashes'.
+void FindBatch(TestData* d, const vector<uint32_t>& hashes, int batch_size) {
+  for (int i = 0; i < batch_size; i += FIND_BATCH_SIZE) {
+    const int n = min(FIND_BATCH_SIZE, batch_size - i);
+    d->bf.FindBatch(&hashes[i & d->vec_mask], n, d->found.get());
+    for (int j = 0; j < n; ++j) d->result += d->found[j];
+  }
+}
+
+void PresentBatch(int batch_size, void* data) {
+  TestData* d = reinterpret_cast<TestData*>(data);
+  FindBatch(d, d->present, batch_size);
+}
+
+void AbsentBatch(int batch_size, void* data) {
+  TestData* d = reinterpret_cast<TestData*>(data);
+  FindBatch(d, d->absent, batch_size);
+}
+
 }  // namespace find
 
 // Benchmark or
@@ -383,6 +414,14 @@ void RunBenchmarks() {
 
         snprintf(name, sizeof(name), "absent  ndv %7dk fpp %6.1f%%", ndv/1000, fpp*100);
         suite.AddBenchmark(name, find::Absent, testdata.back().get());
+
+        snprintf(name, sizeof(name), "present batch ndv %7dk fpp %6.1f%%", ndv/1000,
+            fpp*100);
+        suite.AddBenchmark(name, find::PresentBatch, testdata.back().get());
+
+        snprintf(name, sizeof(name), "absent  batch ndv %7dk fpp %6.1f%%", ndv/1000,
+            fpp*100);
+        suite.AddBenchmark(name, find::AbsentBatch, testdata.back().get());
       }
     }
     cout << suite.Measure() << endl;
@@ -0,0 +1,197 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <iostream>
+#include <random>
+
+#include "runtime/decimal-value.inline.h"
+#include "runtime/multi-precision.h"
+#include "util/benchmark.h"
+#include "util/cpu-info.h"
+#include "util/decimal-util.h"
+
+#include "common/names.h"
+
+using namespace impala;
+
+// Benchmark for the 256-bit intermediate results of DECIMAL(38) multiplication and
+// division, comparing boost's int256_t with the native kernels in multi-precision.h.
+//
+// "Multiply" multiplies two values with 38 digits and scales the 76-digit product down
+// by 10^38 with rounding, like DecimalValue::Multiply() does when the product does not
+// fit into 128 bits. "Divide" scales a value up by 10^38 and divides it by another
+// value, like DecimalValue::Divide(). "Compare" compares values of different scales.
+// The "Decimal16Value" cases call the DecimalValue functions, which use the native
+// kernels, to show the end-to-end cost.
+//
+// Results are machine dependent.
+
+// Number of operand pairs in the data set.
+static const int NUM_VALUES = 1 << 12;
+
+// Scales of the operands and results of the benchmarked operations.
+static const int SCALE = 38;
+static const int RESULT_SCALE = 38;
+
+struct TestData {
+  vector<int128_t> x;
+  vector<int128_t> y;
+  int128_t result = 0;
+};
+
+// Returns a random value with between 1 and 38 digits and a random sign.
+static int128_t RandomDecimal(std::mt19937_64* rng) {
+  int num_digits = 1 + (*rng)() % ColumnType::MAX_PRECISION;
+  int128_t value = 0;
+  for (int i = 0; i < num_digits; ++i) value = value * 10 + (*rng)() % 10;
+  return (*rng)() % 2 == 0 ? value : -value;
+}
+
+void TestMultiplyBoost(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    for (int j = 0; j < NUM_VALUES; ++j) {
+      int256_t product = ConvertToInt256(data->x[j]) * ConvertToInt256(data->y[j]);
+      product = DecimalUtil::ScaleDownAndRound<int256_t>(product, SCALE, true);
+      bool overflow = false;
+      data->result += ConvertToInt128(product, MAX_UNSCALED_DECIMAL16, &overflow);
+    }
+  }
+}
+
+void TestMultiplyNative(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  const __uint128_t divisor = DecimalUtil::GetScaleMultiplier<int128_t>(SCALE);
+  for (int i = 0; i < batch_size; ++i) {
+    for (int j = 0; j < NUM_VALUES; ++j) {
+      int128_t x = data->x[j];
+      int128_t y = data->y[j];
+      UnsignedInt256 product = MultiplyWide(abs(x), abs(y));
+      __uint128_t remainder;
+      __uint128_t quotient = DivideWide(product, divisor, &remainder);
+      if (remainder >= (divisor >> 1)) ++quotient;
+      data->result += detail::ApplySign(quotient, (x < 0) != (y < 0));
+    }
+  }
+}
+
+void TestMultiplyDecimal16(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    for (int j = 0; j < NUM_VALUES; ++j) {
+      bool overflow = false;
+      data->result += Decimal16Value(data->x[j]).Multiply<int128_t>(SCALE,
+          Decimal16Value(data->y[j]), SCALE, ColumnType::MAX_PRECISION, SCALE, true,
+          &overflow).value();
+    }
+  }
+}
+
+void TestDivideBoost(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    for (int j = 0; j < NUM_VALUES; ++j) {
+      int256_t x = DecimalUtil::MultiplyByScale<int256_t>(
+          ConvertToInt256(data->x[j]), RESULT_SCALE, false);
+      int256_t y = ConvertToInt256(data->y[j]);
+      bool overflow = false;
+      data->result += ConvertToInt128(x / y, MAX_UNSCALED_DECIMAL16, &overflow);
+    }
+  }
+}
+
+void TestDivideNative(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  const __uint128_t multiplier = DecimalUtil::GetScaleMultiplier<int128_t>(RESULT_SCALE);
+  for (int i = 0; i < batch_size; ++i) {
+    for (int j = 0; j < NUM_VALUES; ++j) {
+      int128_t x = data->x[j];
+      int128_t y = data->y[j];
+      UnsignedInt256 scaled_x = MultiplyWide(abs(x), multiplier);
+      if (scaled_x.hi >= static_cast<__uint128_t>(abs(y))) continue;
+      __uint128_t remainder;
+      __uint128_t quotient = DivideWide(scaled_x, abs(y), &remainder);
+      data->result += detail::ApplySign(quotient, (x < 0) != (y < 0));
+    }
+  }
+}
+
+void TestDivideDecimal16(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    for (int j = 0; j < NUM_VALUES; ++j) {
+      bool is_nan = false;
+      bool overflow = false;
+      data->result += Decimal16Value(data->x[j]).Divide<int128_t>(SCALE,
+          Decimal16Value(data->y[j]), SCALE, ColumnType::MAX_PRECISION, RESULT_SCALE,
+          false, &is_nan, &overflow).value();
+    }
+  }
+}
+
+void TestCompareBoost(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    for (int j = 0; j < NUM_VALUES; ++j) {
+      int256_t x = ConvertToInt256(data->x[j]);
+      int256_t y = DecimalUtil::MultiplyByScale<int256_t>(
+          ConvertToInt256(data->y[j]), SCALE, false);
+      data->result += x < y;
+    }
+  }
+}
+
+void TestCompareDecimal16(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    for (int j = 0; j < NUM_VALUES; ++j) {
+      data->result +=
+          Decimal16Value(data->x[j]).Compare(SCALE, Decimal16Value(data->y[j]), 0) < 0;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  CpuInfo::Init();
+  cout << Benchmark::GetMachineInfo() << endl;
+
+  std::mt19937_64 rng(0);
+  TestData data;
+  for (int i = 0; i < NUM_VALUES; ++i) {
+    data.x.push_back(RandomDecimal(&rng));
+    int128_t y = RandomDecimal(&rng);
+    data.y.push_back(y == 0 ? 1 : y);
+  }
+
+  Benchmark multiply_suite("Multiply");
+  int baseline = multiply_suite.AddBenchmark("Boost", TestMultiplyBoost, &data, -1);
+  multiply_suite.AddBenchmark("Native", TestMultiplyNative, &data, baseline);
+  multiply_suite.AddBenchmark("Decimal16Value", TestMultiplyDecimal16, &data, baseline);
+  cout << multiply_suite.Measure() << endl;
+
+  Benchmark divide_suite("Divide");
+  baseline = divide_suite.AddBenchmark("Boost", TestDivideBoost, &data, -1);
+  divide_suite.AddBenchmark("Native", TestDivideNative, &data, baseline);
+  divide_suite.AddBenchmark("Decimal16Value", TestDivideDecimal16, &data, baseline);
+  cout << divide_suite.Measure() << endl;
+
+  Benchmark compare_suite("Compare");
+  baseline = compare_suite.AddBenchmark("Boost", TestCompareBoost, &data, -1);
+  compare_suite.AddBenchmark("Decimal16Value", TestCompareDecimal16, &data, baseline);
+  cout << compare_suite.Measure() << endl;
+  return 0;
+}
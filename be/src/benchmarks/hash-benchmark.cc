@@ -51,6 +51,8 @@ using namespace impala;
 //   4. Boost Hash: boost hash function
 //   5. Crc: hash using sse4 crc hash instruction
 //   6. Codegen: hash using sse4 with the tuple types baked into the codegen function
+//   7. FastHash64Batch: hash all rows column by column with HashUtil::FastHash64Batch(),
+//      which hashes several rows at once (Int set only)
 //
 // n is the number of buckets, k is the number of items
 // Expected(collisions) = n - k + E(X)
@@ -91,6 +93,8 @@ struct TestData {
   int num_cols;
   int num_rows;
   vector<int32_t> results;
+  // Scratch space for the 64-bit hashes of the batch hash functions.
+  vector<uint64_t> hashes;
   CodegenHashFn jitted_fn;
 };
 
@@ -190,6 +194,22 @@ void TestMurmur2_64IntHash(int batch, void* d) {
   }
 }
 
+void TestFastHashBatchIntHash(int batch, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  int rows = data->num_rows;
+  int cols = data->num_cols;
+  for (int i = 0; i < batch; ++i) {
+    int32_t* values = reinterpret_cast<int32_t*>(data->data);
+    uint64_t* hashes = data->hashes.data();
+    for (int j = 0; j < rows; ++j) hashes[j] = HashUtil::FNV_SEED;
+    for (int k = 0; k < cols; ++k) {
+      HashUtil::FastHash64Batch(
+          rows, &values[k], cols * sizeof(int32_t), sizeof(int32_t), hashes);
+    }
+    for (int j = 0; j < rows; ++j) data->results[j] = hashes[j];
+  }
+}
+
 template <bool handle_empty>
 void TestFnvMixedHashTemplate(int batch, void* d) {
   TestData* data = reinterpret_cast<TestData*>(d);
@@ -534,6 +554,7 @@ int main(int argc, char **argv) {
   int_data.data = int_provider.NextBatch(&int_data.num_rows);
   int_data.num_cols = int_cols.size();
   int_data.results.resize(int_data.num_rows);
+  int_data.hashes.resize(int_data.num_rows);
   int_data.jitted_fn = jitted_hash_ints.load();
 
   // Some mixed col types.  The test hash function will know the exact
@@ -564,6 +585,7 @@ int main(int argc, char **argv) {
   int_suite.AddBenchmark("Boost", TestBoostIntHash, &int_data);
   int_suite.AddBenchmark("Crc", TestCrcIntHash, &int_data);
   int_suite.AddBenchmark("Codegen", TestCodegenIntHash, &int_data);
+  int_suite.AddBenchmark("FastHash64Batch", TestFastHashBatchIntHash, &int_data);
   cout << int_suite.Measure() << endl;
 
   Benchmark mixed_suite("Mixed Hash");
@@ -0,0 +1,192 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <iostream>
+#include <boost/scoped_ptr.hpp>
+
+#include "common/init.h"
+#include "common/object-pool.h"
+#include "exprs/scalar-expr-evaluator.h"
+#include "exprs/slot-ref.h"
+#include "runtime/mem-pool.h"
+#include "runtime/mem-tracker.h"
+#include "runtime/row-batch.h"
+#include "runtime/string-value.h"
+#include "runtime/tuple-row.h"
+#include "service/fe-support.h"
+#include "service/frontend.h"
+#include "service/hs2-util.h"
+#include "testutil/desc-tbl-builder.h"
+#include "util/benchmark.h"
+#include "util/cpu-info.h"
+
+#include "common/names.h"
+
+using namespace apache::hive::service::cli;
+using namespace impala;
+
+// Benchmark for converting the output of a query into HS2 columns, which is what the
+// coordinator does for every row fetched by a client with protocol version V6 and up.
+// It compares evaluating the output exprs once per row ('eval', the path taken for any
+// expr) with reading the slots of plain SlotRefs directly from the tuples ('slot_ref').
+// Each iteration converts NUM_BATCHES batches of NUM_ROWS rows into one column, like a
+// fetch of NUM_BATCHES * NUM_ROWS rows does.
+//
+// Before measuring, the benchmark checks that both paths produce the same columns.
+
+static const int NUM_ROWS = 1024;
+static const int NUM_BATCHES = 8;
+static const int MAX_STRING_LEN = 32;
+
+// Layout of the tuples. The INT slot is nullable and uses bit 4 of the first byte as
+// its null indicator, see SlotRef(const ColumnType&, int, bool).
+static const int INT_OFFSET = 4;
+static const int BIGINT_OFFSET = 8;
+static const int DOUBLE_OFFSET = 16;
+static const int STRING_OFFSET = 24;
+static const int TUPLE_SIZE = STRING_OFFSET + sizeof(StringValue);
+
+scoped_ptr<Frontend> fe;
+
+struct TestData {
+  string name;
+  RowBatch* batch;
+  ScalarExprEvaluator* eval;
+  TColumnType type;
+};
+
+static void FillBatch(RowBatch* batch) {
+  MemPool* pool = batch->tuple_data_pool();
+  uint8_t* tuple_mem = pool->Allocate(TUPLE_SIZE * NUM_ROWS);
+  for (int i = 0; i < NUM_ROWS; ++i) {
+    Tuple* tuple = reinterpret_cast<Tuple*>(tuple_mem + i * TUPLE_SIZE);
+    tuple->Init(TUPLE_SIZE);
+    if (rand() % 10 == 0) {
+      tuple->SetNull(NullIndicatorOffset(0, INT_OFFSET));
+    } else {
+      *reinterpret_cast<int32_t*>(tuple->GetSlot(INT_OFFSET)) = rand();
+    }
+    *reinterpret_cast<int64_t*>(tuple->GetSlot(BIGINT_OFFSET)) =
+        static_cast<int64_t>(rand()) * rand();
+    *reinterpret_cast<double*>(tuple->GetSlot(DOUBLE_OFFSET)) = rand() / 7.0;
+    int len = rand() % MAX_STRING_LEN;
+    char* str = reinterpret_cast<char*>(pool->Allocate(len));
+    for (int j = 0; j < len; ++j) str[j] = 'a' + rand() % 26;
+    *reinterpret_cast<StringValue*>(tuple->GetSlot(STRING_OFFSET)) =
+        StringValue(str, len);
+    int row_idx = batch->AddRow();
+    batch->GetRow(row_idx)->SetTuple(0, tuple);
+    batch->CommitLastRow();
+  }
+}
+
+static void ConvertEval(const TestData* data, thrift::TColumn* column) {
+  for (int i = 0; i < NUM_BATCHES; ++i) {
+    EvalExprValuesToHS2TColumn(
+        data->eval, data->type, data->batch, 0, NUM_ROWS, i * NUM_ROWS, column);
+  }
+}
+
+static void ConvertSlotRef(const TestData* data, thrift::TColumn* column) {
+  for (int i = 0; i < NUM_BATCHES; ++i) {
+    bool converted = SlotRefValuesToHS2TColumn(
+        data->eval, data->type, data->batch, 0, NUM_ROWS, i * NUM_ROWS, column);
+    DCHECK(converted);
+  }
+}
+
+// TColumn::operator==() only compares the fields marked as set, which the conversion
+// functions don't do, so compare all of them.
+static bool SameValues(const thrift::TColumn& a, const thrift::TColumn& b) {
+  return a.boolVal == b.boolVal && a.byteVal == b.byteVal && a.i16Val == b.i16Val
+      && a.i32Val == b.i32Val && a.i64Val == b.i64Val && a.doubleVal == b.doubleVal
+      && a.stringVal == b.stringVal;
+}
+
+static void TestEval(int batch_size, void* d) {
+  const TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    thrift::TColumn column;
+    ConvertEval(data, &column);
+  }
+}
+
+static void TestSlotRef(int batch_size, void* d) {
+  const TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    thrift::TColumn column;
+    ConvertSlotRef(data, &column);
+  }
+}
+
+int main(int argc, char** argv) {
+  InitCommonRuntime(argc, argv, true);
+  InitFeSupport();
+  fe.reset(new Frontend());
+  cout << Benchmark::GetMachineInfo() << endl;
+
+  MemTracker tracker;
+  MemPool mem_pool(&tracker);
+  ObjectPool obj_pool;
+  // The tuples are laid out by FillBatch(), the descriptor only provides the shape of
+  // the rows.
+  DescriptorTblBuilder builder(fe.get(), &obj_pool);
+  builder.DeclareTuple() << TYPE_INT;
+  DescriptorTbl* desc_tbl = builder.Build();
+  RowDescriptor row_desc(*desc_tbl, vector<TTupleId>(1, 0), vector<bool>(1, false));
+  RowBatch* batch = obj_pool.Add(new RowBatch(&row_desc, NUM_ROWS, &tracker));
+  FillBatch(batch);
+
+  const pair<ColumnType, int> slots[] = {{ColumnType(TYPE_INT), INT_OFFSET},
+      {ColumnType(TYPE_BIGINT), BIGINT_OFFSET}, {ColumnType(TYPE_DOUBLE), DOUBLE_OFFSET},
+      {ColumnType(TYPE_STRING), STRING_OFFSET}};
+  vector<ScalarExpr*> exprs;
+  vector<ScalarExprEvaluator*> evals;
+  vector<TestData> data;
+  for (const auto& slot : slots) {
+    SlotRef* expr = obj_pool.Add(
+        new SlotRef(slot.first, slot.second, slot.second == INT_OFFSET));
+    ABORT_IF_ERROR(expr->Init(RowDescriptor(), true, nullptr));
+    exprs.push_back(expr);
+    ScalarExprEvaluator* eval;
+    ABORT_IF_ERROR(ScalarExprEvaluator::Create(
+        *expr, nullptr, &obj_pool, &mem_pool, &mem_pool, &eval));
+    ABORT_IF_ERROR(eval->Open(nullptr));
+    evals.push_back(eval);
+    data.push_back({slot.first.DebugString(), batch, eval, slot.first.ToThrift()});
+  }
+
+  for (const TestData& d : data) {
+    thrift::TColumn expected, actual;
+    ConvertEval(&d, &expected);
+    ConvertSlotRef(&d, &actual);
+    CHECK(SameValues(expected, actual)) << "Mismatch for " << d.name;
+  }
+
+  for (TestData& d : data) {
+    Benchmark suite("HS2 " + d.name + " column");
+    int baseline = suite.AddBenchmark("eval", TestEval, &d, -1);
+    suite.AddBenchmark("slot_ref", TestSlotRef, &d, baseline);
+    cout << suite.Measure() << endl;
+  }
+
+  ScalarExprEvaluator::Close(evals, nullptr);
+  ScalarExpr::Close(exprs);
+  batch->Reset();
+  mem_pool.FreeAll();
+  return 0;
+}
@@ -0,0 +1,187 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+#include "util/benchmark.h"
+#include "util/cpu-info.h"
+#include "util/sharded-query-map-util.h"
+#include "util/uid-util.h"
+#include "util/unique-id-hash.h"
+
+#include "common/names.h"
+
+using namespace impala;
+
+// Benchmark for the registries that an ImpalaServer coordinator updates for every query:
+// the session map that is looked up by every client RPC and the map of query locations
+// that every query is registered in and unregistered from on each of its backends.
+//
+// Each thread repeatedly looks up its session, registers a query on all backends and
+// unregisters it again, which mirrors the accesses of RegisterQuery()/UnregisterQuery().
+// "Mutex" protects the maps with a single lock each, as ImpalaServer used to.
+// "Sharded" uses ShardedQueryMap, as ImpalaServer does now.
+//
+// Results are machine dependent. Run with the number of threads of a busy coordinator.
+
+// Number of query lifecycles per thread and iteration.
+static const int QUERIES_PER_ITER = 10;
+
+// Number of backends every query runs on.
+static const int NUM_BACKENDS = 20;
+
+struct Session {
+  mutex lock;
+  int ref_count = 0;
+};
+
+struct TestData {
+  int num_threads;
+  vector<TUniqueId> session_ids;
+  vector<UniqueIdPB> backend_ids;
+};
+
+// The registries of ImpalaServer, each protected by a single mutex.
+struct MutexRegistry {
+  mutex session_lock;
+  std::unordered_map<TUniqueId, shared_ptr<Session>> sessions;
+  mutex locations_lock;
+  std::unordered_map<UniqueIdPB, std::unordered_set<TUniqueId>> locations;
+
+  void AddSession(const TUniqueId& session_id) {
+    lock_guard<mutex> l(session_lock);
+    sessions.emplace(session_id, make_shared<Session>());
+  }
+
+  void RunQuery(const TUniqueId& session_id, const TUniqueId& query_id,
+      const vector<UniqueIdPB>& backend_ids) {
+    shared_ptr<Session> session;
+    {
+      lock_guard<mutex> l(session_lock);
+      session = sessions[session_id];
+      lock_guard<mutex> session_l(session->lock);
+      ++session->ref_count;
+    }
+    {
+      lock_guard<mutex> l(locations_lock);
+      for (const UniqueIdPB& backend_id : backend_ids) {
+        locations[backend_id].insert(query_id);
+      }
+    }
+    {
+      lock_guard<mutex> l(locations_lock);
+      for (const UniqueIdPB& backend_id : backend_ids) {
+        locations[backend_id].erase(query_id);
+      }
+    }
+    lock_guard<mutex> session_l(session->lock);
+    --session->ref_count;
+  }
+};
+
+// The registries of ImpalaServer, sharded by session and backend id.
+struct ShardedRegistry {
+  ShardedQueryMap<shared_ptr<Session>> sessions;
+  ShardedQueryPBMap<std::unordered_set<TUniqueId>> locations;
+
+  void AddSession(const TUniqueId& session_id) {
+    ScopedShardedMapRef<shared_ptr<Session>> map_ref(session_id, &sessions);
+    map_ref->emplace(session_id, make_shared<Session>());
+  }
+
+  void RunQuery(const TUniqueId& session_id, const TUniqueId& query_id,
+      const vector<UniqueIdPB>& backend_ids) {
+    shared_ptr<Session> session;
+    {
+      ScopedShardedMapRef<shared_ptr<Session>> map_ref(session_id, &sessions);
+      session = (*map_ref.get())[session_id];
+      lock_guard<mutex> session_l(session->lock);
+      ++session->ref_count;
+    }
+    for (const UniqueIdPB& backend_id : backend_ids) {
+      ScopedShardedMapPBRef<std::unordered_set<TUniqueId>> map_ref(
+          backend_id, &locations);
+      (*map_ref.get())[backend_id].insert(query_id);
+    }
+    for (const UniqueIdPB& backend_id : backend_ids) {
+      ScopedShardedMapPBRef<std::unordered_set<TUniqueId>> map_ref(
+          backend_id, &locations);
+      (*map_ref.get())[backend_id].erase(query_id);
+    }
+    lock_guard<mutex> session_l(session->lock);
+    --session->ref_count;
+  }
+};
+
+template <typename Registry>
+void RunThreads(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  Registry registry;
+  for (const TUniqueId& session_id : data->session_ids) registry.AddSession(session_id);
+  thread_group threads;
+  for (int i = 0; i < data->num_threads; ++i) {
+    threads.add_thread(new thread([&registry, data, batch_size, i]() {
+      const TUniqueId& session_id = data->session_ids[i];
+      for (int j = 0; j < batch_size * QUERIES_PER_ITER; ++j) {
+        TUniqueId query_id;
+        query_id.hi = session_id.hi;
+        query_id.lo = j;
+        registry.RunQuery(session_id, query_id, data->backend_ids);
+      }
+    }));
+  }
+  threads.join_all();
+}
+
+int main(int argc, char **argv) {
+  CpuInfo::Init();
+  cout << Benchmark::GetMachineInfo() << endl;
+
+  const int max_threads = 32;
+  vector<TUniqueId> session_ids;
+  for (int i = 0; i < max_threads; ++i) session_ids.push_back(GenerateUUID());
+  vector<UniqueIdPB> backend_ids;
+  for (int i = 0; i < NUM_BACKENDS; ++i) {
+    UniqueIdPB backend_id;
+    TUniqueIdToUniqueIdPB(GenerateUUID(), &backend_id);
+    backend_ids.push_back(backend_id);
+  }
+
+  Benchmark suite("query registry", /* micro = */ false);
+  vector<TestData> data;
+  for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    data.push_back({num_threads, session_ids, backend_ids});
+  }
+  for (TestData& d : data) {
+    stringstream suffix;
+    suffix << " " << d.num_threads << "-Threads";
+    int baseline =
+        suite.AddBenchmark("Mutex" + suffix.str(), RunThreads<MutexRegistry>, &d, -1);
+    suite.AddBenchmark(
+        "Sharded" + suffix.str(), RunThreads<ShardedRegistry>, &d, baseline);
+  }
+  cout << suite.Measure() << endl;
+
+  return 0;
+}
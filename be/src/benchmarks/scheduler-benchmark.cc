@@ -34,6 +34,10 @@
 using namespace impala;
 using namespace impala::test;
 
+DECLARE_int32(scheduler_parallel_assignment_threshold);
+DECLARE_int32(scheduler_assignment_threads);
+DECLARE_int64(scheduler_assignment_reuse_window_ms);
+
 
 // This benchmark exercises the core scheduling method 'ComputeScanRangeAssignment()' of
 // the Scheduler class for various cluster and table sizes. It makes the following
@@ -49,6 +53,10 @@ using namespace impala::test;
 //   Scheduling happens on scan ranges, which are issued based on file blocks by the
 //   frontend.
 //
+// The "Large Tables" suites compare assigning 1M+ scan ranges on a single thread
+// ('serial'), on --scheduler_assignment_threads threads ('parallel') and reusing the
+// assignment of the previous iteration ('reuse').
+//
 // Machine Info: Intel(R) Core(TM) i7-4790 CPU @ 3.60GHz
 // Cluster Size, DISK_LOCAL:  Function  iters/ms   10%ile   50%ile   90%ile     10%ile     50%ile     90%ile
 //                                                                          (relative) (relative) (relative)
@@ -87,6 +95,8 @@ static const vector<int> CLUSTER_SIZES = {3, 10, 50, 100, 500, 1000, 3000, 10000
 static const int DEFAULT_CLUSTER_SIZE = 100;
 static const vector<int> NUM_BLOCKS_PER_TABLE = {1, 10, 100, 1000, 10000};
 static const int DEFAULT_NUM_BLOCKS_PER_TABLE = 100;
+static const vector<int> NUM_BLOCKS_PER_LARGE_TABLE = {1000000, 2000000};
+static const int NUM_ASSIGNMENT_THREADS = 8;
 
 /// Members of this struct are needed to build the test fixtures and depend on each other.
 /// Since their constructors take const references they must be constructed in order,
@@ -97,11 +107,18 @@ struct TestCtx {
   std::unique_ptr<Plan> plan;
   std::unique_ptr<Result> result;
   std::unique_ptr<SchedulerWrapper> scheduler_wrapper;
+
+  /// Values of the scheduler flags while running the benchmark. The defaults match the
+  /// defaults of the flags.
+  int parallel_assignment_threshold = 100000;
+  int assignment_threads = 8;
+  int64_t assignment_reuse_window_ms = 0;
 };
 
 /// Initialize a test context for a single benchmark run.
 void InitializeTestCtx(int num_hosts, int num_blocks,
-    TReplicaPreference::type replica_preference, TestCtx* test_ctx) {
+    TReplicaPreference::type replica_preference, TestCtx* test_ctx,
+    bool random_replica = true) {
   test_ctx->cluster.reset(new Cluster());
   test_ctx->cluster->AddHosts(num_hosts, true, true);
 
@@ -110,7 +127,7 @@ void InitializeTestCtx(int num_hosts, int num_blocks,
 
   test_ctx->plan.reset(new Plan(*test_ctx->schema));
   test_ctx->plan->SetReplicaPreference(replica_preference);
-  test_ctx->plan->SetRandomReplica(true);
+  test_ctx->plan->SetRandomReplica(random_replica);
   test_ctx->plan->AddTableScan("T0");
 
   test_ctx->result.reset(new Result(*test_ctx->plan));
@@ -122,6 +139,9 @@ void InitializeTestCtx(int num_hosts, int num_blocks,
 /// repeatedly.
 void BenchmarkFunction(int num_iterations, void* data) {
   TestCtx* test_ctx = static_cast<TestCtx*>(data);
+  FLAGS_scheduler_parallel_assignment_threshold = test_ctx->parallel_assignment_threshold;
+  FLAGS_scheduler_assignment_threads = test_ctx->assignment_threads;
+  FLAGS_scheduler_assignment_reuse_window_ms = test_ctx->assignment_reuse_window_ms;
   for (int i = 0; i < num_iterations; ++i) {
     test_ctx->result->Reset();
     Status status = test_ctx->scheduler_wrapper->Compute(test_ctx->result.get());
@@ -162,6 +182,31 @@ void RunNumBlocksBenchmark(TReplicaPreference::type replica_preference) {
   cout << suite.Measure() << endl;
 }
 
+/// Build and run a benchmark suite for a table with 'num_blocks' blocks on the default
+/// cluster size that compares serial, parallel and reused assignments. Replicas are not
+/// picked randomly, since that prevents reusing assignments.
+void RunLargeTableBenchmark(int num_blocks) {
+  string suite_name = strings::Substitute("Large Tables, $0 Blocks", num_blocks);
+  Benchmark suite(suite_name, false /* micro_heuristics */);
+  // All contexts schedule the same plan, which is only built once. Each of them has
+  // its own scheduler, so only 'reuse' can reuse assignments.
+  TestCtx test_ctx[3];
+  InitializeTestCtx(DEFAULT_CLUSTER_SIZE, num_blocks, TReplicaPreference::DISK_LOCAL,
+      &test_ctx[0], false /* random_replica */);
+  test_ctx[0].parallel_assignment_threshold = 0;
+  for (int i = 1; i < 3; ++i) {
+    test_ctx[i].result.reset(new Result(*test_ctx[0].plan));
+    test_ctx[i].scheduler_wrapper.reset(new SchedulerWrapper(*test_ctx[0].plan));
+    test_ctx[i].parallel_assignment_threshold = 1;
+    test_ctx[i].assignment_threads = NUM_ASSIGNMENT_THREADS;
+  }
+  test_ctx[2].assignment_reuse_window_ms = 60 * 1000;
+  int baseline = suite.AddBenchmark("serial", BenchmarkFunction, &test_ctx[0], -1);
+  suite.AddBenchmark("parallel", BenchmarkFunction, &test_ctx[1], baseline);
+  suite.AddBenchmark("reuse", BenchmarkFunction, &test_ctx[2], baseline);
+  cout << suite.Measure() << endl;
+}
+
 int main(int argc, char** argv) {
   impala::InitCommonRuntime(argc, argv, true, impala::TestInfo::BE_TEST);
   impala::InitFeSupport();
@@ -171,4 +216,5 @@ int main(int argc, char** argv) {
   RunClusterSizeBenchmark(TReplicaPreference::DISK_LOCAL);
   RunClusterSizeBenchmark(TReplicaPreference::REMOTE);
   RunNumBlocksBenchmark(TReplicaPreference::DISK_LOCAL);
+  for (int num_blocks : NUM_BLOCKS_PER_LARGE_TABLE) RunLargeTableBenchmark(num_blocks);
 }
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <iostream>
+#include <sstream>
 #include "util/benchmark.h"
 #include "util/cpu-info.h"
 #include "runtime/string-search.h"
@@ -37,6 +38,10 @@ using namespace impala;
 //                           LibC               262.2              3.201X
 //            Null Terminated SSE               212.4              2.592X
 //        Non-null Terminated SSE               139.6              1.704X
+//
+// "AVX2" and "SSE4.2" call the SIMD kernels of StringSearch directly. "StringSearch"
+// runs StringSearch::Search(), which picks one of them based on the CPU. The "log
+// lines" suite searches for a short word in longer strings, as in LIKE '%error%'.
 
 struct TestData {
   vector<StringValue> needles;
@@ -63,6 +68,23 @@ void TestLibc(int batch_size, void* d) {
 }
 
 void TestPython(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    data->matches = 0;
+    for (int n = 0; n < data->needles.size(); ++n) {
+      StringSearch needle(&(data->needles[n]));
+      for (int iters = 0; iters < 10; ++iters) {
+        for (int h = 0; h < data->haystacks.size(); ++h) {
+          if (needle.SearchBoyerMooreHorspool(&(data->haystacks[h])) != -1) {
+            ++data->matches;
+          }
+        }
+      }
+    }
+  }
+}
+
+void TestStringSearch(int batch_size, void* d) {
   TestData* data = reinterpret_cast<TestData*>(d);
   for (int i = 0; i < batch_size; ++i) {
     data->matches = 0;
@@ -79,6 +101,25 @@ void TestPython(int batch_size, void* d) {
   }
 }
 
+template <int (*SEARCH_FN)(const char*, int, const char*, int)>
+void TestSimd(int batch_size, void* d) {
+  TestData* data = reinterpret_cast<TestData*>(d);
+  for (int i = 0; i < batch_size; ++i) {
+    data->matches = 0;
+    for (int n = 0; n < data->needles.size(); ++n) {
+      const StringValue& needle = data->needles[n];
+      for (int iters = 0; iters < 10; ++iters) {
+        for (int h = 0; h < data->haystacks.size(); ++h) {
+          const StringValue& haystack = data->haystacks[h];
+          if (SEARCH_FN(haystack.ptr, haystack.len, needle.ptr, needle.len) != -1) {
+            ++data->matches;
+          }
+        }
+      }
+    }
+  }
+}
+
 void TestImpalaNullTerminated(int batch_size, void* d) {
   TestData* data = reinterpret_cast<TestData*>(d);
   for (int i = 0; i < batch_size; ++i) {
@@ -115,6 +156,22 @@ void TestImpalaNonNullTerminated(int batch_size, void* d) {
   }
 }
 
+void AddTestStrings(const vector<string>& needles, const vector<string>& haystacks,
+    TestData* data) {
+  // Reserve the space so that the StringValues keep pointing to valid strings.
+  data->strings.reserve(needles.size() + haystacks.size());
+  for (int i = 0; i < needles.size(); ++i) {
+    data->strings.push_back(needles[i]);
+    StringValue v(const_cast<char*>(data->strings.back().c_str()), needles[i].size());
+    data->needles.push_back(v);
+  }
+  for (int i = 0; i < haystacks.size(); ++i) {
+    data->strings.push_back(haystacks[i]);
+    StringValue v(const_cast<char*>(data->strings.back().c_str()), haystacks[i].size());
+    data->haystacks.push_back(v);
+  }
+}
+
 // This should be tailored to represent the data we expect.
 // Some algos are better suited for longer vs shorter needles, finding the string vs.
 // not finding the string, etc.
@@ -149,16 +206,39 @@ void InitTestData(TestData* data) {
   haystacks.push_back("tQJzS0SiXRElwq1QEBhy0gGGii9xAcQbTIrt4QcGMViyOx4lfZ73zZ5XHxyzk1V");
   haystacks.push_back("tQJzS0SiXRElwq1QEBhy0gGGii9xAcQbTIrt4QcGMViyOx4lfZ73zZ5XHyzaxyz");
 
-  for (int i = 0; i < needles.size(); ++i) {
-    StringValue v(const_cast<char*>(needles[i].c_str()), needles[i].size());
-    data->needles.push_back(v);
-    data->strings.push_back(needles[i]);
+  AddTestStrings(needles, haystacks, data);
+}
+
+// Log lines of a few hundred bytes, of which one in four contains the needle.
+void InitLogTestData(TestData* data) {
+  vector<string> needles;
+  vector<string> haystacks;
+
+  needles.push_back("error");
+
+  const char* components[] = {"impalad", "catalogd", "statestored", "admissiond"};
+  for (int i = 0; i < 64; ++i) {
+    stringstream line;
+    line << "I1018 12:" << (10 + i % 50) << ":07.123456 " << (20000 + i * 37)
+         << " " << components[i % 4] << ".cc:" << (100 + i * 13) << "] "
+         << "Query id=" << std::hex << (0x5a3f00000000 + i * 7919) << std::dec
+         << " fragment instance finished, rows produced=" << i * 1000
+         << ", peak memory=" << i * 3 << "MB, status="
+         << (i % 4 == 3 ? "error: memory limit exceeded" : "ok, no warnings")
+         << ", coordinator=host-" << i % 16 << ".example.com:27000";
+    haystacks.push_back(line.str());
   }
-  for (int i = 0; i < haystacks.size(); ++i) {
-    StringValue v(const_cast<char*>(haystacks[i].c_str()), haystacks[i].size());
-    data->haystacks.push_back(v);
-    data->strings.push_back(haystacks[i]);
+  AddTestStrings(needles, haystacks, data);
+}
+
+void AddSimdBenchmarks(Benchmark* suite, TestData* data) {
+  if (CpuInfo::IsSupported(CpuInfo::AVX2)) {
+    suite->AddBenchmark("AVX2", TestSimd<StringSearch::SearchAvx2>, data);
+  }
+  if (CpuInfo::IsSupported(CpuInfo::SSE4_2)) {
+    suite->AddBenchmark("SSE4.2", TestSimd<StringSearch::SearchSse42>, data);
   }
+  suite->AddBenchmark("StringSearch", TestStringSearch, data);
 }
 
 int main(int argc, char **argv) {
@@ -173,7 +253,16 @@ int main(int argc, char **argv) {
   suite.AddBenchmark("LibC", TestLibc, &data);
   suite.AddBenchmark("Null Terminated SSE", TestImpalaNullTerminated, &data);
   suite.AddBenchmark("Non-null Terminated SSE", TestImpalaNonNullTerminated, &data);
+  AddSimdBenchmarks(&suite, &data);
   cout << suite.Measure();
 
+  TestData log_data;
+  InitLogTestData(&log_data);
+  Benchmark log_suite("String Search log lines");
+  log_suite.AddBenchmark("Python", TestPython, &log_data);
+  log_suite.AddBenchmark("LibC", TestLibc, &log_data);
+  AddSimdBenchmarks(&log_suite, &log_data);
+  cout << log_suite.Measure();
+
   return 0;
 }
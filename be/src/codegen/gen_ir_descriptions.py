@@ -133,6 +133,8 @@ ir_functions = [
    "_ZN6impala18AggregateFunctions8HllMergeEPN10impala_udf15FunctionContextERKNS1_9StringValEPS4_"],
   ["DECODE_AVRO_DATA",
    "_ZN6impala15HdfsAvroScanner14DecodeAvroDataEiPNS_7MemPoolEPPhS3_PNS_5TupleEPNS_8TupleRowE"],
+  ["AVRO_NUM_FILE_FIELDS",
+   "_ZN6impala15HdfsAvroScanner13NumFileFieldsEv"],
   ["READ_UNION_TYPE",
    "_ZN6impala15HdfsAvroScanner13ReadUnionTypeEiPPhS1_Pb"],
   ["READ_AVRO_BOOLEAN",
@@ -229,6 +231,8 @@ ir_functions = [
   "_ZN6impala20KrpcDataStreamSender25GetPartitionExprEvaluatorEi"],
   ["KRPC_DSS_HASH_AND_ADD_ROWS",
   "_ZN6impala20KrpcDataStreamSender14HashAndAddRowsEPNS_8RowBatchE"],
+  ["OR_PREDICATE_EVAL_PATTERN_SET",
+  "_ZN6impala11OrPredicate14EvalPatternSetEPNS_19ScalarExprEvaluatorEPKNS_8TupleRowEi"],
   ["GET_FUNCTION_CTX",
   "_ZN6impala11HiveUdfCall18GetFunctionContextEPNS_19ScalarExprEvaluatorEi"],
   ["GET_JNI_CONTEXT",
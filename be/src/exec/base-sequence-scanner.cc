@@ -179,6 +179,13 @@ Status BaseSequenceScanner::GetNextInternal(RowBatch* row_batch) {
     return status;
   }
   if (eos_) return Status::OK();
+  // Skip the rest of the scan range if a runtime filter that arrived after it was
+  // started rules out this partition. Header ranges are always processed above, since
+  // they issue the file's data ranges.
+  if (!PartitionPassesLateFilters()) {
+    eos_ = true;
+    return Status::OK();
+  }
 
   int64_t tuple_buffer_size;
   RETURN_IF_ERROR(
@@ -0,0 +1,236 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+#include <gflags/gflags.h>
+#include <gutil/strings/substitute.h>
+
+#include "exec/decompression-pipeline.h"
+#include "gen-cpp/ErrorCodes_types.h"
+#include "runtime/mem-pool.h"
+#include "runtime/mem-tracker.h"
+#include "testutil/gtest-util.h"
+#include "util/codec.h"
+
+#include "common/names.h"
+
+DECLARE_int64(text_decompression_pipeline_min_file_size);
+DECLARE_int32(text_decompression_pipeline_max_queued_buffers);
+
+namespace impala {
+
+class DecompressionPipelineTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    // Rows of a text file with enough variation that the compressed data spans many
+    // input buffers.
+    for (int i = 0; text_.size() < 1024 * 1024; ++i) {
+      text_ += Substitute("$0,row $1,$2\n", i, i * 7919 % 104729, i % 13 == 0);
+    }
+    scoped_ptr<Codec> compressor;
+    ASSERT_OK(Codec::CreateCompressor(&pool_, false, THdfsCompression::GZIP,
+        &compressor));
+    int64_t compressed_len = 0;
+    uint8_t* compressed = nullptr;
+    ASSERT_OK(compressor->ProcessBlock(false, text_.size(),
+        reinterpret_cast<const uint8_t*>(text_.data()), &compressed_len, &compressed));
+    compressed_.assign(compressed, compressed + compressed_len);
+    compressor->Close();
+  }
+
+  virtual void TearDown() {
+    pool_.FreeAll();
+    mem_tracker_.Close();
+  }
+
+  /// Decompresses 'compressed' with a pipeline the way HdfsTextScanner does: whenever
+  /// the pipeline needs input, the next 'input_buffer_size' bytes are added. Appends
+  /// the decompressed data to 'output' and returns the first error.
+  Status Decompress(const vector<uint8_t>& compressed, int input_buffer_size,
+      int max_queued_buffers, string* output, int* num_buffers = nullptr) {
+    DecompressionPipeline pipeline("test-file", &mem_tracker_, max_queued_buffers,
+        nullptr);
+    Status status = pipeline.Start(THdfsCompression::GZIP, "test-decompress");
+    int64_t offset = 0;
+    bool eos = false;
+    if (num_buffers != nullptr) *num_buffers = 0;
+    while (status.ok() && !eos) {
+      uint8_t* buffer;
+      int64_t len;
+      bool needs_input;
+      status = pipeline.GetNext(&pool_, &buffer, &len, &eos, &needs_input);
+      if (!status.ok()) break;
+      if (needs_input) {
+        const int64_t input_len =
+            min<int64_t>(input_buffer_size, compressed.size() - offset);
+        status = pipeline.AddInput(compressed.data() + offset, input_len,
+            offset + input_len == compressed.size());
+        offset += input_len;
+        continue;
+      }
+      output->append(reinterpret_cast<char*>(buffer), len);
+      if (num_buffers != nullptr) ++*num_buffers;
+    }
+    pipeline.Close();
+    return status;
+  }
+
+  MemTracker mem_tracker_;
+  MemPool pool_{&mem_tracker_};
+
+  /// Uncompressed and gzip-compressed test data.
+  string text_;
+  vector<uint8_t> compressed_;
+};
+
+// Only large enough files with a streaming codec are decompressed on a separate thread.
+TEST_F(DecompressionPipelineTest, ShouldUse) {
+  const int64_t old_min_file_size = FLAGS_text_decompression_pipeline_min_file_size;
+  scoped_ptr<Codec> gzip;
+  ASSERT_OK(Codec::CreateDecompressor(&pool_, false, THdfsCompression::GZIP, &gzip));
+  scoped_ptr<Codec> snappy;
+  ASSERT_OK(Codec::CreateDecompressor(
+      &pool_, false, THdfsCompression::SNAPPY_BLOCKED, &snappy));
+  ASSERT_FALSE(snappy->supports_streaming());
+
+  FLAGS_text_decompression_pipeline_min_file_size = 1024;
+  EXPECT_FALSE(DecompressionPipeline::ShouldUse(nullptr, 1L << 30));
+  EXPECT_FALSE(DecompressionPipeline::ShouldUse(snappy.get(), 1L << 30));
+  EXPECT_FALSE(DecompressionPipeline::ShouldUse(gzip.get(), 1023));
+  EXPECT_TRUE(DecompressionPipeline::ShouldUse(gzip.get(), 1024));
+  EXPECT_TRUE(DecompressionPipeline::ShouldUse(gzip.get(), 1L << 30));
+
+  FLAGS_text_decompression_pipeline_min_file_size = 0;
+  EXPECT_TRUE(DecompressionPipeline::ShouldUse(gzip.get(), 0));
+
+  // A negative value disables the pipeline.
+  FLAGS_text_decompression_pipeline_min_file_size = -1;
+  EXPECT_FALSE(DecompressionPipeline::ShouldUse(gzip.get(), 1L << 30));
+
+  FLAGS_text_decompression_pipeline_min_file_size = old_min_file_size;
+  gzip->Close();
+  snappy->Close();
+}
+
+// Buffers are returned in file order for any input buffer size and queue depth.
+TEST_F(DecompressionPipelineTest, InOrder) {
+  const int default_max_queued_buffers =
+      FLAGS_text_decompression_pipeline_max_queued_buffers;
+  for (int max_queued_buffers : {1, default_max_queued_buffers}) {
+    for (int input_buffer_size : {1, 4 * 1024, 1024 * 1024}) {
+      // Decompressing one byte at a time is too slow for the whole file.
+      vector<uint8_t> compressed = compressed_;
+      string expected = text_;
+      if (input_buffer_size == 1) {
+        string small_text = text_.substr(0, 4 * 1024);
+        scoped_ptr<Codec> compressor;
+        ASSERT_OK(Codec::CreateCompressor(&pool_, false, THdfsCompression::GZIP,
+            &compressor));
+        int64_t len = 0;
+        uint8_t* data = nullptr;
+        ASSERT_OK(compressor->ProcessBlock(false, small_text.size(),
+            reinterpret_cast<const uint8_t*>(small_text.data()), &len, &data));
+        compressed.assign(data, data + len);
+        expected = small_text;
+        compressor->Close();
+      }
+      string output;
+      int num_buffers;
+      ASSERT_OK(Decompress(compressed, input_buffer_size, max_queued_buffers, &output,
+          &num_buffers));
+      EXPECT_TRUE(output == expected) << "max_queued_buffers=" << max_queued_buffers
+          << " input_buffer_size=" << input_buffer_size;
+      // The last buffer is empty and only marks the end of the file.
+      EXPECT_GT(num_buffers, 1);
+      pool_.FreeAll();
+    }
+  }
+}
+
+// Several concatenated gzip streams are decompressed like a single one.
+TEST_F(DecompressionPipelineTest, MultipleStreams) {
+  vector<uint8_t> compressed = compressed_;
+  compressed.insert(compressed.end(), compressed_.begin(), compressed_.end());
+  string output;
+  ASSERT_OK(Decompress(compressed, 64 * 1024, 2, &output));
+  EXPECT_TRUE(output == text_ + text_);
+}
+
+// A file that ends in the middle of a compressed stream is reported as truncated.
+TEST_F(DecompressionPipelineTest, Truncated) {
+  vector<uint8_t> compressed(compressed_.begin(), compressed_.end() - 100);
+  string output;
+  EXPECT_ERROR(Decompress(compressed, 64 * 1024, 2, &output),
+      TErrorCode::COMPRESSED_FILE_TRUNCATED);
+  // Everything before the truncated part was returned.
+  EXPECT_GT(output.size(), 0);
+  EXPECT_EQ(0, text_.compare(0, output.size(), output));
+}
+
+// Corrupt data in the middle of the file fails the pipeline after the buffers that were
+// decompressed before it were returned.
+TEST_F(DecompressionPipelineTest, CorruptedMidStream) {
+  // A valid gzip stream followed by data without a gzip header.
+  vector<uint8_t> compressed = compressed_;
+  compressed.insert(compressed.end(), 1024, 0xff);
+  string output;
+  Status status = Decompress(compressed, 16 * 1024, 2, &output);
+  EXPECT_EQ(TErrorCode::COMPRESSED_FILE_BLOCK_CORRUPTED, status.code());
+  EXPECT_NE(string::npos, status.GetDetail().find("test-file"));
+  EXPECT_GT(output.size(), 0);
+  EXPECT_EQ(0, text_.compare(0, output.size(), output));
+}
+
+// Close() stops the decompression thread at any point: while it waits for input, while
+// it waits for the scanner to take buffers from a full queue, and in between.
+TEST_F(DecompressionPipelineTest, Close) {
+  {
+    DecompressionPipeline pipeline("test-file", &mem_tracker_, 1, nullptr);
+    ASSERT_OK(pipeline.Start(THdfsCompression::GZIP, "test-decompress"));
+    pipeline.Close();
+    pipeline.Close();
+  }
+  {
+    // Queue all input but never take any output.
+    DecompressionPipeline pipeline("test-file", &mem_tracker_, 1, nullptr);
+    ASSERT_OK(pipeline.Start(THdfsCompression::GZIP, "test-decompress"));
+    const int64_t half = compressed_.size() / 2;
+    uint8_t* buffer;
+    int64_t len;
+    bool eos;
+    bool needs_input;
+    ASSERT_OK(pipeline.GetNext(&pool_, &buffer, &len, &eos, &needs_input));
+    ASSERT_TRUE(needs_input);
+    ASSERT_OK(pipeline.AddInput(compressed_.data(), half, false));
+    ASSERT_OK(pipeline.GetNext(&pool_, &buffer, &len, &eos, &needs_input));
+    ASSERT_TRUE(needs_input);
+    ASSERT_OK(pipeline.AddInput(
+        compressed_.data() + half, compressed_.size() - half, true));
+    // Take one buffer so that the decompression thread is known to be running.
+    ASSERT_OK(pipeline.GetNext(&pool_, &buffer, &len, &eos, &needs_input));
+    ASSERT_FALSE(needs_input);
+    ASSERT_FALSE(eos);
+    pipeline.Close();
+  }
+  pool_.FreeAll();
+  // All buffers that were not returned were freed.
+  EXPECT_EQ(0, mem_tracker_.consumption());
+}
+}
@@ -0,0 +1,271 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "exec/decompression-pipeline.h"
+
+#include <cstring>
+#include <gflags/gflags.h>
+#include <gutil/strings/substitute.h>
+
+#include "gen-cpp/ErrorCodes_types.h"
+#include "runtime/fragment-instance-state.h"
+#include "runtime/mem-pool.h"
+#include "runtime/mem-tracker.h"
+#include "util/codec.h"
+#include "util/thread.h"
+
+#include "common/names.h"
+
+DEFINE_int64(text_decompression_pipeline_min_file_size, 64L * 1024L * 1024L,
+    "(Advanced) Compressed text files of at least this many bytes are decompressed on "
+    "a separate thread, overlapping decompression with parsing, if a spare scanner "
+    "thread token is available. Only applies to codecs that support streaming "
+    "decompression (e.g. gzip, bzip2, zstd). A negative value disables the pipeline.");
+DEFINE_int32(text_decompression_pipeline_max_queued_buffers, 4,
+    "(Advanced) Maximum number of decompressed buffers per file that the text "
+    "decompression thread may get ahead of the scanner thread.");
+
+using namespace impala;
+
+DecompressionPipeline::DecompressionPipeline(const string& filename,
+    MemTracker* mem_tracker, int max_queued_buffers,
+    RuntimeProfile::Counter* decompress_timer)
+  : filename_(filename),
+    mem_tracker_(mem_tracker),
+    max_queued_buffers_(max_queued_buffers),
+    decompress_timer_(decompress_timer),
+    decompressor_pool_(new MemPool(mem_tracker)) {
+  DCHECK_GT(max_queued_buffers_, 0);
+}
+
+DecompressionPipeline::~DecompressionPipeline() {
+  DCHECK(decompress_thread_ == nullptr) << "Must call Close()";
+  DCHECK(decompressor_ == nullptr);
+}
+
+bool DecompressionPipeline::ShouldUse(const Codec* decompressor, int64_t file_length) {
+  if (decompressor == nullptr || !decompressor->supports_streaming()) return false;
+  return FLAGS_text_decompression_pipeline_min_file_size >= 0
+      && file_length >= FLAGS_text_decompression_pipeline_min_file_size;
+}
+
+Status DecompressionPipeline::Start(THdfsCompression::type compression,
+    const string& thread_name) {
+  DCHECK(decompress_thread_ == nullptr);
+  RETURN_IF_ERROR(Codec::CreateDecompressor(
+      decompressor_pool_.get(), false, compression, &decompressor_));
+  DCHECK(decompressor_->supports_streaming());
+  return Thread::Create(FragmentInstanceState::FINST_THREAD_GROUP_NAME, thread_name,
+      &DecompressionPipeline::DecompressLoop, this, &decompress_thread_, true);
+}
+
+void DecompressionPipeline::DecompressLoop() {
+  Status status = Decompress();
+  lock_guard<mutex> l(lock_);
+  if (!status.ok()) status_ = status;
+  producer_done_ = true;
+  consumer_cv_.NotifyOne();
+}
+
+Status DecompressionPipeline::Decompress() {
+  // Compressed bytes that the decompressor did not consume yet start at
+  // 'input.data + input_offset'.
+  Buffer input;
+  input.pool.reset(new MemPool(mem_tracker_));
+  int64_t input_offset = 0;
+  // True if the last call to the decompressor that made progress ended at the end of a
+  // compressed stream.
+  bool stream_end = false;
+  Status status;
+  while (true) {
+    Buffer output;
+    output.pool.reset(new MemPool(mem_tracker_));
+    int64_t bytes_read = 0;
+    bool output_stream_end = false;
+    if (input_offset < input.len) {
+      SCOPED_TIMER(decompress_timer_);
+      status = decompressor_->ProcessBlockStreaming(input.len - input_offset,
+          input.data + input_offset, &bytes_read, &output.len, &output.data,
+          &output_stream_end);
+      // The output buffer is not reused by 'decompressor_', so hand it to 'output'.
+      output.pool->AcquireData(decompressor_pool_.get(), false);
+    }
+    if (!status.ok()) {
+      output.pool->FreeAll();
+      status.AddDetail(Substitute("file=$0", filename_));
+      break;
+    }
+    input_offset += bytes_read;
+    if (bytes_read > 0 || output.len > 0) stream_end = output_stream_end;
+    if (output.len > 0) {
+      if (!AddOutput(&output)) break;
+      // The decompressor may have more output for the input it consumed.
+      continue;
+    }
+    output.pool->FreeAll();
+    if (bytes_read > 0 && input_offset < input.len) continue;
+
+    // The decompressor needs more input to make progress.
+    if (input.eos) {
+      if (!stream_end || input_offset < input.len) {
+        status = Status(TErrorCode::COMPRESSED_FILE_TRUNCATED, filename_);
+        break;
+      }
+      Buffer last;
+      last.eos = true;
+      last.pool.reset(new MemPool(mem_tracker_));
+      AddOutput(&last);
+      break;
+    }
+    bool cancelled = false;
+    status = GetInput(&input, &input_offset, &cancelled);
+    if (cancelled || !status.ok()) break;
+  }
+  input.pool->FreeAll();
+  return status;
+}
+
+Status DecompressionPipeline::GetInput(
+    Buffer* input, int64_t* input_offset, bool* cancelled) {
+  Buffer next;
+  {
+    unique_lock<mutex> l(lock_);
+    while (!shutdown_ && input_queue_.empty()) producer_cv_.Wait(l);
+    if (shutdown_) {
+      *cancelled = true;
+      return Status::OK();
+    }
+    next = move(input_queue_.front());
+    input_queue_.pop_front();
+    consumer_cv_.NotifyOne();
+  }
+  const int64_t remaining = input->len - *input_offset;
+  if (remaining > 0) {
+    // The decompressor could not make progress with the end of the previous buffer,
+    // e.g. because it ends in the middle of a block header. Prepend it to 'next'.
+    const int64_t len = remaining + next.len;
+    uint8_t* data = next.pool->TryAllocate(len);
+    if (UNLIKELY(data == nullptr)) {
+      next.pool->FreeAll();
+      return mem_tracker_->MemLimitExceeded(nullptr,
+          Substitute("Could not allocate $0 bytes to decompress $1", len, filename_),
+          len);
+    }
+    memcpy(data, input->data + *input_offset, remaining);
+    if (next.len > 0) memcpy(data + remaining, next.data, next.len);
+    next.data = data;
+    next.len = len;
+  }
+  input->pool->FreeAll();
+  *input = move(next);
+  *input_offset = 0;
+  return Status::OK();
+}
+
+bool DecompressionPipeline::AddOutput(Buffer* buffer) {
+  unique_lock<mutex> l(lock_);
+  while (!shutdown_
+      && output_queue_.size() >= static_cast<size_t>(max_queued_buffers_)) {
+    producer_cv_.Wait(l);
+  }
+  if (shutdown_) {
+    buffer->pool->FreeAll();
+    return false;
+  }
+  output_queue_.push_back(move(*buffer));
+  consumer_cv_.NotifyOne();
+  return true;
+}
+
+Status DecompressionPipeline::GetNext(
+    MemPool* pool, uint8_t** buffer, int64_t* len, bool* eos, bool* needs_input) {
+  DCHECK(decompress_thread_ != nullptr);
+  *needs_input = false;
+  unique_lock<mutex> l(lock_);
+  while (true) {
+    // Keep the decompression thread supplied with input before waiting for output.
+    if (!producer_done_ && !input_eos_
+        && input_queue_.size() < static_cast<size_t>(MAX_QUEUED_INPUT_BUFFERS)) {
+      *needs_input = true;
+      return Status::OK();
+    }
+    if (!output_queue_.empty()) break;
+    if (producer_done_) {
+      // The decompression thread exits without an error only after queueing the last
+      // buffer, which the caller should not read past.
+      DCHECK(!status_.ok());
+      return status_;
+    }
+    consumer_cv_.Wait(l);
+  }
+  Buffer& next = output_queue_.front();
+  *buffer = next.data;
+  *len = next.len;
+  *eos = next.eos;
+  pool->AcquireData(next.pool.get(), false);
+  output_queue_.pop_front();
+  producer_cv_.NotifyOne();
+  return Status::OK();
+}
+
+Status DecompressionPipeline::AddInput(const uint8_t* data, int64_t len, bool eos) {
+  Buffer input;
+  input.pool.reset(new MemPool(mem_tracker_));
+  if (len > 0) {
+    input.data = input.pool->TryAllocate(len);
+    if (UNLIKELY(input.data == nullptr)) {
+      return mem_tracker_->MemLimitExceeded(nullptr,
+          Substitute("Could not allocate $0 bytes to decompress $1", len, filename_),
+          len);
+    }
+    memcpy(input.data, data, len);
+  }
+  input.len = len;
+  input.eos = eos;
+  lock_guard<mutex> l(lock_);
+  DCHECK(!input_eos_);
+  input_eos_ = eos;
+  if (producer_done_) {
+    // Decompression failed, GetNext() will return the error.
+    input.pool->FreeAll();
+    return Status::OK();
+  }
+  input_queue_.push_back(move(input));
+  producer_cv_.NotifyOne();
+  return Status::OK();
+}
+
+void DecompressionPipeline::Close() {
+  if (decompress_thread_ != nullptr) {
+    {
+      lock_guard<mutex> l(lock_);
+      shutdown_ = true;
+      producer_cv_.NotifyOne();
+    }
+    decompress_thread_->Join();
+    decompress_thread_.reset();
+  }
+  for (deque<Buffer>* queue : {&input_queue_, &output_queue_}) {
+    for (Buffer& buffer : *queue) buffer.pool->FreeAll();
+    queue->clear();
+  }
+  if (decompressor_ != nullptr) {
+    decompressor_->Close();
+    decompressor_.reset();
+  }
+  decompressor_pool_->FreeAll();
+}
@@ -0,0 +1,173 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <boost/scoped_ptr.hpp>
+
+#include "common/status.h"
+#include "gen-cpp/CatalogObjects_types.h"
+#include "util/condition-variable.h"
+#include "util/runtime-profile.h"
+
+namespace impala {
+
+class Codec;
+class MemPool;
+class MemTracker;
+class Thread;
+
+/// Decompresses a compressed, non-splittable file on a dedicated thread so that
+/// decompression overlaps with parsing and materialization in the scanner thread.
+/// Without it, a single large compressed file is decompressed and parsed serially by
+/// one scanner thread.
+///
+/// All I/O stays on the scanner thread: ScannerContext::Stream is not thread-safe, so
+/// the scanner reads compressed buffers from its stream and passes copies of them to
+/// AddInput(). The decompression thread only touches its own decompressor and the
+/// buffers in the two queues below, which are protected by 'lock_':
+/// - compressed input added by AddInput(), at most MAX_QUEUED_INPUT_BUFFERS entries;
+/// - decompressed output returned by GetNext(), at most 'max_queued_buffers' entries.
+/// Each buffer is backed by its own MemPool, so that ownership of its memory moves
+/// between the threads without sharing a MemPool.
+///
+/// The scanner thread drives the pipeline by calling GetNext() until it returns the
+/// last buffer. GetNext() asks for more input whenever the input queue has room, so
+/// the decompression thread does not run dry while the scanner parses.
+///
+/// Only codecs that support ProcessBlockStreaming() can be pipelined. The pipeline
+/// creates its own decompressor that never reuses output buffers, since buffers handed
+/// to the scanner may still be referenced while later buffers are decompressed.
+class DecompressionPipeline {
+ public:
+  /// 'filename' is used in error messages. 'decompress_timer' is updated from the
+  /// decompression thread.
+  DecompressionPipeline(const std::string& filename, MemTracker* mem_tracker,
+      int max_queued_buffers, RuntimeProfile::Counter* decompress_timer);
+  ~DecompressionPipeline();
+
+  /// Returns true if a file of 'file_length' bytes that is decompressed by
+  /// 'decompressor' is large enough to be worth a decompression thread, according to
+  /// --text_decompression_pipeline_min_file_size. 'decompressor' may be nullptr for
+  /// uncompressed files.
+  static bool ShouldUse(const Codec* decompressor, int64_t file_length);
+
+  /// Creates the decompressor for 'compression' and starts the decompression thread.
+  /// If this fails, the pipeline must not be used and the caller should decompress
+  /// serially instead. Close() must be called in either case.
+  Status Start(THdfsCompression::type compression, const std::string& thread_name)
+      WARN_UNUSED_RESULT;
+
+  /// Returns the next decompressed buffer in '*buffer' and '*len', blocking until one
+  /// is available. Ownership of the memory backing the buffer is transferred to
+  /// 'pool'. Sets '*eos' to true if this is the last buffer of the file.
+  ///
+  /// If the decompression thread can take more compressed input, returns without a
+  /// buffer and sets '*needs_input' to true instead. The caller must then call
+  /// AddInput() before calling GetNext() again.
+  ///
+  /// Returns an error if decompression failed. Buffers decompressed before the error
+  /// are returned first.
+  Status GetNext(MemPool* pool, uint8_t** buffer, int64_t* len, bool* eos,
+      bool* needs_input) WARN_UNUSED_RESULT;
+
+  /// Queues a copy of the 'len' bytes of compressed data at 'data' for decompression.
+  /// 'eos' must be true for the last input buffer of the file. Only valid after
+  /// GetNext() set '*needs_input'. Returns an error if the copy cannot be allocated.
+  Status AddInput(const uint8_t* data, int64_t len, bool eos) WARN_UNUSED_RESULT;
+
+  /// Stops the decompression thread and waits for it to exit. Frees any buffers that
+  /// were not returned by GetNext(). Idempotent.
+  void Close();
+
+  /// Maximum number of compressed buffers that may be queued for the decompression
+  /// thread.
+  static const int MAX_QUEUED_INPUT_BUFFERS = 2;
+
+ private:
+  /// A compressed or decompressed buffer.
+  struct Buffer {
+    uint8_t* data = nullptr;
+    int64_t len = 0;
+    /// True for the last buffer of the file.
+    bool eos = false;
+    std::unique_ptr<MemPool> pool;
+  };
+
+  /// Body of the decompression thread. Runs Decompress() and records its result.
+  void DecompressLoop();
+
+  /// Decompresses the input queue until the end of the file, an error or Close().
+  Status Decompress() WARN_UNUSED_RESULT;
+
+  /// Waits for the next input buffer and replaces 'input' with it. Bytes of 'input'
+  /// from '*input_offset' on that were not consumed yet are prepended to the new
+  /// buffer. Sets '*cancelled' if Close() was called.
+  Status GetInput(Buffer* input, int64_t* input_offset, bool* cancelled)
+      WARN_UNUSED_RESULT;
+
+  /// Queues a decompressed buffer for GetNext(), waiting while the output queue is
+  /// full. Returns false if Close() was called.
+  bool AddOutput(Buffer* buffer);
+
+  const std::string filename_;
+  MemTracker* const mem_tracker_;
+  const int max_queued_buffers_;
+  RuntimeProfile::Counter* const decompress_timer_;
+
+  /// Pool that 'decompressor_' allocates output buffers from. Only accessed by the
+  /// decompression thread, which moves its memory into a Buffer after each call to the
+  /// decompressor.
+  std::unique_ptr<MemPool> decompressor_pool_;
+  boost::scoped_ptr<Codec> decompressor_;
+
+  std::unique_ptr<Thread> decompress_thread_;
+
+  /// Protects all members below.
+  std::mutex lock_;
+
+  /// Signalled when a buffer is added to 'output_queue_', a buffer is removed from
+  /// 'input_queue_' or the decompression thread exits.
+  ConditionVariable consumer_cv_;
+
+  /// Signalled when a buffer is added to 'input_queue_', a buffer is removed from
+  /// 'output_queue_' or Close() is called.
+  ConditionVariable producer_cv_;
+
+  /// Compressed buffers that were not yet taken by the decompression thread.
+  std::deque<Buffer> input_queue_;
+
+  /// True once the last input buffer was added.
+  bool input_eos_ = false;
+
+  /// Decompressed buffers that were not yet returned by GetNext(), in file order.
+  std::deque<Buffer> output_queue_;
+
+  /// Set by Close() to make the decompression thread exit.
+  bool shutdown_ = false;
+
+  /// Set by the decompression thread when it is done producing buffers.
+  bool producer_done_ = false;
+
+  /// Error hit by the decompression thread, if any.
+  Status status_;
+};
+}
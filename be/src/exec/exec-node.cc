@@ -486,6 +486,14 @@ Status ExecNode::QueryMaintenance(RuntimeState* state) {
   return state->CheckQueryState();
 }
 
+int ExecNode::EvalConjunctsBatch(ScalarExprEvaluator* const* evals, int num_conjuncts,
+    TupleRow* const* rows, int* sel, int num_sel) {
+  for (int i = 0; i < num_conjuncts && num_sel > 0; ++i) {
+    num_sel = evals[i]->EvalPredicateBatch(rows, sel, num_sel);
+  }
+  return num_sel;
+}
+
 // Codegen for EvalConjuncts.  The generated signature is the same as EvalConjuncts().
 //
 // For a node with two conjunct predicates:
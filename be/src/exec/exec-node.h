@@ -239,6 +239,15 @@ class ExecNode {
   static inline bool EvalConjuncts(
       ScalarExprEvaluator* const* evals, int num_conjuncts, TupleRow* row);
 
+  /// Batch-at-a-time version of EvalConjuncts(). Evaluates the conjuncts in 'evals' over
+  /// 'rows[sel[i]]' for each i in [0, num_sel), where 'sel' is in ascending order, and
+  /// compacts 'sel' to the rows for which all of them return true. Each conjunct is only
+  /// evaluated on the rows that passed the previous ones. Returns the number of rows
+  /// left in 'sel'. Used by interpreted code instead of calling EvalConjuncts() for each
+  /// row, see ScalarExpr::FilterBatch().
+  static int EvalConjunctsBatch(ScalarExprEvaluator* const* evals, int num_conjuncts,
+      TupleRow* const* rows, int* sel, int num_sel);
+
   /// Codegen EvalConjuncts(). Returns a non-OK status if the function couldn't be
   /// codegen'd. The codegen'd version uses inlined, codegen'd GetBooleanVal() functions.
   static Status CodegenEvalConjuncts(LlvmCodeGen* codegen,
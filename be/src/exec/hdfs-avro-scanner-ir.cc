@@ -65,6 +65,10 @@ int HdfsAvroScanner::DecodeAvroData(int max_tuples, MemPool* pool, uint8_t** dat
   return num_to_commit;
 }
 
+int HdfsAvroScanner::NumFileFields() {
+  return num_file_fields_;
+}
+
 bool HdfsAvroScanner::ReadUnionType(int null_union_position, uint8_t** data,
     uint8_t* data_end, bool* is_null) {
   DCHECK(null_union_position == 0 || null_union_position == 1);
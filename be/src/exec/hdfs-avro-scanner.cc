@@ -174,11 +174,13 @@ Status HdfsAvroScanner::ParseMetadata() {
 
         RETURN_IF_ERROR(ResolveSchemas(scan_node_->avro_schema(), file_schema));
 
-        // We currently codegen a function only for the table schema. If this file's
-        // schema is different from the table schema, don't use the codegen'd function and
-        // use the interpreted path instead.
-        avro_header_->use_codegend_decode_avro_data = avro_schema_equal(
-            scan_node_->avro_schema().schema, file_schema->schema);
+        // We codegen a function only for the table schema. If this file's schema can't
+        // be decoded by it, use the interpreted path instead.
+        avro_header_->use_codegend_decode_avro_data = FileSchemaMatchesCodegen(
+            scan_node_->avro_schema(), *file_schema, SchemaPath());
+        VLOG_FILE << stream_->filename() << ": file schema "
+                  << (avro_header_->use_codegend_decode_avro_data ? "can" : "can't")
+                  << " use codegen'd DecodeAvroData()";
 
       } else if (key == AVRO_CODEC_KEY) {
         string avro_codec(reinterpret_cast<char*>(value), value_len);
@@ -287,6 +289,55 @@ Status HdfsAvroScanner::ResolveSchemas(const AvroSchemaElement& table_root,
   return Status::OK();
 }
 
+bool HdfsAvroScanner::FileSchemaMatchesCodegen(const AvroSchemaElement& table_record,
+    const AvroSchemaElement& file_record, const SchemaPath& path) const {
+  DCHECK_EQ(table_record.schema->type, AVRO_RECORD);
+  DCHECK_EQ(file_record.schema->type, AVRO_RECORD);
+  int num_table_fields = table_record.children.size();
+  int num_file_fields = file_record.children.size();
+  // Only the top-level record can be decoded partially by the codegen'd function.
+  if (num_file_fields > num_table_fields) return false;
+  if (!path.empty() && num_file_fields != num_table_fields) return false;
+
+  for (int i = 0; i < num_table_fields; ++i) {
+    // Find the slot that the codegen'd function writes for this field the same way
+    // CodegenReadRecord() does.
+    int col_idx = i;
+    if (path.empty()) col_idx += scan_node_->num_partition_keys();
+    SchemaPath field_path = path;
+    field_path.push_back(col_idx);
+    int slot_idx = scan_node_->GetMaterializedSlotIdx(field_path);
+    const SlotDescriptor* codegen_slot_desc =
+        (slot_idx == HdfsScanNodeBase::SKIP_COLUMN) ?
+        nullptr : scan_node_->materialized_slots()[slot_idx];
+
+    if (i >= num_file_fields) {
+      // The field is missing from the file, so ResolveSchemas() either wrote a default
+      // value to the template tuple or failed. Nested fields of a missing record can't
+      // be handled this way.
+      if (table_record.children[i].schema->type == AVRO_RECORD) return false;
+      // The codegen'd InitTuple() only copies the template tuple if there are
+      // materialized partition keys, see HdfsScanner::CodegenInitTuple().
+      if (codegen_slot_desc != nullptr
+          && scan_node_->num_materialized_partition_keys() == 0) {
+        return false;
+      }
+      continue;
+    }
+
+    const AvroSchemaElement& table_field = table_record.children[i];
+    const AvroSchemaElement& file_field = file_record.children[i];
+    if (table_field.schema->type != file_field.schema->type) return false;
+    if (table_field.null_union_position != file_field.null_union_position) return false;
+    if (file_field.slot_desc != codegen_slot_desc) return false;
+    if (table_field.schema->type == AVRO_RECORD
+        && !FileSchemaMatchesCodegen(table_field, file_field, field_path)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 Status HdfsAvroScanner::WriteDefaultValue(
     SlotDescriptor* slot_desc, avro_datum_t default_value, const char* field_name) {
   if (avro_header_->template_tuple == nullptr) {
@@ -476,6 +527,7 @@ Status HdfsAvroScanner::InitNewRange() {
   only_parsing_header_ = false;
   avro_header_ = reinterpret_cast<AvroFileHeader*>(header_);
   template_tuple_ = avro_header_->template_tuple;
+  num_file_fields_ = avro_header_->schema->children.size();
   if (header_->is_compressed) {
     RETURN_IF_ERROR(UpdateDecompressor(header_->compression_type));
   }
@@ -813,6 +865,8 @@ Status HdfsAvroScanner::CodegenMaterializeTuple(const HdfsScanPlanNode* node,
   // are too long, it takes LLVM longer too.
   int step_size = 200;
   std::vector<llvm::Function*> helper_functions;
+  llvm::Function* num_file_fields_fn =
+      codegen->GetFunction(IRFunction::AVRO_NUM_FILE_FIELDS, false);
 
   // prototype re-used several times by amending with SetName()
   LlvmCodeGen::FnPrototype prototype(codegen, "", codegen->bool_type());
@@ -839,20 +893,30 @@ Status HdfsAvroScanner::CodegenMaterializeTuple(const HdfsScanPlanNode* node,
     llvm::Value* tuple_val =
         builder.CreateBitCast(opaque_tuple_val, tuple_ptr_type, "tuple_ptr");
 
+    // Files may contain only a prefix of the table's fields. See
+    // FileSchemaMatchesCodegen().
+    llvm::Value* num_fields_val =
+        builder.CreateCall(num_file_fields_fn, {this_val}, "num_file_fields");
+
     // Create a bail out block to handle decoding failures.
     llvm::BasicBlock* bail_out_block =
         llvm::BasicBlock::Create(context, "bail_out", helper_fn, nullptr);
+    // Block to jump to after the last field that is present in the file.
+    llvm::BasicBlock* done_block =
+        llvm::BasicBlock::Create(context, "done", helper_fn, bail_out_block);
 
     Status status = CodegenReadRecord(
         SchemaPath(), *node->avro_schema_.get(), i, std::min(num_children, i + step_size),
-        node, codegen, &builder, helper_fn, bail_out_block,
-        bail_out_block, this_val, pool_val, tuple_val, data_val, data_end_val);
+        node, codegen, &builder, helper_fn, done_block, bail_out_block, num_fields_val,
+        done_block, this_val, pool_val, tuple_val, data_val, data_end_val);
     if (!status.ok()) {
       VLOG_QUERY << status.GetDetail();
       return status;
     }
+    builder.CreateBr(done_block);
 
     // Returns true on successful decoding.
+    builder.SetInsertPoint(done_block);
     builder.CreateRet(codegen->true_value());
 
     // Returns false on decoding errors.
@@ -913,8 +977,10 @@ Status HdfsAvroScanner::CodegenReadRecord(const SchemaPath& path,
     const AvroSchemaElement& record, int child_start, int child_end,
     const HdfsScanPlanNode* node, LlvmCodeGen* codegen, void* void_builder,
     llvm::Function* fn, llvm::BasicBlock* insert_before, llvm::BasicBlock* bail_out,
-    llvm::Value* this_val, llvm::Value* pool_val, llvm::Value* tuple_val,
-    llvm::Value* data_val, llvm::Value* data_end_val) {
+    llvm::Value* num_fields_val, llvm::BasicBlock* done, llvm::Value* this_val,
+    llvm::Value* pool_val, llvm::Value* tuple_val, llvm::Value* data_val,
+    llvm::Value* data_end_val) {
+  DCHECK_EQ(num_fields_val == nullptr, done == nullptr);
   RETURN_IF_ERROR(CheckSchema(record));
   DCHECK_EQ(record.schema->type, AVRO_RECORD);
   llvm::LLVMContext& context = codegen->context();
@@ -950,6 +1016,16 @@ Status HdfsAvroScanner::CodegenReadRecord(const SchemaPath& path,
     llvm::BasicBlock* end_field_block =
         llvm::BasicBlock::Create(context, "end_field", fn, insert_before);
 
+    if (num_fields_val != nullptr) {
+      // Stop decoding the record if the file schema doesn't have this field.
+      llvm::BasicBlock* field_present_block =
+          llvm::BasicBlock::Create(context, "field_present", fn, read_field_block);
+      llvm::Value* field_present = builder->CreateICmpSLT(
+          codegen->GetI32Constant(i), num_fields_val, "field_present");
+      builder->CreateCondBr(field_present, field_present_block, done);
+      builder->SetInsertPoint(field_present_block);
+    }
+
     if (field.nullable()) {
       // Field could be null. Create conditional branch based on ReadUnionType result.
       llvm::Function* read_union_fn =
@@ -995,9 +1071,8 @@ Status HdfsAvroScanner::CodegenReadRecord(const SchemaPath& path,
       llvm::BasicBlock* insert_before_block =
           (null_block != nullptr) ? null_block : end_field_block;
       RETURN_IF_ERROR(CodegenReadRecord(new_path, field, 0, field.children.size(),
-          node, codegen, builder, fn,
-          insert_before_block, bail_out, this_val, pool_val, tuple_val, data_val,
-          data_end_val));
+          node, codegen, builder, fn, insert_before_block, bail_out, nullptr, nullptr,
+          this_val, pool_val, tuple_val, data_val, data_end_val));
     } else {
       RETURN_IF_ERROR(CodegenReadScalar(field, slot_desc, codegen, builder,
           this_val, pool_val, tuple_val, data_val, data_end_val, &ret_val));
@@ -46,7 +46,11 @@
 /// header to decode the serialized objects. If possible, non-materialized columns are
 /// skipped without being read. If codegen is enabled, we codegen a function based on the
 /// table schema that parses records, materializes them to tuples, and evaluates the
-/// conjuncts.
+/// conjuncts. Codegen happens before any file header is read, so the function can't be
+/// specialized for each file schema. Instead it is also used for files whose resolved
+/// schema decodes the same way as a prefix of the table schema, which covers the common
+/// case of schema evolution by appending fields with default values. See
+/// FileSchemaMatchesCodegen().
 ///
 /// The Avro C library is used to parse the file's schema and the table's schema, which are
 /// then resolved according to the Avro spec and transformed into our own schema
@@ -64,7 +68,7 @@
 ///
 /// TODO:
 /// - implement SkipComplex()
-/// - codegen a function per unique file schema, rather than just the table schema
+/// - codegen functions for file schemas that reorder or drop fields
 /// - once Exprs are thread-safe, we can cache the jitted function directly
 /// - microbenchmark codegen'd functions (this and other scanners)
 
@@ -126,7 +130,7 @@ class HdfsAvroScanner : public BaseSequenceScanner {
     Tuple* template_tuple;
 
     /// True if this file can use the codegen'd version of DecodeAvroData() (i.e. its
-    /// schema matches the table schema), false otherwise.
+    /// schema decodes like a prefix of the table schema), false otherwise.
     bool use_codegend_decode_avro_data;
   };
 
@@ -141,6 +145,11 @@ class HdfsAvroScanner : public BaseSequenceScanner {
   int64_t num_records_in_block_ = 0;
   int64_t record_pos_ = 0;
 
+  /// Number of top-level fields in the file schema of the current file. Read by the
+  /// codegen'd MaterializeTuple() through NumFileFields() so that it stops decoding a
+  /// record after the last field present in the file.
+  int num_file_fields_ = 0;
+
   /// Metadata keys
   static const std::string AVRO_SCHEMA_KEY;
   static const std::string AVRO_CODEC_KEY;
@@ -182,6 +191,20 @@ class HdfsAvroScanner : public BaseSequenceScanner {
   /// type promotion rules. Note that this does not handle nullability or TYPE_NULL.
   bool VerifyTypesMatch(const ColumnType& reader_type, const ColumnType& writer_type);
 
+  /// Returns true if the codegen'd MaterializeTuple(), which is generated from the table
+  /// schema, can decode records written with 'file_record'. This is the case if every
+  /// field of 'file_record' has the same type and nullability as the field at the same
+  /// position in 'table_record', and was resolved to the same slot that the codegen'd
+  /// function writes for it. The top-level file record ('path' is empty) may have fewer
+  /// fields than the table record; the missing fields must have been resolved to default
+  /// values in the template tuple by ResolveSchemas(). Nested records must match fully.
+  bool FileSchemaMatchesCodegen(const AvroSchemaElement& table_record,
+      const AvroSchemaElement& file_record, const SchemaPath& path) const;
+
+  /// Returns 'num_file_fields_'. Cross-compiled so the codegen'd MaterializeTuple() can
+  /// call it.
+  int NumFileFields();
+
   /// Writes 'default_value' to 'slot_desc' in the template tuple, initializing the
   /// template tuple if it doesn't already exist. Returns a non-OK status if slot_desc's
   /// and default_value's types are incompatible or unsupported. field_name is used for
@@ -235,6 +258,9 @@ class HdfsAvroScanner : public BaseSequenceScanner {
   ///     the bail_out block or some basic blocks before that.
   /// - bail_out: the block to jump to if anything fails. This is used in particular by
   ///     ReadAvroChar() which can exceed memory limit during allocation from MemPool.
+  /// - num_fields_val / done: if 'num_fields_val' is not null, a field is only read if
+  ///     its index is smaller than 'num_fields_val', otherwise the code jumps to 'done'.
+  ///     Only used for the top-level record, see FileSchemaMatchesCodegen().
   /// - this_val, pool_val, tuple_val, data_val, data_end_val: arguments to
   ///     MaterializeTuple()
   /// - child_start / child_end: specifies to only generate a subset of the record
@@ -242,9 +268,9 @@ class HdfsAvroScanner : public BaseSequenceScanner {
   static Status CodegenReadRecord(const SchemaPath& path, const AvroSchemaElement& record,
       int child_start, int child_end, const HdfsScanPlanNode* node, LlvmCodeGen* codegen,
       void* builder, llvm::Function* fn, llvm::BasicBlock* insert_before,
-      llvm::BasicBlock* bail_out, llvm::Value* this_val, llvm::Value* pool_val,
-      llvm::Value* tuple_val, llvm::Value* data_val,
-      llvm::Value* data_end_val) WARN_UNUSED_RESULT;
+      llvm::BasicBlock* bail_out, llvm::Value* num_fields_val, llvm::BasicBlock* done,
+      llvm::Value* this_val, llvm::Value* pool_val, llvm::Value* tuple_val,
+      llvm::Value* data_val, llvm::Value* data_end_val) WARN_UNUSED_RESULT;
 
   /// Creates the IR for reading an Avro scalar at builder's current insert point.
   static Status CodegenReadScalar(const AvroSchemaElement& element,
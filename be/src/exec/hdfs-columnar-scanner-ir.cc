@@ -44,9 +44,16 @@ int HdfsColumnarScanner::ProcessScratchBatch(RowBatch* dst_batch) {
   // Do not use batch_->AtCapacity() in this loop because it is not necessary
   // to perform the memory capacity check.
   bool* is_selected = scratch_batch_->selected_rows.get() + scratch_batch_->tuple_idx;
+  // Results of the runtime filters that were already evaluated for the whole batch.
+  const bool* filter_passed = scratch_batch_->num_filtered > 0 ?
+      scratch_batch_->filter_passed.get() + scratch_batch_->tuple_idx : nullptr;
   while (scratch_tuple != scratch_tuple_end) {
     *output_row = reinterpret_cast<Tuple*>(scratch_tuple);
     scratch_tuple += tuple_size;
+    if (filter_passed != nullptr && !*filter_passed++) {
+      *is_selected++ = false;
+      continue;
+    }
     // Evaluate runtime filters and conjuncts. Short-circuit the evaluation if
     // the filters/conjuncts are empty to avoid function calls.
     if (!EvalRuntimeFilters(reinterpret_cast<TupleRow*>(output_row))) {
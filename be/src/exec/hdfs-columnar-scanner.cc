@@ -21,8 +21,13 @@
 #include <gutil/strings/substitute.h>
 
 #include "codegen/llvm-codegen.h"
+#include "exec/filter-context.h"
 #include "exec/hdfs-scan-node-base.h"
 #include "exec/scratch-tuple-batch.h"
+#include "exprs/scalar-expr-evaluator.h"
+#include "runtime/raw-value.inline.h"
+#include "runtime/runtime-filter-bank.h"
+#include "runtime/runtime-filter.inline.h"
 #include "runtime/exec-env.h"
 #include "runtime/fragment-state.h"
 #include "runtime/io/disk-io-mgr.h"
@@ -103,9 +108,67 @@ Status HdfsColumnarScanner::Open(ScannerContext* context) {
   io_total_bytes_ = PROFILE_IoReadTotalBytes.Instantiate(profile);
   io_skipped_bytes_ = PROFILE_IoReadSkippedBytes.Instantiate(profile);
   num_file_metadata_read_ = PROFILE_NumFileMetadataRead.Instantiate(profile);
+
+  if (!filter_ctxs_.empty()) {
+    const int batch_size = state_->batch_size();
+    filter_hashes_.resize(batch_size);
+    filter_row_idxs_.resize(batch_size);
+    filter_found_.reset(new bool[batch_size]);
+  }
   return Status::OK();
 }
 
+void HdfsColumnarScanner::EvalBloomFiltersBatch() {
+  DCHECK_EQ(scratch_batch_->tuple_idx, 0);
+  DCHECK_LE(scratch_batch_->num_tuples, static_cast<int>(filter_hashes_.size()));
+  const int num_tuples = scratch_batch_->num_tuples;
+  bool* passed = scratch_batch_->filter_passed.get();
+  bool any_evaluated = false;
+  for (int i = 0; i < filter_ctxs_.size(); ++i) {
+    LocalFilterStats* stats = &filter_stats_[i];
+    const FilterContext* ctx = filter_ctxs_[i];
+    stats->evaluated_in_batch = 0;
+    // Same conditions as in EvalRuntimeFilter(). Other filter types are evaluated row
+    // by row.
+    if (!stats->enabled_for_row || !ctx->filter->is_bloom_filter()
+        || !ctx->filter->HasFilter()) {
+      continue;
+    }
+    const BloomFilter* bloom_filter = ctx->filter->get_bloom_filter();
+    if (bloom_filter == BloomFilter::ALWAYS_TRUE_FILTER) continue;
+    if (!any_evaluated) {
+      memset(passed, true, num_tuples);
+      any_evaluated = true;
+    }
+    stats->evaluated_in_batch = 1;
+    stats->total_possible += num_tuples;
+
+    // Hash the values of the rows that were not rejected by a previous filter.
+    const ColumnType& type = ctx->expr_eval->root().type();
+    int num_rows = 0;
+    for (int row_idx = 0; row_idx < num_tuples; ++row_idx) {
+      if (!passed[row_idx]) continue;
+      Tuple* tuple = scratch_batch_->GetTuple(row_idx);
+      void* val = ctx->expr_eval->GetValue(reinterpret_cast<TupleRow*>(&tuple));
+      filter_hashes_[num_rows] = RawValue::GetHashValueFastHash32(
+          val, type, RuntimeFilterBank::DefaultHashSeed());
+      filter_row_idxs_[num_rows] = row_idx;
+      ++num_rows;
+    }
+    bloom_filter->FindBatch(filter_hashes_.data(), num_rows, filter_found_.get());
+    int num_rejected = 0;
+    for (int j = 0; j < num_rows; ++j) {
+      if (!filter_found_[j]) {
+        passed[filter_row_idxs_[j]] = false;
+        ++num_rejected;
+      }
+    }
+    stats->considered += num_rows;
+    stats->rejected += num_rejected;
+  }
+  scratch_batch_->num_filtered = any_evaluated ? num_tuples : 0;
+}
+
 int HdfsColumnarScanner::FilterScratchBatch(RowBatch* dst_batch) {
   // This function must not be called when the output batch is already full. As long as
   // we always call CommitRows() after TransferScratchTuples(), the output batch can
@@ -129,6 +192,17 @@ int HdfsColumnarScanner::FilterScratchBatch(RowBatch* dst_batch) {
     DCHECK_EQ(0, scratch_batch_->total_allocated_bytes());
     return num_tuples;
   }
+  if (scratch_batch_->tuple_idx == 0 && !filter_ctxs_.empty()) {
+    if (IsProcessScratchBatchCodegend()) {
+      // The codegen'd ProcessScratchBatch() evaluates the filters with the codegen'd
+      // filter exprs and hash functions, which is cheaper than hashing the values with
+      // the interpreted exprs here. Codegen may have finished after earlier batches of
+      // this scanner were filtered in batch, so clear their marks.
+      for (LocalFilterStats& stats : filter_stats_) stats.evaluated_in_batch = 0;
+    } else {
+      EvalBloomFiltersBatch();
+    }
+  }
   return ProcessScratchBatchCodegenOrInterpret(dst_batch);
 }
 
@@ -174,12 +248,65 @@ Status HdfsColumnarScanner::Codegen(HdfsScanPlanNode* node, FragmentState* state
   return Status::OK();
 }
 
+bool HdfsColumnarScanner::IsProcessScratchBatchCodegend() const {
+  return codegend_process_scratch_batch_fn_ != nullptr
+      && codegend_process_scratch_batch_fn_->load() != nullptr;
+}
+
 int HdfsColumnarScanner::ProcessScratchBatchCodegenOrInterpret(RowBatch* dst_batch) {
+  if (!IsProcessScratchBatchCodegend() && !conjunct_evals_->empty()) {
+    return ProcessScratchBatchBatched(dst_batch);
+  }
   return CallCodegendOrInterpreted<ProcessScratchBatchFn>::invoke(this,
       codegend_process_scratch_batch_fn_, &HdfsColumnarScanner::ProcessScratchBatch,
       dst_batch);
 }
 
+int HdfsColumnarScanner::ProcessScratchBatchBatched(RowBatch* dst_batch) {
+  DCHECK(scratch_batch_ != nullptr);
+  ScalarExprEvaluator* const* conjunct_evals = conjunct_evals_->data();
+  const int num_conjuncts = conjunct_evals_->size();
+  Tuple** output_row_start =
+      reinterpret_cast<Tuple**>(dst_batch->GetRow(dst_batch->num_rows()));
+  const int output_capacity = dst_batch->capacity() - dst_batch->num_rows();
+  int num_output = 0;
+  const bool* filter_passed = scratch_batch_->num_filtered > 0 ?
+      scratch_batch_->filter_passed.get() : nullptr;
+  while (!scratch_batch_->AtEnd() && num_output < output_capacity) {
+    // Evaluate no more tuples than fit into 'dst_batch', so that all evaluated tuples
+    // are consumed.
+    const int start_idx = scratch_batch_->tuple_idx;
+    const int num_rows =
+        min(scratch_batch_->num_tuples - start_idx, output_capacity - num_output);
+    if (batch_tuples_.size() < num_rows) {
+      batch_tuples_.resize(num_rows);
+      batch_rows_.resize(num_rows);
+      batch_sel_.resize(num_rows);
+    }
+    bool* is_selected = scratch_batch_->selected_rows.get() + start_idx;
+    // Runtime filters are evaluated row by row first, the conjuncts then only see the
+    // rows that passed them.
+    int num_sel = 0;
+    for (int i = 0; i < num_rows; ++i) {
+      is_selected[i] = false;
+      batch_tuples_[i] = scratch_batch_->GetTuple(start_idx + i);
+      batch_rows_[i] = reinterpret_cast<TupleRow*>(&batch_tuples_[i]);
+      if (filter_passed != nullptr && !filter_passed[start_idx + i]) continue;
+      if (!EvalRuntimeFilters(batch_rows_[i])) continue;
+      batch_sel_[num_sel++] = i;
+    }
+    num_sel = ExecNode::EvalConjunctsBatch(
+        conjunct_evals, num_conjuncts, batch_rows_.data(), batch_sel_.data(), num_sel);
+    for (int i = 0; i < num_sel; ++i) {
+      const int row_idx = batch_sel_[i];
+      is_selected[row_idx] = true;
+      output_row_start[num_output++] = batch_tuples_[row_idx];
+    }
+    scratch_batch_->tuple_idx += num_rows;
+  }
+  return num_output;
+}
+
 HdfsColumnarScanner::ColumnReservations
 HdfsColumnarScanner::DivideReservationBetweenColumnsHelper(int64_t min_buffer_size,
     int64_t max_buffer_size, const ColumnRangeLengths& col_range_lengths,
@@ -19,6 +19,8 @@
 
 #include "exec/hdfs-scanner.h"
 
+#include <memory>
+#include <vector>
 #include <boost/scoped_ptr.hpp>
 
 namespace impala {
@@ -92,6 +94,20 @@ class HdfsColumnarScanner : public HdfsScanner {
   /// Returns the number of tuples that should be committed to the given batch.
   int FilterScratchBatch(RowBatch* row_batch);
 
+  /// Evaluates the bloom runtime filters that are available against all tuples of
+  /// 'scratch_batch_' at once and stores the result in 'scratch_batch_->filter_passed'.
+  /// The hashes of a filter's values are computed first and then probed in one
+  /// BloomFilter::FindBatch() call, which prefetches the buckets and hides the cache
+  /// misses that dominate probing a large filter one row at a time. The evaluated
+  /// filters are marked in 'filter_stats_' so that ProcessScratchBatch() skips them.
+  /// Must be called before the first tuple of 'scratch_batch_' is processed. Only used
+  /// if ProcessScratchBatch() is interpreted, since the values are hashed with the
+  /// interpreted filter exprs.
+  void EvalBloomFiltersBatch();
+
+  /// Returns true if the codegen'd ProcessScratchBatch() is available.
+  bool IsProcessScratchBatchCodegend() const;
+
   /// Get filename of the scan range.
   const char* filename() const { return metadata_range_->file(); }
 
@@ -107,6 +123,11 @@ class HdfsColumnarScanner : public HdfsScanner {
   /// materialized tuples. This is a separate function so it can be codegened.
   int ProcessScratchBatch(RowBatch* dst_batch);
 
+  /// Same as ProcessScratchBatch(), but evaluates the conjuncts batch-at-a-time with
+  /// ExecNode::EvalConjunctsBatch(). Used instead of the interpreted
+  /// ProcessScratchBatch() if it is not codegen'd and there are conjuncts.
+  int ProcessScratchBatchBatched(RowBatch* dst_batch);
+
   /// List of pair of (column index, reservation allocated).
   typedef std::vector<std::pair<int, int64_t>> ColumnReservations;
   /// List of column range lengths.
@@ -146,6 +167,18 @@ class HdfsColumnarScanner : public HdfsScanner {
   /// does not require row validation.
   Status GetNextWithTemplateTuple(RowBatch* row_batch);
 
+  /// Scratch space for EvalBloomFiltersBatch(), with one entry per tuple of
+  /// 'scratch_batch_'. Only allocated if there are runtime filters.
+  std::vector<uint32_t> filter_hashes_;
+  std::vector<int> filter_row_idxs_;
+  std::unique_ptr<bool[]> filter_found_;
+
+  /// Scratch space for ProcessScratchBatchBatched(): the scratch tuples of a chunk,
+  /// single-tuple rows pointing into 'batch_tuples_' and the selection vector over them.
+  std::vector<Tuple*> batch_tuples_;
+  std::vector<TupleRow*> batch_rows_;
+  std::vector<int> batch_sel_;
+
   /// Number of columns that need to be read.
   RuntimeProfile::Counter* num_cols_counter_;
 
@@ -0,0 +1,74 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "exec/hdfs-orc-scanner.h"
+
+#include <cstring>
+
+#include "runtime/mem-pool.h"
+#include "runtime/mem-tracker.h"
+#include "testutil/gtest-util.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+// Decodes several batches of string data into 'blob' the way the string reader of the
+// ORC lib does and transfers each batch's buffer to a MemPool. Checks that the values of
+// every batch stay valid, that the memory is counted once against the MemTracker and
+// that each batch allocates only the buffer it needs.
+TEST(OrcMemPoolTest, TransferBuffer) {
+  MemTracker tracker;
+  MemPool dst_pool(&tracker);
+  {
+    HdfsOrcScanner::OrcMemPool orc_pool(nullptr, &tracker);
+    orc::DataBuffer<char> blob(orc_pool);
+    vector<pair<const char*, string>> batches;
+    int64_t transferred_bytes = 0;
+    for (int i = 0; i < 10; ++i) {
+      const int size = 1000 + 100 * (i % 3);
+      blob.resize(size);
+      EXPECT_EQ(size, blob.capacity());
+      string values(size, 'a' + i);
+      memcpy(blob.data(), values.data(), size);
+      const char* data = blob.data();
+      ASSERT_OK(orc_pool.TransferBuffer(&blob, &dst_pool));
+      transferred_bytes += size;
+      // The buffer now belongs to 'dst_pool' and 'blob' has none.
+      EXPECT_EQ(0, blob.capacity());
+      EXPECT_EQ(transferred_bytes, dst_pool.total_reserved_bytes());
+      EXPECT_EQ(transferred_bytes, tracker.consumption());
+      batches.emplace_back(data, move(values));
+    }
+    for (const auto& batch : batches) {
+      EXPECT_EQ(0, memcmp(batch.first, batch.second.data(), batch.second.size()));
+    }
+
+    // A batch with only empty strings has no data to transfer.
+    blob.resize(0);
+    ASSERT_OK(orc_pool.TransferBuffer(&blob, &dst_pool));
+    EXPECT_EQ(transferred_bytes, dst_pool.total_reserved_bytes());
+    EXPECT_EQ(transferred_bytes, tracker.consumption());
+
+    dst_pool.FreeAll();
+    EXPECT_EQ(0, tracker.consumption());
+  }
+  EXPECT_EQ(0, tracker.consumption());
+  tracker.Close();
+}
+
+}
@@ -70,7 +70,11 @@ Status HdfsOrcScanner::IssueInitialRanges(HdfsScanNodeBase* scan_node,
 }
 
 HdfsOrcScanner::OrcMemPool::OrcMemPool(HdfsOrcScanner* scanner)
-    : scanner_(scanner), mem_tracker_(scanner_->scan_node_->mem_tracker()) {
+    : OrcMemPool(scanner->state_, scanner->scan_node_->mem_tracker()) {
+}
+
+HdfsOrcScanner::OrcMemPool::OrcMemPool(RuntimeState* state, MemTracker* mem_tracker)
+    : state_(state), mem_tracker_(mem_tracker) {
 }
 
 HdfsOrcScanner::OrcMemPool::~OrcMemPool() {
@@ -79,7 +83,7 @@ HdfsOrcScanner::OrcMemPool::~OrcMemPool() {
 
 void HdfsOrcScanner::OrcMemPool::FreeAll() {
   if (!chunk_sizes_.empty()) {
-    scanner_->state_->LogError(ErrorMsg(TErrorCode::INTERNAL_ERROR,
+    state_->LogError(ErrorMsg(TErrorCode::INTERNAL_ERROR,
         "Impala had to free memory leaked by ORC library."));
   }
   int64_t total_bytes_released = 0;
@@ -96,7 +100,7 @@ void HdfsOrcScanner::OrcMemPool::FreeAll() {
 char* HdfsOrcScanner::OrcMemPool::malloc(uint64_t size) {
   if (!mem_tracker_->TryConsume(size)) {
     throw ResourceError(mem_tracker_->MemLimitExceeded(
-        scanner_->state_, "Failed to allocate memory required by ORC library", size));
+        state_, "Failed to allocate memory required by ORC library", size));
   }
   char* addr = static_cast<char*>(std::malloc(size));
   if (addr == nullptr) {
@@ -110,10 +114,37 @@ char* HdfsOrcScanner::OrcMemPool::malloc(uint64_t size) {
 void HdfsOrcScanner::OrcMemPool::free(char* p) {
   DCHECK(chunk_sizes_.find(p) != chunk_sizes_.end()) << "invalid free!" << endl
        << GetStackTrace();
-  std::free(p);
   int64_t size = chunk_sizes_[p];
-  mem_tracker_->Release(size);
   chunk_sizes_.erase(p);
+  if (p == transfer_chunk_) {
+    // The memory stays consumed against 'mem_tracker_', which is shared with the
+    // destination pool.
+    transfer_dst_pool_->AcquireExternalChunk(reinterpret_cast<uint8_t*>(p), size);
+    transfer_chunk_ = nullptr;
+    return;
+  }
+  std::free(p);
+  mem_tracker_->Release(size);
+}
+
+Status HdfsOrcScanner::OrcMemPool::TransferBuffer(orc::DataBuffer<char>* blob,
+    MemPool* dst_pool) {
+  DCHECK_EQ(dst_pool->mem_tracker(), mem_tracker_);
+  DCHECK(transfer_chunk_ == nullptr);
+  // No values point into an empty buffer, so the ORC lib can keep reusing it.
+  if (blob->data() == nullptr || blob->size() == 0) return Status::OK();
+  DCHECK(chunk_sizes_.find(blob->data()) != chunk_sizes_.end());
+  transfer_chunk_ = blob->data();
+  transfer_dst_pool_ = dst_pool;
+  {
+    // Moving the buffer out leaves 'blob' empty without allocating a new buffer. The
+    // buffer is freed through free() when 'released' goes out of scope, which passes
+    // it to 'dst_pool'.
+    orc::DataBuffer<char> released(std::move(*blob));
+  }
+  DCHECK(transfer_chunk_ == nullptr);
+  DCHECK_EQ(blob->capacity(), 0);
+  return Status::OK();
 }
 
 void HdfsOrcScanner::ScanRangeInputStream::read(void* buf, uint64_t length,
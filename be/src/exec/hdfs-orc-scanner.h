@@ -76,6 +76,8 @@ class HdfsOrcScanner : public HdfsColumnarScanner {
   class OrcMemPool : public orc::MemoryPool {
    public:
     OrcMemPool(HdfsOrcScanner* scanner);
+    /// Tracks the memory against 'mem_tracker'. 'state' is used to report errors.
+    OrcMemPool(RuntimeState* state, MemTracker* mem_tracker);
     virtual ~OrcMemPool();
 
     char* malloc(uint64_t size) override;
@@ -83,10 +85,23 @@ class HdfsOrcScanner : public HdfsColumnarScanner {
 
     void FreeAll();
 
+    /// Detaches the buffer backing 'blob' from the ORC library and hands it over to
+    /// 'dst_pool', so values pointing into it stay valid after the ORC lib decodes the
+    /// next batch. 'blob' is left without a buffer, and the ORC lib allocates one of the
+    /// size of the next batch's data when it decodes that batch. Does nothing if 'blob'
+    /// holds no data. 'dst_pool' must use the same MemTracker as this pool.
+    Status TransferBuffer(orc::DataBuffer<char>* blob, MemPool* dst_pool)
+        WARN_UNUSED_RESULT;
+
    private:
-    HdfsOrcScanner* scanner_;
+    RuntimeState* state_;
     MemTracker* mem_tracker_;
     boost::unordered_map<char*, uint64_t> chunk_sizes_;
+
+    /// Set by TransferBuffer() while the ORC buffer is being swapped out. When the ORC
+    /// lib frees 'transfer_chunk_', it is passed to 'transfer_dst_pool_' instead.
+    char* transfer_chunk_ = nullptr;
+    MemPool* transfer_dst_pool_ = nullptr;
   };
 
   struct ColumnRange {
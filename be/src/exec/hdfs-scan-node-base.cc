@@ -938,6 +938,21 @@ bool HdfsScanNodeBase::PartitionPassesFilters(int32_t partition_id,
   return true;
 }
 
+const FilterContext* HdfsScanNodeBase::GetPartitionRejectingFilter(
+    int32_t partition_id, const vector<FilterContext>& filter_ctxs) {
+  for (const FilterContext& ctx : filter_ctxs) {
+    if (ctx.filter->AlwaysFalse()) return &ctx;
+  }
+  Tuple* template_tuple = GetTemplateTupleForPartitionId(partition_id);
+  if (template_tuple == nullptr) return nullptr;
+  TupleRow* tuple_row_mem = reinterpret_cast<TupleRow*>(&template_tuple);
+  for (const FilterContext& ctx : filter_ctxs) {
+    if (!ctx.filter->IsBoundByPartitionColumn(id_)) continue;
+    if (ctx.filter->HasFilter() && !ctx.Eval(tuple_row_mem)) return &ctx;
+  }
+  return nullptr;
+}
+
 void HdfsScanNodeBase::RangeComplete(const THdfsFileFormat::type& file_type,
     const THdfsCompression::type& compression_type, bool skipped) {
   vector<THdfsCompression::type> types;
@@ -630,6 +630,12 @@ class HdfsScanNodeBase : public ScanNode {
   bool PartitionPassesFilters(int32_t partition_id, const std::string& stats_name,
       const std::vector<FilterContext>& filter_ctxs);
 
+  /// Returns the first filter in 'filter_ctxs' that filters out partition
+  /// 'partition_id', or nullptr if the partition passes all of them. Unlike
+  /// PartitionPassesFilters(), does not update any filter statistics.
+  const FilterContext* GetPartitionRejectingFilter(int32_t partition_id,
+      const std::vector<FilterContext>& filter_ctxs);
+
   /// Update book-keeping to skip the scan range if it has been issued but will not be
   /// processed by a scanner. E.g. used to cancel ranges that are filtered out by
   /// late-arriving filters that could not be applied in IssueInitialScanRanges()
@@ -99,6 +99,8 @@ void StringToDecimalSymbolDummy() {
 
 bool HdfsScanner::EvalRuntimeFilter(int i, TupleRow* row) {
   LocalFilterStats* stats = &filter_stats_[i];
+  // Already applied to the whole batch and accounted for in 'stats'.
+  if (stats->evaluated_in_batch) return true;
   const FilterContext* ctx = filter_ctxs_[i];
   ++stats->total_possible;
   if (stats->enabled_for_row && ctx->filter->HasFilter()) {
@@ -34,6 +34,7 @@
 #include "runtime/tuple-row.h"
 #include "util/bitmap.h"
 #include "util/codec.h"
+#include "util/debug-util.h"
 #include "util/test-info.h"
 
 #include "common/names.h"
@@ -48,6 +49,19 @@ DEFINE_double(min_filter_reject_ratio, 0.1, "(Advanced) If the percentage of "
 const char* FieldLocation::LLVM_CLASS_NAME = "struct.impala::FieldLocation";
 const char* HdfsScanner::LLVM_CLASS_NAME = "class.impala::HdfsScanner";
 
+// Maximum time that the HDFS_SCANNER_OPEN_WAIT_FOR_FILTERS debug action waits for the
+// runtime filters in Open().
+static const int32_t DEBUG_FILTER_WAIT_TIME_MS = 60 * 1000;
+
+// Returns the number of filters in 'filter_ctxs' that have arrived.
+static int NumArrivedFilters(const vector<FilterContext>& filter_ctxs) {
+  int num_arrived = 0;
+  for (const FilterContext& ctx : filter_ctxs) {
+    if (ctx.filter != nullptr && ctx.filter->HasFilter()) ++num_arrived;
+  }
+  return num_arrived;
+}
+
 HdfsScanner::HdfsScanner(HdfsScanNodeBase* scan_node, RuntimeState* state)
     : scan_node_(scan_node),
       state_(state),
@@ -115,6 +129,14 @@ Status HdfsScanner::Open(ScannerContext* context) {
   template_tuple_ = file_metadata_utils_.CreateTemplateTuple(template_tuple_pool_.get());
   template_tuple_map_[scan_node_->tuple_desc()] = template_tuple_;
 
+  // Testing hook: wait for all runtime filters, so that filters that had not arrived
+  // when the scan range was started arrive before any of its rows are read.
+  if (!DebugAction(state_->query_options(), "HDFS_SCANNER_OPEN_WAIT_FOR_FILTERS").ok()) {
+    for (const FilterContext& ctx : context_->filter_ctxs()) {
+      ctx.filter->WaitForArrival(DEBUG_FILTER_WAIT_TIME_MS);
+    }
+  }
+
   decompress_timer_ = ADD_TIMER(scan_node_->runtime_profile(), "DecompressionTime");
   return Status::OK();
 }
@@ -819,6 +841,20 @@ void HdfsScanner::CheckFiltersEffectiveness() {
   }
 }
 
+bool HdfsScanner::PartitionPassesLateFilters() {
+  const vector<FilterContext>& filter_ctxs = context_->filter_ctxs();
+  int num_arrived = NumArrivedFilters(filter_ctxs);
+  if (num_arrived == num_arrived_filters_) return true;
+  num_arrived_filters_ = num_arrived;
+  const FilterContext* rejecting_ctx = scan_node_->GetPartitionRejectingFilter(
+      context_->partition_descriptor()->id(), filter_ctxs);
+  if (rejecting_ctx == nullptr) return true;
+  // The split was already counted when the scan node started it, before this filter
+  // arrived. Count only that the filter was applied to it and rejected it.
+  rejecting_ctx->stats->IncrCounters(FilterStats::SPLITS_KEY, 0, 1, 1);
+  return false;
+}
+
 Status HdfsScanner::IssueFooterRanges(HdfsScanNodeBase* scan_node,
     const THdfsFileFormat::type& file_type, const vector<HdfsFileDesc*>& files,
     int64_t footer_size_estimate) {
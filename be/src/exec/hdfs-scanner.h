@@ -361,8 +361,13 @@ class HdfsScanner {
     /// Apply the filter at row group level only.
     uint8_t enabled_for_rowgroup;
 
+    /// Set to 1 if the filter was already evaluated for all rows of the current batch
+    /// with a batched probe, in which case EvalRuntimeFilter() skips it. Only set by
+    /// HdfsColumnarScanner.
+    uint8_t evaluated_in_batch;
+
     /// Padding to ensure structs do not straddle cache-line boundary.
-    uint8_t padding[5];
+    uint8_t padding[4];
 
     LocalFilterStats()
       : considered(0),
@@ -370,7 +375,8 @@ class HdfsScanner {
         total_possible(0),
         enabled_for_row(1),
         enabled_for_page(1),
-        enabled_for_rowgroup(1) {}
+        enabled_for_rowgroup(1),
+        evaluated_in_batch(0) {}
   };
 
   /// Cached runtime filter contexts, one for each filter that applies to this column.
@@ -389,6 +395,23 @@ class HdfsScanner {
   /// row batches. Will update 'filter_stats_'.
   void CheckFiltersEffectiveness();
 
+  /// Returns false if a runtime filter that arrived after this scan range was started
+  /// rejects the range's partition, in which case the rest of the range cannot produce
+  /// any rows and the scanner can stop early. Filters are only re-evaluated against the
+  /// partition's template tuple when more filters have arrived since the last call, so
+  /// this is cheap enough to call once per row batch. Meant for scanners that have no
+  /// row group or stripe boundaries at which to re-check the filters, i.e. text and the
+  /// sequence-based formats. The split filter statistics are only updated if the range
+  /// is rejected, since the range was counted when it was started.
+  bool PartitionPassesLateFilters();
+
+  /// Number of runtime filters in context_->filter_ctxs() that had arrived when the
+  /// partition filters were last evaluated by PartitionPassesLateFilters(). Starts at 0,
+  /// since filters may arrive between the partition check when the scan range is
+  /// started and Open(). The first call may thus re-check filters that the partition
+  /// already passed, which is cheap and does not update the filter statistics.
+  int num_arrived_filters_ = 0;
+
   /// Evaluates 'row' against the i-th runtime filter for this scan node and returns
   /// true if 'row' finds a match in the filter. Returns false otherwise.
   bool EvalRuntimeFilter(int i, TupleRow* row);
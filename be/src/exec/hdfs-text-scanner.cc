@@ -29,6 +29,7 @@
 
 #include "common/compiler-util.h"
 #include "common/logging.h"
+#include "exec/decompression-pipeline.h"
 #include "exec/delimited-text-parser.h"
 #include "exec/delimited-text-parser.inline.h"
 #include "exec/exec-node.inline.h"
@@ -49,15 +50,19 @@
 #include "runtime/mem-tracker.h"
 #include "runtime/row-batch.h"
 #include "runtime/runtime-state.h"
+#include "runtime/thread-resource-mgr.h"
 #include "runtime/tuple-row.h"
 #include "runtime/tuple.h"
 #include "util/codec.h"
+#include "util/debug-util.h"
 #include "util/error-util.h"
 #include "util/runtime-profile-counters.h"
 #include "util/stopwatch.h"
 
 #include "common/names.h"
 
+DECLARE_int32(text_decompression_pipeline_max_queued_buffers);
+
 namespace impala {
 class LlvmCodeGen;
 class ScalarExpr;
@@ -189,6 +194,7 @@ Status HdfsTextScanner::IssueInitialRanges(HdfsScanNodeBase* scan_node,
 
 void HdfsTextScanner::Close(RowBatch* row_batch) {
   DCHECK(!is_closed_);
+  CloseDecompressionPipeline();
   // Need to close the decompressor before transferring the remaining resources to
   // 'row_batch' because in some cases there is memory allocated in the decompressor_'s
   // temp_memory_pool_.
@@ -237,6 +243,7 @@ Status HdfsTextScanner::InitNewRange() {
     compression_type = THdfsCompression::DEFAULT;
   }
   RETURN_IF_ERROR(UpdateDecompressor(compression_type));
+  StartDecompressionPipeline();
 
   HdfsPartitionDescriptor* hdfs_partition = context_->partition_descriptor();
   char field_delim = hdfs_partition->field_delim();
@@ -377,7 +384,10 @@ Status HdfsTextScanner::ProcessRange(RowBatch* row_batch, int* num_tuples) {
   DCHECK(scan_state_ == FIRST_TUPLE_FOUND || scan_state_ == PAST_SCAN_RANGE);
 
   MemPool* pool = row_batch->tuple_data_pool();
-  bool eosr = stream_->eosr() || scan_state_ == PAST_SCAN_RANGE;
+  // With a decompression pipeline, 'stream_' reaches the end of the range before all of
+  // it was decompressed. The last decompressed buffer closes the pipeline.
+  bool eosr = (decompression_pipeline_ == nullptr && stream_->eosr())
+      || scan_state_ == PAST_SCAN_RANGE;
   while (true) {
     if (!eosr && byte_buffer_ptr_ == byte_buffer_end_) {
       RETURN_IF_ERROR(FillByteBufferWrapper(pool, &eosr));
@@ -466,6 +476,15 @@ Status HdfsTextScanner::GetNextInternal(RowBatch* row_batch) {
   DCHECK_GE(scan_state_, SCAN_RANGE_INITIALIZED);
   DCHECK_NE(scan_state_, DONE);
 
+  // Runtime filters that arrived after the scan range was started may rule out this
+  // partition. If so, the remainder of the scan range produces no rows. Every scan range
+  // of the partition is skipped, so no tuple straddling two ranges is lost.
+  if (!PartitionPassesLateFilters()) {
+    eos_ = true;
+    scan_state_ = DONE;
+    return Status::OK();
+  }
+
   if (scan_state_ == SCAN_RANGE_INITIALIZED) {
     // Find the first tuple.  If tuple_found is false, it means we went through the entire
     // scan range without finding a single tuple.  The bytes will be picked up by the scan
@@ -528,6 +547,9 @@ Status HdfsTextScanner::FillByteBuffer(MemPool* pool, bool* eosr, int num_bytes)
           reinterpret_cast<uint8_t**>(&byte_buffer_ptr_), &byte_buffer_read_size_));
     }
     *eosr = stream_->eosr();
+  } else if (decompression_pipeline_ != nullptr) {
+    DCHECK_EQ(num_bytes, 0);
+    RETURN_IF_ERROR(FillByteBufferFromPipeline(pool, eosr));
   } else if (decompressor_->supports_streaming()) {
     DCHECK_EQ(num_bytes, 0);
     RETURN_IF_ERROR(FillByteBufferCompressedStream(pool, eosr));
@@ -600,15 +622,8 @@ Status HdfsTextScanner::DecompressBufferStream(int64_t bytes_to_read,
 }
 
 Status HdfsTextScanner::FillByteBufferCompressedStream(MemPool* pool, bool* eosr) {
-  // We're about to create a new decompression buffer (if we can't reuse). Attach the
-  // memory from previous decompression rounds to 'pool'.
-  if (!decompressor_->reuse_output_buffer()) {
-    if (pool != nullptr) {
-      pool->AcquireData(data_buffer_pool_.get(), false);
-    } else {
-      data_buffer_pool_->FreeAll();
-    }
-  }
+  // We're about to create a new decompression buffer (if we can't reuse).
+  if (!decompressor_->reuse_output_buffer()) AttachDecompressionBuffers(pool);
 
   uint8_t* decompressed_buffer = nullptr;
   int64_t decompressed_len = 0;
@@ -639,6 +654,81 @@ Status HdfsTextScanner::FillByteBufferCompressedStream(MemPool* pool, bool* eosr
   return Status::OK();
 }
 
+void HdfsTextScanner::AttachDecompressionBuffers(MemPool* pool) {
+  if (pool != nullptr) {
+    pool->AcquireData(data_buffer_pool_.get(), false);
+  } else {
+    data_buffer_pool_->FreeAll();
+  }
+}
+
+Status HdfsTextScanner::FillByteBufferFromPipeline(MemPool* pool, bool* eosr) {
+  // The pipeline never reuses decompression buffers.
+  AttachDecompressionBuffers(pool);
+
+  uint8_t* decompressed_buffer = nullptr;
+  int64_t decompressed_len = 0;
+  while (true) {
+    bool needs_input = false;
+    {
+      SCOPED_TIMER(decompression_pipeline_wait_timer_);
+      RETURN_IF_ERROR(decompression_pipeline_->GetNext(data_buffer_pool_.get(),
+          &decompressed_buffer, &decompressed_len, eosr, &needs_input));
+    }
+    if (!needs_input) break;
+    // 'stream_' is only read by this thread. The pipeline copies the compressed data, so
+    // the I/O buffer can be returned as soon as the stream moves past it.
+    uint8_t* compressed_buffer = nullptr;
+    int64_t compressed_len = 0;
+    RETURN_IF_ERROR(stream_->GetBuffer(false, &compressed_buffer, &compressed_len));
+    RETURN_IF_ERROR(decompression_pipeline_->AddInput(
+        compressed_buffer, compressed_len, stream_->eosr()));
+  }
+  byte_buffer_ptr_ = reinterpret_cast<char*>(decompressed_buffer);
+  byte_buffer_read_size_ = decompressed_len;
+
+  if (*eosr) {
+    CloseDecompressionPipeline();
+    DCHECK(stream_->eosr());
+    context_->ReleaseCompletedResources(true);
+  }
+  return Status::OK();
+}
+
+void HdfsTextScanner::StartDecompressionPipeline() {
+  DCHECK(decompression_pipeline_ == nullptr);
+  if (!DecompressionPipeline::ShouldUse(
+          decompressor_.get(), stream_->file_desc()->file_length)) {
+    return;
+  }
+  // The decompression thread counts against the query's thread quota, like any other
+  // optional scanner thread.
+  if (!state_->resource_pool()->TryAcquireThreadToken()) return;
+
+  if (decompression_pipeline_wait_timer_ == nullptr) {
+    decompression_pipeline_wait_timer_ =
+        ADD_TIMER(scan_node_->runtime_profile(), "DecompressionPipelineWaitTime");
+  }
+  decompression_pipeline_.reset(new DecompressionPipeline(stream_->filename(),
+      scan_node_->mem_tracker(), FLAGS_text_decompression_pipeline_max_queued_buffers,
+      decompress_timer_));
+  string thread_name = Substitute("text-decompress (finst:$0, plan-node-id:$1)",
+      PrintId(state_->fragment_instance_id()), scan_node_->id());
+  Status status = decompression_pipeline_->Start(decompression_type_, thread_name);
+  if (!status.ok()) {
+    VLOG_QUERY << "Could not start decompression thread for " << stream_->filename()
+               << ", decompressing in the scanner thread: " << status.GetDetail();
+    CloseDecompressionPipeline();
+  }
+}
+
+void HdfsTextScanner::CloseDecompressionPipeline() {
+  if (decompression_pipeline_ == nullptr) return;
+  decompression_pipeline_->Close();
+  decompression_pipeline_.reset();
+  state_->resource_pool()->ReleaseThreadToken(false);
+}
+
 Status HdfsTextScanner::FillByteBufferCompressedFile(bool* eosr) {
   // For other compressed text: attempt to read and decompress the entire file, point
   // to the decompressed buffer, and then continue normal processing.
@@ -769,6 +859,10 @@ Status HdfsTextScanner::CheckForSplitDelimiter(bool* split_delimiter) {
       && byte_buffer_last_byte_ == '\r';
   if (!split_delimiter_possible) return Status::OK();
 
+  // Compressed files are never split across scan ranges. 'stream_' is also ahead of the
+  // decompressed data while the pipeline is running.
+  if (decompression_pipeline_ != nullptr) return Status::OK();
+
   // The '\r' may be escaped. If it's not the text parser will report a complete tuple.
   if (delimited_text_parser_->HasUnfinishedTuple()) return Status::OK();
 
@@ -19,6 +19,8 @@
 #ifndef IMPALA_EXEC_HDFS_TEXT_SCANNER_H
 #define IMPALA_EXEC_HDFS_TEXT_SCANNER_H
 
+#include <memory>
+
 #include "exec/hdfs-scanner.h"
 #include "runtime/string-buffer.h"
 #include "util/runtime-profile-counters.h"
@@ -27,6 +29,7 @@ namespace impala {
 
 template<bool>
 class DelimitedTextParser;
+class DecompressionPipeline;
 class ScannerContext;
 struct HdfsFileDesc;
 
@@ -46,6 +49,12 @@ struct HdfsFileDesc;
 /// delimiter is considered part of the second scan range, i.e., the first scan range's
 /// scanner is responsible for the tuple directly before it, and the second scan range's
 /// scanner for the tuple directly after it.
+///
+/// Compressed text:
+/// Compressed text files are not splittable, so a single scanner processes the whole
+/// file. If a spare thread token is available, files compressed with a streaming codec
+/// are decompressed by a DecompressionPipeline on a separate thread, which overlaps
+/// decompression with parsing and materialization in the scanner thread.
 class HdfsTextScanner : public HdfsScanner {
  public:
   HdfsTextScanner(HdfsScanNodeBase* scan_node, RuntimeState* state);
@@ -191,6 +200,23 @@ class HdfsTextScanner : public HdfsScanner {
   /// by returned batches to 'pool'. If 'pool' is nullptr the buffers are freed instead.
   Status FillByteBufferCompressedStream(MemPool* pool, bool* eosr) WARN_UNUSED_RESULT;
 
+  /// Same as FillByteBufferCompressedStream() but gets the next decompressed buffer from
+  /// 'decompression_pipeline_', feeding it compressed buffers read from 'stream_' as
+  /// needed. Closes the pipeline once the last buffer is returned.
+  Status FillByteBufferFromPipeline(MemPool* pool, bool* eosr) WARN_UNUSED_RESULT;
+
+  /// Attaches decompression buffers from previous calls that might still be referenced
+  /// by returned batches to 'pool'. If 'pool' is nullptr the buffers are freed instead.
+  void AttachDecompressionBuffers(MemPool* pool);
+
+  /// Starts 'decompression_pipeline_' if the file in 'stream_' is compressed with a
+  /// streaming codec, is large enough and a thread token can be acquired. Falls back to
+  /// decompressing in the scanner thread if the pipeline cannot be started.
+  void StartDecompressionPipeline();
+
+  /// Stops and frees 'decompression_pipeline_', if any, and releases its thread token.
+  void CloseDecompressionPipeline();
+
   /// Used by FillByteBufferCompressedStream() to decompress data from 'stream_'.
   /// Returns COMPRESSED_FILE_DECOMPRESSOR_NO_PROGRESS if it needs more input.
   /// If bytes_to_read > 0, will read specified size.
@@ -280,6 +306,14 @@ class HdfsTextScanner : public HdfsScanner {
 
   /// Time parsing text files
   RuntimeProfile::Counter* parse_delimiter_timer_;
+
+  /// Decompresses the file on a separate thread. Only set between
+  /// StartDecompressionPipeline() and CloseDecompressionPipeline(). 'stream_' is still
+  /// only read by the scanner thread, which passes the compressed data to the pipeline.
+  std::unique_ptr<DecompressionPipeline> decompression_pipeline_;
+
+  /// Time the scanner thread spent waiting for 'decompression_pipeline_'.
+  RuntimeProfile::Counter* decompression_pipeline_wait_timer_ = nullptr;
 };
 
 }
@@ -176,8 +176,8 @@ Status OrcBoolColumnReader::ReadValue(int row_idx, Tuple* tuple, MemPool* pool)
 }
 
 Status OrcStringColumnReader::InitBlob(orc::DataBuffer<char>* blob, MemPool* pool) {
-  // TODO: IMPALA-9310: Possible improvement is moving the buffer out from orc::DataBuffer
-  // instead of copying and let Impala free the memory later.
+  // TODO: IMPALA-9310: The dictionary is shared with the ORC lib, so we can't move its
+  // buffer out like we do for non-encoded batches. It is only copied once per stripe.
   blob_ = reinterpret_cast<char*>(pool->TryAllocateUnaligned(blob->size()));
   if (UNLIKELY(blob_ == nullptr)) {
     string details = Substitute("Could not allocate string buffer of $0 bytes "
@@ -281,8 +281,8 @@ Status OrcStringColumnReader::ReadValueInternal(int row_idx, Tuple* tuple) {
     src_ptr = blob_ + offsets[index];
     src_len = offsets[index + 1] - offsets[index];
   } else {
-    // The pointed data is now in blob_, a buffer handled by Impala.
-    src_ptr = blob_ + (batch_->data[row_idx] - batch_->blob.data());
+    // The pointed data is in a buffer transferred to Impala in UpdateInputBatch().
+    src_ptr = batch_->data[row_idx];
     src_len = batch_->length[row_idx];
   }
   int dst_len = slot_desc_->type().len;
@@ -230,6 +230,43 @@ class OrcPrimitiveColumnReader : public OrcBatchedReader<Final> {
     if (final->batch_ == nullptr) return 0;
     return final->batch_->numElements;
   }
+
+ protected:
+  /// Implementation of ReadValueBatch() for fixed-width slots whose values can't fail
+  /// to convert. Reads 'src' values of 'batch' starting at 'row_idx', converts them with
+  /// 'convert' and writes them to the slots of consecutive tuples of 'scratch_batch'
+  /// starting at 'scratch_batch_idx'. Uses a tight loop without per-row calls and
+  /// without null checks if 'batch' has no nulls.
+  template <typename SlotType, typename SrcType, typename ConvertFn>
+  Status ReadFixedWidthValueBatch(orc::ColumnVectorBatch* batch, const SrcType* src,
+      int row_idx, ScratchTupleBatch* scratch_batch, int scratch_batch_idx,
+      ConvertFn convert) WARN_UNUSED_RESULT {
+    int num_to_read = std::min<int>(scratch_batch->capacity - scratch_batch_idx,
+        batch->numElements - row_idx);
+    DCHECK_GE(num_to_read, 0);
+    const int tuple_size = OrcColumnReader::scanner_->tuple_byte_size();
+    const int slot_offset = OrcColumnReader::slot_desc_->tuple_offset();
+    uint8_t* tuple_mem = scratch_batch->tuple_mem + scratch_batch_idx * tuple_size;
+    src += row_idx;
+    if (!batch->hasNulls) {
+      for (int i = 0; i < num_to_read; ++i, tuple_mem += tuple_size) {
+        *reinterpret_cast<SlotType*>(tuple_mem + slot_offset) = convert(src[i]);
+      }
+    } else {
+      const char* not_null = batch->notNull.data() + row_idx;
+      const NullIndicatorOffset& null_offset =
+          OrcColumnReader::slot_desc_->null_indicator_offset();
+      for (int i = 0; i < num_to_read; ++i, tuple_mem += tuple_size) {
+        if (not_null[i]) {
+          *reinterpret_cast<SlotType*>(tuple_mem + slot_offset) = convert(src[i]);
+        } else {
+          reinterpret_cast<Tuple*>(tuple_mem)->SetNull(null_offset);
+        }
+      }
+    }
+    scratch_batch->num_tuples = scratch_batch_idx + num_to_read;
+    return Status::OK();
+  }
 };
 
 class OrcBoolColumnReader : public OrcPrimitiveColumnReader<OrcBoolColumnReader> {
@@ -248,6 +285,12 @@ class OrcBoolColumnReader : public OrcPrimitiveColumnReader<OrcBoolColumnReader>
   }
 
   Status ReadValue(int row_idx, Tuple* tuple, MemPool* pool) final WARN_UNUSED_RESULT;
+
+  Status ReadValueBatch(int row_idx, ScratchTupleBatch* scratch_batch, MemPool* pool,
+      int scratch_batch_idx) final WARN_UNUSED_RESULT {
+    return ReadFixedWidthValueBatch<bool>(DCHECK_NOTNULL(batch_), batch_->data.data(),
+        row_idx, scratch_batch, scratch_batch_idx, [](int64_t v) { return v != 0; });
+  }
  private:
   friend class OrcPrimitiveColumnReader<OrcBoolColumnReader>;
 
@@ -279,6 +322,13 @@ class OrcIntColumnReader : public OrcPrimitiveColumnReader<OrcIntColumnReader<T>
     return Status::OK();
   }
 
+  Status ReadValueBatch(int row_idx, ScratchTupleBatch* scratch_batch, MemPool* pool,
+      int scratch_batch_idx) final WARN_UNUSED_RESULT {
+    return this->template ReadFixedWidthValueBatch<T>(DCHECK_NOTNULL(batch_),
+        batch_->data.data(), row_idx, scratch_batch, scratch_batch_idx,
+        [](int64_t v) { return static_cast<T>(v); });
+  }
+
  private:
   friend class OrcPrimitiveColumnReader<OrcIntColumnReader<T>>;
 
@@ -310,6 +360,13 @@ class OrcDoubleColumnReader : public OrcPrimitiveColumnReader<OrcDoubleColumnRea
     return Status::OK();
   }
 
+  Status ReadValueBatch(int row_idx, ScratchTupleBatch* scratch_batch, MemPool* pool,
+      int scratch_batch_idx) final WARN_UNUSED_RESULT {
+    return this->template ReadFixedWidthValueBatch<T>(DCHECK_NOTNULL(batch_),
+        batch_->data.data(), row_idx, scratch_batch, scratch_batch_idx,
+        [](double v) { return static_cast<T>(v); });
+  }
+
  private:
   friend class OrcPrimitiveColumnReader<OrcDoubleColumnReader<T>>;
 
@@ -327,13 +384,15 @@ class OrcStringColumnReader : public OrcPrimitiveColumnReader<OrcStringColumnRea
   Status UpdateInputBatch(orc::ColumnVectorBatch* orc_batch) override WARN_UNUSED_RESULT {
     batch_ = static_cast<orc::StringVectorBatch*>(orc_batch);
     if (orc_batch == nullptr) return Status::OK();
-    // We update the blob of a non-encoded batch every time, but since the dictionary blob
-    // is the same for the stripe, we only reset it for every new stripe.
+    // The blob of a non-encoded batch is handed over to Impala for every batch without
+    // copying it, but since the dictionary blob is the same for the stripe, we only copy
+    // it for every new stripe.
     // Note that this is possible since the encoding should be the same for every batch
     // through the whole stripe.
     if(!orc_batch->isEncoded) {
       DCHECK(batch_ == dynamic_cast<orc::StringVectorBatch*>(orc_batch));
-      return InitBlob(&batch_->blob, scanner_->data_batch_pool_.get());
+      return scanner_->reader_mem_pool_->TransferBuffer(&batch_->blob,
+          scanner_->data_batch_pool_.get());
     }
     DCHECK(static_cast<orc::EncodedStringVectorBatch*>(batch_) ==
         dynamic_cast<orc::EncodedStringVectorBatch*>(orc_batch));
@@ -371,17 +430,16 @@ class OrcStringColumnReader : public OrcPrimitiveColumnReader<OrcStringColumnRea
       WARN_UNUSED_RESULT;
 
   orc::StringVectorBatch* batch_ = nullptr;
-  // We copy the blob from the batch, so the memory will be handled by Impala, and not
-  // by the ORC lib.
+  // We copy the dictionary blob from the batch, so the memory will be handled by Impala,
+  // and not by the ORC lib. Not used for non-encoded batches, whose values point into
+  // the blob that was transferred to 'data_batch_pool_' in UpdateInputBatch().
   char* blob_ = nullptr;
 
   // We cache the last stripe so we know when we have to update the blob (in case of
   // dictionary encoding).
   int last_stripe_idx_ = -1;
 
-  /// Initializes the blob if it has not been already in the current batch.
-  /// Unfortunately, this cannot be done in UpdateInputBatch, since we do not have
-  /// access to the pool there.
+  /// Copies the dictionary 'blob' into 'pool' and points 'blob_' to the copy.
   Status InitBlob(orc::DataBuffer<char>* blob, MemPool* pool);
 };
 
@@ -462,6 +520,14 @@ class OrcDecimalColumnReader
     return Status::OK();
   }
 
+  Status ReadValueBatch(int row_idx, ScratchTupleBatch* scratch_batch, MemPool* pool,
+      int scratch_batch_idx) final WARN_UNUSED_RESULT {
+    using StorageType = typename DECIMAL_TYPE::StorageType;
+    return this->template ReadFixedWidthValueBatch<DECIMAL_TYPE>(DCHECK_NOTNULL(batch_),
+        batch_->values.data(), row_idx, scratch_batch, scratch_batch_idx,
+        [](int64_t v) { return DECIMAL_TYPE(static_cast<StorageType>(v)); });
+  }
+
  private:
   friend class OrcPrimitiveColumnReader<OrcDecimalColumnReader<DECIMAL_TYPE>>;
 
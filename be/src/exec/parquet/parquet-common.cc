@@ -260,7 +260,10 @@ ParquetTimestampDecoder::ParquetTimestampDecoder(const parquet::SchemaElement& e
   bool valid_schema = GetTimestampInfoFromSchema(e, precision_, needs_conversion);
   DCHECK(valid_schema); // Invalid schemas should be rejected in an earlier step.
   if (e.type == parquet::Type::INT96 && convert_int96_timestamps) needs_conversion = true;
-  if (needs_conversion) timezone_ = timezone;
+  if (needs_conversion) {
+    timezone_ = timezone;
+    if (timezone_ != UTCPTR) tz_converter_ = TimezoneConverter(timezone_);
+  }
 }
 
 void ParquetTimestampDecoder::ConvertMinStatToLocalTime(TimestampValue* v) const {
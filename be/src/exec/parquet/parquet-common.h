@@ -29,6 +29,7 @@
 #include "runtime/decimal-value.h"
 #include "runtime/string-value.h"
 #include "runtime/timestamp-value.inline.h"
+#include "runtime/timezone-converter.h"
 #include "util/bit-util.h"
 #include "util/decimal-util.h"
 #include "util/mem-util.h"
@@ -794,7 +795,7 @@ public:
 
   void ConvertToLocalTime(TimestampValue* v) const {
     DCHECK(timezone_ != nullptr);
-    if (v->HasDateAndTime()) v->UtcToLocal(*timezone_);
+    if (v->HasDateAndTime()) tz_converter_.UtcToLocal(v);
   }
 
   /// Timezone conversion of min/max stats need some extra logic because UTC->local
@@ -823,6 +824,11 @@ private:
   /// Timezone used for UTC->Local conversions. If it is UTCPTR, no conversion is needed.
   const Timezone* timezone_ = UTCPTR;
 
+  /// Converts values to 'timezone_' if it is not UTCPTR. Values of a column chunk are
+  /// usually close in time, so it mostly converts them with the cached offset of the
+  /// previous value. Mutable because the cache is updated by conversions.
+  mutable TimezoneConverter tz_converter_;
+
   /// Unit of the encoded timestamp. Used to decide between milli and microseconds during
   /// INT64 decoding. INT64 with nanosecond precision (and reduced range) is also planned
   /// to be implemented once it is added in Parquet (PARQUET-1387).
@@ -73,13 +73,22 @@ struct ScratchTupleBatch {
   // 'selected_rows[i]' would be true else false.
   boost::scoped_array<bool> selected_rows;
 
+  // Result of the runtime filters that were evaluated for the whole batch at once by
+  // HdfsColumnarScanner::EvalBloomFiltersBatch(). 'filter_passed[i]' is false if the
+  // i'th tuple was rejected by one of them. Only valid if 'num_filtered' > 0.
+  boost::scoped_array<bool> filter_passed;
+
+  // Number of tuples that 'filter_passed' is valid for. Either 0 or 'num_tuples'.
+  int num_filtered = 0;
+
   ScratchTupleBatch(
       const RowDescriptor& row_desc, int batch_size, MemTracker* mem_tracker)
     : capacity(batch_size),
       tuple_byte_size(row_desc.GetRowSize()),
       tuple_mem_pool(mem_tracker),
       aux_mem_pool(mem_tracker),
-      selected_rows(new bool[batch_size]) {
+      selected_rows(new bool[batch_size]),
+      filter_passed(new bool[batch_size]) {
     DCHECK_EQ(row_desc.tuple_descriptors().size(), 1);
   }
 
@@ -87,6 +96,7 @@ struct ScratchTupleBatch {
     tuple_idx = 0;
     num_tuples = 0;
     num_tuples_transferred = 0;
+    num_filtered = 0;
     if (tuple_mem == nullptr) {
       int64_t dummy;
       RETURN_IF_ERROR(RowBatch::ResizeAndAllocateTupleBuffer(
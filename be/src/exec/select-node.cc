@@ -107,7 +107,7 @@ Status SelectNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos)
     if (copy_rows_fn != nullptr) {
       copy_rows_fn(this, row_batch);
     } else {
-      CopyRows(row_batch);
+      CopyRowsBatched(row_batch);
     }
     COUNTER_SET(rows_returned_counter_, rows_returned());
     *eos = ReachedLimit()
@@ -121,6 +121,47 @@ Status SelectNode::GetNext(RuntimeState* state, RowBatch* row_batch, bool* eos)
   return Status::OK();
 }
 
+void SelectNode::CopyRowsBatched(RowBatch* output_batch) {
+  const int num_conjuncts = conjuncts_.size();
+  DCHECK_EQ(num_conjuncts, conjunct_evals_.size());
+  while (child_row_idx_ < child_row_batch_->num_rows() && !output_batch->AtCapacity()) {
+    // Evaluate no more rows than fit into 'output_batch', so that all evaluated rows
+    // are consumed.
+    const int num_rows = min(child_row_batch_->num_rows() - child_row_idx_,
+        output_batch->capacity() - output_batch->num_rows());
+    if (batch_rows_.size() < num_rows) {
+      batch_rows_.resize(num_rows);
+      batch_sel_.resize(num_rows);
+    }
+    for (int i = 0; i < num_rows; ++i) {
+      batch_rows_[i] = child_row_batch_->GetRow(child_row_idx_ + i);
+      batch_sel_[i] = i;
+    }
+    int num_selected = ExecNode::EvalConjunctsBatch(conjunct_evals_.data(),
+        num_conjuncts, batch_rows_.data(), batch_sel_.data(), num_rows);
+    // Rows past the limit are not returned and must stay unconsumed, like in
+    // CopyRows().
+    bool reached_limit = false;
+    if (limit_ != -1 && num_selected >= limit_ - rows_returned()) {
+      num_selected = limit_ - rows_returned();
+      reached_limit = true;
+    }
+    for (int i = 0; i < num_selected; ++i) {
+      int dst_row_idx = output_batch->AddRow();
+      output_batch->CopyRow(
+          batch_rows_[batch_sel_[i]], output_batch->GetRow(dst_row_idx));
+      output_batch->CommitLastRow();
+    }
+    IncrementNumRowsReturned(num_selected);
+    if (reached_limit) {
+      DCHECK(ReachedLimit());
+      if (num_selected > 0) child_row_idx_ += batch_sel_[num_selected - 1] + 1;
+      return;
+    }
+    child_row_idx_ += num_rows;
+  }
+}
+
 Status SelectNode::Reset(RuntimeState* state, RowBatch* row_batch) {
   child_row_batch_->TransferResourceOwnership(row_batch);
   child_row_idx_ = 0;
@@ -19,6 +19,7 @@
 #ifndef IMPALA_EXEC_SELECT_NODE_H
 #define IMPALA_EXEC_SELECT_NODE_H
 
+#include <vector>
 #include <boost/scoped_ptr.hpp>
 
 #include "codegen/codegen-fn-ptr.h"
@@ -80,9 +81,18 @@ class SelectNode : public ExecNode {
   /// was used to create this instance.
   const CodegenFnPtr<SelectPlanNode::CopyRowsFn>& codegend_copy_rows_fn_;
 
+  /// Rows of 'child_row_batch_' and the selection vector over them that are passed to
+  /// ExecNode::EvalConjunctsBatch() by CopyRowsBatched().
+  std::vector<TupleRow*> batch_rows_;
+  std::vector<int> batch_sel_;
+
   /// Copy rows from child_row_batch_ for which conjuncts_ evaluate to true to
   /// output_batch, up to limit_ or till the output row batch reaches capacity.
   void CopyRows(RowBatch* output_batch);
+
+  /// Same as CopyRows(), but evaluates the conjuncts batch-at-a-time. Used instead of
+  /// the interpreted CopyRows() if CopyRows() is not codegen'd.
+  void CopyRowsBatched(RowBatch* output_batch);
 };
 
 }
@@ -0,0 +1,439 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+#include <gutil/strings/substitute.h>
+
+#include "exec/exec-node.inline.h"
+#include "exprs/compound-predicates.h"
+#include "exprs/literal.h"
+#include "exprs/null-literal.h"
+#include "exprs/scalar-expr-evaluator.h"
+#include "exprs/scalar-fn-call.h"
+#include "exprs/slot-ref.h"
+#include "runtime/date-value.h"
+#include "runtime/descriptors.h"
+#include "runtime/fragment-state.h"
+#include "runtime/mem-pool.h"
+#include "runtime/mem-tracker.h"
+#include "runtime/query-state.h"
+#include "runtime/runtime-state.h"
+#include "runtime/test-env.h"
+#include "runtime/tuple-row.h"
+#include "runtime/tuple.h"
+#include "testutil/gtest-util.h"
+
+#include "gen-cpp/Exprs_types.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+// The rows have a single tuple with one nullable slot. The null indicator is bit 1 of
+// the first byte and the slot starts at byte 1, see SlotRef(ColumnType, int, bool).
+static const int SLOT_OFFSET = 1;
+static const NullIndicatorOffset SLOT_NULL_OFFSET(0, SLOT_OFFSET);
+
+static const int NUM_ROWS = 200;
+
+class BatchPredicateTest : public testing::Test {
+ protected:
+  scoped_ptr<TestEnv> test_env_;
+  RuntimeState* runtime_state_ = nullptr;
+  FragmentState* fragment_state_ = nullptr;
+
+  ObjectPool pool_;
+  MemTracker tracker_;
+  MemPool expr_perm_pool_{&tracker_};
+  MemPool expr_results_pool_{&tracker_};
+  MemPool tuple_pool_{&tracker_};
+
+  vector<ScalarExpr*> exprs_;
+  vector<ScalarExprEvaluator*> evals_;
+
+  /// The rows that the predicates are evaluated on.
+  vector<TupleRow*> rows_;
+
+  virtual void SetUp() {
+    // The batch predicates are only used by interpreted exprs.
+    TQueryOptions query_options;
+    query_options.__set_disable_codegen(true);
+    test_env_.reset(new TestEnv());
+    ASSERT_OK(test_env_->Init());
+    ASSERT_OK(test_env_->CreateQueryState(0, &query_options, &runtime_state_));
+    QueryState* qs = runtime_state_->query_state();
+    TPlanFragment* fragment = qs->obj_pool()->Add(new TPlanFragment());
+    PlanFragmentCtxPB* fragment_ctx = qs->obj_pool()->Add(new PlanFragmentCtxPB());
+    fragment_state_ =
+        qs->obj_pool()->Add(new FragmentState(qs, *fragment, *fragment_ctx));
+  }
+
+  virtual void TearDown() {
+    ScalarExprEvaluator::Close(evals_, runtime_state_);
+    ScalarExpr::Close(exprs_);
+    fragment_state_->ReleaseResources();
+    runtime_state_ = nullptr;
+    test_env_.reset();
+    expr_perm_pool_.FreeAll();
+    expr_results_pool_.FreeAll();
+    tuple_pool_.FreeAll();
+    pool_.Clear();
+  }
+
+  /// Creates NUM_ROWS rows whose slot values cycle through 'values'. If 'null_every' is
+  /// positive, every 'null_every'th row has a NULL slot instead. If 'null_tuples' is
+  /// true, every 50th row has a NULL tuple.
+  template <typename T>
+  void CreateRows(const vector<T>& values, int null_every, bool null_tuples = false) {
+    rows_.clear();
+    for (int i = 0; i < NUM_ROWS; ++i) {
+      TupleRow* row =
+          reinterpret_cast<TupleRow*>(tuple_pool_.Allocate(sizeof(Tuple*)));
+      Tuple* tuple = Tuple::Create(SLOT_OFFSET + sizeof(T), &tuple_pool_);
+      const T& value = values[i % values.size()];
+      memcpy(tuple->GetSlot(SLOT_OFFSET), &value, sizeof(T));
+      if (null_every > 0 && i % null_every == 0) tuple->SetNull(SLOT_NULL_OFFSET);
+      row->SetTuple(0, null_tuples && i % 50 == 1 ? nullptr : tuple);
+      rows_.push_back(row);
+    }
+  }
+
+  ScalarExpr* Slot(const ColumnType& type) {
+    return pool_.Add(new SlotRef(type, SLOT_OFFSET, true /* nullable */));
+  }
+
+  template <typename T>
+  ScalarExpr* Lit(const ColumnType& type, const T& value) {
+    return pool_.Add(new Literal(type, value));
+  }
+
+  /// Returns the builtin comparison 'op' (e.g. "lt") of 'lhs' and 'rhs', which must have
+  /// the same type. Resolves the same symbol as the frontend does for it.
+  ScalarExpr* Compare(const string& op, ScalarExpr* lhs, ScalarExpr* rhs) {
+    const string val_type = AnyValName(lhs->type());
+    const string name = Substitute("$0$1_$2_$2",
+        static_cast<char>(toupper(op[0])), op.substr(1), val_type);
+    const string symbol = Substitute(
+        "_ZN6impala9Operators$0$1EPN10impala_udf15FunctionContextERKNS1_$2$3ES6_",
+        name.size(), name, val_type.size(), val_type);
+    return FnCall(op, symbol, {lhs, rhs});
+  }
+
+  /// Returns 'child' IS NULL, or 'child' IS NOT NULL if 'is_not_null' is true.
+  ScalarExpr* IsNull(ScalarExpr* child, bool is_not_null = false) {
+    const string val_type = AnyValName(child->type());
+    // The return type BooleanVal is a substitution if the argument is one as well.
+    const string ret_type =
+        val_type == "BooleanVal" ? "S3_" : "NS2_10BooleanValE";
+    const string fn = is_not_null ? "9IsNotNull" : "6IsNull";
+    const string symbol = Substitute(
+        "_ZN6impala15IsNullPredicate$0IN10impala_udf$1$2EE$3PNS2_15FunctionContextERKT_",
+        fn, val_type.size(), val_type, ret_type);
+    return FnCall(is_not_null ? "is_not_null_pred" : "is_null_pred", symbol, {child});
+  }
+
+  ScalarExpr* And(ScalarExpr* lhs, ScalarExpr* rhs) {
+    return Compound<AndPredicate>("and", lhs, rhs);
+  }
+
+  ScalarExpr* Or(ScalarExpr* lhs, ScalarExpr* rhs) {
+    return Compound<OrPredicate>("or", lhs, rhs);
+  }
+
+  /// Initializes the expr tree 'root' and opens an evaluator for it.
+  ScalarExprEvaluator* Prepare(ScalarExpr* root) {
+    Status status = root->Init(RowDescriptor(), true, fragment_state_);
+    EXPECT_OK(status);
+    if (!status.ok()) return nullptr;
+    int fn_ctx_idx = 0;
+    root->AssignFnCtxIdx(&fn_ctx_idx);
+    exprs_.push_back(root);
+    ScalarExprEvaluator* eval = nullptr;
+    status = ScalarExprEvaluator::Create(*root, runtime_state_, &pool_,
+        &expr_perm_pool_, &expr_results_pool_, &eval);
+    EXPECT_OK(status);
+    if (!status.ok()) return nullptr;
+    evals_.push_back(eval);
+    status = eval->Open(runtime_state_);
+    EXPECT_OK(status);
+    return status.ok() ? eval : nullptr;
+  }
+
+  /// Returns true if 'expr' is evaluated by the batch implementation of ScalarFnCall
+  /// rather than row by row.
+  static bool HasBatchPredicate(const ScalarExpr* expr) {
+    const ScalarFnCall* fn_call = dynamic_cast<const ScalarFnCall*>(expr);
+    return fn_call != nullptr
+        && fn_call->batch_predicate_ != ScalarFnCall::BatchPredicate::NONE;
+  }
+
+  /// Checks that FilterBatch() keeps exactly the rows for which the row-at-a-time
+  /// EvalPredicate() is true, for a selection of all rows and for a sparse selection.
+  /// Returns the number of rows that passed out of all rows.
+  int CheckParity(ScalarExprEvaluator* eval) {
+    int num_passed_all = -1;
+    for (int step : {1, 3}) {
+      vector<int> sel;
+      vector<int> expected;
+      for (int i = 0; i < rows_.size(); i += step) {
+        sel.push_back(i);
+        if (eval->EvalPredicate(rows_[i])) expected.push_back(i);
+      }
+      const int num_passed = eval->EvalPredicateBatch(rows_.data(), sel.data(),
+          sel.size());
+      sel.resize(num_passed);
+      EXPECT_EQ(expected, sel) << eval->root().DebugString() << " step=" << step;
+      if (step == 1) num_passed_all = num_passed;
+    }
+    return num_passed_all;
+  }
+
+  /// Checks every comparison between a slot of 'type' and 'literal' in both operand
+  /// orders against the row-at-a-time evaluation.
+  template <typename T>
+  void CheckComparisons(const ColumnType& type, const T& literal) {
+    for (const string& op : {"eq", "ne", "lt", "le", "gt", "ge"}) {
+      for (bool slot_first : {true, false}) {
+        ScalarExpr* slot = Slot(type);
+        ScalarExpr* lit = Lit(type, literal);
+        ScalarExpr* pred =
+            slot_first ? Compare(op, slot, lit) : Compare(op, lit, slot);
+        ScalarExprEvaluator* eval = Prepare(pred);
+        ASSERT_TRUE(eval != nullptr);
+        EXPECT_TRUE(HasBatchPredicate(pred)) << op;
+        CheckParity(eval);
+      }
+    }
+  }
+
+ private:
+  static string AnyValName(const ColumnType& type) {
+    switch (type.type) {
+      case TYPE_BOOLEAN: return "BooleanVal";
+      case TYPE_TINYINT: return "TinyIntVal";
+      case TYPE_SMALLINT: return "SmallIntVal";
+      case TYPE_INT: return "IntVal";
+      case TYPE_BIGINT: return "BigIntVal";
+      case TYPE_FLOAT: return "FloatVal";
+      case TYPE_DOUBLE: return "DoubleVal";
+      case TYPE_DATE: return "DateVal";
+      default:
+        DCHECK(false) << type;
+        return "";
+    }
+  }
+
+  ScalarExpr* FnCall(
+      const string& name, const string& symbol, const vector<ScalarExpr*>& children) {
+    TFunction fn;
+    fn.name.function_name = name;
+    fn.binary_type = TFunctionBinaryType::BUILTIN;
+    for (ScalarExpr* child : children) fn.arg_types.push_back(child->type().ToThrift());
+    fn.ret_type = ColumnType(TYPE_BOOLEAN).ToThrift();
+    fn.has_var_args = false;
+    TScalarFunction scalar_fn;
+    scalar_fn.symbol = symbol;
+    fn.__set_scalar_fn(scalar_fn);
+    TExprNode node;
+    node.node_type = TExprNodeType::FUNCTION_CALL;
+    node.type = fn.ret_type;
+    node.num_children = children.size();
+    node.is_constant = false;
+    node.__set_fn(fn);
+    ScalarExpr* expr = pool_.Add(new ScalarFnCall(node));
+    expr->children_ = children;
+    return expr;
+  }
+
+  template <typename PREDICATE>
+  ScalarExpr* Compound(const string& name, ScalarExpr* lhs, ScalarExpr* rhs) {
+    TFunction fn;
+    fn.name.function_name = name;
+    fn.binary_type = TFunctionBinaryType::BUILTIN;
+    TExprNode node;
+    node.node_type = TExprNodeType::COMPOUND_PRED;
+    node.type = ColumnType(TYPE_BOOLEAN).ToThrift();
+    node.num_children = 2;
+    node.is_constant = false;
+    node.__set_fn(fn);
+    ScalarExpr* expr = pool_.Add(new PREDICATE(node));
+    expr->children_ = {lhs, rhs};
+    return expr;
+  }
+};
+
+TEST_F(BatchPredicateTest, IntegerComparisons) {
+  CreateRows<int8_t>({-128, -1, 0, 1, 5, 127}, 7);
+  CheckComparisons(ColumnType(TYPE_TINYINT), static_cast<int8_t>(1));
+  CreateRows<int16_t>({-32768, -300, 0, 299, 300, 32767}, 5);
+  CheckComparisons(ColumnType(TYPE_SMALLINT), static_cast<int16_t>(300));
+  CreateRows<int32_t>({numeric_limits<int32_t>::min(), -7, 0, 41, 42, 43}, 11);
+  CheckComparisons(ColumnType(TYPE_INT), 42);
+  CreateRows<int64_t>({numeric_limits<int64_t>::min(), -1, 1L << 40, (1L << 40) + 1,
+      numeric_limits<int64_t>::max()}, 3);
+  CheckComparisons(ColumnType(TYPE_BIGINT), static_cast<int64_t>(1L << 40));
+}
+
+TEST_F(BatchPredicateTest, BooleanAndDateComparisons) {
+  CreateRows<bool>({true, false, false}, 4);
+  CheckComparisons(ColumnType(TYPE_BOOLEAN), true);
+  CheckComparisons(ColumnType(TYPE_BOOLEAN), false);
+  CreateRows<DateValue>({DateValue(-719162), DateValue(0), DateValue(18000),
+      DateValue(18001), DateValue(2932896)}, 6);
+  CheckComparisons(ColumnType(TYPE_DATE), DateValue(18000));
+}
+
+// NaN compares unequal to everything, including itself, and -0.0 equals 0.0, both in
+// the builtin operators and in the batch implementation.
+TEST_F(BatchPredicateTest, FloatingPointComparisons) {
+  const double nan = numeric_limits<double>::quiet_NaN();
+  const double inf = numeric_limits<double>::infinity();
+  CreateRows<double>({-inf, -1.5, -0.0, 0.0, nan, 2.5, inf}, 9);
+  for (double literal : {0.0, -0.0, nan, 2.5, inf}) {
+    CheckComparisons(ColumnType(TYPE_DOUBLE), literal);
+  }
+  const float nanf = numeric_limits<float>::quiet_NaN();
+  CreateRows<float>({-1.5f, -0.0f, 0.0f, nanf, 2.5f}, 8);
+  for (float literal : {0.0f, -0.0f, nanf, 2.5f}) {
+    CheckComparisons(ColumnType(TYPE_FLOAT), literal);
+  }
+  // Spot-check the semantics that the two implementations agree on.
+  CreateRows<double>({-0.0, 0.0, nan}, 0);
+  ScalarExprEvaluator* eq_zero = Prepare(
+      Compare("eq", Slot(ColumnType(TYPE_DOUBLE)), Lit(ColumnType(TYPE_DOUBLE), 0.0)));
+  ASSERT_TRUE(eq_zero != nullptr);
+  // Rows 0, 1, 3, 4, ... hold -0.0 or 0.0.
+  EXPECT_EQ(134, CheckParity(eq_zero));
+  ScalarExprEvaluator* ne_nan = Prepare(
+      Compare("ne", Slot(ColumnType(TYPE_DOUBLE)), Lit(ColumnType(TYPE_DOUBLE), nan)));
+  ASSERT_TRUE(ne_nan != nullptr);
+  EXPECT_EQ(NUM_ROWS, CheckParity(ne_nan));
+}
+
+// A comparison with NULL is never true.
+TEST_F(BatchPredicateTest, NullLiteral) {
+  CreateRows<int32_t>({1, 2, 3}, 4);
+  for (const string& op : {"eq", "ne", "lt", "ge"}) {
+    ScalarExpr* pred = Compare(op, Slot(ColumnType(TYPE_INT)),
+        pool_.Add(new NullLiteral(TYPE_INT)));
+    ScalarExprEvaluator* eval = Prepare(pred);
+    ASSERT_TRUE(eval != nullptr);
+    EXPECT_EQ(0, CheckParity(eval)) << op;
+  }
+}
+
+TEST_F(BatchPredicateTest, IsNull) {
+  for (bool null_tuples : {false, true}) {
+    CreateRows<int64_t>({1, 2, 3}, 4, null_tuples);
+    const int num_nulls = (NUM_ROWS + 3) / 4 + (null_tuples ? NUM_ROWS / 50 : 0);
+    ScalarExpr* is_null = IsNull(Slot(ColumnType(TYPE_BIGINT)));
+    ScalarExprEvaluator* eval = Prepare(is_null);
+    ASSERT_TRUE(eval != nullptr);
+    EXPECT_TRUE(HasBatchPredicate(is_null));
+    EXPECT_EQ(num_nulls, CheckParity(eval));
+    ScalarExpr* is_not_null = IsNull(Slot(ColumnType(TYPE_BIGINT)), true);
+    eval = Prepare(is_not_null);
+    ASSERT_TRUE(eval != nullptr);
+    EXPECT_TRUE(HasBatchPredicate(is_not_null));
+    EXPECT_EQ(NUM_ROWS - num_nulls, CheckParity(eval));
+  }
+  CreateRows<bool>({true, false}, 3);
+  for (bool is_not_null : {false, true}) {
+    ScalarExpr* pred = IsNull(Slot(ColumnType(TYPE_BOOLEAN)), is_not_null);
+    ScalarExprEvaluator* eval = Prepare(pred);
+    ASSERT_TRUE(eval != nullptr);
+    EXPECT_TRUE(HasBatchPredicate(pred));
+    CheckParity(eval);
+  }
+}
+
+// AND and OR of predicates that are evaluated on the whole batch, row by row, or both,
+// including NULL operands. A NULL result does not pass, e.g. 'NULL OR false' is NULL.
+TEST_F(BatchPredicateTest, CompoundPredicates) {
+  const ColumnType type(TYPE_INT);
+  CreateRows<int32_t>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}, 7, true);
+  // 'x = x' is not a batch predicate and is NULL for NULL slots.
+  auto batch_lt = [&](int v) { return Compare("lt", Slot(type), Lit(type, v)); };
+  auto batch_gt = [&](int v) { return Compare("gt", Slot(type), Lit(type, v)); };
+  auto row_by_row = [&]() { return Compare("eq", Slot(type), Slot(type)); };
+  auto is_null = [&]() { return IsNull(Slot(type)); };
+  auto null_cmp = [&]() {
+    return Compare("eq", Slot(type), pool_.Add(new NullLiteral(TYPE_INT)));
+  };
+  vector<ScalarExpr*> preds = {
+      And(batch_gt(2), batch_lt(7)),
+      And(batch_lt(7), row_by_row()),
+      And(row_by_row(), batch_gt(2)),
+      And(is_null(), batch_gt(2)),
+      And(null_cmp(), batch_gt(2)),
+      Or(batch_lt(3), batch_gt(6)),
+      Or(batch_gt(6), batch_lt(3)),
+      Or(batch_lt(3), is_null()),
+      Or(is_null(), row_by_row()),
+      Or(null_cmp(), batch_gt(4)),
+      Or(batch_gt(4), null_cmp()),
+      Or(batch_lt(0), batch_gt(9)),
+      Or(batch_lt(10), is_null()),
+      // Nested ORs use separate scratch selections.
+      Or(Or(batch_lt(2), batch_gt(8)), Or(is_null(), Compare("eq", Slot(type),
+          Lit(type, 5)))),
+      Or(And(batch_gt(1), batch_lt(4)), Or(batch_gt(7), And(row_by_row(),
+          Compare("eq", Slot(type), Lit(type, 5))))),
+      And(Or(batch_lt(3), is_null()), Or(batch_gt(1), row_by_row())),
+  };
+  for (ScalarExpr* pred : preds) {
+    ScalarExprEvaluator* eval = Prepare(pred);
+    ASSERT_TRUE(eval != nullptr);
+    CheckParity(eval);
+  }
+  // Reusing the evaluators for another batch gives the same results.
+  CreateRows<int32_t>({9, 8, 7, 6, 5, 4, 3, 2, 1, 0}, 3);
+  for (ScalarExprEvaluator* eval : evals_) CheckParity(eval);
+}
+
+// A list of conjuncts passes the same rows as ExecNode::EvalConjuncts().
+TEST_F(BatchPredicateTest, Conjuncts) {
+  const ColumnType type(TYPE_INT);
+  CreateRows<int32_t>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}, 13, true);
+  vector<ScalarExprEvaluator*> conjuncts = {
+      Prepare(IsNull(Slot(type), true)),
+      Prepare(Or(Compare("lt", Slot(type), Lit(type, 3)),
+          Compare("ge", Lit(type, 7), Slot(type)))),
+      Prepare(Compare("eq", Slot(type), Slot(type))),
+      Prepare(Compare("ne", Lit(type, 2), Slot(type)))};
+  for (ScalarExprEvaluator* eval : conjuncts) ASSERT_TRUE(eval != nullptr);
+  for (int num_conjuncts = 0; num_conjuncts <= conjuncts.size(); ++num_conjuncts) {
+    vector<int> sel;
+    vector<int> expected;
+    for (int i = 0; i < rows_.size(); ++i) {
+      sel.push_back(i);
+      if (ExecNode::EvalConjuncts(conjuncts.data(), num_conjuncts, rows_[i])) {
+        expected.push_back(i);
+      }
+    }
+    sel.resize(ExecNode::EvalConjunctsBatch(conjuncts.data(), num_conjuncts,
+        rows_.data(), sel.data(), sel.size()));
+    EXPECT_EQ(expected, sel) << num_conjuncts;
+  }
+}
+
+}
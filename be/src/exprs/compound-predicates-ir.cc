@@ -17,6 +17,8 @@
 
 #include "exprs/compound-predicates.h"
 
+#include "exprs/scalar-expr-evaluator.h"
+
 using namespace impala;
 using namespace impala_udf;
 
@@ -25,3 +27,9 @@ BooleanVal CompoundPredicate::Not(FunctionContext* context, const BooleanVal& v)
   return BooleanVal(!v.val);
 }
 
+BooleanVal OrPredicate::EvalPatternSet(
+    ScalarExprEvaluator* eval, const TupleRow* row, int fn_ctx_idx) {
+  const OrPredicate* pred = reinterpret_cast<const OrPredicate*>(
+      eval->fn_context(fn_ctx_idx)->GetFunctionState(FunctionContext::THREAD_LOCAL));
+  return pred->OrPredicate::GetBooleanValInterpreted(eval, row);
+}
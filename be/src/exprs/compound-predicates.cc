@@ -15,12 +15,18 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <cstring>
 #include <sstream>
+#include <re2/re2.h>
+#include <re2/set.h>
 
 #include "codegen/codegen-anyval.h"
 #include "codegen/llvm-codegen.h"
 #include "exprs/compound-predicates.h"
+#include "exprs/like-predicate.h"
+#include "exprs/scalar-expr-evaluator.h"
 #include "exprs/scalar-expr.inline.h"
+#include "exprs/slot-ref.h"
 #include "runtime/runtime-state.h"
 
 #include "common/names.h"
@@ -41,16 +47,139 @@ BooleanVal AndPredicate::GetBooleanValInterpreted(
   return BooleanVal(true);
 }
 
+// A row passes (x && y) only if both x and y are true, so y is only evaluated on the
+// rows for which x is true.
+int AndPredicate::FilterBatchInterpreted(ScalarExprEvaluator* eval,
+    TupleRow* const* rows, int* sel, int num_sel) const {
+  DCHECK_EQ(children_.size(), 2);
+  num_sel = children_[0]->FilterBatch(eval, rows, sel, num_sel);
+  if (num_sel == 0) return 0;
+  return children_[1]->FilterBatch(eval, rows, sel, num_sel);
+}
+
 string AndPredicate::DebugString() const {
   stringstream out;
   out << "AndPredicate(" << ScalarExpr::DebugString() << ")";
   return out.str();
 }
 
+// Memory budget of the DFA of a pattern set. RE2 is shared by all threads that evaluate
+// the predicate, so this is larger than the default of a single RE2.
+static const int64_t PATTERN_SET_MAX_MEM = 64L * 1024 * 1024;
+
+struct OrPredicate::PatternSet {
+  PatternSet(const re2::RE2::Options& options) : set(options, re2::RE2::UNANCHORED) {}
+
+  /// The string slot that the patterns are matched against.
+  ScalarExpr* slot_ref = nullptr;
+
+  re2::RE2::Set set;
+};
+
+OrPredicate::OrPredicate(const TExprNode& node) : CompoundPredicate(node) {}
+
+OrPredicate::~OrPredicate() {}
+
+Status OrPredicate::Init(
+    const RowDescriptor& row_desc, bool is_entry_point, FragmentState* state) {
+  RETURN_IF_ERROR(CompoundPredicate::Init(row_desc, is_entry_point, state));
+  InitPatternSet();
+  return Status::OK();
+}
+
+void OrPredicate::GetDisjuncts(vector<ScalarExpr*>* disjuncts) const {
+  for (ScalarExpr* child : children_) {
+    const OrPredicate* or_child = dynamic_cast<const OrPredicate*>(child);
+    if (or_child != nullptr) {
+      or_child->GetDisjuncts(disjuncts);
+    } else {
+      disjuncts->push_back(child);
+    }
+  }
+}
+
+void OrPredicate::InitPatternSet() {
+  vector<ScalarExpr*> disjuncts;
+  GetDisjuncts(&disjuncts);
+  re2::RE2::Options options;
+  options.set_max_mem(PATTERN_SET_MAX_MEM);
+  options.set_log_errors(false);
+  unique_ptr<PatternSet> pattern_set = make_unique<PatternSet>(options);
+  for (ScalarExpr* disjunct : disjuncts) {
+    if (!disjunct->is_builtin_fn() || disjunct->GetNumChildren() != 2) return;
+    ScalarExpr* value = disjunct->GetChild(0);
+    ScalarExpr* pattern = disjunct->GetChild(1);
+    if (!value->IsSlotRef() || value->type().type != TYPE_STRING) return;
+    if (!pattern->IsLiteral()) return;
+    if (pattern_set->slot_ref == nullptr) {
+      pattern_set->slot_ref = value;
+    } else if (static_cast<SlotRef*>(value)->slot_id()
+        != static_cast<SlotRef*>(pattern_set->slot_ref)->slot_id()) {
+      return;
+    }
+    // A NULL pattern makes the predicate NULL rather than false.
+    StringVal pattern_val = pattern->GetStringVal(nullptr, nullptr);
+    if (pattern_val.is_null) return;
+    string regex;
+    const string& fn_name = disjunct->function_name();
+    if (!LikePredicate::GetUnanchoredRegex(fn_name, pattern_val, &regex)) return;
+    // Invalid patterns are reported by the children when they are opened.
+    if (pattern_set->set.Add(regex, nullptr) < 0) return;
+  }
+  if (!pattern_set->set.Compile()) return;
+  pattern_set_ = move(pattern_set);
+  // The leaves of nested OrPredicates are matched by this one.
+  for (ScalarExpr* child : children_) {
+    OrPredicate* or_child = dynamic_cast<OrPredicate*>(child);
+    if (or_child != nullptr) or_child->pattern_set_.reset();
+  }
+}
+
+Status OrPredicate::OpenEvaluator(FunctionContext::FunctionStateScope scope,
+    RuntimeState* state, ScalarExprEvaluator* eval) const {
+  RETURN_IF_ERROR(CompoundPredicate::OpenEvaluator(scope, state, eval));
+  if (pattern_set_ != nullptr) {
+    FunctionContext* fn_ctx = eval->fn_context(fn_ctx_idx());
+    fn_ctx->SetFunctionState(
+        FunctionContext::THREAD_LOCAL, const_cast<OrPredicate*>(this));
+  }
+  return Status::OK();
+}
+
+void OrPredicate::CloseEvaluator(FunctionContext::FunctionStateScope scope,
+    RuntimeState* state, ScalarExprEvaluator* eval) const {
+  if (pattern_set_ != nullptr) {
+    FunctionContext* fn_ctx = eval->fn_context(fn_ctx_idx());
+    fn_ctx->SetFunctionState(FunctionContext::THREAD_LOCAL, nullptr);
+  }
+  CompoundPredicate::CloseEvaluator(scope, state, eval);
+}
+
+bool OrPredicate::MatchPatternSet(
+    ScalarExprEvaluator* eval, const TupleRow* row, BooleanVal* result) const {
+  StringVal val = pattern_set_->slot_ref->GetStringVal(eval, row);
+  if (val.is_null) {
+    *result = BooleanVal::null();
+    return true;
+  }
+  re2::RE2::Set::ErrorInfo error_info;
+  bool matched = pattern_set_->set.Match(
+      re2::StringPiece(reinterpret_cast<const char*>(val.ptr), val.len), nullptr,
+      &error_info);
+  // The DFA may run out of memory for some inputs.
+  if (!matched && error_info.kind != re2::RE2::Set::kNoError) return false;
+  *result = BooleanVal(matched);
+  return true;
+}
+
 // (<> || true) is true, (false || NULL) is NULL
 BooleanVal OrPredicate::GetBooleanValInterpreted(
     ScalarExprEvaluator* eval, const TupleRow* row) const {
   DCHECK_EQ(children_.size(), 2);
+  if (pattern_set_ != nullptr) {
+    BooleanVal result;
+    if (MatchPatternSet(eval, row, &result)) return result;
+  }
   BooleanVal val1 = children_[0]->GetBooleanVal(eval, row);
   if (!val1.is_null && val1.val) return BooleanVal(true); // short-circuit
 
@@ -61,12 +190,86 @@ BooleanVal OrPredicate::GetBooleanValInterpreted(
   return BooleanVal(false);
 }
 
+// A row passes (x || y) if x or y is true, so y is only evaluated on the rows for which
+// x is not true. The two sets of passing rows are then merged back into 'sel'.
+int OrPredicate::FilterBatchInterpreted(ScalarExprEvaluator* eval,
+    TupleRow* const* rows, int* sel, int num_sel) const {
+  DCHECK_EQ(children_.size(), 2);
+  // The pattern set evaluates all children at once for each row.
+  if (pattern_set_ != nullptr) {
+    return ScalarExpr::FilterBatchInterpreted(eval, rows, sel, num_sel);
+  }
+  ScalarExprEvaluator::ScopedSelScratch scratch(eval, 2 * num_sel);
+  int* input = scratch.data();
+  int* rest = input + num_sel;
+  memcpy(input, sel, num_sel * sizeof(int));
+  const int num_first = children_[0]->FilterBatch(eval, rows, sel, num_sel);
+  if (num_first == num_sel) return num_sel;
+  // Both 'input' and the rows that passed x are in ascending order.
+  int num_rest = 0;
+  for (int i = 0, j = 0; i < num_sel; ++i) {
+    if (j < num_first && sel[j] == input[i]) {
+      ++j;
+    } else {
+      rest[num_rest++] = input[i];
+    }
+  }
+  const int num_second = children_[1]->FilterBatch(eval, rows, rest, num_rest);
+  // Merge from the back so that the rows that passed x are not overwritten.
+  int i = num_first - 1;
+  int j = num_second - 1;
+  for (int k = num_first + num_second - 1; j >= 0; --k) {
+    if (i >= 0 && sel[i] > rest[j]) {
+      sel[k] = sel[i--];
+    } else {
+      sel[k] = rest[j--];
+    }
+  }
+  return num_first + num_second;
+}
+
 string OrPredicate::DebugString() const {
   stringstream out;
-  out << "OrPredicate(" << ScalarExpr::DebugString() << ")";
+  out << "OrPredicate(";
+  if (pattern_set_ != nullptr) out << "pattern_set ";
+  out << ScalarExpr::DebugString() << ")";
   return out.str();
 }
 
+// The codegen'd compute function of a predicate that is evaluated with a pattern set
+// calls the interpreted one, since matching the set dominates the cost:
+//
+// define i16 @OrPredicatePatternSet(%"class.impala::ScalarExprEvaluator"* %eval,
+//                                   %"class.impala::TupleRow"* %row) #49 {
+// entry:
+//   %result = call i16 @_ZN6impala11OrPredicate14EvalPatternSetEPNS_19ScalarExpr...(
+//       %"class.impala::ScalarExprEvaluator"* %eval, %"class.impala::TupleRow"* %row,
+//       i32 0)
+//   ret i16 %result
+// }
+Status OrPredicate::GetCodegendComputeFnImpl(LlvmCodeGen* codegen, llvm::Function** fn) {
+  if (pattern_set_ == nullptr) {
+    return CompoundPredicate::CodegenComputeFn(false, codegen, fn);
+  }
+  llvm::Function* eval_pattern_set_fn =
+      codegen->GetFunction(IRFunction::OR_PREDICATE_EVAL_PATTERN_SET, false);
+  llvm::LLVMContext& context = codegen->context();
+  LlvmBuilder builder(context);
+  llvm::Value* args[2];
+  llvm::Function* function =
+      CreateIrFunctionPrototype("OrPredicatePatternSet", codegen, &args);
+  llvm::BasicBlock* entry_block = llvm::BasicBlock::Create(context, "entry", function);
+  builder.SetInsertPoint(entry_block);
+  llvm::Value* result = builder.CreateCall(eval_pattern_set_fn,
+      {args[0], args[1], codegen->GetI32Constant(fn_ctx_idx())}, "result");
+  builder.CreateRet(result);
+  *fn = codegen->FinalizeFunction(function);
+  if (UNLIKELY(*fn == nullptr)) {
+    return Status(TErrorCode::IR_VERIFY_FAILED, "OrPredicate");
+  }
+  return Status::OK();
+}
+
 // IR codegen for compound and/or predicates.  Compound predicate has non trivial
 // null handling as well as many branches so this is pretty complicated.  The IR
 // for x && y is:
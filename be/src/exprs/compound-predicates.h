@@ -19,6 +19,7 @@
 #ifndef IMPALA_EXPRS_COMPOUND_PREDICATES_H_
 #define IMPALA_EXPRS_COMPOUND_PREDICATES_H_
 
+#include <memory>
 #include <string>
 #include "exprs/predicate.h"
 #include "gen-cpp/Exprs_types.h"
@@ -52,6 +53,9 @@ class AndPredicate: public CompoundPredicate {
   friend class ScalarExpr;
   AndPredicate(const TExprNode& node) : CompoundPredicate(node) { }
 
+  virtual int FilterBatchInterpreted(ScalarExprEvaluator* eval, TupleRow* const* rows,
+      int* sel, int num_sel) const override;
+
   virtual std::string DebugString() const;
 
  private:
@@ -59,23 +63,67 @@ class AndPredicate: public CompoundPredicate {
 };
 
 /// Expr for evaluating or (||) operators
+///
+/// A tree of OrPredicates whose leaves all are LIKE, ILIKE, RLIKE, REGEXP, IREGEXP or
+/// REGEXP_LIKE predicates with constant patterns on the same string slot, e.g.
+/// "col LIKE '%a%' OR col LIKE '%b%' OR regexp_like(col, 'c+d')", is evaluated by its
+/// root with a single RE2::Set of all patterns. The set matches the string against all
+/// patterns in one pass instead of once per pattern.
 class OrPredicate: public CompoundPredicate {
  public:
+  virtual ~OrPredicate();
+
   virtual BooleanVal GetBooleanValInterpreted(
       ScalarExprEvaluator*, const TupleRow*) const;
 
-  virtual Status GetCodegendComputeFnImpl(LlvmCodeGen* codegen, llvm::Function** fn) {
-    return CompoundPredicate::CodegenComputeFn(false, codegen, fn);
-  }
+  virtual Status GetCodegendComputeFnImpl(LlvmCodeGen* codegen, llvm::Function** fn);
+
+  /// Calls GetBooleanValInterpreted() of the OrPredicate that the FunctionContext at
+  /// 'fn_ctx_idx' in 'eval' belongs to. Called by the codegen'd compute function if the
+  /// predicate is evaluated with a pattern set.
+  static BooleanVal EvalPatternSet(
+      ScalarExprEvaluator* eval, const TupleRow* row, int fn_ctx_idx);
 
  protected:
   friend class ScalarExpr;
-  OrPredicate(const TExprNode& node) : CompoundPredicate(node) { }
+  OrPredicate(const TExprNode& node);
+
+  virtual Status Init(const RowDescriptor& row_desc, bool is_entry_point,
+      FragmentState* state) override WARN_UNUSED_RESULT;
+  virtual Status OpenEvaluator(FunctionContext::FunctionStateScope scope,
+      RuntimeState* state, ScalarExprEvaluator* eval) const override WARN_UNUSED_RESULT;
+  virtual void CloseEvaluator(FunctionContext::FunctionStateScope scope,
+      RuntimeState* state, ScalarExprEvaluator* eval) const override;
+
+  /// The FunctionContext only is used to find this predicate from codegen'd code.
+  virtual bool HasFnCtx() const override { return pattern_set_ != nullptr; }
+
+  virtual int FilterBatchInterpreted(ScalarExprEvaluator* eval, TupleRow* const* rows,
+      int* sel, int num_sel) const override;
 
   virtual std::string DebugString() const;
 
  private:
   friend class OpcodeRegistry;
+
+  struct PatternSet;
+
+  /// The patterns of all the leaves of the tree rooted at this predicate, if they can be
+  /// matched at once. NULL otherwise, and in predicates that are part of a larger tree.
+  std::unique_ptr<PatternSet> pattern_set_;
+
+  /// Adds the leaves of the tree of OrPredicates rooted at this one to 'disjuncts'.
+  void GetDisjuncts(std::vector<ScalarExpr*>* disjuncts) const;
+
+  /// Sets 'pattern_set_' if the leaves of the tree are predicates whose patterns can be
+  /// matched at once.
+  void InitPatternSet();
+
+  /// Matches the value of the slot against 'pattern_set_' and stores the result of the
+  /// predicate in 'result'. Returns false if the set could not be matched, in which case
+  /// the children need to be evaluated instead.
+  bool MatchPatternSet(
+      ScalarExprEvaluator* eval, const TupleRow* row, BooleanVal* result) const;
 };
 
 }
@@ -5046,6 +5046,34 @@ TEST_P(ExprTest, StringRegexpFunctions) {
       R"('([[:alpha:]]+)(\\\\\\\\)([[:alpha:]]+)', 3))", "world");
 }
 
+// Regex functions whose pattern is not constant find the compiled regexes in a
+// RegexCache. The functions are evaluated in an aggregation over a union, so that the
+// patterns are slots and the planner cannot fold them into constants. Patterns repeat
+// across rows, so most of them are cache hits, and invalid patterns are cached too.
+TEST_P(ExprTest, NonConstantRegexPatterns) {
+  const string regex_rows = " from (values ('a.c' as p, 'abc' as s), ('x+', 'axxb'), "
+      "('a.c', 'xbc'), ('x+', 'ab'), ('a.c', 'aac'), ('(b)', 'abc'), ('x+', 'xyx')) as t";
+  TestValue("sum(cast(regexp_like(s, p) as int))" + regex_rows, TYPE_BIGINT, 5);
+  TestValue("sum(cast(s regexp p as int))" + regex_rows, TYPE_BIGINT, 5);
+  TestValue("sum(length(regexp_extract(s, p, 0)))" + regex_rows, TYPE_BIGINT, 10);
+  TestValue("sum(length(regexp_replace(s, p, '-')))" + regex_rows, TYPE_BIGINT, 16);
+  TestValue("sum(regexp_match_count(s, p))" + regex_rows, TYPE_BIGINT, 6);
+
+  const string like_rows = " from (values ('a%' as p, 'abc' as s), ('%c', 'abc'), "
+      "('a%', 'bc'), ('%c', 'ab'), ('a_c', 'abc'), ('a%', 'a'), ('%c', 'ABC')) as t";
+  TestValue("sum(cast(s like p as int))" + like_rows, TYPE_BIGINT, 4);
+
+  const string invalid_rows = " from (values ('a.c' as p, 'abc' as s), ('a(b', 'ab'), "
+      "('x+', 'xx'), ('a(b', 'ab')) as t";
+  TestErrorString("sum(cast(regexp_like(s, p) as int))" + invalid_rows,
+      "Invalid regex: a(b");
+  TestErrorString("sum(cast(s regexp p as int))" + invalid_rows, "Invalid regex: a(b");
+  TestErrorString("sum(regexp_match_count(s, p))" + invalid_rows,
+      "Could not compile regexp pattern: a(b\nError: missing ): a(b");
+  // regexp_extract() only adds a warning and returns NULL for an invalid pattern.
+  TestValue("count(regexp_extract(s, p, 0))" + invalid_rows, TYPE_BIGINT, 2);
+}
+
 TEST_P(ExprTest, StringParseUrlFunction) {
   // TODO: For now, our parse_url my not behave exactly like Hive
   // when given malformed URLs.
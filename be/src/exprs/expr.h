@@ -67,6 +67,9 @@ class Expr {
  public:
   const std::string& function_name() const { return fn_.name.function_name; }
 
+  /// Returns true if 'fn_' is a builtin rather than a user-defined function.
+  bool is_builtin_fn() const { return fn_.binary_type == TFunctionBinaryType::BUILTIN; }
+
   virtual ~Expr();
 
   /// Returns true if the given Expr is an AggFn. Overridden by AggFn.
@@ -115,6 +118,7 @@ class Expr {
   std::vector<ScalarExpr*> children_;
 
  private:
+  friend class BatchPredicateTest;
   friend class ExprTest;
   friend class ExprCodegenTest;
 
@@ -66,7 +66,9 @@ void LikePredicate::LikePrepareInternal(FunctionContext* context,
   LikePredicateState* state = new LikePredicateState();
   state->function_ = LikeFn;
   context->SetFunctionState(scope, state);
-  if (context->IsArgConstant(1)) {
+  if (!context->IsArgConstant(1)) {
+    state->regex_cache_.reset(new RegexCache(context));
+  } else {
     StringVal pattern_val = *reinterpret_cast<StringVal*>(context->GetConstantArg(1));
     if (pattern_val.is_null) return;
     StringValue pattern = StringValue::FromStringVal(pattern_val);
@@ -114,6 +116,9 @@ void LikePredicate::LikeClose(FunctionContext* context,
   if (scope == FunctionContext::THREAD_LOCAL) {
     LikePredicateState* state = reinterpret_cast<LikePredicateState*>(
         context->GetFunctionState(FunctionContext::THREAD_LOCAL));
+    if (state != nullptr && state->regex_cache_ != nullptr) {
+      state->regex_cache_->UpdateProfile(context);
+    }
     delete state;
     context->SetFunctionState(FunctionContext::THREAD_LOCAL, nullptr);
   }
@@ -135,7 +140,9 @@ void LikePredicate::RegexPrepareInternal(FunctionContext* context,
   LikePredicateState* state = new LikePredicateState();
   context->SetFunctionState(scope, state);
   state->function_ = RegexFn;
-  if (context->IsArgConstant(1)) {
+  if (!context->IsArgConstant(1)) {
+    state->regex_cache_.reset(new RegexCache(context));
+  } else {
     StringVal* pattern = reinterpret_cast<StringVal*>(context->GetConstantArg(1));
     if (pattern->is_null) return;
     string pattern_str(reinterpret_cast<const char*>(pattern->ptr), pattern->len);
@@ -182,8 +189,11 @@ void LikePredicate::RegexpLikePrepare(FunctionContext* context,
   LikePredicateState* state = new LikePredicateState();
   context->SetFunctionState(scope, state);
   // If both the pattern and the match parameter are constant, we pre-compile the
-  // regular expression once here. Otherwise, the RE is compiled per row in RegexpLike()
-  if (context->IsArgConstant(1) && context->IsArgConstant(2)) {
+  // regular expression once here. Otherwise, RegexpLike() compiles the RE per row and
+  // caches it.
+  if (!context->IsArgConstant(1) || !context->IsArgConstant(2)) {
+    state->regex_cache_.reset(new RegexCache(context));
+  } else {
     StringVal* pattern;
     pattern = reinterpret_cast<StringVal*>(context->GetConstantArg(1));
     if (pattern->is_null) return;
@@ -215,7 +225,7 @@ BooleanVal LikePredicate::RegexpLikeInternal(FunctionContext* context,
     const StringVal& val, const StringVal& pattern, const StringVal& match_parameter) {
   if (val.is_null || pattern.is_null) return BooleanVal::null();
   // If either the pattern or the third optional match parameter are not constant, we
-  // have to recompile the RE for every row.
+  // have to compile the RE for every row, or find it in the cache.
   if (!context->IsArgConstant(2) || !context->IsArgConstant(1)) {
     if (match_parameter.is_null) return BooleanVal::null();
     RE2::Options opts;
@@ -224,13 +234,16 @@ BooleanVal LikePredicate::RegexpLikeInternal(FunctionContext* context,
       context->SetError(error_str.c_str());
       return BooleanVal(false);
     }
-    string re_pattern(reinterpret_cast<const char*>(pattern.ptr), pattern.len);
-    re2::RE2 re(re_pattern, opts);
+    LikePredicateState* state = reinterpret_cast<LikePredicateState*>(
+        context->GetFunctionState(FunctionContext::THREAD_LOCAL));
+    re2::StringPiece re_pattern(reinterpret_cast<const char*>(pattern.ptr), pattern.len);
+    const RE2& re = state->regex_cache_->GetOrCompile(re_pattern, opts);
     if (re.ok()) {
       return RE2::PartialMatch(
           re2::StringPiece(reinterpret_cast<const char*>(val.ptr), val.len), re);
     } else {
-      context->SetError(Substitute("Invalid regex: $0", re_pattern).c_str());
+      string pattern_str(re_pattern.data(), re_pattern.size());
+      context->SetError(Substitute("Invalid regex: $0", pattern_str).c_str());
       return BooleanVal(false);
     }
   }
@@ -242,6 +255,9 @@ void LikePredicate::RegexClose(FunctionContext* context,
   if (scope == FunctionContext::THREAD_LOCAL) {
     LikePredicateState* state = reinterpret_cast<LikePredicateState*>(
         context->GetFunctionState(FunctionContext::THREAD_LOCAL));
+    if (state != nullptr && state->regex_cache_ != nullptr) {
+      state->regex_cache_->UpdateProfile(context);
+    }
     delete state;
     context->SetFunctionState(FunctionContext::THREAD_LOCAL, nullptr);
   }
@@ -338,6 +354,8 @@ BooleanVal LikePredicate::RegexMatch(FunctionContext* context,
           operand_value.ptr), operand_value.len), *state->regex_.get());
     }
   } else {
+    LikePredicateState* state = reinterpret_cast<LikePredicateState*>(
+        context->GetFunctionState(FunctionContext::THREAD_LOCAL));
     string re_pattern;
     RE2::Options opts;
     if (is_like_pattern) {
@@ -348,7 +366,7 @@ BooleanVal LikePredicate::RegexMatch(FunctionContext* context,
       re_pattern =
         string(reinterpret_cast<const char*>(pattern_value.ptr), pattern_value.len);
     }
-    re2::RE2 re(re_pattern, opts);
+    const RE2& re = state->regex_cache_->GetOrCompile(re_pattern, opts);
     if (re.ok()) {
       if (is_like_pattern) {
         return RE2::FullMatch(re2::StringPiece(
@@ -368,11 +386,36 @@ BooleanVal LikePredicate::RegexMatch(FunctionContext* context,
   }
 }
 
+bool LikePredicate::GetUnanchoredRegex(const string& fn_name, const StringVal& pattern,
+    string* regex) {
+  const bool is_like = fn_name == "like" || fn_name == "ilike";
+  if (!is_like && fn_name != "rlike" && fn_name != "regexp" && fn_name != "iregexp"
+      && fn_name != "regexp_like") {
+    return false;
+  }
+  regex->clear();
+  if (fn_name == "ilike" || fn_name == "iregexp") regex->append("(?i)");
+  if (is_like) {
+    // LIKE patterns must match the whole string, and '%' and '_' also match newlines.
+    string like_regex;
+    ConvertLikePattern(pattern, DEFAULT_ESCAPE_CHAR, &like_regex);
+    regex->append("(?s)\\A(?:").append(like_regex).append(")\\z");
+  } else {
+    regex->append(reinterpret_cast<const char*>(pattern.ptr), pattern.len);
+  }
+  return true;
+}
+
 void LikePredicate::ConvertLikePattern(FunctionContext* context, const StringVal& pattern,
     string* re_pattern) {
-  re_pattern->clear();
   LikePredicateState* state = reinterpret_cast<LikePredicateState*>(
       context->GetFunctionState(FunctionContext::THREAD_LOCAL));
+  ConvertLikePattern(pattern, state->escape_char_, re_pattern);
+}
+
+void LikePredicate::ConvertLikePattern(const StringVal& pattern, char escape_char,
+    string* re_pattern) {
+  re_pattern->clear();
   bool is_escaped = false;
   for (int i = 0; i < pattern.len; ++i) {
     if (!is_escaped && pattern.ptr[i] == '%') {
@@ -380,7 +423,7 @@ void LikePredicate::ConvertLikePattern(FunctionContext* context, const StringVal
     } else if (!is_escaped && pattern.ptr[i] == '_') {
       re_pattern->append(".");
     // check for escape char before checking for regex special chars, they might overlap
-    } else if (!is_escaped && pattern.ptr[i] == state->escape_char_) {
+    } else if (!is_escaped && pattern.ptr[i] == escape_char) {
       is_escaped = true;
     } else if (
         pattern.ptr[i] == '.'
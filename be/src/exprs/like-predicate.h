@@ -24,6 +24,7 @@
 #include <string>
 
 #include "exprs/predicate.h"
+#include "exprs/regex-cache.h"
 #include "gen-cpp/Exprs_types.h"
 #include "runtime/string-search.h"
 #include "udf/udf.h"
@@ -39,6 +40,14 @@ class LikePredicate: public Predicate {
  public:
   ~LikePredicate() { }
 
+  /// Returns in 'regex' a regular expression that is found in exactly the strings for
+  /// which the builtin function 'fn_name' returns true with the pattern 'pattern'.
+  /// 'fn_name' must be one of the two-argument predicates LIKE, ILIKE, RLIKE, REGEXP,
+  /// IREGEXP and REGEXP_LIKE, otherwise false is returned. Used to search for the
+  /// patterns of many predicates at once with an RE2::Set.
+  static bool GetUnanchoredRegex(const std::string& fn_name,
+      const impala_udf::StringVal& pattern, std::string* regex);
+
  protected:
   friend class ScalarExprEvaluator;
 
@@ -49,6 +58,9 @@ class LikePredicate: public Predicate {
   typedef impala_udf::BooleanVal (*LikePredicateFunction) (impala_udf::FunctionContext*,
       const impala_udf::StringVal&, const impala_udf::StringVal&);
 
+  /// The escape char of LIKE patterns.
+  static const char DEFAULT_ESCAPE_CHAR = '\\';
+
   struct LikePredicateState {
     char escape_char_;
 
@@ -79,7 +91,10 @@ class LikePredicate: public Predicate {
     /// Used for RLIKE and REGEXP predicates if the pattern is a constant argument.
     boost::scoped_ptr<re2::RE2> regex_;
 
-    LikePredicateState() : escape_char_('\\') {
+    /// Cache of the compiled patterns if the pattern is not a constant argument.
+    boost::scoped_ptr<RegexCache> regex_cache_;
+
+    LikePredicateState() : escape_char_(DEFAULT_ESCAPE_CHAR) {
     }
 
     void SetSearchString(const std::string& search_string) {
@@ -174,6 +189,10 @@ class LikePredicate: public Predicate {
   /// regular expression pattern. Escaped chars are copied verbatim.
   static void ConvertLikePattern(impala_udf::FunctionContext* context,
       const impala_udf::StringVal& pattern, std::string* re_pattern);
+
+  /// Same as above, with the escape char 'escape_char'.
+  static void ConvertLikePattern(const impala_udf::StringVal& pattern, char escape_char,
+      std::string* re_pattern);
 };
 
 }  // namespace impala
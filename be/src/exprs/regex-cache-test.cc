@@ -0,0 +1,181 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "exprs/regex-cache.h"
+
+#include "runtime/mem-pool.h"
+#include "runtime/mem-tracker.h"
+#include "testutil/gtest-util.h"
+#include "udf/udf-internal.h"
+
+#include "common/names.h"
+
+using impala_udf::FunctionContext;
+
+namespace impala {
+
+static const int64_t NO_MEM_LIMIT = 1L << 30;
+static const int64_t REGEX_MAX_MEM = 64L * 1024L;
+
+TEST(RegexCacheTest, HitsAndMisses) {
+  RegexCache cache(nullptr, 4, NO_MEM_LIMIT, REGEX_MAX_MEM);
+  re2::RE2::Options options;
+  const re2::RE2& re = cache.GetOrCompile("a+b", options);
+  ASSERT_TRUE(re.ok());
+  EXPECT_TRUE(re2::RE2::FullMatch("aab", re));
+  EXPECT_EQ(0, cache.hits());
+  EXPECT_EQ(1, cache.misses());
+  EXPECT_EQ(&re, &cache.GetOrCompile("a+b", options));
+  EXPECT_EQ(1, cache.hits());
+  EXPECT_EQ(1, cache.misses());
+
+  // The same pattern with different options is a different regex.
+  re2::RE2::Options case_insensitive;
+  case_insensitive.set_case_sensitive(false);
+  const re2::RE2& re_ci = cache.GetOrCompile("a+b", case_insensitive);
+  EXPECT_TRUE(re2::RE2::FullMatch("AaB", re_ci));
+  EXPECT_FALSE(re2::RE2::FullMatch("AaB", cache.GetOrCompile("a+b", options)));
+  EXPECT_EQ(2, cache.hits());
+  EXPECT_EQ(2, cache.misses());
+  EXPECT_EQ(2, cache.size());
+}
+
+TEST(RegexCacheTest, InvalidPattern) {
+  RegexCache cache(nullptr, 4, NO_MEM_LIMIT, REGEX_MAX_MEM);
+  re2::RE2::Options options;
+  options.set_log_errors(false);
+  EXPECT_FALSE(cache.GetOrCompile("a(b", options).ok());
+  // Invalid patterns are cached so that they are not compiled for every row.
+  EXPECT_FALSE(cache.GetOrCompile("a(b", options).ok());
+  EXPECT_EQ(1, cache.hits());
+  EXPECT_EQ(1, cache.misses());
+}
+
+TEST(RegexCacheTest, EvictsLeastRecentlyUsed) {
+  RegexCache cache(nullptr, 2, NO_MEM_LIMIT, REGEX_MAX_MEM);
+  re2::RE2::Options options;
+  cache.GetOrCompile("a", options);
+  cache.GetOrCompile("b", options);
+  // Use "a" so that "b" is the least recently used one.
+  cache.GetOrCompile("a", options);
+  EXPECT_EQ(1, cache.hits());
+  cache.GetOrCompile("c", options);
+  EXPECT_EQ(2, cache.size());
+  EXPECT_EQ(3, cache.misses());
+  cache.GetOrCompile("a", options);
+  EXPECT_EQ(2, cache.hits());
+  cache.GetOrCompile("b", options);
+  EXPECT_EQ(2, cache.hits());
+  EXPECT_EQ(4, cache.misses());
+  EXPECT_EQ(2, cache.size());
+}
+
+// Least recently used regexes are evicted to keep the estimated memory of the cache
+// below its limit, while a regex that exceeds the limit on its own is still cached.
+TEST(RegexCacheTest, BoundedByMemory) {
+  re2::RE2::Options options;
+  int64_t small_bytes;
+  {
+    RegexCache cache(nullptr, 100, NO_MEM_LIMIT, REGEX_MAX_MEM);
+    cache.GetOrCompile("a+b", options);
+    small_bytes = cache.bytes();
+    EXPECT_GT(small_bytes, 0);
+  }
+  RegexCache cache(nullptr, 100, 3 * small_bytes, REGEX_MAX_MEM);
+  cache.GetOrCompile("a+b", options);
+  cache.GetOrCompile("a+c", options);
+  cache.GetOrCompile("a+d", options);
+  EXPECT_EQ(3, cache.size());
+  EXPECT_EQ(3 * small_bytes, cache.bytes());
+  // Use "a+b" so that "a+c" is the least recently used one.
+  cache.GetOrCompile("a+b", options);
+  cache.GetOrCompile("a+e", options);
+  EXPECT_EQ(3, cache.size());
+  EXPECT_LE(cache.bytes(), 3 * small_bytes);
+  EXPECT_EQ(1, cache.hits());
+  cache.GetOrCompile("a+b", options);
+  EXPECT_EQ(2, cache.hits());
+  cache.GetOrCompile("a+c", options);
+  EXPECT_EQ(2, cache.hits());
+
+  // A pattern that is too large for REGEX_MAX_MEM is charged the max_mem() of 'options'
+  // and evicts all other regexes.
+  const string large_pattern = "(abcdefgh){1000}";
+  const re2::RE2& large = cache.GetOrCompile(large_pattern, options);
+  ASSERT_TRUE(large.ok());
+  string large_match;
+  for (int i = 0; i < 1000; ++i) large_match += "abcdefgh";
+  EXPECT_TRUE(re2::RE2::PartialMatch(large_match, large));
+  EXPECT_EQ(1, cache.size());
+  EXPECT_GT(cache.bytes(), 3 * small_bytes);
+  EXPECT_EQ(&large, &cache.GetOrCompile(large_pattern, options));
+}
+
+// Cached regexes are compiled with a max_mem() of at most REGEX_MAX_MEM, which bounds
+// their DFA state caches, and that max_mem() is included in the estimated memory.
+TEST(RegexCacheTest, BoundsRegexMemory) {
+  RegexCache cache(nullptr, 4, NO_MEM_LIMIT, REGEX_MAX_MEM);
+  re2::RE2::Options options;
+  ASSERT_GT(options.max_mem(), REGEX_MAX_MEM);
+  const re2::RE2& re = cache.GetOrCompile("[a-z]+[0-9]*", options);
+  ASSERT_TRUE(re.ok());
+  EXPECT_EQ(REGEX_MAX_MEM, re.options().max_mem());
+  EXPECT_TRUE(re2::RE2::FullMatch("abc123", re));
+  EXPECT_GT(cache.bytes(), REGEX_MAX_MEM);
+
+  // A lower max_mem() of the caller is kept.
+  re2::RE2::Options low_max_mem;
+  low_max_mem.set_max_mem(REGEX_MAX_MEM / 2);
+  const re2::RE2& low = cache.GetOrCompile("a+b", low_max_mem);
+  EXPECT_EQ(REGEX_MAX_MEM / 2, low.options().max_mem());
+
+  // A pattern that does not fit in REGEX_MAX_MEM still compiles, with the max_mem() of
+  // the caller.
+  const re2::RE2& large = cache.GetOrCompile("(abcdefgh){1000}", options);
+  ASSERT_TRUE(large.ok());
+  EXPECT_EQ(options.max_mem(), large.options().max_mem());
+}
+
+// The memory of the cached regexes is charged to the MemTracker of the FunctionContext
+// and released when regexes are evicted and when the cache is destroyed.
+TEST(RegexCacheTest, TracksMemory) {
+  MemTracker tracker;
+  MemPool pool(&tracker);
+  FunctionContext::TypeDesc string_type;
+  string_type.type = FunctionContext::TYPE_STRING;
+  FunctionContext* context = FunctionContextImpl::CreateContext(
+      nullptr, &pool, &pool, string_type, {string_type, string_type}, 0, true);
+  {
+    RegexCache cache(context, 2, NO_MEM_LIMIT, REGEX_MAX_MEM);
+    re2::RE2::Options options;
+    options.set_log_errors(false);
+    cache.GetOrCompile("a+b", options);
+    EXPECT_GT(cache.bytes(), 0);
+    EXPECT_EQ(cache.bytes(), tracker.consumption());
+    cache.GetOrCompile("a(b", options);
+    cache.GetOrCompile("[a-z]+[0-9]*", options);
+    EXPECT_EQ(2, cache.size());
+    EXPECT_EQ(cache.bytes(), tracker.consumption());
+  }
+  EXPECT_EQ(0, tracker.consumption());
+  context->impl()->Close();
+  delete context;
+  pool.FreeAll();
+  tracker.Close();
+}
+
+}
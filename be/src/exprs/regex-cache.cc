@@ -0,0 +1,146 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "exprs/regex-cache.h"
+
+#include <gflags/gflags.h>
+
+#include "common/logging.h"
+#include "runtime/runtime-state.h"
+#include "udf/udf-internal.h"
+#include "util/runtime-profile-counters.h"
+
+#include "common/names.h"
+
+DEFINE_int32(regex_cache_capacity, 64, "(Advanced) Maximum number of compiled regular "
+    "expressions that each instance of a regex function with a non-constant pattern "
+    "keeps cached. Must be at least 1.");
+DEFINE_int64(regex_cache_max_bytes, 8L * 1024L * 1024L, "(Advanced) Maximum estimated "
+    "memory of the compiled regular expressions that each instance of a regex function "
+    "with a non-constant pattern keeps cached. The memory is counted against the query's "
+    "memory limit.");
+DEFINE_int64(regex_cache_regex_max_mem, 256L * 1024L, "(Advanced) Maximum memory of "
+    "each regular expression cached by a regex function with a non-constant pattern, "
+    "including the DFA state it builds while matching. This much memory is counted "
+    "against --regex_cache_max_bytes for each cached regular expression. Patterns that "
+    "are too large for it are compiled without this limit.");
+
+using impala_udf::FunctionContext;
+
+namespace impala {
+
+RegexCache::RegexCache(FunctionContext* context)
+  : RegexCache(context, max(1, FLAGS_regex_cache_capacity), FLAGS_regex_cache_max_bytes,
+        FLAGS_regex_cache_regex_max_mem) {
+}
+
+RegexCache::RegexCache(FunctionContext* context, int capacity, int64_t max_bytes,
+    int64_t regex_max_mem)
+  : context_(context),
+    capacity_(capacity),
+    max_bytes_(max_bytes),
+    regex_max_mem_(regex_max_mem) {
+  DCHECK_GE(capacity, 1);
+}
+
+RegexCache::~RegexCache() {
+  if (context_ != nullptr && bytes_ > 0) context_->Free(bytes_);
+}
+
+int64_t RegexCache::EstimateBytes(const string& key, const re2::RE2& regex) {
+  // The key is stored both in the entry and in 'index_'.
+  int64_t bytes = sizeof(Entry) + sizeof(re2::RE2) + 2 * key.size();
+  // max_mem() bounds the compiled program and the DFA state caches that RE2 builds
+  // while matching.
+  if (regex.ok()) bytes += regex.options().max_mem();
+  return bytes;
+}
+
+void RegexCache::EvictLast() {
+  DCHECK(!entries_.empty());
+  const int64_t bytes = entries_.back().bytes;
+  index_.erase(entries_.back().key);
+  entries_.pop_back();
+  bytes_ -= bytes;
+  if (context_ != nullptr) context_->Free(bytes);
+}
+
+void RegexCache::SetKey(
+    const re2::StringPiece& pattern, const re2::RE2::Options& options) {
+  // All options that affect the compiled regex, followed by the pattern.
+  const uint32_t flags = options.posix_syntax()
+      | options.longest_match() << 1
+      | options.log_errors() << 2
+      | options.literal() << 3
+      | options.never_nl() << 4
+      | options.dot_nl() << 5
+      | options.never_capture() << 6
+      | options.case_sensitive() << 7
+      | options.perl_classes() << 8
+      | options.word_boundary() << 9
+      | options.one_line() << 10
+      | static_cast<uint32_t>(options.encoding()) << 11;
+  const int64_t max_mem = options.max_mem();
+  key_.clear();
+  key_.append(reinterpret_cast<const char*>(&flags), sizeof(flags));
+  key_.append(reinterpret_cast<const char*>(&max_mem), sizeof(max_mem));
+  key_.append(pattern.data(), pattern.size());
+}
+
+const re2::RE2& RegexCache::GetOrCompile(
+    const re2::StringPiece& pattern, const re2::RE2::Options& options) {
+  SetKey(pattern, options);
+  auto it = index_.find(key_);
+  if (it != index_.end()) {
+    ++hits_;
+    // Move the entry to the front of the LRU list.
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return *it->second->regex;
+  }
+  ++misses_;
+  unique_ptr<re2::RE2> regex;
+  if (options.max_mem() > regex_max_mem_) {
+    re2::RE2::Options bounded_options(options);
+    bounded_options.set_max_mem(regex_max_mem_);
+    bounded_options.set_log_errors(false);
+    regex = make_unique<re2::RE2>(pattern, bounded_options);
+    // Compile the pattern again with the caller's options if it does not compile, e.g.
+    // because it needs more memory, so that the cache does not change which patterns
+    // compile or which errors are logged.
+    if (regex->error_code() != re2::RE2::NoError) regex.reset();
+  }
+  if (regex == nullptr) regex = make_unique<re2::RE2>(pattern, options);
+  const int64_t bytes = EstimateBytes(key_, *regex);
+  while (!entries_.empty() && (entries_.size() >= static_cast<size_t>(capacity_)
+      || bytes_ + bytes > max_bytes_)) {
+    EvictLast();
+  }
+  if (context_ != nullptr) context_->TrackAllocation(bytes);
+  bytes_ += bytes;
+  entries_.push_front(Entry{key_, move(regex), bytes});
+  index_.emplace(key_, entries_.begin());
+  return *entries_.front().regex;
+}
+
+void RegexCache::UpdateProfile(FunctionContext* context) const {
+  RuntimeState* state = context->impl()->state();
+  if (state == nullptr || state->runtime_profile() == nullptr) return;
+  RuntimeProfile* profile = state->runtime_profile();
+  COUNTER_ADD(profile->AddCounter("RegexCacheHits", TUnit::UNIT), hits_);
+  COUNTER_ADD(profile->AddCounter("RegexCacheMisses", TUnit::UNIT), misses_);
+}
+}
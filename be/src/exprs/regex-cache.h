@@ -0,0 +1,120 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <re2/re2.h>
+#include <re2/stringpiece.h>
+
+#include "udf/udf.h"
+
+namespace impala {
+
+/// A bounded cache of compiled regular expressions for the regex builtins whose pattern
+/// is not a constant, e.g. when it comes from a column of a table of rules that is
+/// joined with the rows to match. Compiling a regex usually costs much more than
+/// matching it, and such patterns tend to repeat across rows, so without a cache these
+/// functions spend most of their time compiling.
+///
+/// The cache holds up to 'capacity' regexes, keyed by the pattern and the options they
+/// were compiled with, and evicts the least recently used ones when it is full or when
+/// the estimated memory of its regexes exceeds 'max_bytes'. That memory is charged to
+/// the MemTracker of the FunctionContext that owns the cache via TrackAllocation().
+/// RE2 grows the DFA state caches of a regex while matching, up to
+/// RE2::Options::max_mem() for the program and its DFAs together, so the cache charges
+/// max_mem() for each regex. To keep that small, the regexes are compiled with a
+/// max_mem() of at most 'regex_max_mem', unless the pattern does not fit in it. A cache
+/// is owned by the THREAD_LOCAL state of a FunctionContext and is not thread-safe.
+class RegexCache {
+ public:
+  /// Creates a cache with the capacity and memory limits set by --regex_cache_capacity,
+  /// --regex_cache_max_bytes and --regex_cache_regex_max_mem. The memory of the cached
+  /// regexes is charged to 'context', unless it is nullptr.
+  explicit RegexCache(impala_udf::FunctionContext* context);
+
+  /// 'capacity' must be at least 1. A regex that exceeds 'max_bytes' on its own is still
+  /// cached, as the only entry.
+  RegexCache(impala_udf::FunctionContext* context, int capacity, int64_t max_bytes,
+      int64_t regex_max_mem);
+
+  /// Releases the memory charged to 'context', so the cache must be destroyed before
+  /// 'context' is closed.
+  ~RegexCache();
+
+  /// Returns the regex compiled from 'pattern' with 'options', compiling it if it is not
+  /// cached. The regex is compiled with a max_mem() of at most 'regex_max_mem', or with
+  /// 'options' as they are if the pattern is too large for that. Patterns that fail to
+  /// compile are cached too, so callers must check ok() on the result. The regex is
+  /// owned by the cache and stays valid until the next call.
+  const re2::RE2& GetOrCompile(
+      const re2::StringPiece& pattern, const re2::RE2::Options& options);
+
+  /// Adds the number of hits and misses of the cache to the counters RegexCacheHits and
+  /// RegexCacheMisses in the runtime profile of the fragment instance that evaluates
+  /// 'context'. Called when the function is closed.
+  void UpdateProfile(impala_udf::FunctionContext* context) const;
+
+  int64_t hits() const { return hits_; }
+  int64_t misses() const { return misses_; }
+  int size() const { return entries_.size(); }
+
+  /// The estimated memory of the cached regexes.
+  int64_t bytes() const { return bytes_; }
+
+ private:
+  struct Entry {
+    std::string key;
+    std::unique_ptr<re2::RE2> regex;
+    /// The estimated memory of this entry, including its key in 'index_'.
+    int64_t bytes;
+  };
+
+  /// Returns the estimated memory of an entry for 'regex' with the key 'key'.
+  static int64_t EstimateBytes(const std::string& key, const re2::RE2& regex);
+
+  /// Removes the least recently used entry and releases its memory.
+  void EvictLast();
+
+  /// Sets 'key_' to the key of 'pattern' with 'options'.
+  void SetKey(const re2::StringPiece& pattern, const re2::RE2::Options& options);
+
+  impala_udf::FunctionContext* const context_;
+  const int capacity_;
+  const int64_t max_bytes_;
+  const int64_t regex_max_mem_;
+
+  /// The cached regexes, the most recently used first.
+  std::list<Entry> entries_;
+
+  /// Maps the keys of the cached regexes to their entries in 'entries_'.
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+
+  /// Buffer for the key of the current lookup, reused to avoid an allocation per row.
+  std::string key_;
+
+  /// The sum of 'bytes' of all entries.
+  int64_t bytes_ = 0;
+
+  int64_t hits_ = 0;
+  int64_t misses_ = 0;
+};
+}
@@ -400,6 +400,11 @@ BooleanVal ScalarExprEvaluator::GetBooleanVal(const TupleRow* row) {
   return root_.GetBooleanVal(this, row);
 }
 
+int ScalarExprEvaluator::EvalPredicateBatch(
+    TupleRow* const* rows, int* sel, int num_sel) {
+  return root_.FilterBatch(this, rows, sel, num_sel);
+}
+
 TinyIntVal ScalarExprEvaluator::GetTinyIntVal(const TupleRow* row) {
   return root_.GetTinyIntVal(this, row);
 }
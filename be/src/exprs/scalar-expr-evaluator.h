@@ -18,6 +18,7 @@
 #ifndef IMPALA_EXPRS_SCALAR_EXPR_EVALUATOR_H
 #define IMPALA_EXPRS_SCALAR_EXPR_EVALUATOR_H
 
+#include <vector>
 #include <boost/scoped_ptr.hpp>
 
 #include "common/object-pool.h"
@@ -183,6 +184,36 @@ class ScalarExprEvaluator {
     return false;
   }
 
+  /// Batch-at-a-time version of EvalPredicate(). Evaluates the predicate against
+  /// 'rows[sel[i]]' for each i in [0, num_sel), where 'sel' is in ascending order, and
+  /// compacts 'sel' in place to the indices of the rows that passed, preserving their
+  /// order. Returns the number of rows that passed. See ScalarExpr::FilterBatch().
+  int EvalPredicateBatch(TupleRow* const* rows, int* sel, int num_sel);
+
+  /// Scratch selection vector of at least 'len' ints that is borrowed from 'eval' for
+  /// the lifetime of this object. Used by FilterBatchInterpreted() implementations so
+  /// that they do not allocate for every batch. Nested users get separate buffers: the
+  /// buffers are kept in a stack that grows with the nesting depth.
+  class ScopedSelScratch {
+   public:
+    ScopedSelScratch(ScalarExprEvaluator* eval, int len) : eval_(eval) {
+      std::vector<std::vector<int>>& stack = eval->sel_scratch_;
+      int depth = eval->sel_scratch_depth_++;
+      if (depth == static_cast<int>(stack.size())) stack.emplace_back();
+      std::vector<int>* buffer = &stack[depth];
+      if (static_cast<int>(buffer->size()) < len) buffer->resize(len);
+      data_ = buffer->data();
+    }
+
+    ~ScopedSelScratch() { --eval_->sel_scratch_depth_; }
+
+    int* data() const { return data_; }
+
+   private:
+    ScalarExprEvaluator* const eval_;
+    int* data_;
+  };
+
   /// Returns an error status if there was any error in evaluating the expression
   /// or its sub-expressions. 'start_idx' and 'end_idx' correspond to the range
   /// within the vector of FunctionContext for the sub-expressions of interest.
@@ -277,6 +308,11 @@ class ScalarExprEvaluator {
   /// TODO: move this to Expr initialization after IMPALA-4743 is fixed.
   int output_scale_ = -1;
 
+  /// Buffers handed out by ScopedSelScratch, one per nesting level, and the number of
+  /// them that are currently in use. Reused across batches.
+  std::vector<std::vector<int>> sel_scratch_;
+  int sel_scratch_depth_ = 0;
+
   ScalarExprEvaluator(const ScalarExpr& root, MemPool* expr_perm_pool,
       MemPool* expr_results_pool);
 
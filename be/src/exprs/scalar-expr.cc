@@ -335,6 +335,29 @@ bool ScalarExpr::ShouldCodegen(const FragmentState* state) const {
       && !((state->CodegenHasDisableHint() || is_codegen_disabled_) && IsInterpretable());
 }
 
+int ScalarExpr::FilterBatch(ScalarExprEvaluator* eval, TupleRow* const* rows,
+    int* sel, int num_sel) const {
+  DCHECK_EQ(type_.type, PrimitiveType::TYPE_BOOLEAN);
+  // A codegen'd entry point is faster than the interpreted batch implementation, which
+  // would bypass it.
+  if (codegend_compute_fn_.load() != nullptr) {
+    return ScalarExpr::FilterBatchInterpreted(eval, rows, sel, num_sel);
+  }
+  return FilterBatchInterpreted(eval, rows, sel, num_sel);
+}
+
+int ScalarExpr::FilterBatchInterpreted(ScalarExprEvaluator* eval,
+    TupleRow* const* rows, int* sel, int num_sel) const {
+  int num_passed = 0;
+  for (int i = 0; i < num_sel; ++i) {
+    const int row_idx = sel[i];
+    BooleanVal v = GetBooleanVal(eval, rows[row_idx]);
+    sel[num_passed] = row_idx;
+    num_passed += !v.is_null && v.val;
+  }
+  return num_passed;
+}
+
 int ScalarExpr::GetSlotIds(vector<SlotId>* slot_ids) const {
   int n = 0;
   for (int i = 0; i < children_.size(); ++i) {
@@ -137,6 +137,17 @@ struct ScalarExprsResultsRowLayout {
 /// (e.g. by ScalarExprEvaluator::GetConstValue()) but may fail back to a slower
 /// interpreted implementation.
 ///
+/// --- Batch-at-a-time evaluation:
+///
+/// Predicates can also be evaluated against a whole batch of rows at once with
+/// FilterBatch(), which narrows a selection vector of row indices down to the rows
+/// that pass. Interpreted operators use it when their predicates are not codegen'd,
+/// since it replaces the per-row walk over the expr tree with a loop per expr node.
+/// Subclasses override FilterBatchInterpreted() for the predicates they can evaluate
+/// over the whole selection without the row-at-a-time compute functions, e.g.
+/// AndPredicate or comparisons of a slot with a constant. Other predicates fall back
+/// to calling GetBooleanVal() for every selected row.
+///
 class ScalarExpr : public Expr {
  public:
   /// Create a new ScalarExpr based on thrift Expr 'texpr'. The newly created ScalarExpr
@@ -239,6 +250,7 @@ class ScalarExpr : public Expr {
   friend class HdfsOrcScanner;
 
   /// For BE tests
+  friend class BatchPredicateTest;
   friend class ExprTest;
   friend class ExprCodegenTest;
   friend class HashTableTest;
@@ -282,6 +294,20 @@ class ScalarExpr : public Expr {
   DecimalVal GetDecimalVal(ScalarExprEvaluator*, const TupleRow*) const;
   DateVal GetDateVal(ScalarExprEvaluator*, const TupleRow*) const;
 
+  /// Evaluates this BOOLEAN expr with predicate semantics, i.e. NULL is treated as false,
+  /// against 'rows[sel[i]]' for each i in [0, num_sel). The indices in 'sel' must be in
+  /// ascending order. Compacts 'sel' in place to the indices of the rows that passed,
+  /// preserving their order, and returns their number. Calls the codegen'd compute
+  /// function row by row if there is one, or FilterBatchInterpreted() otherwise.
+  int FilterBatch(ScalarExprEvaluator* eval, TupleRow* const* rows, int* sel,
+      int num_sel) const;
+
+  /// Interpreted implementation of FilterBatch(). The default implementation calls
+  /// GetBooleanVal() for every selected row. Subclasses override it to evaluate the
+  /// predicate over the whole selection at once.
+  virtual int FilterBatchInterpreted(ScalarExprEvaluator* eval, TupleRow* const* rows,
+      int* sel, int num_sel) const;
+
   /// Virtual compute functions for each return type. Each subclass should override
   /// the functions for the return type(s) it supports. For example, a boolean function
   /// will only override GetBooleanValInterpreted(). Some Exprs, like Literal, have many
@@ -31,10 +31,12 @@
 #include "codegen/llvm-codegen.h"
 #include "exprs/anyval-util.h"
 #include "exprs/scalar-expr-evaluator.h"
+#include "exprs/slot-ref.h"
 #include "runtime/fragment-state.h"
 #include "runtime/hdfs-fs-cache.h"
 #include "runtime/lib-cache.h"
 #include "runtime/runtime-state.h"
+#include "runtime/tuple-row.h"
 #include "runtime/types.h"
 #include "udf/udf-internal.h"
 #include "util/debug-util.h"
@@ -130,9 +132,177 @@ Status ScalarFnCall::Init(
     // until the first time GetCodegendComputeFn() is invoked.
     RETURN_IF_ERROR(LoadPrepareAndCloseFn(nullptr));
   }
+  InitBatchPredicate();
   return Status::OK();
 }
 
+void ScalarFnCall::InitBatchPredicate() {
+  if (fn_.binary_type != TFunctionBinaryType::BUILTIN) return;
+  if (type_.type != TYPE_BOOLEAN || vararg_start_idx_ != -1) return;
+  const string& name = fn_.name.function_name;
+  if (children_.size() == 1) {
+    if (!children_[0]->IsSlotRef() || children_[0]->type().IsComplexType()) return;
+    if (name == "is_null_pred") {
+      batch_predicate_ = BatchPredicate::IS_NULL;
+    } else if (name == "is_not_null_pred") {
+      batch_predicate_ = BatchPredicate::IS_NOT_NULL;
+    } else {
+      return;
+    }
+    batch_slot_child_idx_ = 0;
+    return;
+  }
+  if (children_.size() != 2 || children_[0]->type() != children_[1]->type()) return;
+  switch (children_[0]->type().type) {
+    case TYPE_BOOLEAN:
+    case TYPE_TINYINT:
+    case TYPE_SMALLINT:
+    case TYPE_INT:
+    case TYPE_BIGINT:
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE:
+    case TYPE_DATE:
+      break;
+    default:
+      return;
+  }
+  struct Comparison {
+    const char* name;
+    // The predicate for the operand orders <slot> <op> <literal> and
+    // <literal> <op> <slot>.
+    BatchPredicate slot_first;
+    BatchPredicate literal_first;
+  };
+  static const Comparison COMPARISONS[] = {
+      {"eq", BatchPredicate::EQ, BatchPredicate::EQ},
+      {"ne", BatchPredicate::NE, BatchPredicate::NE},
+      {"lt", BatchPredicate::LT, BatchPredicate::GT},
+      {"le", BatchPredicate::LE, BatchPredicate::GE},
+      {"gt", BatchPredicate::GT, BatchPredicate::LT},
+      {"ge", BatchPredicate::GE, BatchPredicate::LE}};
+  for (const Comparison& comparison : COMPARISONS) {
+    if (name != comparison.name) continue;
+    if (children_[0]->IsSlotRef() && children_[1]->IsLiteral()) {
+      batch_predicate_ = comparison.slot_first;
+      batch_slot_child_idx_ = 0;
+    } else if (children_[0]->IsLiteral() && children_[1]->IsSlotRef()) {
+      batch_predicate_ = comparison.literal_first;
+      batch_slot_child_idx_ = 1;
+    }
+    return;
+  }
+}
+
+// Compacts 'sel' to the rows for which the slot of 'slot_ref' is not NULL and 'pred'
+// returns true for its value, which is read as type 'T'. The selection is compacted
+// without branching on the result of 'pred'.
+template <typename T, typename Pred>
+static int FilterSlotBatch(const SlotRef& slot_ref, TupleRow* const* rows, int* sel,
+    int num_sel, Pred pred) {
+  const int tuple_idx = slot_ref.GetTupleIdx();
+  const int slot_offset = slot_ref.GetSlotOffset();
+  const NullIndicatorOffset null_offset = slot_ref.GetNullIndicatorOffset();
+  int num_passed = 0;
+  for (int i = 0; i < num_sel; ++i) {
+    const int row_idx = sel[i];
+    const Tuple* tuple = rows[row_idx]->GetTuple(tuple_idx);
+    if (tuple == nullptr || tuple->IsNull(null_offset)) continue;
+    T val;
+    memcpy(&val, tuple->GetSlot(slot_offset), sizeof(T));
+    sel[num_passed] = row_idx;
+    num_passed += pred(val);
+  }
+  return num_passed;
+}
+
+template <typename T>
+int ScalarFnCall::FilterCompareBatch(const SlotRef& slot_ref, T constant,
+    TupleRow* const* rows, int* sel, int num_sel) const {
+  switch (batch_predicate_) {
+    case BatchPredicate::EQ:
+      return FilterSlotBatch<T>(slot_ref, rows, sel, num_sel,
+          [constant](T v) { return v == constant; });
+    case BatchPredicate::NE:
+      return FilterSlotBatch<T>(slot_ref, rows, sel, num_sel,
+          [constant](T v) { return v != constant; });
+    case BatchPredicate::LT:
+      return FilterSlotBatch<T>(slot_ref, rows, sel, num_sel,
+          [constant](T v) { return v < constant; });
+    case BatchPredicate::LE:
+      return FilterSlotBatch<T>(slot_ref, rows, sel, num_sel,
+          [constant](T v) { return v <= constant; });
+    case BatchPredicate::GT:
+      return FilterSlotBatch<T>(slot_ref, rows, sel, num_sel,
+          [constant](T v) { return v > constant; });
+    case BatchPredicate::GE:
+      return FilterSlotBatch<T>(slot_ref, rows, sel, num_sel,
+          [constant](T v) { return v >= constant; });
+    default:
+      DCHECK(false);
+      return 0;
+  }
+}
+
+int ScalarFnCall::FilterBatchInterpreted(ScalarExprEvaluator* eval,
+    TupleRow* const* rows, int* sel, int num_sel) const {
+  if (batch_predicate_ == BatchPredicate::NONE) {
+    return ScalarExpr::FilterBatchInterpreted(eval, rows, sel, num_sel);
+  }
+  const SlotRef& slot_ref =
+      *static_cast<const SlotRef*>(children_[batch_slot_child_idx_]);
+  if (batch_predicate_ == BatchPredicate::IS_NULL
+      || batch_predicate_ == BatchPredicate::IS_NOT_NULL) {
+    const bool keep_null = batch_predicate_ == BatchPredicate::IS_NULL;
+    const int tuple_idx = slot_ref.GetTupleIdx();
+    const NullIndicatorOffset null_offset = slot_ref.GetNullIndicatorOffset();
+    int num_passed = 0;
+    for (int i = 0; i < num_sel; ++i) {
+      const int row_idx = sel[i];
+      const Tuple* tuple = rows[row_idx]->GetTuple(tuple_idx);
+      const bool is_null = tuple == nullptr || tuple->IsNull(null_offset);
+      sel[num_passed] = row_idx;
+      num_passed += is_null == keep_null;
+    }
+    return num_passed;
+  }
+  // The literal was evaluated when the evaluator was opened.
+  FunctionContext* fn_ctx = eval->fn_context(fn_ctx_idx_);
+  const AnyVal* constant = fn_ctx->impl()->constant_args()[1 - batch_slot_child_idx_];
+  DCHECK(constant != nullptr);
+  // A comparison with NULL is never true.
+  if (constant->is_null) return 0;
+  switch (slot_ref.type().type) {
+    case TYPE_BOOLEAN:
+      return FilterCompareBatch<bool>(slot_ref,
+          static_cast<const BooleanVal*>(constant)->val, rows, sel, num_sel);
+    case TYPE_TINYINT:
+      return FilterCompareBatch<int8_t>(slot_ref,
+          static_cast<const TinyIntVal*>(constant)->val, rows, sel, num_sel);
+    case TYPE_SMALLINT:
+      return FilterCompareBatch<int16_t>(slot_ref,
+          static_cast<const SmallIntVal*>(constant)->val, rows, sel, num_sel);
+    case TYPE_INT:
+      return FilterCompareBatch<int32_t>(slot_ref,
+          static_cast<const IntVal*>(constant)->val, rows, sel, num_sel);
+    case TYPE_BIGINT:
+      return FilterCompareBatch<int64_t>(slot_ref,
+          static_cast<const BigIntVal*>(constant)->val, rows, sel, num_sel);
+    case TYPE_FLOAT:
+      return FilterCompareBatch<float>(slot_ref,
+          static_cast<const FloatVal*>(constant)->val, rows, sel, num_sel);
+    case TYPE_DOUBLE:
+      return FilterCompareBatch<double>(slot_ref,
+          static_cast<const DoubleVal*>(constant)->val, rows, sel, num_sel);
+    case TYPE_DATE:
+      // Date slots store the number of days since the epoch, like DateVal.
+      return FilterCompareBatch<int32_t>(slot_ref,
+          static_cast<const DateVal*>(constant)->val, rows, sel, num_sel);
+    default:
+      DCHECK(false) << slot_ref.type().DebugString();
+      return ScalarExpr::FilterBatchInterpreted(eval, rows, sel, num_sel);
+  }
+}
+
 Status ScalarFnCall::OpenEvaluator(FunctionContext::FunctionStateScope scope,
     RuntimeState* state, ScalarExprEvaluator* eval) const {
   // Opens and inits children
@@ -41,6 +41,7 @@ using impala_udf::DecimalVal;
 using impala_udf::DateVal;
 
 class ScalarExprEvaluator;
+class SlotRef;
 class TExprNode;
 
 /// Expr for evaluating a pre-compiled native or LLVM IR function that uses the UDF
@@ -74,6 +75,8 @@ class ScalarFnCall : public ScalarExpr {
  protected:
   friend class ScalarExpr;
   friend class ScalarExprEvaluator;
+  /// For BE tests
+  friend class BatchPredicateTest;
 
   virtual bool HasFnCtx() const override { return true; }
 
@@ -90,7 +93,29 @@ class ScalarFnCall : public ScalarExpr {
 
   GENERATE_GET_VAL_INTERPRETED_OVERRIDES_FOR_ALL_SCALAR_TYPES
 
+  /// Evaluates comparisons of a slot with a literal and IS [NOT] NULL on a slot over the
+  /// whole selection. Other functions are evaluated row by row.
+  virtual int FilterBatchInterpreted(ScalarExprEvaluator* eval, TupleRow* const* rows,
+      int* sel, int num_sel) const override;
+
  private:
+  /// Builtin predicates that FilterBatchInterpreted() evaluates without calling
+  /// 'scalar_fn_'.
+  enum class BatchPredicate { NONE, EQ, NE, LT, LE, GT, GE, IS_NULL, IS_NOT_NULL };
+
+  /// The predicate that this function call is evaluated as in FilterBatchInterpreted().
+  /// Set in Init(). The operands are always ordered as <slot> <op> <literal>, so e.g.
+  /// '5 < col' is evaluated as 'col > 5'.
+  BatchPredicate batch_predicate_ = BatchPredicate::NONE;
+
+  /// Index of the SlotRef child that 'batch_predicate_' is evaluated on. The other child
+  /// of a comparison is a literal.
+  int batch_slot_child_idx_ = -1;
+
+  /// Sets 'batch_predicate_' and 'batch_slot_child_idx_' if this is a builtin predicate
+  /// that FilterBatchInterpreted() can evaluate directly.
+  void InitBatchPredicate();
+
   /// If this function has var args, children()[vararg_start_idx_] is the first vararg
   /// argument.
   /// If this function does not have varargs, it is set to -1.
@@ -144,6 +169,12 @@ class ScalarFnCall : public ScalarExpr {
   /// Function to call scalar_fn_. Used in the interpreted path.
   template <typename RETURN_TYPE>
   RETURN_TYPE InterpretEval(ScalarExprEvaluator* eval, const TupleRow* row) const;
+
+  /// Helper for FilterBatchInterpreted() that compares the slot values of type 'T'
+  /// with 'constant' according to 'batch_predicate_'.
+  template <typename T>
+  int FilterCompareBatch(const SlotRef& slot_ref, T constant, TupleRow* const* rows,
+      int* sel, int num_sel) const;
 };
 }
 
@@ -60,6 +60,7 @@ class SlotRef : public ScalarExpr {
   static const char* LLVM_CLASS_NAME;
   NullIndicatorOffset GetNullIndicatorOffset() const { return null_indicator_offset_; }
   int GetSlotOffset() const { return slot_offset_; }
+  int GetTupleIdx() const { return tuple_idx_; }
   virtual const TupleDescriptor* GetCollectionTupleDesc() const override;
 
  protected:
@@ -26,6 +26,7 @@
 #include <boost/static_assert.hpp>
 
 #include "exprs/anyval-util.h"
+#include "exprs/regex-cache.h"
 #include "exprs/scalar-expr.h"
 #include "gutil/strings/charset.h"
 #include "gutil/strings/substitute.h"
@@ -870,32 +871,75 @@ IntVal StringFunctions::LocatePos(FunctionContext* context, const StringVal& sub
   return Instr(context, str, substr, start_pos);
 }
 
+// Sets 'options' to the options of the regexp_*() functions with the match parameter
+// 'match_parameter', which may be NULL. Returns false and sets 'error_str' if the match
+// parameter is invalid.
+static bool GetRegexOptions(const StringVal& match_parameter, string* error_str,
+    re2::RE2::Options* options) {
+  // Disable error logging in case e.g. every row causes an error
+  options->set_log_errors(false);
+  // Return the leftmost longest match (rather than the first match).
+  options->set_longest_match(true);
+  return match_parameter.is_null
+      || StringFunctions::SetRE2Options(match_parameter, error_str, options);
+}
+
+static string RegexErrorString(const StringVal& pattern, const re2::RE2& re) {
+  stringstream ss;
+  ss << "Could not compile regexp pattern: " << AnyValUtil::ToString(pattern) << endl
+     << "Error: " << re.error();
+  return ss.str();
+}
+
 // The caller owns the returned regex. Returns NULL if the pattern could not be compiled.
 re2::RE2* CompileRegex(const StringVal& pattern, string* error_str,
     const StringVal& match_parameter) {
   DCHECK(error_str != NULL);
   re2::StringPiece pattern_sp(reinterpret_cast<char*>(pattern.ptr), pattern.len);
   re2::RE2::Options options;
-  // Disable error logging in case e.g. every row causes an error
-  options.set_log_errors(false);
-  // Return the leftmost longest match (rather than the first match).
-  options.set_longest_match(true);
-  if (!match_parameter.is_null &&
-      !StringFunctions::SetRE2Options(match_parameter, error_str, &options)) {
-    return NULL;
-  }
+  if (!GetRegexOptions(match_parameter, error_str, &options)) return NULL;
   re2::RE2* re = new re2::RE2(pattern_sp, options);
   if (!re->ok()) {
-    stringstream ss;
-    ss << "Could not compile regexp pattern: " << AnyValUtil::ToString(pattern) << endl
-       << "Error: " << re->error();
-    *error_str = ss.str();
+    *error_str = RegexErrorString(pattern, *re);
     delete re;
     return NULL;
   }
   return re;
 }
 
+// THREAD_LOCAL state of the regexp_*() functions.
+struct RegexpState {
+  // The regex compiled in the prepare function if the pattern and the match parameter
+  // are constant.
+  scoped_ptr<re2::RE2> regex;
+
+  // Cache of the compiled regexes if the pattern or the match parameter is not constant.
+  // Created by the first call to GetRegex() that needs it.
+  scoped_ptr<RegexCache> cache;
+};
+
+// Returns the regex of the regexp_*() function of 'context' for the non-NULL 'pattern'
+// and 'match_parameter': the one compiled in the prepare function if they are constant,
+// or the cached one otherwise. Returns NULL and sets 'error_str' if the pattern could
+// not be compiled.
+static const re2::RE2* GetRegex(FunctionContext* context, const StringVal& pattern,
+    const StringVal& match_parameter, string* error_str) {
+  RegexpState* state = reinterpret_cast<RegexpState*>(
+      context->GetFunctionState(FunctionContext::THREAD_LOCAL));
+  DCHECK(state != nullptr);
+  if (state->regex != nullptr) return state->regex.get();
+  if (state->cache == nullptr) state->cache.reset(new RegexCache(context));
+  re2::RE2::Options options;
+  if (!GetRegexOptions(match_parameter, error_str, &options)) return NULL;
+  const re2::RE2& re = state->cache->GetOrCompile(
+      re2::StringPiece(reinterpret_cast<char*>(pattern.ptr), pattern.len), options);
+  if (!re.ok()) {
+    *error_str = RegexErrorString(pattern, re);
+    return NULL;
+  }
+  return &re;
+}
+
 // This function sets options in the RE2 library before pattern matching.
 bool StringFunctions::SetRE2Options(const StringVal& match_parameter,
     string* error_str, re2::RE2::Options* opts) {
@@ -929,6 +973,8 @@ bool StringFunctions::SetRE2Options(const StringVal& match_parameter,
 void StringFunctions::RegexpPrepare(
     FunctionContext* context, FunctionContext::FunctionStateScope scope) {
   if (scope != FunctionContext::THREAD_LOCAL) return;
+  RegexpState* state = new RegexpState();
+  context->SetFunctionState(scope, state);
   if (!context->IsArgConstant(1)) return;
   DCHECK_EQ(context->GetArgType(1)->type, FunctionContext::TYPE_STRING);
   StringVal* pattern = reinterpret_cast<StringVal*>(context->GetConstantArg(1));
@@ -940,14 +986,15 @@ void StringFunctions::RegexpPrepare(
     context->SetError(error_str.c_str());
     return;
   }
-  context->SetFunctionState(scope, re);
+  state->regex.reset(re);
 }
 
 void StringFunctions::RegexpClose(
     FunctionContext* context, FunctionContext::FunctionStateScope scope) {
   if (scope != FunctionContext::THREAD_LOCAL) return;
-  re2::RE2* re = reinterpret_cast<re2::RE2*>(context->GetFunctionState(scope));
-  delete re;
+  RegexpState* state = reinterpret_cast<RegexpState*>(context->GetFunctionState(scope));
+  if (state != nullptr && state->cache != nullptr) state->cache->UpdateProfile(context);
+  delete state;
   context->SetFunctionState(scope, nullptr);
 }
 
@@ -978,18 +1025,11 @@ StringVal StringFunctions::RegexpExtract(FunctionContext* context, const StringV
   if (str.is_null || pattern.is_null || index.is_null) return StringVal::null();
   if (index.val < 0) return StringVal();
 
-  re2::RE2* re = reinterpret_cast<re2::RE2*>(
-      context->GetFunctionState(FunctionContext::THREAD_LOCAL));
-  scoped_ptr<re2::RE2> scoped_re; // destroys re if we have to locally compile it
+  string error_str;
+  const re2::RE2* re = GetRegex(context, pattern, StringVal::null(), &error_str);
   if (re == NULL) {
-    DCHECK(!context->IsArgConstant(1));
-    string error_str;
-    re = CompileRegex(pattern, &error_str, StringVal::null());
-    if (re == NULL) {
-      context->AddWarning(error_str.c_str());
-      return StringVal::null();
-    }
-    scoped_re.reset(re);
+    context->AddWarning(error_str.c_str());
+    return StringVal::null();
   }
 
   re2::StringPiece str_sp(reinterpret_cast<char*>(str.ptr), str.len);
@@ -1010,18 +1050,11 @@ StringVal StringFunctions::RegexpReplace(FunctionContext* context, const StringV
     const StringVal& pattern, const StringVal& replace) {
   if (str.is_null || pattern.is_null || replace.is_null) return StringVal::null();
 
-  re2::RE2* re = reinterpret_cast<re2::RE2*>(
-      context->GetFunctionState(FunctionContext::THREAD_LOCAL));
-  scoped_ptr<re2::RE2> scoped_re; // destroys re if state->re is NULL
+  string error_str;
+  const re2::RE2* re = GetRegex(context, pattern, StringVal::null(), &error_str);
   if (re == NULL) {
-    DCHECK(!context->IsArgConstant(1));
-    string error_str;
-    re = CompileRegex(pattern, &error_str, StringVal::null());
-    if (re == NULL) {
-      context->AddWarning(error_str.c_str());
-      return StringVal::null();
-    }
-    scoped_re.reset(re);
+    context->AddWarning(error_str.c_str());
+    return StringVal::null();
   }
 
   re2::StringPiece replace_str =
@@ -1036,6 +1069,8 @@ void StringFunctions::RegexpMatchCountPrepare(FunctionContext* context,
   if (scope != FunctionContext::THREAD_LOCAL) return;
   int num_args = context->GetNumArgs();
   DCHECK(num_args == 2 || num_args == 4);
+  RegexpState* state = new RegexpState();
+  context->SetFunctionState(scope, state);
   if (!context->IsArgConstant(1) || (num_args == 4 && !context->IsArgConstant(3))) return;
 
   DCHECK_EQ(context->GetArgType(1)->type, FunctionContext::TYPE_STRING);
@@ -1054,7 +1089,7 @@ void StringFunctions::RegexpMatchCountPrepare(FunctionContext* context,
     context->SetError(error_str.c_str());
     return;
   }
-  context->SetFunctionState(scope, re);
+  state->regex.reset(re);
 }
 
 IntVal StringFunctions::RegexpMatchCount2Args(FunctionContext* context,
@@ -1079,20 +1114,11 @@ IntVal StringFunctions::RegexpMatchCount4Args(FunctionContext* context,
     return IntVal::null();
   }
 
-  re2::RE2* re = reinterpret_cast<re2::RE2*>(
-      context->GetFunctionState(FunctionContext::THREAD_LOCAL));
-  // Destroys re if we have to locally compile it.
-  scoped_ptr<re2::RE2> scoped_re;
+  string error_str;
+  const re2::RE2* re = GetRegex(context, pattern, match_parameter, &error_str);
   if (re == NULL) {
-    DCHECK(!context->IsArgConstant(1) || (context->GetNumArgs() == 4 &&
-        !context->IsArgConstant(3)));
-    string error_str;
-    re = CompileRegex(pattern, &error_str, match_parameter);
-    if (re == NULL) {
-      context->SetError(error_str.c_str());
-      return IntVal::null();
-    }
-    scoped_re.reset(re);
+    context->SetError(error_str.c_str());
+    return IntVal::null();
   }
 
   DCHECK_GE(str.len, offset);
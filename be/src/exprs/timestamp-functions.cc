@@ -24,6 +24,7 @@
 #include "runtime/datetime-simple-date-format-parser.h"
 #include "runtime/string-value.inline.h"
 #include "runtime/timestamp-value.h"
+#include "runtime/timezone-converter.h"
 #include "udf/udf-internal.h"
 #include "udf/udf.h"
 
@@ -84,6 +85,26 @@ const map<string, int> TimestampFunctions::DAYNAME_MAP = {
     {"sat", 6}, {"saturday", 6},
 };
 
+void TimestampFunctions::FromToUtcPrepare(
+    FunctionContext* context, FunctionContext::FunctionStateScope scope) {
+  if (scope != FunctionContext::THREAD_LOCAL || !context->IsArgConstant(1)) return;
+  const StringVal* tz_string_val =
+      reinterpret_cast<StringVal*>(context->GetConstantArg(1));
+  if (tz_string_val == nullptr || tz_string_val->is_null) return;
+  const Timezone* timezone = TimezoneDatabase::FindTimezone(
+      string(reinterpret_cast<char*>(tz_string_val->ptr), tz_string_val->len));
+  // Unknown time-zones are reported for each row by FromUtc() and ToUtc().
+  if (timezone == nullptr) return;
+  context->SetFunctionState(scope, new TimezoneConverter(timezone));
+}
+
+void TimestampFunctions::FromToUtcClose(
+    FunctionContext* context, FunctionContext::FunctionStateScope scope) {
+  if (scope != FunctionContext::THREAD_LOCAL) return;
+  delete reinterpret_cast<TimezoneConverter*>(context->GetFunctionState(scope));
+  context->SetFunctionState(scope, nullptr);
+}
+
 TimestampVal TimestampFunctions::FromUtc(FunctionContext* context,
     const TimestampVal& ts_val, const StringVal& tz_string_val) {
   if (ts_val.is_null || tz_string_val.is_null) return TimestampVal::null();
@@ -91,19 +112,25 @@ TimestampVal TimestampFunctions::FromUtc(FunctionContext* context,
   if (UNLIKELY(!ts_value.HasDateAndTime())) return TimestampVal::null();
 
   const StringValue& tz_string_value = StringValue::FromStringVal(tz_string_val);
-  const Timezone* timezone = TimezoneDatabase::FindTimezone(
-      string(tz_string_value.ptr, tz_string_value.len));
-  if (UNLIKELY(timezone == nullptr)) {
-    // Although this is an error, Hive ignores it. We will issue a warning but otherwise
-    // ignore the error too.
-    stringstream ss;
-    ss << "Unknown timezone '" << tz_string_value << "'" << endl;
-    context->AddWarning(ss.str().c_str());
-    return ts_val;
-  }
-
   TimestampValue ts_value_ret = ts_value;
-  ts_value_ret.UtcToLocal(*timezone);
+  // The converter is only set up for constant time-zones.
+  TimezoneConverter* converter = reinterpret_cast<TimezoneConverter*>(
+      context->GetFunctionState(FunctionContext::THREAD_LOCAL));
+  if (converter != nullptr) {
+    converter->UtcToLocal(&ts_value_ret);
+  } else {
+    const Timezone* timezone = TimezoneDatabase::FindTimezone(
+        string(tz_string_value.ptr, tz_string_value.len));
+    if (UNLIKELY(timezone == nullptr)) {
+      // Although this is an error, Hive ignores it. We will issue a warning but
+      // otherwise ignore the error too.
+      stringstream ss;
+      ss << "Unknown timezone '" << tz_string_value << "'" << endl;
+      context->AddWarning(ss.str().c_str());
+      return ts_val;
+    }
+    ts_value_ret.UtcToLocal(*timezone);
+  }
   if (UNLIKELY(!ts_value_ret.HasDateAndTime())) {
     const string msg = Substitute(
         "Timestamp '$0' did not convert to a valid local time in timezone '$1'",
@@ -124,19 +151,25 @@ TimestampVal TimestampFunctions::ToUtc(FunctionContext* context,
   if (!ts_value.HasDateAndTime()) return TimestampVal::null();
 
   const StringValue& tz_string_value = StringValue::FromStringVal(tz_string_val);
-  const Timezone* timezone = TimezoneDatabase::FindTimezone(
-      string(tz_string_value.ptr, tz_string_value.len));
-  if (UNLIKELY(timezone == nullptr)) {
-    // Although this is an error, Hive ignores it. We will issue a warning but otherwise
-    // ignore the error too.
-    stringstream ss;
-    ss << "Unknown timezone '" << tz_string_value << "'" << endl;
-    context->AddWarning(ss.str().c_str());
-    return ts_val;
-  }
-
   TimestampValue ts_value_ret = ts_value;
-  ts_value_ret.LocalToUtc(*timezone);
+  // The converter is only set up for constant time-zones.
+  TimezoneConverter* converter = reinterpret_cast<TimezoneConverter*>(
+      context->GetFunctionState(FunctionContext::THREAD_LOCAL));
+  if (converter != nullptr) {
+    converter->LocalToUtc(&ts_value_ret);
+  } else {
+    const Timezone* timezone = TimezoneDatabase::FindTimezone(
+        string(tz_string_value.ptr, tz_string_value.len));
+    if (UNLIKELY(timezone == nullptr)) {
+      // Although this is an error, Hive ignores it. We will issue a warning but
+      // otherwise ignore the error too.
+      stringstream ss;
+      ss << "Unknown timezone '" << tz_string_value << "'" << endl;
+      context->AddWarning(ss.str().c_str());
+      return ts_val;
+    }
+    ts_value_ret.LocalToUtc(*timezone);
+  }
   if (UNLIKELY(!ts_value_ret.HasDateAndTime())) {
     const string& msg =
         Substitute("Timestamp '$0' in timezone '$1' could not be converted to UTC",
@@ -154,6 +154,12 @@ class TimestampFunctions {
       const BigIntVal& unix_time_micros);
 
   /// Convert a timestamp to or from a particular timezone based time.
+  /// If the timezone is constant, the prepare function sets up a TimezoneConverter that
+  /// caches the UTC offset of the last converted timestamp.
+  static void FromToUtcPrepare(FunctionContext* context,
+      FunctionContext::FunctionStateScope scope);
+  static void FromToUtcClose(FunctionContext* context,
+      FunctionContext::FunctionStateScope scope);
   static TimestampVal FromUtc(FunctionContext* context,
     const TimestampVal& ts_val, const StringVal& tz_string_val);
   static TimestampVal ToUtc(FunctionContext* context,
@@ -72,17 +72,21 @@ BlockBloomFilter::BlockBloomFilter(BlockBloomFilterBufferAllocatorIf* buffer_all
   if (has_avx2()) {
     bucket_insert_func_ptr_ = &BlockBloomFilter::BucketInsertAVX2;
     bucket_find_func_ptr_ = &BlockBloomFilter::BucketFindAVX2;
+    find_batch_func_ptr_ = &BlockBloomFilter::FindBatchAVX2;
   } else {
     bucket_insert_func_ptr_ = &BlockBloomFilter::BucketInsert;
     bucket_find_func_ptr_ = &BlockBloomFilter::BucketFind;
+    find_batch_func_ptr_ = &BlockBloomFilter::FindBatchNoAvx2;
   }
 #else
   bucket_insert_func_ptr_ = &BlockBloomFilter::BucketInsert;
   bucket_find_func_ptr_ = &BlockBloomFilter::BucketFind;
+  find_batch_func_ptr_ = &BlockBloomFilter::FindBatchNoAvx2;
 #endif
 
   DCHECK(bucket_insert_func_ptr_);
   DCHECK(bucket_find_func_ptr_);
+  DCHECK(find_batch_func_ptr_);
 }
 
 BlockBloomFilter::~BlockBloomFilter() {
@@ -329,6 +333,28 @@ bool BlockBloomFilter::Find(const uint32_t hash) const noexcept {
   return (this->*bucket_find_func_ptr_)(bucket_idx, hash);
 }
 
+void BlockBloomFilter::FindBatch(const uint32_t* hashes, size_t n, bool* found) const
+    noexcept {
+  if (always_false_) {
+    memset(found, 0, n * sizeof(bool));
+    return;
+  }
+  DCHECK(find_batch_func_ptr_);
+  (this->*find_batch_func_ptr_)(hashes, n, found);
+}
+
+void BlockBloomFilter::FindBatchNoAvx2(const uint32_t* hashes, size_t n, bool* found) const
+    noexcept {
+  uint32_t bucket_idxs[kFindBatchSize];
+  for (size_t start = 0; start < n; start += kFindBatchSize) {
+    const size_t len = std::min(n - start, kFindBatchSize);
+    PrefetchBuckets(hashes + start, len, bucket_idxs);
+    for (size_t i = 0; i < len; ++i) {
+      found[start + i] = BucketFind(bucket_idxs[i], hashes[start + i]);
+    }
+  }
+}
+
 void BlockBloomFilter::CopyToPB(BlockBloomFilterPB* bf_dst) const {
   bf_dst->mutable_bloom_data()->assign(reinterpret_cast<const char*>(directory_), directory_size());
   bf_dst->set_log_space_bytes(log_space_bytes());
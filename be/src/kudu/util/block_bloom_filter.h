@@ -125,6 +125,12 @@ class BlockBloomFilter {
     return Find(HashUtil::ComputeHash32(key, hash_algorithm_, hash_seed_));
   }
 
+  // Finds 'n' elements in the BloomFilter, setting found[i] to the result of
+  // Find(hashes[i]). Faster than calling Find() in a loop: the function is only
+  // dispatched once per call and the buckets of a run of hashes are prefetched before
+  // any of them is probed, so that the cache misses overlap.
+  void FindBatch(const uint32_t* hashes, size_t n, bool* found) const noexcept;
+
   // As more distinct items are inserted into a BloomFilter, the false positive rate
   // rises. MaxNdv() returns the NDV (number of distinct values) at which a BloomFilter
   // constructed with (1 << log_space_bytes) bytes of space hits false positive
@@ -237,6 +243,22 @@ class BlockBloomFilter {
 
   bool BucketFind(uint32_t bucket_idx, uint32_t hash) const noexcept;
 
+  // Number of hashes whose buckets FindBatch() computes and prefetches at a time.
+  static constexpr size_t kFindBatchSize = 32;
+
+  // Computes the bucket index of each of the 'n' <= kFindBatchSize hashes and prefetches
+  // the buckets.
+  void PrefetchBuckets(const uint32_t* hashes, size_t n, uint32_t* bucket_idxs) const
+      noexcept {
+    for (size_t i = 0; i < n; ++i) {
+      bucket_idxs[i] = Rehash32to32(hashes[i]) & directory_mask_;
+      __builtin_prefetch(&directory_[bucket_idxs[i]]);
+    }
+  }
+
+  // FindBatch() without AVX2 instructions.
+  void FindBatchNoAvx2(const uint32_t* hashes, size_t n, bool* found) const noexcept;
+
   // Computes out[i] |= in[i] for the arrays 'in' and 'out' of length 'n' without using AVX2
   // operations.
   static void OrEqualArrayNoAVX2(size_t n, const uint8_t* __restrict__ in,
@@ -258,6 +280,10 @@ class BlockBloomFilter {
   bool BucketFindAVX2(uint32_t bucket_idx, uint32_t hash) const noexcept
       __attribute__((__target__("avx2")));
 
+  // FindBatch() with AVX2 instructions.
+  void FindBatchAVX2(const uint32_t* hashes, size_t n, bool* found) const noexcept
+      __attribute__((__target__("avx2")));
+
   // Computes out[i] |= in[i] for the arrays 'in' and 'out' of length 'n' using AVX2
   // instructions. 'n' must be a multiple of 32.
   static void OrEqualArrayAVX2(size_t n, const uint8_t* __restrict__ in,
@@ -268,6 +294,7 @@ class BlockBloomFilter {
   // of Find and Insert operations.
   decltype(&BlockBloomFilter::BucketInsert) bucket_insert_func_ptr_;
   decltype(&BlockBloomFilter::BucketFind) bucket_find_func_ptr_;
+  decltype(&BlockBloomFilter::FindBatchNoAvx2) find_batch_func_ptr_;
 
   // Size of the internal directory structure in bytes.
   int64_t directory_size() const {
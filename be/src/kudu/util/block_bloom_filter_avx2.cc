@@ -26,6 +26,7 @@
 
 #include <immintrin.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <ostream>
@@ -74,6 +75,23 @@ bool BlockBloomFilter::BucketFindAVX2(const uint32_t bucket_idx, const uint32_t
   return result;
 }
 
+void BlockBloomFilter::FindBatchAVX2(const uint32_t* hashes, size_t n, bool* found) const
+    noexcept {
+  uint32_t bucket_idxs[kFindBatchSize];
+  const __m256i* const directory = reinterpret_cast<__m256i*>(directory_);
+  for (size_t start = 0; start < n; start += kFindBatchSize) {
+    const size_t len = std::min(n - start, kFindBatchSize);
+    PrefetchBuckets(hashes + start, len, bucket_idxs);
+    for (size_t i = 0; i < len; ++i) {
+      const __m256i mask = MakeMask(hashes[start + i]);
+      // See BucketFindAVX2().
+      found[start + i] = _mm256_testc_si256(directory[bucket_idxs[i]], mask);
+    }
+  }
+  // Only clear the upper halves of the YMM registers once for the whole batch.
+  _mm256_zeroupper();
+}
+
 void BlockBloomFilter::InsertAvx2(const uint32_t hash) noexcept {
   always_false_ = false;
   const uint32_t bucket_idx = Rehash32to32(hash) & directory_mask_;
@@ -160,6 +160,35 @@ TEST_F(BufferAllocatorTest, FreeListSizes) {
   ASSERT_EQ(0, GetFreeListSize(&allocator, CORE, TEST_BUFFER_LEN));
 }
 
+// Test that buffers that are freed on a different NUMA node than the one they were
+// allocated on are counted.
+TEST_F(BufferAllocatorTest, RemoteNumaNodeBuffers) {
+  // Needs two cores that are on different NUMA nodes with the fake NUMA setup.
+  if (CpuInfo::num_cores() < 2) return;
+  CpuTestUtil::SetupFakeNuma(true);
+  ASSERT_NE(CpuInfo::GetNumaNodeOfCore(0), CpuInfo::GetNumaNodeOfCore(1));
+
+  BufferAllocator allocator(dummy_pool_, test_env_->metrics(), TEST_BUFFER_LEN,
+      4 * TEST_BUFFER_LEN, 4 * TEST_BUFFER_LEN);
+  IntCounter* remote_buffers = test_env_->metrics()->FindMetricForTesting<IntCounter>(
+      "buffer-pool.arena-0.remote-numa-node-buffers");
+  ASSERT_TRUE(remote_buffers != nullptr);
+
+  CpuTestUtil::PinToCore(0);
+  BufferHandle local_buffer, remote_buffer;
+  ASSERT_OK(allocator.Allocate(&dummy_client_, TEST_BUFFER_LEN, &local_buffer));
+  ASSERT_OK(allocator.Allocate(&dummy_client_, TEST_BUFFER_LEN, &remote_buffer));
+  allocator.Free(move(local_buffer));
+  EXPECT_EQ(0, remote_buffers->GetValue());
+
+  CpuTestUtil::PinToCore(1);
+  allocator.Free(move(remote_buffer));
+  EXPECT_EQ(1, remote_buffers->GetValue());
+  // Both buffers return to the arena of the core that allocated them.
+  EXPECT_EQ(2, GetFreeListSize(&allocator, 0, TEST_BUFFER_LEN));
+  CpuTestUtil::SetupFakeNuma(false);
+}
+
 class SystemAllocatorTest : public ::testing::Test {
  public:
   virtual void SetUp() {}
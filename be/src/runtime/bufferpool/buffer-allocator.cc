@@ -49,6 +49,13 @@ static constexpr int64_t STATS_MAX_BUFFER_SIZE = 4L * 1024L * 1024L * 1024L;
 static int64_t DecreaseBytesRemaining(
     int64_t max_decrease, bool require_full_decrease, AtomicInt64* bytes_remaining);
 
+/// Returns true if 'core' is on a different NUMA node than the current core.
+static bool IsOnRemoteNumaNode(int core) {
+  if (CpuInfo::GetMaxNumNumaNodes() == 1) return false;
+  return CpuInfo::GetNumaNodeOfCore(core)
+      != CpuInfo::GetNumaNodeOfCore(CpuInfo::GetCurrentCore());
+}
+
 /// An arena containing free buffers and clean pages that are associated with a
 /// particular core. All public methods are thread-safe.
 class BufferPool::FreeBufferArena : public CacheLineAligned {
@@ -125,6 +132,7 @@ class BufferPool::FreeBufferArena : public CacheLineAligned {
   IntCounter* clean_page_hits() const { return clean_page_hits_; }
   IntCounter* num_scavenges() const { return num_scavenges_; }
   IntCounter* num_final_scavenges() const { return num_final_scavenges_; }
+  IntCounter* remote_numa_node_buffers() const { return remote_numa_node_buffers_; }
 
  private:
   /// The data structures for each power-of-two size of buffers/pages.
@@ -213,6 +221,10 @@ class BufferPool::FreeBufferArena : public CacheLineAligned {
 
   // Counts the number of times we had to lock all arenas for a final scavenge of buffers.
   IntCounter* const num_final_scavenges_;
+
+  // Counts the number of times a buffer of this arena was freed or reclaimed by a thread
+  // on a different NUMA node, i.e. a thread that accessed it remotely.
+  IntCounter* const remote_numa_node_buffers_;
 };
 
 int64_t BufferPool::BufferAllocator::CalcMaxBufferLen(
@@ -438,6 +450,9 @@ void BufferPool::BufferAllocator::Free(BufferHandle&& handle) {
   DCHECK(handle.is_open());
   handle.client_ = nullptr; // Buffer is no longer associated with a client.
   FreeBufferArena* arena = per_core_arenas_[handle.home_core_].get();
+  if (IsOnRemoteNumaNode(handle.home_core_)) {
+    arena->remote_numa_node_buffers()->Increment(1);
+  }
   handle.Poison();
   arena->AddFreeBuffer(move(handle));
 }
@@ -452,14 +467,19 @@ void BufferPool::BufferAllocator::AddCleanPage(
 bool BufferPool::BufferAllocator::RemoveCleanPage(
     const unique_lock<mutex>& client_lock, bool claim_buffer, Page* page) {
   page->client->DCheckHoldsLock(client_lock);
-  FreeBufferArena* arena;
+  int home_core;
   {
     lock_guard<SpinLock> pl(page->buffer_lock);
     // Page may be evicted - in which case it has no home core and is not in an arena.
     if (!page->buffer.is_open()) return false;
-    arena = per_core_arenas_[page->buffer.home_core_].get();
+    home_core = page->buffer.home_core_;
+  }
+  FreeBufferArena* arena = per_core_arenas_[home_core].get();
+  if (!arena->RemoveCleanPage(claim_buffer, page)) return false;
+  if (claim_buffer && IsOnRemoteNumaNode(home_core)) {
+    arena->remote_numa_node_buffers()->Increment(1);
   }
-  return arena->RemoveCleanPage(claim_buffer, page);
+  return true;
 }
 
 void BufferPool::BufferAllocator::Maintenance() {
@@ -556,7 +576,9 @@ BufferPool::FreeBufferArena::FreeBufferArena(
         metrics->AddCounter("buffer-pool.$0.clean-page-hits", 0, arena_name)),
     num_scavenges_(metrics->AddCounter("buffer-pool.$0.num-scavenges", 0, arena_name)),
     num_final_scavenges_(
-        metrics->AddCounter("buffer-pool.$0.num-final-scavenges", 0, arena_name)) {}
+        metrics->AddCounter("buffer-pool.$0.num-final-scavenges", 0, arena_name)),
+    remote_numa_node_buffers_(metrics->AddCounter(
+        "buffer-pool.$0.remote-numa-node-buffers", 0, arena_name)) {}
 
 BufferPool::FreeBufferArena::~FreeBufferArena() {
   for (int i = 0; i < NumBufferSizes(); ++i) {
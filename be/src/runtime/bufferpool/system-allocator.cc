@@ -18,11 +18,14 @@
 #include "runtime/bufferpool/system-allocator.h"
 
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include <gperftools/malloc_extension.h>
 
 #include "gutil/strings/substitute.h"
 #include "util/bit-util.h"
+#include "util/cpu-info.h"
 
 #include "common/names.h"
 
@@ -36,6 +39,11 @@ DEFINE_bool(madvise_huge_pages, true,
     "(Advanced) If true, advise operating system to back large memory buffers with huge "
     "pages");
 
+DEFINE_bool(numa_local_buffers, true,
+    "(Advanced) If true and --mmap_buffers is true, ask the operating system to back "
+    "each buffer with memory from the NUMA node of the core that allocated it, "
+    "instead of the node of the core that first touches it.");
+
 namespace impala {
 
 /// These are the page sizes on x86-64. We could parse /proc/meminfo to programmatically
@@ -43,6 +51,28 @@ namespace impala {
 static int64_t SMALL_PAGE_SIZE = 4LL * 1024;
 static int64_t HUGE_PAGE_SIZE = 2LL * 1024 * 1024;
 
+/// The MPOL_PREFERRED memory policy mode from <numaif.h>, which is part of libnuma.
+static const int MPOL_PREFERRED_MODE = 1;
+
+/// Sets the memory policy of the 'len' bytes at 'mem' to prefer the NUMA node of the
+/// current core. The kernel falls back to other nodes if that node is out of memory.
+/// Failures are ignored since the memory is still usable with the default policy.
+static void PreferCurrentNumaNode(uint8_t* mem, int64_t len) {
+  static const int BITS_PER_WORD = 8 * sizeof(unsigned long);
+  const int num_nodes = CpuInfo::GetMaxNumNumaNodes();
+  if (num_nodes <= 1) return;
+  const int node = CpuInfo::GetNumaNodeOfCore(CpuInfo::GetCurrentCore());
+  vector<unsigned long> nodemask(BitUtil::Ceil(num_nodes, BITS_PER_WORD), 0);
+  nodemask[node / BITS_PER_WORD] |= 1UL << (node % BITS_PER_WORD);
+  // The kernel ignores the last bit of 'maxnode'.
+  long rc = syscall(SYS_mbind, mem, len, MPOL_PREFERRED_MODE, nodemask.data(),
+      nodemask.size() * BITS_PER_WORD + 1, 0);
+  if (rc != 0) {
+    LOG_FIRST_N(WARNING, 1) << "mbind() failed to set the NUMA node of a buffer: "
+                            << GetStrErrMsg();
+  }
+}
+
 SystemAllocator::SystemAllocator(int64_t min_buffer_len)
   : min_buffer_len_(min_buffer_len) {
   DCHECK(BitUtil::IsPowerOf2(min_buffer_len));
@@ -111,6 +141,8 @@ Status SystemAllocator::AllocateViaMMap(int64_t len, uint8_t** buffer_mem) {
     DCHECK(rc == 0) << "madvise(MADV_HUGEPAGE) shouldn't fail" << errno;
 #endif
   }
+  // Set the policy before the memory is touched, since that is when it is allocated.
+  if (FLAGS_numa_local_buffers) PreferCurrentNumaNode(mem, len);
   *buffer_mem = mem;
   return Status::OK();
 }
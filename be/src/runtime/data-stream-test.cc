@@ -21,6 +21,7 @@
 #include "common/init.h"
 #include "common/logging.h"
 #include "common/status.h"
+#include "codegen/codegen-fn-ptr.h"
 #include "codegen/llvm-codegen.h"
 #include "exprs/slot-ref.h"
 #include "kudu/rpc/rpc_context.h"
@@ -36,10 +37,15 @@
 #include "runtime/krpc-data-stream-mgr.h"
 #include "runtime/krpc-data-stream-recvr.h"
 #include "runtime/krpc-data-stream-sender.h"
+#include "runtime/date-value.h"
+#include "runtime/decimal-value.h"
 #include "runtime/descriptors.h"
 #include "runtime/client-cache.h"
 #include "runtime/mem-tracker.h"
 #include "runtime/raw-value.inline.h"
+#include "runtime/string-value.h"
+#include "runtime/timestamp-value.h"
+#include "runtime/tuple.h"
 #include "service/data-stream-service.h"
 #include "service/fe-support.h"
 #include "util/cpu-info.h"
@@ -57,6 +63,7 @@
 #include "gen-cpp/Descriptors_types.h"
 #include "service/fe-support.h"
 
+#include <cmath>
 #include <iostream>
 #include <string>
 #include <unistd.h>
@@ -79,6 +86,7 @@ DECLARE_int32(datastream_sender_timeout_ms);
 DECLARE_int32(datastream_service_num_deserialization_threads);
 DECLARE_int32(datastream_service_deserialization_queue_size);
 DECLARE_string(datastream_service_queue_mem_limit);
+DECLARE_string(rack);
 
 static const PlanNodeId DEST_NODE_ID = 1;
 static const int BATCH_CAPACITY = 100;  // rows
@@ -289,6 +297,8 @@ class DataStreamTest : public testing::Test {
     unique_ptr<thread> thread_handle;
     Status status;
     int num_bytes_sent = 0;
+    // -1 if the sender did not count the bytes sent to other racks.
+    int64_t num_cross_rack_bytes_sent = -1;
   };
   // Allocate each SenderInfo separately so the address doesn't change.
   vector<unique_ptr<SenderInfo>> sender_info_;
@@ -357,6 +367,50 @@ class DataStreamTest : public testing::Test {
     row_desc_ = obj_pool_.Add(new RowDescriptor(*desc_tbl_, row_tids, nullable_tuples));
   }
 
+  // Creates a descriptor table with a single tuple that has a nullable slot of each of
+  // 'types', with slot i at byte offset 16 * i, and a RowDescriptor for that tuple.
+  void CreateMixedTypeRowDesc(const vector<ColumnType>& types, DescriptorTbl** desc_tbl,
+      const RowDescriptor** row_desc) {
+    const int null_bytes_offset = 16 * types.size();
+    TTupleDescriptor tuple_desc;
+    tuple_desc.__set_id(0);
+    tuple_desc.__set_byteSize(null_bytes_offset + (types.size() + 7) / 8);
+    tuple_desc.__set_numNullBytes((types.size() + 7) / 8);
+    TDescriptorTable thrift_desc_tbl;
+    thrift_desc_tbl.tupleDescriptors.push_back(tuple_desc);
+    for (int i = 0; i < types.size(); ++i) {
+      DCHECK_LE(types[i].GetSlotSize(), 16);
+      TSlotDescriptor slot_desc;
+      slot_desc.__set_id(i);
+      slot_desc.__set_parent(0);
+      slot_desc.__set_slotType(types[i].ToThrift());
+      slot_desc.__set_materializedPath(vector<int>(1, i));
+      slot_desc.__set_byteOffset(16 * i);
+      slot_desc.__set_nullIndicatorByte(null_bytes_offset + i / 8);
+      slot_desc.__set_nullIndicatorBit(i % 8);
+      slot_desc.__set_slotIdx(i);
+      thrift_desc_tbl.slotDescriptors.push_back(slot_desc);
+    }
+    EXPECT_OK(DescriptorTbl::CreateInternal(&obj_pool_, thrift_desc_tbl, desc_tbl));
+    *row_desc = obj_pool_.Add(new RowDescriptor(**desc_tbl, {0}, {false}));
+  }
+
+  // Accessors for the private hashing functions of KrpcDataStreamSender, which tests
+  // can only call through the fixture.
+  Status CodegenHashRow(KrpcDataStreamSenderConfig* config, LlvmCodeGen* codegen,
+      llvm::Function** fn) {
+    return config->CodegenHashRow(codegen, fn);
+  }
+
+  uint64_t HashRow(KrpcDataStreamSender* sender, TupleRow* row) {
+    return sender->HashRow(row);
+  }
+
+  void HashRowsBatched(KrpcDataStreamSender* sender, RowBatch* batch, int start_row,
+      int num_rows, uint64_t* hashes) {
+    sender->HashRowsBatched(batch, start_row, num_rows, hashes);
+  }
+
   // Create a tuple comparator to sort in ascending order on the single bigint column.
   void CreateTupleComparator(TupleRowComparator** less_than_comparator) {
     TupleRowComparatorConfig* comparator_config =
@@ -631,6 +685,11 @@ class DataStreamTest : public testing::Test {
     sender->Close(&state);
     info->num_bytes_sent = static_cast<KrpcDataStreamSender*>(
         sender.get())->GetNumDataBytesSent();
+    RuntimeProfile::Counter* cross_rack_bytes_sent =
+        sender->profile()->GetCounter("CrossRackBytesSent");
+    if (cross_rack_bytes_sent != nullptr) {
+      info->num_cross_rack_bytes_sent = cross_rack_bytes_sent->value();
+    }
 
     batch->Reset();
     state.ReleaseResources();
@@ -740,6 +799,39 @@ TEST_F(DataStreamTest, BasicTest) {
   }
 }
 
+// Bytes sent to receivers in other racks are counted separately.
+TEST_F(DataStreamTest, CrossRackBytesSent) {
+  gflags::FlagSaver saver;
+  FLAGS_rack = "rack1";
+  // Receivers in the same rack, in another rack and in an unknown rack.
+  for (int i = 0; i < 3; ++i) {
+    StartReceiver(TPartitionType::UNPARTITIONED, 1, i, 1024, false);
+  }
+  dest_.Mutable(0)->set_rack("rack1");
+  dest_.Mutable(1)->set_rack("rack2");
+  StartSender(TPartitionType::UNPARTITIONED);
+  JoinSenders();
+  CheckSenders();
+  JoinReceivers();
+  CheckReceivers(TPartitionType::UNPARTITIONED, 1);
+  // The same batches are broadcast to all receivers, but only one of them is in another
+  // rack.
+  EXPECT_GT(sender_info_[0]->num_cross_rack_bytes_sent, 0);
+  EXPECT_EQ(sender_info_[0]->num_bytes_sent,
+      3 * sender_info_[0]->num_cross_rack_bytes_sent);
+
+  // Backends without a rack don't count the bytes sent to other racks.
+  Reset();
+  FLAGS_rack = "";
+  StartReceiver(TPartitionType::UNPARTITIONED, 1, 0, 1024, false);
+  dest_.Mutable(0)->set_rack("rack2");
+  StartSender(TPartitionType::UNPARTITIONED);
+  JoinSenders();
+  CheckSenders();
+  JoinReceivers();
+  EXPECT_EQ(-1, sender_info_[0]->num_cross_rack_bytes_sent);
+}
+
 // Test streams with different query ids should hash to different destinations.
 TEST_F(DataStreamTest, HashPartitionTest) {
   bool result = false;
@@ -763,6 +855,189 @@ TEST_F(DataStreamTest, HashPartitionTest) {
   ASSERT_EQ(result, true);
 }
 
+// The batched hashing used by Send() without codegen, the per-row HashRow() used by
+// HashAndAddRows() and the codegen'd HashRow() must agree on the hash of every row, so
+// that each row goes to the same channel on every path.
+TEST_F(DataStreamTest, HashPartitionParity) {
+  const vector<ColumnType> types = {ColumnType(TYPE_BOOLEAN), ColumnType(TYPE_TINYINT),
+      ColumnType(TYPE_SMALLINT), ColumnType(TYPE_INT), ColumnType(TYPE_BIGINT),
+      ColumnType(TYPE_FLOAT), ColumnType(TYPE_DOUBLE), ColumnType(TYPE_DATE),
+      ColumnType(TYPE_TIMESTAMP), ColumnType::CreateDecimalType(9, 2),
+      ColumnType::CreateDecimalType(18, 4), ColumnType::CreateDecimalType(38, 10),
+      ColumnType(TYPE_STRING)};
+  DescriptorTbl* desc_tbl;
+  const RowDescriptor* row_desc;
+  CreateMixedTypeRowDesc(types, &desc_tbl, &row_desc);
+
+  // Partition on all columns.
+  TDataStreamSink stream_sink;
+  stream_sink.dest_node_id = DEST_NODE_ID;
+  stream_sink.output_partition.type = TPartitionType::HASH_PARTITIONED;
+  stream_sink.output_partition.__isset.partition_exprs = true;
+  for (int i = 0; i < types.size(); ++i) {
+    TExprNode expr_node;
+    expr_node.node_type = TExprNodeType::SLOT_REF;
+    expr_node.type = types[i].ToThrift();
+    expr_node.num_children = 0;
+    TSlotRef slot_ref;
+    slot_ref.slot_id = i;
+    expr_node.__set_slot_ref(slot_ref);
+    TExpr expr;
+    expr.nodes.push_back(expr_node);
+    stream_sink.output_partition.partition_exprs.push_back(expr);
+  }
+  TDataSink sink;
+  sink.__set_stream_sink(stream_sink);
+
+  // No receivers are needed since no rows are sent.
+  const int num_channels = 7;
+  for (int i = 0; i < num_channels; ++i) {
+    TUniqueId instance_id;
+    GetNextInstanceId(&instance_id);
+  }
+  RuntimeState state(TQueryCtx(), exec_env_.get(), desc_tbl);
+  TPlanFragment fragment;
+  fragment.output_sink = sink;
+  PlanFragmentCtxPB fragment_ctx;
+  *fragment_ctx.mutable_destinations() = dest_;
+  FragmentState fragment_state(state.query_state(), fragment, fragment_ctx);
+  DataSinkConfig* data_sink = nullptr;
+  ASSERT_OK(DataSinkConfig::CreateConfig(sink, row_desc, &fragment_state, &data_sink));
+  KrpcDataStreamSenderConfig* config =
+      static_cast<KrpcDataStreamSenderConfig*>(data_sink);
+
+  typedef uint64_t (*HashRowFn)(KrpcDataStreamSender*, TupleRow*);
+  CodegenFnPtr<HashRowFn> codegend_hash_row;
+  ASSERT_OK(fragment_state.CreateCodegen());
+  LlvmCodeGen* codegen = fragment_state.codegen();
+  llvm::Function* hash_row_fn;
+  ASSERT_OK(CodegenHashRow(config, codegen, &hash_row_fn));
+  codegen->AddFunctionToJit(hash_row_fn, &codegend_hash_row);
+  ASSERT_OK(codegen->FinalizeModule());
+  ASSERT_TRUE(codegend_hash_row.load() != nullptr);
+
+  KrpcDataStreamSender sender(-1, 0, *config, data_sink->tsink_->stream_sink, dest_,
+      1024, &state);
+  ASSERT_OK(sender.Prepare(&state, &tracker_));
+  ASSERT_OK(sender.Open(&state));
+
+  // More rows than fit in one batch of HashRowsBatched(), and not a multiple of it.
+  const int num_rows = 10 * RowBatch::HASH_BATCH_SIZE + 3;
+  const TupleDescriptor* tuple_desc = row_desc->tuple_descriptors()[0];
+  RowBatch batch(row_desc, num_rows, &tracker_);
+  MemPool* pool = batch.tuple_data_pool();
+  uint8_t* tuple_mem = pool->Allocate(num_rows * tuple_desc->byte_size());
+  memset(tuple_mem, 0, num_rows * tuple_desc->byte_size());
+  const float float_values[] = {numeric_limits<float>::quiet_NaN(), nanf("1"),
+      -numeric_limits<float>::quiet_NaN(), 0.0f, -0.0f,
+      numeric_limits<float>::infinity(), -numeric_limits<float>::infinity()};
+  const double double_values[] = {numeric_limits<double>::quiet_NaN(), nan("1"),
+      -numeric_limits<double>::quiet_NaN(), 0.0, -0.0,
+      numeric_limits<double>::infinity(), -numeric_limits<double>::infinity()};
+  const int num_special_values = sizeof(float_values) / sizeof(float);
+  for (int r = 0; r < num_rows; ++r) {
+    Tuple* tuple = reinterpret_cast<Tuple*>(tuple_mem + r * tuple_desc->byte_size());
+    const int64_t sign = r % 2 == 0 ? 1 : -1;
+    for (int i = 0; i < types.size(); ++i) {
+      const SlotDescriptor* slot_desc = tuple_desc->slots()[i];
+      // Each column has NULLs in different rows, and some rows are all NULL.
+      if ((r + i) % 7 == 0 || r % 50 == 1) {
+        tuple->SetNull(slot_desc->null_indicator_offset());
+        continue;
+      }
+      void* slot = tuple->GetSlot(slot_desc->tuple_offset());
+      switch (types[i].type) {
+        case TYPE_BOOLEAN:
+          *reinterpret_cast<bool*>(slot) = r % 3 == 0;
+          break;
+        case TYPE_TINYINT:
+          *reinterpret_cast<int8_t*>(slot) = static_cast<int8_t>(r * 37);
+          break;
+        case TYPE_SMALLINT:
+          *reinterpret_cast<int16_t*>(slot) = static_cast<int16_t>(r * 1009);
+          break;
+        case TYPE_INT:
+          *reinterpret_cast<int32_t*>(slot) = static_cast<int32_t>(r * 2654435761L);
+          break;
+        case TYPE_BIGINT:
+          *reinterpret_cast<int64_t*>(slot) =
+              static_cast<int64_t>(r * 0x9E3779B97F4A7C15UL);
+          break;
+        case TYPE_FLOAT:
+          *reinterpret_cast<float*>(slot) = r % 2 == 0 ?
+              float_values[r / 2 % num_special_values] : sign * r * 1.25f;
+          break;
+        case TYPE_DOUBLE:
+          *reinterpret_cast<double*>(slot) = r % 2 == 0 ?
+              double_values[r / 2 % num_special_values] : sign * r * 1.25;
+          break;
+        case TYPE_DATE:
+          *reinterpret_cast<DateValue*>(slot) = DateValue(sign * r * 1000);
+          break;
+        case TYPE_TIMESTAMP:
+          *reinterpret_cast<TimestampValue*>(slot) = TimestampValue(
+              boost::gregorian::date(1970, 1, 1) + boost::gregorian::days(r * 101),
+              boost::posix_time::time_duration(r % 24, r % 60, r % 60, r * 1000));
+          break;
+        case TYPE_DECIMAL:
+          if (types[i].precision <= ColumnType::MAX_DECIMAL4_PRECISION) {
+            *reinterpret_cast<Decimal4Value*>(slot) =
+                Decimal4Value(static_cast<int32_t>(sign * r * 12345));
+          } else if (types[i].precision <= ColumnType::MAX_DECIMAL8_PRECISION) {
+            *reinterpret_cast<Decimal8Value*>(slot) =
+                Decimal8Value(sign * r * 12345678901L);
+          } else {
+            __int128_t val = sign * r;
+            for (int j = 0; j < 30; ++j) val *= 10;
+            *reinterpret_cast<Decimal16Value*>(slot) = Decimal16Value(val + r);
+          }
+          break;
+        case TYPE_STRING: {
+          // Empty, short and long strings.
+          const int len = r % 5 == 0 ? 0 : r % 40;
+          char* ptr = reinterpret_cast<char*>(pool->Allocate(len));
+          for (int j = 0; j < len; ++j) ptr[j] = 'a' + (r + j) % 26;
+          *reinterpret_cast<StringValue*>(slot) = StringValue(ptr, len);
+          break;
+        }
+        default:
+          FAIL() << "Unexpected type " << types[i];
+      }
+    }
+    int idx = batch.AddRow();
+    batch.GetRow(idx)->SetTuple(0, tuple);
+    batch.CommitLastRow();
+  }
+
+  HashRowFn codegend_hash_row_fn = codegend_hash_row.load();
+  int num_distinct_channels = 0;
+  vector<bool> used_channels(num_channels);
+  for (int start = 0; start < num_rows; start += RowBatch::HASH_BATCH_SIZE) {
+    const int num_window_rows = min(num_rows - start, RowBatch::HASH_BATCH_SIZE);
+    uint64_t hashes[RowBatch::HASH_BATCH_SIZE];
+    HashRowsBatched(&sender, &batch, start, num_window_rows, hashes);
+    for (int i = 0; i < num_window_rows; ++i) {
+      TupleRow* row = batch.GetRow(start + i);
+      const uint64_t hash = HashRow(&sender, row);
+      EXPECT_EQ(hash, hashes[i]) << "row " << start + i;
+      EXPECT_EQ(hash, codegend_hash_row_fn(&sender, row)) << "row " << start + i;
+      const int channel = hash % num_channels;
+      EXPECT_EQ(channel, hashes[i] % num_channels) << "row " << start + i;
+      if (!used_channels[channel]) ++num_distinct_channels;
+      used_channels[channel] = true;
+    }
+  }
+  // The rows are spread over the channels.
+  EXPECT_GT(num_distinct_channels, 1);
+
+  batch.Reset();
+  sender.Close(&state);
+  data_sink->Close();
+  fragment_state.ReleaseResources();
+  state.ReleaseResources();
+  desc_tbl->ReleaseResources();
+}
+
 // This test is to exercise a previously present deadlock path which is now fixed, to
 // ensure that the deadlock does not happen anymore. It does this by doing the following:
 // This test starts multiple senders to send to the same receiver. It makes sure that
@@ -192,6 +192,16 @@ inline int MaxBitsRequiredAfterScaling(int128_t num, int scale_by) {
   return num_occupied + MaxBitsRequiredIncreaseAfterScaling(scale_by);
 }
 
+// Returns the magnitude of 'x'. Unlike abs(), it is defined for the minimum int128_t.
+inline __uint128_t UnsignedAbs(int128_t x) {
+  return x < 0 ? -static_cast<__uint128_t>(x) : static_cast<__uint128_t>(x);
+}
+
+// Returns the int128_t with magnitude 'magnitude', negated if 'negative' is true.
+inline int128_t ApplySign(__uint128_t magnitude, bool negative) {
+  return static_cast<int128_t>(negative ? -magnitude : magnitude);
+}
+
 // Returns the minimum number of leading zero x or y would have after one of them gets
 // scaled up to match the scale of the other one.
 template<typename T>
@@ -433,6 +443,24 @@ DecimalValue<RESULT_T> DecimalValue<T>::Multiply(int this_scale,
   if (UNLIKELY(needs_int256)) {
     if (delta_scale == 0) {
       DCHECK(*overflow);
+    } else if (LIKELY(delta_scale <= 38)) {
+      // Multiply and scale down the magnitudes with the native 256-bit kernels.
+      __uint128_t divisor = DecimalUtil::GetScaleMultiplier<int128_t>(delta_scale);
+      UnsignedInt256 product =
+          MultiplyWide(detail::UnsignedAbs(x), detail::UnsignedAbs(y));
+      const __uint128_t max_result = MAX_UNSCALED_DECIMAL16;
+      __uint128_t remainder = 0;
+      // DivideWide() requires the quotient to fit into 128 bits.
+      __uint128_t quotient = product.hi >= divisor ?
+          ~static_cast<__uint128_t>(0) : DivideWide(product, divisor, &remainder);
+      if (quotient > max_result) {
+        *overflow = true;
+      } else {
+        // Round the magnitude half away from zero.
+        if (round && remainder >= (divisor >> 1)) ++quotient;
+        *overflow |= quotient > max_result;
+        result = detail::ApplySign(quotient, (x < 0) != (y < 0));
+      }
     } else {
       int256_t intermediate_result = ConvertToInt256(x) * ConvertToInt256(y);
       intermediate_result = DecimalUtil::ScaleDownAndRound<int256_t>(
@@ -492,7 +520,31 @@ inline DecimalValue<RESULT_T> DecimalValue<T>::Divide(int this_scale,
   DCHECK_GE(scale_by, 0);
   // Use higher precision ints for intermediates to avoid overflows. Divides lead to
   // large numbers very quickly (and get eliminated by the int divide).
-  if (sizeof(T) == 16) {
+  if (sizeof(T) == 16 && LIKELY(scale_by <= 38)) {
+    // Divide the magnitudes with the native 256-bit kernels. The scaled dividend is less
+    // than 10^76, so only the quotient can overflow.
+    const __uint128_t max_result = MAX_UNSCALED_DECIMAL16;
+    int128_t x_sp = value();
+    int128_t y_sp = other.value();
+    UnsignedInt256 x = MultiplyWide(detail::UnsignedAbs(x_sp),
+        DecimalUtil::GetScaleMultiplier<int128_t>(scale_by));
+    __uint128_t y = detail::UnsignedAbs(y_sp);
+    if (x.hi >= y) {
+      // The quotient does not even fit into 128 bits.
+      *overflow = true;
+      return DecimalValue<RESULT_T>();
+    }
+    __uint128_t remainder;
+    __uint128_t r = DivideWide(x, y, &remainder);
+    *overflow |= r > max_result;
+    // 'remainder' is less than 'y', which is at most MAX_UNSCALED_DECIMAL16, so doubling
+    // it cannot overflow.
+    if (round && 2 * remainder >= y) ++r;
+    // Check overflow again after rounding since +/-1 could cause decimal overflow
+    if (result_precision == ColumnType::MAX_PRECISION) *overflow |= r > max_result;
+    return DecimalValue<RESULT_T>(detail::ApplySign(r, (x_sp < 0) != (y_sp < 0)));
+  } else if (sizeof(T) == 16) {
+    // Scaling up by more than 10^38 may not fit into 256 bits.
     int128_t x_sp = value();
     // There is a test in expr-test.cc that shows that it OK to check for overflow this
     // way (and that no additional checks are required).
@@ -592,18 +644,20 @@ inline DecimalValue<RESULT_T> DecimalValue<T>::Mod(int this_scale,
         DCHECK(abs(x % y) <= MAX_UNSCALED_DECIMAL16);
         result = x % y;
       } else {
-        int256_t x_256 = ConvertToInt256(value());
-        int256_t y_256 = ConvertToInt256(other.value());
+        // The result has the sign of the dividend and a magnitude below both operands,
+        // so compute it on the magnitudes with the native 256-bit kernels.
+        __uint128_t x = detail::UnsignedAbs(value());
+        __uint128_t y = detail::UnsignedAbs(other.value());
+        __uint128_t remainder;
         if (this_scale < other_scale) {
-          x_256 *= DecimalUtil::GetScaleMultiplier<int256_t>(other_scale - this_scale);
+          remainder = ModWide(MultiplyWide(x,
+              DecimalUtil::GetScaleMultiplier<int128_t>(other_scale - this_scale)), y);
         } else {
-          y_256 *= DecimalUtil::GetScaleMultiplier<int256_t>(this_scale - other_scale);
+          UnsignedInt256 y_scaled = MultiplyWide(y,
+              DecimalUtil::GetScaleMultiplier<int128_t>(this_scale - other_scale));
+          remainder = y_scaled.hi == 0 ? x % y_scaled.lo : x;
         }
-        int256_t intermediate_result = x_256 % y_256;
-        bool ovf = false;
-        result = ConvertToInt128(intermediate_result,
-            MAX_UNSCALED_DECIMAL16, &ovf);
-        DCHECK(!ovf);
+        result = detail::ApplySign(remainder, value() < 0);
       }
       break;
     }
@@ -660,17 +714,17 @@ inline int Decimal8Value::Compare(int this_scale, const Decimal8Value& other,
 template <>
 inline int Decimal16Value::Compare(int this_scale, const Decimal16Value& other,
      int other_scale) const {
-  int256_t x = ConvertToInt256(this->value());
-  int256_t y = ConvertToInt256(other.value());
+  // Values with different signs compare without scaling. Otherwise compare the scaled
+  // magnitudes with the native 256-bit kernels and flip the result for negative values.
+  bool x_negative = this->value() < 0;
+  if (x_negative != (other.value() < 0)) return x_negative ? -1 : 1;
   int delta_scale = this_scale - other_scale;
-  if (delta_scale > 0) {
-    y = DecimalUtil::MultiplyByScale<int256_t>(y, delta_scale, false);
-  } else if (delta_scale < 0) {
-    x = DecimalUtil::MultiplyByScale<int256_t>(x, -delta_scale, false);
-  }
-  if (x == y) return 0;
-  if (x < y) return -1;
-  return 1;
+  UnsignedInt256 x = MultiplyWide(detail::UnsignedAbs(this->value()),
+      DecimalUtil::GetScaleMultiplier<int128_t>(delta_scale < 0 ? -delta_scale : 0));
+  UnsignedInt256 y = MultiplyWide(detail::UnsignedAbs(other.value()),
+      DecimalUtil::GetScaleMultiplier<int128_t>(delta_scale > 0 ? delta_scale : 0));
+  int result = CompareWide(x, y);
+  return x_negative ? -result : result;
 }
 
 /// Returns as string with full 0 padding on the right and single 0 padded on the left
@@ -56,6 +56,8 @@ using google::protobuf::RepeatedPtrField;
 using kudu::rpc::RpcContext;
 using namespace apache::thrift;
 
+DECLARE_bool(status_report_profile_deltas);
+
 namespace impala {
 
 const string FragmentInstanceState::PER_HOST_PEAK_MEM_COUNTER = "PerHostPeakMemUsage";
@@ -299,6 +301,9 @@ void FragmentInstanceState::GetStatusReport(FragmentInstanceExecStatusPB* instan
   } else {
     DCHECK(unagg_profile != nullptr);
     profile()->ToThrift(unagg_profile);
+    if (FLAGS_status_report_profile_deltas) {
+      profile_delta_encoder_.EncodeDelta(unagg_profile);
+    }
   }
 
   // Pull out and aggregate counters from the profile.
@@ -384,8 +389,9 @@ void FragmentInstanceState::GetStatusReport(FragmentInstanceExecStatusPB* instan
 }
 
 void FragmentInstanceState::ReportSuccessful(
-    const FragmentInstanceExecStatusPB& instance_exec_status) {
+    const FragmentInstanceExecStatusPB& instance_exec_status, bool profile_received) {
   prev_stateful_reports_.clear();
+  if (profile_received) profile_delta_encoder_.Acknowledge();
   if (instance_exec_status.done()) final_report_sent_ = true;
 }
 
@@ -34,6 +34,7 @@
 #include "util/condition-variable.h"
 #include "util/promise.h"
 #include "util/runtime-profile.h"
+#include "util/runtime-profile-delta.h"
 
 namespace kudu {
 namespace rpc {
@@ -103,7 +104,9 @@ class FragmentInstanceState {
   /// Called periodically by query state thread to get the current status of this fragment
   /// instance. The fragment instance's status is stored in 'instance_status' and its
   /// Thrift runtime profile is stored in either 'unagg_profile' or 'agg_profile',
-  /// depending on whether aggregated profiles are enabled.
+  /// depending on whether aggregated profiles are enabled. If
+  /// --status_report_profile_deltas is true, 'unagg_profile' only contains what changed
+  /// since the last profile the coordinator received.
   void GetStatusReport(FragmentInstanceExecStatusPB* instance_status,
       TRuntimeProfileTree* unagg_profile, AggregatedRuntimeProfile* agg_profile,
       const Status& overall_status);
@@ -111,10 +114,16 @@ class FragmentInstanceState {
   /// After each call to GetStatusReport(), the query state thread should call one of the
   /// following to indicate if the report rpc was successful. Note that in the case of
   /// ReportFailed(), the report may have been received by the coordinator even though the
-  /// rpc appeared to fail.
-  void ReportSuccessful(const FragmentInstanceExecStatusPB& instance_status);
+  /// rpc appeared to fail. 'profile_received' is true if the coordinator received and
+  /// applied the profile of the report.
+  void ReportSuccessful(
+      const FragmentInstanceExecStatusPB& instance_status, bool profile_received);
   void ReportFailed(const FragmentInstanceExecStatusPB& instance_status);
 
+  /// Makes the next report include the full profile, e.g. because the coordinator asked
+  /// for it.
+  void ResetProfileDeltas() { profile_delta_encoder_.Reset(); }
+
   /// Accessor functions for this fragment instance's sink. Valid after the Prepare
   /// phase. Returns nullptr if this fragment has a different sink type.
   PlanRootSink* GetRootSink() const;
@@ -198,6 +207,10 @@ class FragmentInstanceState {
   /// received by the coordinator.
   std::vector<StatefulStatusPB> prev_stateful_reports_;
 
+  /// Computes the profile deltas of unaggregated reports. Only used by the query state
+  /// thread.
+  RuntimeProfileDeltaEncoder profile_delta_encoder_;
+
   /// True if a report has been generated where 'done' is true, after which the sequence
   /// number should not be bumped for future reports.
   bool final_report_generated_ = false;
@@ -20,6 +20,7 @@
 #include <boost/bind.hpp>
 
 #include <chrono>
+#include <cmath>
 #include <condition_variable>
 #include <iostream>
 #include <thrift/protocol/TDebugProtocol.h>
@@ -47,6 +48,7 @@
 #include "service/data-stream-service.h"
 #include "util/aligned-new.h"
 #include "util/debug-util.h"
+#include "util/hash-util.h"
 #include "util/network-util.h"
 #include "util/pretty-printer.h"
 
@@ -67,6 +69,7 @@ using kudu::rpc::RpcSidecar;
 using kudu::MonoDelta;
 
 DECLARE_int64(impala_slow_rpc_threshold_ms);
+DECLARE_string(rack);
 DECLARE_int32(rpc_retry_interval_ms);
 
 namespace impala {
@@ -147,15 +150,18 @@ class KrpcDataStreamSender::Channel : public CacheLineAligned {
   // combination. buffer_size is specified in bytes and a soft limit on how much tuple
   // data is getting accumulated before being sent; it only applies when data is added via
   // AddRow() and not sent directly via SendBatch().
+  // 'is_cross_rack' is true if the destination is in a different rack than this backend.
   Channel(KrpcDataStreamSender* parent, const RowDescriptor* row_desc,
       const std::string& hostname, const NetworkAddressPB& destination,
-      const UniqueIdPB& fragment_instance_id, PlanNodeId dest_node_id, int buffer_size)
+      const UniqueIdPB& fragment_instance_id, PlanNodeId dest_node_id, int buffer_size,
+      bool is_cross_rack)
     : parent_(parent),
       row_desc_(row_desc),
       hostname_(hostname),
       address_(destination),
       fragment_instance_id_(fragment_instance_id),
-      dest_node_id_(dest_node_id) {
+      dest_node_id_(dest_node_id),
+      is_cross_rack_(is_cross_rack) {
     DCHECK(IsResolvedAddress(address_));
   }
 
@@ -220,6 +226,9 @@ class KrpcDataStreamSender::Channel : public CacheLineAligned {
   const UniqueIdPB fragment_instance_id_;
   const PlanNodeId dest_node_id_;
 
+  // True if the receiver is in a different rack, see cross_rack_bytes_sent_counter_.
+  const bool is_cross_rack_;
+
   // The row batch for accumulating rows copied from AddRow().
   // Only used if the partitioning scheme is "KUDU" or "HASH_PARTITIONED".
   scoped_ptr<RowBatch> batch_;
@@ -503,6 +512,9 @@ void KrpcDataStreamSender::Channel::TransmitDataCompleteCb() {
     int64_t row_batch_size = RowBatch::GetSerializedSize(*rpc_in_flight_batch_);
     int64_t network_time = total_time - resp_.receiver_latency_ns();
     COUNTER_ADD(parent_->bytes_sent_counter_, row_batch_size);
+    if (is_cross_rack_) {
+      COUNTER_ADD(parent_->cross_rack_bytes_sent_counter_, row_batch_size);
+    }
     if (LIKELY(network_time > 0)) {
       // 'row_batch_size' is bounded by FLAGS_rpc_max_message_size which shouldn't exceed
       // max 32-bit signed value so multiplication below should not overflow.
@@ -733,9 +745,11 @@ KrpcDataStreamSender::KrpcDataStreamSender(TDataSinkId sink_id, int sender_id,
       || sink.output_partition.type == TPartitionType::KUDU);
 
   for (const auto& destination : destinations) {
+    bool is_cross_rack = !FLAGS_rack.empty() && !destination.rack().empty()
+        && destination.rack() != FLAGS_rack;
     channels_.emplace_back(new Channel(this, row_desc_, destination.address().hostname(),
         destination.krpc_backend(), destination.fragment_instance_id(), sink.dest_node_id,
-        per_channel_buffer_size));
+        per_channel_buffer_size, is_cross_rack));
   }
 
   if (partition_type_ == TPartitionType::UNPARTITIONED
@@ -764,6 +778,10 @@ Status KrpcDataStreamSender::Prepare(
   rpc_failure_counter_ = ADD_COUNTER(profile(), "RpcFailure", TUnit::UNIT);
   bytes_sent_counter_ = ADD_COUNTER(profile(), "TotalBytesSent", TUnit::BYTES);
   state->AddBytesSentCounter(bytes_sent_counter_);
+  if (!FLAGS_rack.empty()) {
+    cross_rack_bytes_sent_counter_ =
+        ADD_COUNTER(profile(), "CrossRackBytesSent", TUnit::BYTES);
+  }
   bytes_sent_time_series_counter_ =
       ADD_TIME_SERIES_COUNTER(profile(), "BytesSent", bytes_sent_counter_);
   network_throughput_counter_ =
@@ -985,6 +1003,103 @@ uint64_t KrpcDataStreamSender::HashRow(TupleRow* row) {
   return hash_val;
 }
 
+// Returns the number of bytes that RawValue::GetHashValueFastHash() hashes for values of
+// 'type' if it is the same for all values, or 0 otherwise.
+static int FixedHashLength(const ColumnType& type) {
+  switch (type.type) {
+    case TYPE_BOOLEAN:
+    case TYPE_TINYINT:
+      return 1;
+    case TYPE_SMALLINT:
+      return 2;
+    case TYPE_INT:
+    case TYPE_DATE:
+    case TYPE_FLOAT:
+      return 4;
+    case TYPE_BIGINT:
+    case TYPE_DOUBLE:
+      return 8;
+    case TYPE_TIMESTAMP:
+      return 12;
+    case TYPE_DECIMAL:
+      return type.GetByteSize();
+    default:
+      return 0;
+  }
+}
+
+void KrpcDataStreamSender::HashPartitionExpr(ScalarExprEvaluator* eval,
+    RowBatch* batch, int start_row, int num_rows, uint64_t* hashes) {
+  DCHECK_LE(num_rows, RowBatch::HASH_BATCH_SIZE);
+  const ColumnType& type = eval->root().type();
+  const int len = FixedHashLength(type);
+  if (len == 0) {
+    for (int i = 0; i < num_rows; ++i) {
+      void* partition_val = eval->GetValue(batch->GetRow(start_row + i));
+      hashes[i] = RawValue::GetHashValueFastHash(partition_val, type, hashes[i]);
+    }
+    return;
+  }
+  // The values are copied next to each other, with NaNs replaced by the canonical NaN
+  // that GetHashValueFastHash() hashes. NULLs are hashed separately.
+  static const int MAX_FIXED_HASH_LENGTH = 16;
+  DCHECK_LE(len, MAX_FIXED_HASH_LENGTH);
+  uint8_t values[RowBatch::HASH_BATCH_SIZE * MAX_FIXED_HASH_LENGTH];
+  bool is_null[RowBatch::HASH_BATCH_SIZE];
+  uint64_t null_hashes[RowBatch::HASH_BATCH_SIZE];
+  bool has_nulls = false;
+  for (int i = 0; i < num_rows; ++i) {
+    const void* partition_val = eval->GetValue(batch->GetRow(start_row + i));
+    uint8_t* value = values + i * len;
+    is_null[i] = partition_val == nullptr;
+    if (UNLIKELY(is_null[i])) {
+      null_hashes[i] = RawValue::GetHashValueFastHash(nullptr, type, hashes[i]);
+      has_nulls = true;
+      memset(value, 0, len);
+      continue;
+    }
+    if (type.type == TYPE_FLOAT
+        && std::isnan(*static_cast<const float*>(partition_val))) {
+      partition_val = &RawValue::CANONICAL_FLOAT_NAN;
+    } else if (type.type == TYPE_DOUBLE
+        && std::isnan(*static_cast<const double*>(partition_val))) {
+      partition_val = &RawValue::CANONICAL_DOUBLE_NAN;
+    }
+    memcpy(value, partition_val, len);
+  }
+  HashUtil::FastHash64Batch(num_rows, values, len, len, hashes);
+  if (UNLIKELY(has_nulls)) {
+    for (int i = 0; i < num_rows; ++i) {
+      if (is_null[i]) hashes[i] = null_hashes[i];
+    }
+  }
+}
+
+void KrpcDataStreamSender::HashRowsBatched(
+    RowBatch* batch, int start_row, int num_rows, uint64_t* hashes) {
+  DCHECK_LE(num_rows, RowBatch::HASH_BATCH_SIZE);
+  for (int i = 0; i < num_rows; ++i) hashes[i] = exchange_hash_seed_;
+  for (ScalarExprEvaluator* eval : partition_expr_evals_) {
+    HashPartitionExpr(eval, batch, start_row, num_rows, hashes);
+  }
+}
+
+Status KrpcDataStreamSender::HashAndAddRowsBatched(RowBatch* batch) {
+  const int num_rows = batch->num_rows();
+  const int num_channels = channels_.size();
+  const int hash_batch_size = RowBatch::HASH_BATCH_SIZE;
+  uint64_t hashes[hash_batch_size];
+  for (int batch_start = 0; batch_start < num_rows; batch_start += hash_batch_size) {
+    int batch_window_size = min(num_rows - batch_start, hash_batch_size);
+    HashRowsBatched(batch, batch_start, batch_window_size, hashes);
+    for (int i = 0; i < batch_window_size; ++i) {
+      RETURN_IF_ERROR(AddRowToChannel(hashes[i] % num_channels,
+          batch->GetRow(i + batch_start)));
+    }
+  }
+  return Status::OK();
+}
+
 Status KrpcDataStreamSender::Send(RuntimeState* state, RowBatch* batch) {
   SCOPED_TIMER(profile()->total_time_counter());
   DCHECK(!closed_);
@@ -1040,7 +1155,7 @@ Status KrpcDataStreamSender::Send(RuntimeState* state, RowBatch* batch) {
     if (hash_and_add_rows_fn != nullptr) {
       RETURN_IF_ERROR(hash_and_add_rows_fn(this, batch));
     } else {
-      RETURN_IF_ERROR(HashAndAddRows(batch));
+      RETURN_IF_ERROR(HashAndAddRowsBatched(batch));
     }
   }
   COUNTER_ADD(total_sent_rows_counter_, batch->num_rows());
@@ -83,6 +83,8 @@ class KrpcDataStreamSenderConfig : public DataSinkConfig {
 
   /// Returns the name of the partitioning type of this data stream sender.
   std::string PartitionTypeName() const;
+
+  friend class DataStreamTest;
 };
 
 /// Single sender of an m:n data stream.
@@ -180,6 +182,22 @@ class KrpcDataStreamSender : public DataSink {
   /// insertion into the channel fails. Returns OK status otherwise.
   Status HashAndAddRows(RowBatch* batch);
 
+  /// Same as HashAndAddRows() with the same hash values, but hashes the partition
+  /// expressions column by column for a window of rows at a time: fixed-length values
+  /// of an expression are gathered and hashed with HashUtil::FastHash64Batch(). Used if
+  /// HashAndAddRows() is not codegen'd.
+  Status HashAndAddRowsBatched(RowBatch* batch);
+
+  /// Stores the hash values of the 'num_rows' rows of 'batch' starting at 'start_row'
+  /// in 'hashes'. Each value equals HashRow() of the same row.
+  void HashRowsBatched(RowBatch* batch, int start_row, int num_rows, uint64_t* hashes);
+
+  /// Evaluates 'eval' over the 'num_rows' rows of 'batch' starting at 'start_row' and
+  /// hashes the values with the hashes in 'hashes' as seeds, storing the results in
+  /// 'hashes'. Like HashRow(), but for one partition expression and several rows.
+  void HashPartitionExpr(ScalarExprEvaluator* eval, RowBatch* batch, int start_row,
+      int num_rows, uint64_t* hashes);
+
   /// Adds the given row to 'channels_[channel_id]'.
   Status AddRowToChannel(const int channel_id, TupleRow* row);
 
@@ -232,6 +250,10 @@ class KrpcDataStreamSender : public DataSink {
   /// Total number of bytes sent. Updated on RPC completion.
   RuntimeProfile::Counter* bytes_sent_counter_ = nullptr;
 
+  /// Number of bytes sent to destinations in a different rack than this backend. Only
+  /// created if --rack is set. Updated on RPC completion.
+  RuntimeProfile::Counter* cross_rack_bytes_sent_counter_ = nullptr;
+
   /// Time series of number of bytes sent, samples bytes_sent_counter_.
   RuntimeProfile::TimeSeriesCounter* bytes_sent_time_series_counter_ = nullptr;
 
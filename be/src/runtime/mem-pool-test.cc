@@ -154,6 +154,51 @@ TEST(MemPoolTest, Keep) {
   p2.FreeAll();
 }
 
+// Test that externally allocated buffers are adopted as full chunks and are released
+// or transferred together with the rest of the pool.
+TEST(MemPoolTest, AcquireExternalChunk) {
+  MemTracker tracker;
+  MemPool p(&tracker);
+  p.Allocate(1024);
+  EXPECT_EQ(MemPoolTest::INITIAL_CHUNK_SIZE, tracker.consumption());
+
+  const int64_t ext_size = 10 * 1024;
+  tracker.Consume(ext_size);
+  uint8_t* ext = reinterpret_cast<uint8_t*>(malloc(ext_size));
+  ASSERT_TRUE(ext != nullptr);
+  memset(ext, 'a', ext_size);
+  p.AcquireExternalChunk(ext, ext_size);
+  ASSERT_TRUE(MemPoolTest::CheckIntegrity(&p, false));
+  EXPECT_EQ(1024 + ext_size, p.total_allocated_bytes());
+  EXPECT_EQ(MemPoolTest::INITIAL_CHUNK_SIZE + ext_size, p.GetTotalChunkSizes());
+
+  // New allocations must not be served from the external chunk.
+  uint8_t* ptr = p.Allocate(512);
+  EXPECT_TRUE(ptr < ext || ptr >= ext + ext_size);
+  ASSERT_TRUE(MemPoolTest::CheckIntegrity(&p, false));
+
+  // The external chunk is transferred along with the other chunks.
+  MemPool p2(&tracker);
+  p2.AcquireData(&p, false);
+  EXPECT_EQ(0, p.total_allocated_bytes());
+  EXPECT_EQ(1024 + 512 + ext_size, p2.total_allocated_bytes());
+  EXPECT_EQ('a', ext[ext_size - 1]);
+
+  // Adopting into an empty pool that has only free chunks also works.
+  p.Allocate(100);
+  p.Clear();
+  tracker.Consume(ext_size);
+  uint8_t* ext2 = reinterpret_cast<uint8_t*>(malloc(ext_size));
+  ASSERT_TRUE(ext2 != nullptr);
+  p.AcquireExternalChunk(ext2, ext_size);
+  ASSERT_TRUE(MemPoolTest::CheckIntegrity(&p, false));
+  EXPECT_EQ(ext_size, p.total_allocated_bytes());
+
+  p.FreeAll();
+  p2.FreeAll();
+  EXPECT_EQ(0, tracker.consumption());
+}
+
 #ifdef ADDRESS_SANITIZER
 
 /// These tests confirm that ASAN will catch use-after-return errors (even though the
@@ -205,6 +205,23 @@ void MemPool::AcquireData(MemPool* src, bool keep_current) {
   DCHECK(CheckIntegrity(false));
 }
 
+void MemPool::AcquireExternalChunk(uint8_t* buf, int64_t size) {
+  DFAKE_SCOPED_LOCK(mutex_);
+  DCHECK(buf != nullptr);
+  DCHECK_GT(size, 0);
+  // The chunk is full, so it must come before all free chunks. If the current chunk
+  // holds no data we can insert in front of it and it becomes the first free chunk.
+  int insert_idx = current_chunk_idx_ == -1 ?
+      0 : current_chunk_idx_ + (chunks_[current_chunk_idx_].allocated_bytes > 0);
+  ChunkInfo chunk(size, buf);
+  chunk.allocated_bytes = size;
+  chunks_.insert(chunks_.begin() + insert_idx, chunk);
+  current_chunk_idx_ = insert_idx;
+  total_reserved_bytes_ += size;
+  total_allocated_bytes_ += size;
+  DCHECK(CheckIntegrity(false));
+}
+
 void MemPool::SetMemTracker(MemTracker* new_tracker) {
   DFAKE_SCOPED_LOCK(mutex_);
   mem_tracker_->TransferTo(new_tracker, total_reserved_bytes_);
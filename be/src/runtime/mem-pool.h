@@ -169,6 +169,13 @@ class MemPool {
   /// All offsets handed out by calls to GetCurrentOffset() for 'src' become invalid.
   void AcquireData(MemPool* src, bool keep_current);
 
+  /// Takes ownership of 'buf', a buffer of 'size' bytes that was allocated with malloc()
+  /// and whose size was already consumed against this pool's MemTracker. The buffer is
+  /// added as a fully allocated chunk, so it is freed or transferred together with the
+  /// rest of the data in this pool. Used to adopt buffers filled by third-party
+  /// libraries without copying them.
+  void AcquireExternalChunk(uint8_t* buf, int64_t size);
+
   /// Change the MemTracker, updating consumption on the current and new tracker.
   void SetMemTracker(MemTracker* new_tracker);
 
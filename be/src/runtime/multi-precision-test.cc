@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <random>
 #include <string>
 
 #include <boost/math/constants/constants.hpp>
@@ -100,6 +101,58 @@ TEST(MultiPrecisionIntTest, Example) {
   EXPECT_EQ(v128, 0);
 }
 
+static int256_t ToInt256(__uint128_t x) {
+  int256_t v = static_cast<uint64_t>(x >> 64);
+  v <<= 64;
+  v |= static_cast<uint64_t>(x);
+  return v;
+}
+
+static int256_t ToInt256(const UnsignedInt256& x) {
+  return (ToInt256(x.hi) << 128) | ToInt256(x.lo);
+}
+
+// Returns a random value with a random number of significant bits, so that divisors
+// of one and two 64-bit digits and the carries between them are all covered.
+static __uint128_t RandomUInt128(std::mt19937_64* rng) {
+  int bits = (*rng)() % 129;
+  if (bits == 0) return 0;
+  __uint128_t v = (static_cast<__uint128_t>((*rng)()) << 64) | (*rng)();
+  return v >> (128 - bits);
+}
+
+// The native 256-bit kernels must agree with int256_t.
+TEST(MultiPrecisionIntTest, WideKernels) {
+  const __uint128_t max_uint128 = ~static_cast<__uint128_t>(0);
+  std::mt19937_64 rng(0);
+  vector<__uint128_t> values = {0, 1, 10, 0xffffffffffffffff,
+      static_cast<__uint128_t>(1) << 64, static_cast<__uint128_t>(1) << 127,
+      max_uint128 - 1, max_uint128};
+  for (int i = 0; i < 300; ++i) values.push_back(RandomUInt128(&rng));
+
+  for (__uint128_t x : values) {
+    for (__uint128_t y : values) {
+      UnsignedInt256 product = MultiplyWide(x, y);
+      int256_t expected_product = ToInt256(x) * ToInt256(y);
+      ASSERT_TRUE(ToInt256(product) == expected_product);
+      if (y == 0) continue;
+
+      UnsignedInt256 dividend = {x % y, y - x};
+      __uint128_t remainder;
+      __uint128_t quotient = DivideWide(dividend, y, &remainder);
+      ASSERT_TRUE(ToInt256(quotient) == ToInt256(dividend) / ToInt256(y));
+      ASSERT_TRUE(ToInt256(remainder) == ToInt256(dividend) % ToInt256(y));
+      ASSERT_TRUE(ToInt256(ModWide(product, y)) == expected_product % ToInt256(y));
+
+      UnsignedInt256 other = {y, x};
+      int256_t expected_other = ToInt256(other);
+      int result = CompareWide(product, other);
+      EXPECT_EQ(expected_product < expected_other, result < 0);
+      EXPECT_EQ(expected_product == expected_other, result == 0);
+    }
+  }
+}
+
 // Example taken from:
 // http://www.boost.org/doc/libs/1_55_0/libs/multiprecision/doc/html/boost_multiprecision/tut/floats/fp_eg/aos.html
 
@@ -49,6 +49,7 @@
 #include <functional>
 #include <limits>
 
+#include "common/logging.h"
 #include "util/arithmetic-util.h"
 
 namespace impala {
@@ -128,6 +129,138 @@ inline uint64_t LowBits(int128_t x) {
   return x & 0xffffffffffffffff;
 }
 
+/// An unsigned 256-bit integer stored as two 128-bit halves. The decimal kernels below
+/// use it for intermediate results of DECIMAL(38) arithmetic. Unlike int256_t, which
+/// keeps a sign-magnitude array of limbs and loops over it, each of its operations
+/// compiles to a handful of native 64-bit multiplies, divides and adds with carry.
+struct UnsignedInt256 {
+  __uint128_t hi;
+  __uint128_t lo;
+};
+
+/// Returns the full 256-bit product of 'x' and 'y'.
+inline UnsignedInt256 MultiplyWide(__uint128_t x, __uint128_t y) {
+  const uint64_t x_lo = x;
+  const uint64_t x_hi = x >> 64;
+  const uint64_t y_lo = y;
+  const uint64_t y_hi = y >> 64;
+  const __uint128_t ll = static_cast<__uint128_t>(x_lo) * y_lo;
+  const __uint128_t lh = static_cast<__uint128_t>(x_lo) * y_hi;
+  const __uint128_t hl = static_cast<__uint128_t>(x_hi) * y_lo;
+  const __uint128_t hh = static_cast<__uint128_t>(x_hi) * y_hi;
+  // The sum of the three 64-bit words in the middle column carries at most 2 into the
+  // high half.
+  const __uint128_t mid =
+      (ll >> 64) + static_cast<uint64_t>(lh) + static_cast<uint64_t>(hl);
+  UnsignedInt256 result;
+  result.lo = (mid << 64) | static_cast<uint64_t>(ll);
+  result.hi = hh + (lh >> 64) + (hl >> 64) + (mid >> 64);
+  return result;
+}
+
+namespace detail {
+
+/// Divides the 128-bit value 'hi':'lo' by 'd' and stores the remainder in '*r'.
+/// 'hi' must be less than 'd' so that the quotient fits into 64 bits.
+inline uint64_t Divide128By64(uint64_t hi, uint64_t lo, uint64_t d, uint64_t* r) {
+  DCHECK_LT(hi, d);
+#ifdef __x86_64__
+  // The compiler cannot prove that the quotient fits and would call __udivti3 instead.
+  uint64_t q;
+  __asm__("divq %[d]" : "=a"(q), "=d"(*r) : [d] "rm"(d), "a"(lo), "d"(hi));
+  return q;
+#else
+  const __uint128_t n = (static_cast<__uint128_t>(hi) << 64) | lo;
+  *r = static_cast<uint64_t>(n % d);
+  return static_cast<uint64_t>(n / d);
+#endif
+}
+
+/// One step of Knuth's long division (TAOCP 4.3.1, algorithm D) with 64-bit digits:
+/// divides the 192-bit value 'u2':'u1':'u0' by 'v' and stores the remainder in '*r'.
+/// The most significant bit of 'v' must be set and 'u2':'u1' must be less than 'v', so
+/// that the quotient fits into 64 bits.
+inline uint64_t Divide192By128(uint64_t u2, uint64_t u1, uint64_t u0, __uint128_t v,
+    __uint128_t* r) {
+  const uint64_t v1 = v >> 64;
+  const uint64_t v0 = v;
+  DCHECK_NE(v1 >> 63, 0);
+  // Estimate the quotient from the leading digits. The estimate is at most 2 too large.
+  uint64_t q;
+  if (u2 == v1) {
+    q = ~0ULL;
+  } else {
+    uint64_t unused;
+    q = Divide128By64(u2, u1, v1, &unused);
+  }
+  // Subtract q * v from u. The top digit of the difference is 0 if the estimate was
+  // right and wraps around to a negative number if it was too large.
+  const __uint128_t p_lo = static_cast<__uint128_t>(q) * v0;
+  const __uint128_t p_hi = static_cast<__uint128_t>(q) * v1;
+  const __uint128_t u_lo = (static_cast<__uint128_t>(u1) << 64) | u0;
+  const __uint128_t p_mid = p_lo + (p_hi << 64);
+  const uint64_t p_top = (p_hi >> 64) + (p_mid < p_lo);
+  __uint128_t rem = u_lo - p_mid;
+  int64_t rem_top = u2 - p_top - (u_lo < p_mid);
+  while (rem_top < 0) {
+    --q;
+    rem += v;
+    rem_top += rem < v;
+  }
+  DCHECK_EQ(rem_top, 0);
+  *r = rem;
+  return q;
+}
+
+}
+
+/// Divides 'x' by 'y' and stores the remainder in '*remainder'. 'x.hi' must be less
+/// than 'y' so that the quotient fits into 128 bits, which also excludes a zero 'y'.
+inline __uint128_t DivideWide(const UnsignedInt256& x, __uint128_t y,
+    __uint128_t* remainder) {
+  DCHECK(x.hi < y);
+  const uint64_t y_hi = y >> 64;
+  if (y_hi == 0) {
+    // Schoolbook division by a single digit. 'x.hi' < 'y' fits into one digit.
+    const uint64_t d = y;
+    uint64_t r;
+    const uint64_t q1 = detail::Divide128By64(x.hi, x.lo >> 64, d, &r);
+    const uint64_t q0 = detail::Divide128By64(r, x.lo, d, &r);
+    *remainder = r;
+    return (static_cast<__uint128_t>(q1) << 64) | q0;
+  }
+  // Normalize the divisor so that its most significant bit is set, which keeps the
+  // quotient estimates of Divide192By128() close. Shifting by 's' does not overflow
+  // the dividend because 'x.hi' < 'y'.
+  const int s = __builtin_clzll(y_hi);
+  const __uint128_t v = y << s;
+  const __uint128_t n_hi = s == 0 ? x.hi : (x.hi << s) | (x.lo >> (128 - s));
+  const __uint128_t n_lo = x.lo << s;
+  __uint128_t r;
+  const uint64_t q1 = detail::Divide192By128(n_hi >> 64, n_hi, n_lo >> 64, v, &r);
+  const uint64_t q0 = detail::Divide192By128(r >> 64, r, n_lo, v, &r);
+  *remainder = r >> s;
+  return (static_cast<__uint128_t>(q1) << 64) | q0;
+}
+
+/// Returns 'x' modulo 'y'. 'y' must not be zero.
+inline __uint128_t ModWide(const UnsignedInt256& x, __uint128_t y) {
+  DCHECK(y != 0);
+  UnsignedInt256 reduced = x;
+  if (reduced.hi >= y) reduced.hi %= y;
+  __uint128_t remainder;
+  DivideWide(reduced, y, &remainder);
+  return remainder;
+}
+
+/// Returns a negative value, zero or a positive value if 'x' is less than, equal to or
+/// greater than 'y'.
+inline int CompareWide(const UnsignedInt256& x, const UnsignedInt256& y) {
+  if (x.hi != y.hi) return x.hi < y.hi ? -1 : 1;
+  if (x.lo != y.lo) return x.lo < y.lo ? -1 : 1;
+  return 0;
+}
+
 // Doubles the width of integer types (e.g. int32_t -> int64_t).
 // Currently only works with a few signed types.
 // Feel free to extend it to other types as well.
@@ -47,6 +47,7 @@
 #include "service/control-service.h"
 #include "service/data-stream-service.h"
 #include "util/container-util.h"
+#include "util/cpu-info.h"
 #include "util/debug-util.h"
 #include "util/impalad-metrics.h"
 #include "util/memory-metrics.h"
@@ -68,6 +69,17 @@ static const int DEFAULT_REPORT_WAIT_TIME_MS = 5000;
 DECLARE_int32(backend_client_rpc_timeout_ms);
 DECLARE_int64(rpc_max_message_size);
 
+DEFINE_bool(status_report_profile_deltas, true, "If true, the runtime profiles in the "
+    "status reports that executors send to the coordinator only include the counters, "
+    "info strings and events that changed since the last report the coordinator "
+    "received. The coordinator can request the full profiles again at any time.");
+
+DEFINE_bool(numa_pin_fragment_instances, false, "(Advanced) If true and the machine has "
+    "more than one NUMA node, each fragment instance thread and the threads it starts "
+    "only run on the cores of one NUMA node, so that the buffers it allocates, which "
+    "come from the node of the allocating core, stay local to it. Nodes are assigned "
+    "to fragment instances round-robin.");
+
 DEFINE_int32_hidden(stress_status_report_delay_ms, 0, "Stress option to inject a delay "
     "before status reports. Has no effect on release builds.");
 
@@ -531,6 +543,9 @@ void QueryState::ConstructReport(bool instances_started,
 
   // Add profile to report
   host_profile_->ToThrift(&profiles_forest->host_profile);
+  if (FLAGS_status_report_profile_deltas) {
+    host_profile_delta_encoder_.EncodeDelta(&profiles_forest->host_profile);
+  }
   profiles_forest->__isset.host_profile = true;
 
   // Free resources in chunked counters in the profile
@@ -708,13 +723,26 @@ bool QueryState::ReportExecStatus() {
         PrintId(query_id()), num_failed_reports_, retry_time_ms);
   }
 
+  // The profile deltas are computed against the last profile that the coordinator
+  // received. If it asks for the full profile, e.g. because it failed to apply a delta,
+  // start over with the next report.
+  const bool profile_received =
+      rpc_status.ok() && report.has_thrift_profiles_sidecar_idx();
+  const bool resend_full_profile = rpc_status.ok() && resp.resend_full_profile();
+  if (resend_full_profile) {
+    host_profile_delta_encoder_.Reset();
+  } else if (profile_received) {
+    host_profile_delta_encoder_.Acknowledge();
+  }
+
   // Notify the fragment instances of the report's status.
   for (const FragmentInstanceExecStatusPB& instance_exec_status :
       report.instance_exec_status()) {
     const TUniqueId& id = ProtoToQueryId(instance_exec_status.fragment_instance_id());
     FragmentInstanceState* fis = fis_map_[id];
     if (rpc_status.ok()) {
-      fis->ReportSuccessful(instance_exec_status);
+      fis->ReportSuccessful(instance_exec_status, profile_received);
+      if (resend_full_profile) fis->ResetProfileDeltas();
     } else {
       fis->ReportFailed(instance_exec_status);
     }
@@ -943,6 +971,18 @@ void QueryState::ReleaseBackendResourceRefcount() {
 void QueryState::ExecFInstance(FragmentInstanceState* fis) {
   ScopedThreadContext debugctx(GetThreadDebugInfo(), fis->query_id(), fis->instance_id());
 
+  if (FLAGS_numa_pin_fragment_instances && CpuInfo::GetMaxNumNumaNodes() > 1) {
+    // The thread is not reused after the instance finishes, so the affinity does not
+    // need to be reset.
+    static AtomicInt32 next_numa_node(0);
+    int numa_node = (next_numa_node.Add(1) & INT32_MAX) % CpuInfo::GetMaxNumNumaNodes();
+    Status pin_status = CpuInfo::PinCurrentThreadToNumaNode(numa_node);
+    if (!pin_status.ok()) {
+      VLOG_QUERY << "Could not pin instance_id=" << PrintId(fis->instance_id())
+                 << " to NUMA node " << numa_node << ": " << pin_status.GetDetail();
+    }
+  }
+
   ImpaladMetrics::IMPALA_SERVER_NUM_FRAGMENTS_IN_FLIGHT->Increment(1L);
   ImpaladMetrics::IMPALA_SERVER_NUM_FRAGMENTS->Increment(1L);
   VLOG_QUERY << "Executing instance. instance_id=" << PrintId(fis->instance_id())
@@ -33,6 +33,7 @@
 #include "gutil/macros.h"
 #include "gutil/threading/thread_collision_warner.h" // for DFAKE_*
 #include "util/counting-barrier.h"
+#include "util/runtime-profile-delta.h"
 #include "util/spinlock.h"
 #include "util/unique-id-hash.h"
 
@@ -454,6 +455,10 @@ class QueryState {
   /// Tracks host resource usage of this backend. Owned by 'obj_pool_', created in c'tor.
   RuntimeProfile* const host_profile_;
 
+  /// Computes the deltas of 'host_profile_' sent with the status reports.
+  /// Thread-safety: Only used by the query state thread.
+  RuntimeProfileDeltaEncoder host_profile_delta_encoder_;
+
   /// The number of failed intermediate reports since the last successfully sent report.
   int64_t num_failed_reports_ = 0;
 
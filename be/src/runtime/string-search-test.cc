@@ -18,6 +18,9 @@
 #include <gtest/gtest.h>
 
 #include "runtime/string-search.h"
+#include "util/cpu-info.h"
+
+#include "common/names.h"
 
 namespace impala {
 
@@ -127,4 +130,43 @@ TEST(StringSearchTest, ReverseSearch) {
   // the same as the first one.
   EXPECT_EQ(0, TestRSearch("cacacbaba", "cacacba"));
 }
+
+// Checks that the SIMD kernels find the same match as the scalar search for needles
+// taken from all positions of haystacks of different lengths, including partial matches
+// across block boundaries and matches in the tail that does not fill a block.
+TEST(StringSearchTest, SimdSearch) {
+  const bool has_avx2 = CpuInfo::IsSupported(CpuInfo::AVX2);
+  const bool has_sse42 = CpuInfo::IsSupported(CpuInfo::SSE4_2);
+  // A small alphabet makes candidates where only the first and last byte match common.
+  string haystack;
+  for (int i = 0; i < 200; ++i) haystack.push_back('a' + (i * 7 + i / 13) % 3);
+  haystack.append("xyzw");
+  for (int haystack_len : {16, 17, 31, 32, 33, 47, 64, 100, 204}) {
+    StringValue haystack_val(const_cast<char*>(haystack.data()), haystack_len);
+    for (int needle_len : {2, 3, 5, 15, 16, 17, 40}) {
+      // Needles that extend beyond the end of the haystack are not found.
+      const int max_start = min<int>(haystack_len + 2, haystack.size() - needle_len);
+      for (int start = 0; start <= max_start; ++start) {
+        string needle = haystack.substr(start, needle_len);
+        StringValue needle_val(const_cast<char*>(needle.data()), needle_len);
+        StringSearch search(&needle_val);
+        const int expected = search.SearchBoyerMooreHorspool(&haystack_val);
+        if (start + needle_len <= haystack_len) {
+          EXPECT_GE(expected, 0);
+          EXPECT_LE(expected, start);
+        }
+        EXPECT_EQ(expected, search.Search(&haystack_val));
+        if (needle_len > haystack_len) continue;
+        if (has_avx2) {
+          EXPECT_EQ(expected, StringSearch::SearchAvx2(
+              haystack.data(), haystack_len, needle.data(), needle_len));
+        }
+        if (has_sse42 && needle_len <= StringSearch::SSE42_MAX_PATTERN_LEN) {
+          EXPECT_EQ(expected, StringSearch::SearchSse42(
+              haystack.data(), haystack_len, needle.data(), needle_len));
+        }
+      }
+    }
+  }
+}
 }
@@ -0,0 +1,102 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/string-search.h"
+
+#ifndef __aarch64__
+  #include <immintrin.h>
+#endif
+
+#include "util/sse-util.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+// Checks the candidate positions [start, n - m] one by one. Used for the positions at
+// the end of the haystack that do not fill a whole block.
+static int SearchTail(const char* s, int n, const char* p, int m, int start) {
+  for (int i = start; i <= n - m; ++i) {
+    if (s[i] == p[0] && memcmp(s + i + 1, p + 1, m - 1) == 0) return i;
+  }
+  return -1;
+}
+
+#ifndef __aarch64__
+__attribute__((target("avx2")))
+int StringSearch::SearchAvx2(const char* s, int n, const char* p, int m) {
+  DCHECK_GE(m, 2);
+  DCHECK_LE(m, n);
+  const __m256i first = _mm256_set1_epi8(p[0]);
+  const __m256i last = _mm256_set1_epi8(p[m - 1]);
+  int i = 0;
+  // Each iteration checks the candidate positions [i, i + AVX2_BLOCK_SIZE). The last
+  // byte of the last candidate must be within the haystack.
+  for (; i + m - 1 + AVX2_BLOCK_SIZE <= n; i += AVX2_BLOCK_SIZE) {
+    const __m256i block_first =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+    const __m256i block_last =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + m - 1));
+    uint32_t candidates = _mm256_movemask_epi8(_mm256_and_si256(
+        _mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last)));
+    // Verify the candidates in ascending order so that the first match is returned.
+    while (candidates != 0) {
+      const int offset = i + __builtin_ctz(candidates);
+      if (memcmp(s + offset + 1, p + 1, m - 2) == 0) return offset;
+      candidates &= candidates - 1;
+    }
+  }
+  return SearchTail(s, n, p, m, i);
+}
+
+int StringSearch::SearchSse42(const char* s, int n, const char* p, int m) {
+  DCHECK_GE(m, 2);
+  DCHECK_LE(m, SSE42_MAX_PATTERN_LEN);
+  DCHECK_LE(m, n);
+  // The pattern may end right before unmapped memory, so it is copied to a full register.
+  char pattern_buf[SSE42_BLOCK_SIZE] = {0};
+  memcpy(pattern_buf, p, m);
+  const __m128i pattern = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern_buf));
+  int i = 0;
+  while (i + SSE42_BLOCK_SIZE <= n) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+    // Returns the first offset in 'block' where the pattern starts, including a prefix
+    // of the pattern at the end of 'block', or SSE42_BLOCK_SIZE if there is none.
+    const int offset =
+        SSE4_cmpestri<SSEUtil::STRSTR_MODE>(pattern, m, block, SSE42_BLOCK_SIZE);
+    if (offset == SSE42_BLOCK_SIZE) {
+      i += SSE42_BLOCK_SIZE;
+    } else if (offset + m <= SSE42_BLOCK_SIZE) {
+      return i + offset;
+    } else {
+      // Only a prefix of the pattern is in 'block'. Continue with a block that starts at
+      // the candidate. 'offset' is positive because m <= SSE42_BLOCK_SIZE.
+      i += offset;
+    }
+  }
+  return SearchTail(s, n, p, m, i);
+}
+#else
+int StringSearch::SearchAvx2(const char* s, int n, const char* p, int m) {
+  return SearchTail(s, n, p, m, 0);
+}
+
+int StringSearch::SearchSse42(const char* s, int n, const char* p, int m) {
+  return SearchTail(s, n, p, m, 0);
+}
+#endif
+}
@@ -24,13 +24,18 @@
 
 #include "common/logging.h"
 #include "runtime/string-value.h"
+#include "util/cpu-info.h"
 
 namespace impala {
 
-/// TODO: This can be sped up with SIDD_CMP_EQUAL_ORDERED or at the very least rewritten
-/// from published algorithms.
-//
-/// This is based on the Python search string function doing string search
+/// Forward search uses SIMD kernels when the CPU supports them and the haystack is long
+/// enough to fill a register: with AVX2, the first and the last byte of the pattern are
+/// compared against 32 candidate positions at once and only the positions where both
+/// match are verified (SearchAvx2()). Without AVX2, patterns of up to 16 bytes are
+/// searched for with the SSE4.2 PCMPESTRI instruction in "equal ordered" mode
+/// (SearchSse42()). All other cases, and reverse search, use the scalar algorithm below.
+///
+/// The scalar search is based on the Python search string function doing string search
 /// (substring) using an optimized boyer-moore-horspool algorithm.
 
 /// http://hg.python.org/cpython/file/6b6c79eba944/Objects/stringlib/fastsearch.h
@@ -82,6 +87,26 @@ class StringSearch {
     if (str == NULL || pattern_ == NULL || pattern_->len == 0) {
       return -1;
     }
+    const int n = str->len;
+    const int m = pattern_->len;
+    if (m > 1 && n >= m) {
+      if (n >= m + AVX2_BLOCK_SIZE - 1 && CpuInfo::IsSupported(CpuInfo::AVX2)) {
+        return SearchAvx2(str->ptr, n, pattern_->ptr, m);
+      }
+      if (m <= SSE42_MAX_PATTERN_LEN && n >= SSE42_BLOCK_SIZE
+          && CpuInfo::IsSupported(CpuInfo::SSE4_2)) {
+        return SearchSse42(str->ptr, n, pattern_->ptr, m);
+      }
+    }
+    return SearchBoyerMooreHorspool(str);
+  }
+
+  /// Same as Search(), but always uses the scalar boyer-moore-horspool algorithm.
+  int SearchBoyerMooreHorspool(const StringValue* str) const {
+    // Special cases
+    if (str == NULL || pattern_ == NULL || pattern_->len == 0) {
+      return -1;
+    }
 
     int mlast = pattern_->len - 1;
     int w = str->len - pattern_->len;
@@ -126,6 +151,21 @@ class StringSearch {
     return -1;
   }
 
+  /// SIMD kernels of Search(). Return the offset of the first occurrence of the 'm'
+  /// bytes at 'p' in the 'n' bytes at 's', or -1 if there is none. Require 2 <= m <= n
+  /// and must only be called if the CPU supports the respective instruction set.
+  /// SearchSse42() also requires m <= SSE42_MAX_PATTERN_LEN. Defined out of line so that
+  /// they are compiled for their target instruction set.
+  static int SearchAvx2(const char* s, int n, const char* p, int m);
+  static int SearchSse42(const char* s, int n, const char* p, int m);
+
+  /// Number of candidate positions that SearchAvx2() checks at once.
+  static const int AVX2_BLOCK_SIZE = 32;
+  /// Number of haystack bytes that SearchSse42() compares at once, which also is the
+  /// maximum pattern length it supports.
+  static const int SSE42_BLOCK_SIZE = 16;
+  static const int SSE42_MAX_PATTERN_LEN = SSE42_BLOCK_SIZE;
+
   /// Search for this pattern in str backwards.
   ///   Returns the offset into str if the pattern exists
   ///   Returns -1 if the pattern is not found
@@ -37,6 +37,7 @@
 #include "runtime/runtime-state.h"
 #include "runtime/string-value.inline.h"
 #include "udf/udf-internal.h"
+#include "util/string-parser.h"
 
 #include "common/names.h"
 
@@ -102,6 +103,13 @@ bool TimestampParser::ParseSimpleDateFormat(const char* str, int len,
   const DateTimeFormatContext* dt_ctx =
       SimpleDateFormatTokenizer::GetDefaultFormatContext(str, default_fmt_len, true);
   if (dt_ctx != nullptr) {
+    DateTimeParseResult dt_result;
+    if (LIKELY(ParseDefaultFormat(str, default_fmt_len, &dt_result))) {
+      if (!PopulateParseResult(*dt_ctx, dt_result, d, t)) {
+        return IndicateTimestampParseFailure(d, t);
+      }
+      return true;
+    }
     return ParseSimpleDateFormat(str, default_fmt_len, *dt_ctx, d, t);
   }
   // Generating context lazily as a fall back if default formats fail.
@@ -114,6 +122,50 @@ bool TimestampParser::ParseSimpleDateFormat(const char* str, int len,
   return ParseSimpleDateFormat(str, trimmed_len, *dt_ctx, d, t);
 }
 
+bool TimestampParser::ParseDefaultFormat(const char* str, int len,
+    DateTimeParseResult* dt_result) {
+  const int date_len = SimpleDateFormatTokenizer::DEFAULT_DATE_FMT_LEN;
+  const int date_time_len = SimpleDateFormatTokenizer::DEFAULT_SHORT_DATE_TIME_FMT_LEN;
+  // A period without fractional digits is left to the general parser.
+  if (len != date_len && len != date_time_len && len <= date_time_len + 1) return false;
+  // GetDefaultFormatContext() has checked the separators at offsets 4, 7, 10 and 13,
+  // and the period at offset 19. Parse "yyyy-MM-dd" as "yy" and "yy-MM-dd".
+  if (!isdigit(str[0]) || !isdigit(str[1])) return false;
+  int year_low;
+  if (!StringParser::ParseDigitPairs(str + 2, &year_low, &dt_result->month,
+      &dt_result->day)) {
+    return false;
+  }
+  dt_result->year = ((str[0] - '0') * 10 + (str[1] - '0')) * 100 + year_low;
+  if (dt_result->month < 1 || dt_result->month > 12) return false;
+  if (dt_result->day < 1 || dt_result->day > 31) return false;
+  if (len == date_len) return true;
+
+  // Parse "HH:mm:ss".
+  if (str[16] != ':') return false;
+  if (!StringParser::ParseDigitPairs(str + 11, &dt_result->hour, &dt_result->minute,
+      &dt_result->second)) {
+    return false;
+  }
+  if (dt_result->hour > 23 || dt_result->minute > 59 || dt_result->second > 59) {
+    return false;
+  }
+
+  if (len > date_time_len) {
+    // Parse the fractional seconds after the period and scale them to nanoseconds.
+    int32_t fraction = 0;
+    for (int i = date_time_len + 1; i < len; ++i) {
+      if (!isdigit(str[i])) return false;
+      fraction = fraction * 10 + (str[i] - '0');
+    }
+    for (int i = len - date_time_len - 1; i < FRACTIONAL_SECOND_MAX_LENGTH; ++i) {
+      fraction *= 10;
+    }
+    dt_result->fraction = fraction;
+  }
+  return true;
+}
+
 date TimestampParser::RealignYear(const DateTimeParseResult& dt_result,
     const DateTimeFormatContext& dt_ctx, int day_offset, const time_duration& t) {
   DCHECK(!dt_ctx.century_break_ptime.is_special());
@@ -85,6 +85,15 @@ class TimestampParser {
       int max_length, char* dst);
 
  private:
+  /// Fast path of ParseSimpleDateFormat() for strings of 'len' characters for which
+  /// SimpleDateFormatTokenizer::GetDefaultFormatContext() returned a context, i.e. in
+  /// the format 'yyyy-MM-dd' or 'yyyy-MM-dd HH:mm:ss[.S...]' (or with a 'T' in place of
+  /// the space). It parses several digits at once, instead of a token at a time like
+  /// the general parser. Returns false without a decision if any field is not all digits
+  /// or is out of range, in which case the general parser must be used.
+  static bool ParseDefaultFormat(const char* str, int len,
+      datetime_parse_util::DateTimeParseResult* dt_result);
+
   /// Helper function finding the correct century for 1 or 2 digit year according to
   /// century break. Throws bad_year, bad_day_of_month, or bad_day_month if the date is
   /// invalid. The century break behavior is copied from Java SimpleDateFormat in order to
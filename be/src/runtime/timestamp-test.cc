@@ -27,6 +27,7 @@
 #include "runtime/raw-value.inline.h"
 #include "runtime/timestamp-value.h"
 #include "runtime/timestamp-value.inline.h"
+#include "runtime/timezone-converter.h"
 #include "testutil/gtest-util.h"
 #include "util/string-parser.h"
 
@@ -1062,4 +1063,55 @@ TEST(TimestampTest, TimezoneConversions) {
     EXPECT_FALSE(tmp.HasDate());
   }
 }
+
+// TimezoneConverter must return the same results as UtcToLocal() and LocalToUtc() for
+// sequences of timestamps that cross DST changes in both directions.
+TEST(TimestampTest, TimezoneConverter) {
+  const string& path = Substitute("$0/testdata/tzdb_tiny", getenv("IMPALA_HOME"));
+  Status status = TimezoneDatabase::LoadZoneInfoBeTestOnly(path);
+  ASSERT_TRUE(status.ok());
+
+  // Steps of 15 minutes and 7 nanoseconds through 2017, with a few jumps in between.
+  vector<TimestampValue> timestamps;
+  TimestampValue ts = StrToTs("2016-12-31 00:00:00");
+  const time_duration step = time_duration(0, 15, 0) + boost::posix_time::nanoseconds(7);
+  for (int i = 0; i < 4 * 24 * 367; ++i) {
+    timestamps.push_back(ts);
+    if (i % 1000 == 0) timestamps.push_back(StrToTs("1970-01-01 00:00:00"));
+    ts = ts.Add(step);
+  }
+  // UTC times whose local time is outside of the valid range in some time-zones.
+  const vector<TimestampValue> boundaries = {StrToTs("1400-01-01 00:30:00"),
+      StrToTs("9999-12-31 23:30:00"), StrToTs("2017-01-01 00:00:00")};
+
+  for (const string& tz_name : {"CET", "America/New_York", "UTC"}) {
+    const Timezone* tz = TimezoneDatabase::FindTimezone(tz_name);
+    ASSERT_NE(tz, nullptr);
+    TimezoneConverter converter(tz);
+    for (const TimestampValue& utc : timestamps) {
+      TimestampValue expected = utc;
+      expected.UtcToLocal(*tz);
+      TimestampValue actual = utc;
+      converter.UtcToLocal(&actual);
+      EXPECT_EQ(expected, actual) << tz_name << " " << utc;
+    }
+    for (const TimestampValue& utc : boundaries) {
+      TimestampValue expected = utc;
+      expected.UtcToLocal(*tz);
+      TimestampValue actual = utc;
+      converter.UtcToLocal(&actual);
+      EXPECT_EQ(expected.HasDate(), actual.HasDate()) << tz_name << " " << utc;
+      if (expected.HasDate()) EXPECT_EQ(expected, actual) << tz_name << " " << utc;
+    }
+    for (const TimestampValue& local : timestamps) {
+      // Skipped and repeated local times become invalid.
+      TimestampValue expected = local;
+      expected.LocalToUtc(*tz);
+      TimestampValue actual = local;
+      converter.LocalToUtc(&actual);
+      EXPECT_EQ(expected.HasDate(), actual.HasDate()) << tz_name << " " << local;
+      if (expected.HasDate()) EXPECT_EQ(expected, actual) << tz_name << " " << local;
+    }
+  }
+}
 }
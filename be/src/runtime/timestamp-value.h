@@ -366,6 +366,7 @@ class TimestampValue {
   static const char* LLVM_CLASS_NAME;
 
  private:
+  friend class TimezoneConverter;
   friend class UnusedClass;
 
   /// Used when converting a time with fractional seconds which are stored as in integer
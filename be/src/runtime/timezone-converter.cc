@@ -0,0 +1,139 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/timezone-converter.h"
+
+#include <limits>
+
+#include "cctz/civil_time.h"
+#include "runtime/timestamp-value.inline.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+// Unix times of the first and last second that a TimestampValue can represent.
+static const int64_t MIN_UNIX_TIME = -17987443200; // 1400-01-01 00:00:00
+static const int64_t MAX_UNIX_TIME = 253402300799; // 9999-12-31 23:59:59
+
+static const int64_t SECONDS_PER_DAY = 24 * 60 * 60;
+
+static cctz::time_point<cctz::sys_seconds> UnixTimeToTimePoint(int64_t unix_time) {
+  static const cctz::time_point<cctz::sys_seconds> epoch =
+      std::chrono::time_point_cast<cctz::sys_seconds>(
+          std::chrono::system_clock::from_time_t(0));
+  return epoch + cctz::sys_seconds(unix_time);
+}
+
+// Returns the unix time of civil time 'cs' in UTC.
+static int64_t CivilToUnixTime(const cctz::civil_second& cs) {
+  return cs - cctz::civil_second(1970, 1, 1, 0, 0, 0);
+}
+
+void TimezoneConverter::FillCache(int64_t unix_time) {
+  const cctz::time_point<cctz::sys_seconds> tp = UnixTimeToTimePoint(unix_time);
+  offset_ = tz_->lookup(tp).offset;
+  // Without transitions, the offset of the time-zone never changes.
+  int64_t utc_start = std::numeric_limits<int64_t>::min();
+  int64_t utc_end = std::numeric_limits<int64_t>::max();
+  int64_t local_start = utc_start;
+  int64_t local_end = utc_end;
+  // A transition jumps from the civil time 'from' in the old offset to the civil time
+  // 'to' in the new offset at the same instant. Local times between 'from' and 'to' are
+  // skipped if 'to' is later and repeated if 'to' is earlier.
+  cctz::time_zone::civil_transition prev, next;
+  // prev_transition() returns the last transition strictly before its argument.
+  bool has_prev = tz_->prev_transition(tp + cctz::sys_seconds(1), &prev);
+  bool has_next = tz_->next_transition(tp, &next);
+  if (has_next) {
+    if (has_prev) {
+      utc_start = CivilToUnixTime(prev.to) - offset_;
+      local_start = max(CivilToUnixTime(prev.from), CivilToUnixTime(prev.to));
+    }
+    utc_end = CivilToUnixTime(next.from) - offset_;
+    local_end = min(CivilToUnixTime(next.from), CivilToUnixTime(next.to));
+  } else if (has_prev) {
+    // cctz stops returning transitions a few hundred years after the last one in the
+    // time-zone file, although time-zones with DST rules keep changing their offset.
+    // Only cache the UTC day of 'unix_time' if the offset is the same during all of it.
+    utc_start = unix_time - ((unix_time % SECONDS_PER_DAY) + SECONDS_PER_DAY)
+        % SECONDS_PER_DAY;
+    utc_end = utc_start + SECONDS_PER_DAY;
+    if (tz_->lookup(UnixTimeToTimePoint(utc_start)).offset != offset_
+        || tz_->lookup(UnixTimeToTimePoint(utc_end - 1)).offset != offset_) {
+      utc_start = utc_end = 0;
+    }
+    local_start = local_end = 0;
+  }
+  if (UNLIKELY(utc_start > unix_time || utc_end <= unix_time)) {
+    // Don't cache anything if the transitions do not surround 'unix_time'.
+    utc_start = utc_end = local_start = local_end = 0;
+  }
+  // Clip the intervals so that the results of conversions are in the valid range.
+  utc_start_ = max(utc_start, MIN_UNIX_TIME - offset_);
+  utc_end_ = min(utc_end, MAX_UNIX_TIME + 1 - offset_);
+  local_start_ = max(local_start, MIN_UNIX_TIME + offset_);
+  local_end_ = min(local_end, MAX_UNIX_TIME + 1 + offset_);
+}
+
+void TimezoneConverter::UtcToLocal(TimestampValue* v) {
+  DCHECK(tz_ != nullptr);
+  DCHECK(v->HasDateAndTime());
+  time_t unix_time;
+  if (UNLIKELY(!v->UtcToUnixTime(&unix_time))) {
+    v->SetToInvalidDateTime();
+    return;
+  }
+  if (unix_time < utc_start_ || unix_time >= utc_end_) {
+    FillCache(unix_time);
+    if (unix_time < utc_start_ || unix_time >= utc_end_) {
+      v->UtcToLocal(*tz_);
+      return;
+    }
+  }
+  // Time-zone conversion rules don't affect fractional seconds, leave them intact.
+  int64_t nanos = v->time_.fractional_seconds();
+  *v = TimestampValue::UtcFromUnixTimeTicks<1>(unix_time + offset_);
+  v->time_ += boost::posix_time::nanoseconds(nanos);
+}
+
+void TimezoneConverter::LocalToUtc(TimestampValue* v) {
+  DCHECK(tz_ != nullptr);
+  DCHECK(v->HasDateAndTime());
+  // The civil time of 'v' as a unix time in UTC.
+  time_t local_time;
+  if (UNLIKELY(!v->UtcToUnixTime(&local_time))) {
+    v->SetToInvalidDateTime();
+    return;
+  }
+  if (local_time < local_start_ || local_time >= local_end_) {
+    // The slow path also decides whether 'v' is skipped or repeated. Cache the interval
+    // of its result for the next calls, unless it is cached already but the local times
+    // are not, which happens if there are no reliable transitions around it.
+    v->LocalToUtc(*tz_);
+    time_t unix_time;
+    if (v->UtcToUnixTime(&unix_time)
+        && (unix_time < utc_start_ || unix_time >= utc_end_)) {
+      FillCache(unix_time);
+    }
+    return;
+  }
+  int64_t nanos = v->time_.fractional_seconds();
+  *v = TimestampValue::UtcFromUnixTimeTicks<1>(local_time - offset_);
+  v->time_ += boost::posix_time::nanoseconds(nanos);
+}
+}
@@ -0,0 +1,75 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include "common/global-types.h"
+#include "runtime/timestamp-value.h"
+
+namespace impala {
+
+/// Converts timestamps between UTC and a time-zone with the same results as
+/// TimestampValue::UtcToLocal() and TimestampValue::LocalToUtc().
+///
+/// Looking up the UTC offset of a timestamp in the time-zone is a binary search over its
+/// transitions. The converter remembers the interval between the two transitions around
+/// the last converted timestamp, so converting a timestamp inside the same interval,
+/// e.g. the same DST period, only adds the cached offset. Timestamps are typically
+/// converted in runs that are close in time, so most conversions hit the cache.
+///
+/// A converter is not thread-safe. It is cheap to copy.
+class TimezoneConverter {
+ public:
+  /// A default-constructed converter must be assigned before it is used.
+  TimezoneConverter() {}
+
+  /// 'tz' must outlive the converter.
+  explicit TimezoneConverter(const Timezone* tz) : tz_(tz) { DCHECK(tz != nullptr); }
+
+  /// Converts 'v' from UTC to the time-zone in-place, like v->UtcToLocal(). 'v' must
+  /// have both a valid date and time.
+  void UtcToLocal(TimestampValue* v);
+
+  /// Converts 'v' from the time-zone to UTC in-place, like v->LocalToUtc(). 'v' must
+  /// have both a valid date and time. Local times that are skipped or repeated by a
+  /// transition invalidate 'v'.
+  void LocalToUtc(TimestampValue* v);
+
+ private:
+  /// Sets the cached intervals to the ones that contain 'unix_time' (in UTC seconds).
+  void FillCache(int64_t unix_time);
+
+  const Timezone* tz_ = nullptr;
+
+  /// The UTC offset in seconds of the cached interval.
+  int64_t offset_ = 0;
+
+  /// Range [utc_start_, utc_end_) of UTC unix times that have offset 'offset_'. It is
+  /// clipped so that the local times of its timestamps are valid TimestampValues. Empty
+  /// until the first conversion.
+  int64_t utc_start_ = 0;
+  int64_t utc_end_ = 0;
+
+  /// Range [local_start_, local_end_) of local times, as unix times of the same civil
+  /// time in UTC, that map to a unique UTC time with offset 'offset_'. Local times that
+  /// are skipped or repeated by the transitions are outside of it.
+  int64_t local_start_ = 0;
+  int64_t local_end_ = 0;
+};
+}
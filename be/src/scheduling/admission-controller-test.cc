@@ -16,7 +16,7 @@
 // under the License.
 
 #include "scheduling/admission-controller.h"
-
+#include "common/atomic.h"
 #include "common/names.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/logging_test_util.h"
@@ -29,10 +29,14 @@
 #include "testutil/gtest-util.h"
 #include "util/metrics.h"
 #include <regex>
+#include <boost/thread/thread.hpp>
 
 // Access the flags that are defined in RequestPoolService.
 DECLARE_string(fair_scheduler_allocation_path);
 DECLARE_string(llama_site_path);
+DECLARE_int32(mem_estimate_history_min_samples);
+DECLARE_double(mem_estimate_history_percentile);
+DECLARE_double(mem_estimate_history_headroom);
 
 namespace impala {
 
@@ -60,7 +64,8 @@ static std::vector<THeavyMemoryQuery> empty_heavy_memory_query_list;
 /// Common code and constants should go here.
 /// These are single threaded tests so we access the internal data structures of
 /// the AdmissionController object, and call methods such as 'GetPoolStats' without
-/// taking the admission_ctrl_lock_ lock.
+/// taking the admission_ctrl_lock_ lock. The only exception is AdmissionStress, which
+/// takes the lock in its threads.
 class AdmissionControllerTest : public testing::Test {
  protected:
   boost::scoped_ptr<TestEnv> test_env_;
@@ -239,6 +244,63 @@ class AdmissionControllerTest : public testing::Test {
     topic->topic_entries.push_back(item);
   }
 
+  /// Add the per-host stats 'host_stats' reported by the coordinator 'coord_id' to the
+  /// TTopicDelta 'topic'.
+  static void AddHostStatsToTopic(TTopicDelta* topic, const string& coord_id,
+      const AdmissionController::PerHostStats& host_stats) {
+    TPerHostStatsUpdate update;
+    for (const auto& entry : host_stats) {
+      update.per_host_stats.emplace_back();
+      update.per_host_stats.back().__set_host_addr(entry.first);
+      update.per_host_stats.back().__set_stats(entry.second);
+    }
+    TTopicItem item;
+    // Matches TOPIC_KEY_STAT_PREFIX in admission-controller.cc.
+    item.key = "STAT:" + coord_id;
+    ThriftSerializer serializer(false);
+    Status status = serializer.SerializeToString(&update, &item.value);
+    DCHECK(status.ok());
+    topic->topic_entries.push_back(item);
+  }
+
+  /// Send the IMPALA_REQUEST_QUEUE_TOPIC update 'delta' to 'admission_controller'.
+  static void SendTopicUpdate(
+      AdmissionController* admission_controller, const TTopicDelta& delta) {
+    StatestoreSubscriber::TopicDeltaMap incoming_topic_deltas;
+    incoming_topic_deltas.emplace(Statestore::IMPALA_REQUEST_QUEUE_TOPIC, delta);
+    vector<TTopicDelta> outgoing_topic_updates;
+    admission_controller->UpdatePoolStats(incoming_topic_deltas, &outgoing_topic_updates);
+  }
+
+  /// Check that the cached remote per-host totals of 'admission_controller' match the
+  /// sum over the stats of all remote coordinators.
+  static void CheckRemoteHostStatsTotals(AdmissionController* admission_controller) {
+    AdmissionController::PerHostStats expected;
+    for (const auto& coord_entry : admission_controller->remote_per_host_stats_) {
+      for (const auto& host_entry : coord_entry.second) {
+        THostStats& totals = expected[host_entry.first];
+        totals.mem_admitted += host_entry.second.mem_admitted;
+        totals.num_admitted += host_entry.second.num_admitted;
+        totals.slots_in_use += host_entry.second.slots_in_use;
+      }
+    }
+    for (const auto& entry : admission_controller->remote_host_stats_totals_) {
+      const THostStats& totals = expected[entry.first];
+      EXPECT_EQ(totals.mem_admitted, entry.second.mem_admitted) << entry.first;
+      EXPECT_EQ(totals.num_admitted, entry.second.num_admitted) << entry.first;
+      EXPECT_EQ(totals.slots_in_use, entry.second.slots_in_use) << entry.first;
+    }
+    // Exactly the hosts with a non-zero count have an entry.
+    for (const auto& entry : expected) {
+      const THostStats& totals = entry.second;
+      bool is_zero = totals.mem_admitted == 0 && totals.num_admitted == 0
+          && totals.slots_in_use == 0;
+      EXPECT_EQ(is_zero ? 0 : 1,
+          admission_controller->remote_host_stats_totals_.count(entry.first))
+          << entry.first;
+    }
+  }
+
   /// Check that PoolConfig can be read from a RequestPoolService, and that the
   /// configured values are as expected.
   static void CheckPoolConfig(RequestPoolService& request_pool_service,
@@ -847,6 +909,58 @@ TEST_F(AdmissionControllerTest, DedicatedCoordScheduleState) {
   ASSERT_EQ(700 * MEGABYTE, schedule_state->coord_backend_mem_limit());
 }
 
+// Test that the per-host memory estimate is derived from the peak memory of previous runs
+// of a plan once enough of them are known, and that the accuracy stats are kept per
+// source of the estimate.
+TEST_F(AdmissionControllerTest, MemEstimateFromHistory) {
+  FLAGS_mem_estimate_history_min_samples = 3;
+  FLAGS_mem_estimate_history_percentile = 100;
+  FLAGS_mem_estimate_history_headroom = 1.5;
+  AdmissionController* admission_controller = MakeAdmissionController();
+  RequestPoolService* request_pool_service = admission_controller->request_pool_service_;
+  TPoolConfig pool_config;
+  ASSERT_OK(request_pool_service->GetPoolConfig("default", &pool_config));
+  AdmissionController::PoolStats* pool_stats =
+      admission_controller->GetPoolStats("default");
+
+  const uint64_t FINGERPRINT = 1234;
+  const int64_t PLANNER_ESTIMATE = 512 * MEGABYTE;
+  for (int i = 0; i < 2; ++i) {
+    pool_stats->RecordPeakMem(FINGERPRINT, PLANNER_ESTIMATE, false, 100 * MEGABYTE);
+  }
+  ASSERT_EQ(-1, pool_stats->GetMemEstimateFromHistory(FINGERPRINT));
+  // The planner overestimated the first runs.
+  pool_stats->RecordPeakMem(FINGERPRINT, PLANNER_ESTIMATE, false, 200 * MEGABYTE);
+  const int64_t history_estimate = pool_stats->GetMemEstimateFromHistory(FINGERPRINT);
+  ASSERT_EQ(300 * MEGABYTE, history_estimate);
+  ASSERT_EQ(3, pool_stats->planner_estimate_accuracy_.num_queries);
+  ASSERT_EQ(0, pool_stats->planner_estimate_accuracy_.num_underestimates);
+  ASSERT_EQ(-1, pool_stats->GetMemEstimateFromHistory(FINGERPRINT + 1));
+
+  // The history estimate replaces the planner's estimate unless MEM_LIMIT is set.
+  ScheduleState* schedule_state = MakeScheduleState(
+      "default", 0, pool_config, 2, PLANNER_ESTIMATE, PLANNER_ESTIMATE, false);
+  schedule_state->set_mem_estimate_from_history(history_estimate);
+  schedule_state->UpdateMemoryRequirements(pool_config);
+  ASSERT_EQ(history_estimate, schedule_state->per_backend_mem_to_admit());
+  ASSERT_EQ(history_estimate, schedule_state->coord_backend_mem_to_admit());
+  schedule_state = MakeScheduleState(
+      "default", GIGABYTE, pool_config, 2, PLANNER_ESTIMATE, PLANNER_ESTIMATE, false);
+  schedule_state->set_mem_estimate_from_history(history_estimate);
+  schedule_state->UpdateMemoryRequirements(pool_config);
+  ASSERT_EQ(GIGABYTE, schedule_state->per_backend_mem_to_admit());
+
+  // A run that needs more memory than any previous one is an underestimate.
+  pool_stats->RecordPeakMem(FINGERPRINT, history_estimate, true, 400 * MEGABYTE);
+  ASSERT_EQ(1, pool_stats->history_estimate_accuracy_.num_queries);
+  ASSERT_EQ(1, pool_stats->history_estimate_accuracy_.num_underestimates);
+  ASSERT_EQ(600 * MEGABYTE, pool_stats->GetMemEstimateFromHistory(FINGERPRINT));
+
+  pool_stats->ResetInformationalStats();
+  ASSERT_EQ(0, pool_stats->history_estimate_accuracy_.num_queries);
+  ASSERT_EQ(0, pool_stats->planner_estimate_accuracy_.num_queries);
+}
+
 // Test admission decisions for clusters with dedicated coordinators, where different
 // amounts of memory should be admitted on coordinators and executors.
 TEST_F(AdmissionControllerTest, DedicatedCoordAdmissionChecks) {
@@ -1172,4 +1286,215 @@ TEST_F(AdmissionControllerTest, TopNQueryCheck) {
 #endif
 }
 
+/// Test that the per-host totals over the stats of remote coordinators are kept up to
+/// date when coordinators update or remove their stats.
+TEST_F(AdmissionControllerTest, RemoteHostStatsTotals) {
+  AdmissionController* admission_controller = MakeAdmissionController();
+
+  THostStats stats;
+  stats.mem_admitted = 10 * MEGABYTE;
+  stats.num_admitted = 1;
+  stats.slots_in_use = 2;
+  AdmissionController::PerHostStats coord1_stats = {{HOST_0, stats}, {HOST_1, stats}};
+  stats.mem_admitted = 5 * MEGABYTE;
+  AdmissionController::PerHostStats coord2_stats = {{HOST_1, stats}, {HOST_2, stats}};
+  TTopicDelta delta = MakeTopicDelta(false);
+  AddHostStatsToTopic(&delta, "coord1:25000", coord1_stats);
+  AddHostStatsToTopic(&delta, "coord2:25000", coord2_stats);
+  SendTopicUpdate(admission_controller, delta);
+  CheckRemoteHostStatsTotals(admission_controller);
+  const AdmissionController::PerHostStats& totals =
+      admission_controller->remote_host_stats_totals_;
+  EXPECT_EQ(15 * MEGABYTE, totals.at(HOST_1).mem_admitted);
+  EXPECT_EQ(2, totals.at(HOST_1).num_admitted);
+  EXPECT_EQ(4, totals.at(HOST_1).slots_in_use);
+
+  // An update of one host replaces only the stats of that host.
+  stats.mem_admitted = 20 * MEGABYTE;
+  stats.slots_in_use = 0;
+  delta = MakeTopicDelta(true);
+  AddHostStatsToTopic(&delta, "coord1:25000", {{HOST_1, stats}});
+  SendTopicUpdate(admission_controller, delta);
+  CheckRemoteHostStatsTotals(admission_controller);
+  EXPECT_EQ(10 * MEGABYTE, totals.at(HOST_0).mem_admitted);
+  EXPECT_EQ(25 * MEGABYTE, totals.at(HOST_1).mem_admitted);
+  EXPECT_EQ(2, totals.at(HOST_1).slots_in_use);
+
+  // The stats of this coordinator itself are ignored.
+  delta = MakeTopicDelta(true);
+  AddHostStatsToTopic(&delta, HOST_0, {{HOST_1, stats}});
+  SendTopicUpdate(admission_controller, delta);
+  CheckRemoteHostStatsTotals(admission_controller);
+  EXPECT_EQ(25 * MEGABYTE, totals.at(HOST_1).mem_admitted);
+
+  // Removing a coordinator subtracts all of its stats.
+  delta = MakeTopicDelta(true);
+  TTopicItem item;
+  item.key = "STAT:coord1:25000";
+  item.deleted = true;
+  delta.topic_entries.push_back(item);
+  SendTopicUpdate(admission_controller, delta);
+  CheckRemoteHostStatsTotals(admission_controller);
+  // HOST_0 was only reported by coord1, so its entry is removed.
+  EXPECT_EQ(0, totals.count(HOST_0));
+  EXPECT_EQ(5 * MEGABYTE, totals.at(HOST_1).mem_admitted);
+  EXPECT_EQ(2, totals.at(HOST_1).slots_in_use);
+
+  // A host whose counts drop to zero is removed while it is still reported.
+  THostStats idle;
+  idle.mem_admitted = 0;
+  idle.num_admitted = 0;
+  idle.slots_in_use = 0;
+  delta = MakeTopicDelta(true);
+  AddHostStatsToTopic(&delta, "coord2:25000", {{HOST_1, idle}});
+  SendTopicUpdate(admission_controller, delta);
+  CheckRemoteHostStatsTotals(admission_controller);
+  EXPECT_EQ(0, totals.count(HOST_1));
+  EXPECT_EQ(5 * MEGABYTE, totals.at(HOST_2).mem_admitted);
+  EXPECT_EQ(1, totals.size());
+}
+
+/// Stress test for admission decisions in a large cluster with many coordinators.
+/// Threads that admit queries one at a time, as on submission, and a thread that admits
+/// batches of queries, as the dequeue thread does, run concurrently with a thread that
+/// delivers stats updates from the other coordinators. Every decision must admit the
+/// query and the cached remote per-host totals must stay consistent throughout.
+TEST_F(AdmissionControllerTest, AdmissionStress) {
+  FLAGS_fair_scheduler_allocation_path = GetResourceFile("fair-scheduler-test2.xml");
+  FLAGS_llama_site_path = GetResourceFile("llama-site-test2.xml");
+  const int NUM_HOSTS = 200;
+  const int NUM_COORDINATORS = 50;
+  const int NUM_UPDATES = 200;
+  const int NUM_ADMISSION_THREADS = 4;
+  const int MIN_DECISIONS_PER_THREAD = 1000;
+  const int DEQUEUE_BATCH_SIZE = 10;
+  const int CHECK_TOTALS_INTERVAL = 100;
+
+  AdmissionController* admission_controller = MakeAdmissionController();
+  RequestPoolService* request_pool_service = admission_controller->request_pool_service_;
+  TPoolConfig config;
+  ASSERT_OK(request_pool_service->GetPoolConfig(QUEUE_D, &config));
+  config.max_mem_resources = 1000L * GIGABYTE;
+  // One schedule per decision thread, plus one for the dequeue thread.
+  vector<ScheduleState*> schedule_states;
+  for (int i = 0; i <= NUM_ADMISSION_THREADS; ++i) {
+    ScheduleState* schedule_state = MakeScheduleState(QUEUE_D, config, 1, 10 * MEGABYTE);
+    SetHostsInScheduleState(*schedule_state, NUM_HOSTS, false, 0, 200L * MEGABYTE, 1,
+        64);
+    schedule_state->UpdateMemoryRequirements(config);
+    schedule_states.push_back(schedule_state);
+  }
+
+  // Every coordinator has admitted 2MB and one slot on every host. The updates below
+  // keep each coordinator at most at 3MB per host, so a query with 10MB per host always
+  // fits into the 200MB of each host.
+  THostStats stats;
+  stats.mem_admitted = 2 * MEGABYTE;
+  stats.num_admitted = 1;
+  stats.slots_in_use = 1;
+  AdmissionController::PerHostStats host_stats;
+  for (int i = 0; i < NUM_HOSTS; ++i) host_stats[Substitute("host$0:25000", i)] = stats;
+  TTopicDelta delta = MakeTopicDelta(false);
+  for (int i = 0; i < NUM_COORDINATORS; ++i) {
+    AddHostStatsToTopic(&delta, Substitute("coord$0:25000", i), host_stats);
+  }
+  SendTopicUpdate(admission_controller, delta);
+  CheckRemoteHostStatsTotals(admission_controller);
+  // The expected stats of each host for each coordinator after all updates.
+  map<string, AdmissionController::PerHostStats> expected_stats;
+  for (int i = 0; i < NUM_COORDINATORS; ++i) {
+    expected_stats[Substitute("coord$0:25000", i)] = host_stats;
+  }
+
+  AtomicInt64 num_decisions(0);
+  AtomicInt64 num_not_admitted(0);
+  AtomicBool updates_done(false);
+  // Makes one admission decision with 'schedule_state'. Must hold admission_ctrl_lock_.
+  auto decide = [&](const ScheduleState& schedule_state, bool admit_from_queue) {
+    string not_admitted_reason;
+    bool coordinator_resource_limited = false;
+    if (!admission_controller->CanAdmitRequest(schedule_state, config, admit_from_queue,
+            &not_admitted_reason, nullptr, coordinator_resource_limited)) {
+      num_not_admitted.Add(1);
+      LOG(ERROR) << "Not admitted: " << not_admitted_reason;
+    }
+    if (num_decisions.Add(1) % CHECK_TOTALS_INTERVAL == 0) {
+      CheckRemoteHostStatsTotals(admission_controller);
+    }
+  };
+
+  thread_group threads;
+  for (int t = 0; t < NUM_ADMISSION_THREADS; ++t) {
+    threads.add_thread(new thread([&, t]() {
+      for (int i = 0; i < MIN_DECISIONS_PER_THREAD || !updates_done.Load(); ++i) {
+        lock_guard<mutex> l(admission_controller->admission_ctrl_lock_);
+        decide(*schedule_states[t], false);
+      }
+    }));
+  }
+  threads.add_thread(new thread([&]() {
+    for (int i = 0; i < MIN_DECISIONS_PER_THREAD || !updates_done.Load();
+         i += DEQUEUE_BATCH_SIZE) {
+      lock_guard<mutex> l(admission_controller->admission_ctrl_lock_);
+      for (int j = 0; j < DEQUEUE_BATCH_SIZE; ++j) {
+        decide(*schedule_states[NUM_ADMISSION_THREADS], true);
+      }
+    }
+  }));
+  threads.add_thread(new thread([&]() {
+    THostStats update_stats = stats;
+    for (int u = 0; u < NUM_UPDATES; ++u) {
+      // One coordinator changes its view of two hosts.
+      const string coord = Substitute("coord$0:25000", u % NUM_COORDINATORS);
+      update_stats.mem_admitted = (u % 4) * MEGABYTE;
+      AdmissionController::PerHostStats update;
+      update[Substitute("host$0:25000", u % NUM_HOSTS)] = update_stats;
+      update[Substitute("host$0:25000", (u + 1) % NUM_HOSTS)] = update_stats;
+      TTopicDelta update_delta = MakeTopicDelta(true);
+      AddHostStatsToTopic(&update_delta, coord, update);
+      SendTopicUpdate(admission_controller, update_delta);
+      for (const auto& entry : update) expected_stats[coord][entry.first] = entry.second;
+    }
+    updates_done.Store(true);
+  }));
+  threads.join_all();
+
+  EXPECT_EQ(0, num_not_admitted.Load());
+  EXPECT_GE(num_decisions.Load(), (NUM_ADMISSION_THREADS + 1) * MIN_DECISIONS_PER_THREAD);
+  CheckRemoteHostStatsTotals(admission_controller);
+  for (int i = 0; i < NUM_HOSTS; ++i) {
+    const string host = Substitute("host$0:25000", i);
+    int64_t expected_mem_admitted = 0;
+    for (const auto& entry : expected_stats) {
+      expected_mem_admitted += entry.second.at(host).mem_admitted;
+    }
+    EXPECT_EQ(expected_mem_admitted,
+        admission_controller->remote_host_stats_totals_.at(host).mem_admitted) << host;
+  }
+
+  string not_admitted_reason;
+  bool coordinator_resource_limited = false;
+  ScheduleState* schedule_state = schedule_states[0];
+
+  // A single coordinator filling up one host blocks the query.
+  stats.mem_admitted = 150L * MEGABYTE;
+  delta = MakeTopicDelta(true);
+  AddHostStatsToTopic(&delta, "coord7:25000", {{"host42:25000", stats}});
+  SendTopicUpdate(admission_controller, delta);
+  ASSERT_FALSE(admission_controller->CanAdmitRequest(*schedule_state, config, true,
+      &not_admitted_reason, nullptr, coordinator_resource_limited));
+  EXPECT_STR_CONTAINS(not_admitted_reason, "host42:25000");
+
+  // Once that coordinator goes away the query can be admitted again.
+  delta = MakeTopicDelta(true);
+  TTopicItem item;
+  item.key = "STAT:coord7:25000";
+  item.deleted = true;
+  delta.topic_entries.push_back(item);
+  SendTopicUpdate(admission_controller, delta);
+  CheckRemoteHostStatsTotals(admission_controller);
+  ASSERT_TRUE(admission_controller->CanAdmitRequest(*schedule_state, config, true,
+      &not_admitted_reason, nullptr, coordinator_resource_limited));
+}
+
 } // end namespace impala
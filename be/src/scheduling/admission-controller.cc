@@ -33,6 +33,7 @@
 #include "service/impala-server.h"
 #include "util/bit-util.h"
 #include "util/debug-util.h"
+#include "util/hash-util.h"
 #include "util/metrics.h"
 #include "util/pretty-printer.h"
 #include "util/runtime-profile-counters.h"
@@ -60,6 +61,22 @@ DEFINE_int64_hidden(admission_control_stale_topic_threshold_ms, 5 * 1000,
     "capture most cases where the Impala daemon is disconnected from the statestore "
     "or topic updates are seriously delayed.");
 
+DEFINE_bool(enable_mem_estimate_history, false, "If true, the admission controller "
+    "keeps the peak per-host memory of completed queries by pool and plan and admits "
+    "repeated runs of a plan that don't set MEM_LIMIT based on the observed peaks "
+    "instead of the planner's memory estimate.");
+DEFINE_int32(mem_estimate_history_max_plans, 1000, "Maximum number of distinct plans "
+    "whose peak memory is kept per resource pool when --enable_mem_estimate_history is "
+    "true. The least recently used plans are evicted first.");
+DEFINE_int32(mem_estimate_history_samples, 20, "Number of most recent peak memory "
+    "values kept per plan when --enable_mem_estimate_history is true.");
+DEFINE_int32(mem_estimate_history_min_samples, 3, "Minimum number of peak memory "
+    "values that must be known for a plan before they replace the planner's estimate.");
+DEFINE_double(mem_estimate_history_percentile, 95, "Percentile, in [0, 100], of the "
+    "known peak memory values of a plan that is used as its memory estimate.");
+DEFINE_double(mem_estimate_history_headroom, 1.2, "Factor that the percentile of the "
+    "known peak memory values of a plan is multiplied with to get its memory estimate.");
+
 namespace impala {
 
 const int64_t AdmissionController::PoolStats::HISTOGRAM_NUM_OF_BINS = 128;
@@ -139,6 +156,10 @@ const string POOL_MIN_QUERY_MEM_LIMIT_METRIC_KEY_FORMAT =
   "admission-controller.pool-min-query-mem-limit.$0";
 const string POOL_CLAMP_MEM_LIMIT_QUERY_OPTION_METRIC_KEY_FORMAT =
   "admission-controller.pool-clamp-mem-limit-query-option.$0";
+const string MEM_ESTIMATE_HISTORY_HITS_METRIC_KEY_FORMAT =
+  "admission-controller.mem-estimate-history-hits.$0";
+const string MEM_ESTIMATE_HISTORY_MISSES_METRIC_KEY_FORMAT =
+  "admission-controller.mem-estimate-history-misses.$0";
 
 // Profile info strings
 const string AdmissionController::PROFILE_INFO_KEY_ADMISSION_RESULT = "Admission result";
@@ -158,6 +179,8 @@ const string AdmissionController::PROFILE_INFO_KEY_LAST_QUEUED_REASON =
     "Latest admission queue reason";
 const string AdmissionController::PROFILE_INFO_KEY_ADMITTED_MEM =
     "Cluster Memory Admitted";
+const string AdmissionController::PROFILE_INFO_KEY_MEM_ESTIMATE_FROM_HISTORY =
+    "Per-Host Memory Estimate From History";
 const string AdmissionController::PROFILE_INFO_KEY_EXECUTOR_GROUP = "Executor Group";
 const string AdmissionController::PROFILE_INFO_KEY_STALENESS_WARNING =
     "Admission control state staleness";
@@ -684,6 +707,16 @@ void AdmissionController::PoolStats::AdmitQueryAndMemory(const ScheduleState& st
   metrics_.total_admitted->Increment(1L);
 }
 
+AdmissionController::PoolStats::PoolStats(
+    AdmissionController* parent, const string& name)
+  : name_(name), parent_(parent), agg_num_running_(0), agg_num_queued_(0),
+    agg_mem_reserved_(0), local_mem_admitted_(0), wait_time_ms_ema_(0.0),
+    mem_estimate_history_(
+        FLAGS_mem_estimate_history_max_plans, FLAGS_mem_estimate_history_samples) {
+  peak_mem_histogram_.resize(HISTOGRAM_NUM_OF_BINS, 0);
+  InitMetrics();
+}
+
 void AdmissionController::PoolStats::ReleaseQuery(int64_t peak_mem_consumption) {
   // Update stats tracking the number of running and admitted queries.
   agg_num_running_ -= 1;
@@ -707,6 +740,30 @@ void AdmissionController::PoolStats::ReleaseQuery(int64_t peak_mem_consumption)
   }
 }
 
+int64_t AdmissionController::PoolStats::GetMemEstimateFromHistory(
+    uint64_t plan_fingerprint) {
+  double percentile = max(0.0, min(100.0, FLAGS_mem_estimate_history_percentile));
+  int64_t peak_mem = mem_estimate_history_.GetEstimate(
+      plan_fingerprint, percentile, FLAGS_mem_estimate_history_min_samples);
+  if (peak_mem <= 0) return -1;
+  return static_cast<int64_t>(peak_mem * max(1.0, FLAGS_mem_estimate_history_headroom));
+}
+
+void AdmissionController::PoolStats::RecordPeakMem(uint64_t plan_fingerprint,
+    int64_t estimated_mem_to_admit, bool estimate_from_history,
+    int64_t peak_mem_consumption) {
+  DCHECK_GT(peak_mem_consumption, 0);
+  mem_estimate_history_.AddSample(plan_fingerprint, peak_mem_consumption);
+  // Queries that only ran on the coordinator were not admitted any executor memory.
+  if (estimated_mem_to_admit <= 0) return;
+  MemEstimateAccuracy* accuracy = estimate_from_history ?
+      &history_estimate_accuracy_ : &planner_estimate_accuracy_;
+  ++accuracy->num_queries;
+  if (peak_mem_consumption > estimated_mem_to_admit) ++accuracy->num_underestimates;
+  accuracy->sum_admitted_to_peak_ratio +=
+      static_cast<double>(estimated_mem_to_admit) / peak_mem_consumption;
+}
+
 void AdmissionController::PoolStats::ReleaseMem(int64_t mem_to_release) {
   // Update stats tracking memory admitted.
   DCHECK_GT(mem_to_release, 0);
@@ -868,12 +925,10 @@ bool AdmissionController::HasAvailableMemResources(const ScheduleState& state,
     const THostStats& host_stats = host_stats_[host_id];
     int64_t mem_reserved = host_stats.mem_reserved;
     int64_t agg_mem_admitted_on_host = host_stats.mem_admitted;
-    // Aggregate the mem admitted across all queries admitted by other coordinators.
-    for (const auto& remote_entry : remote_per_host_stats_) {
-      auto remote_stat_itr = remote_entry.second.find(host_id);
-      if (remote_stat_itr != remote_entry.second.end()) {
-        agg_mem_admitted_on_host += remote_stat_itr->second.mem_admitted;
-      }
+    // Add the mem admitted across all queries admitted by other coordinators.
+    auto remote_totals_it = remote_host_stats_totals_.find(host_id);
+    if (remote_totals_it != remote_host_stats_totals_.end()) {
+      agg_mem_admitted_on_host += remote_totals_it->second.mem_admitted;
     }
     int64_t mem_to_admit = GetMemToAdmit(state, entry.second);
     VLOG_ROW << "Checking memory on host=" << host_id
@@ -918,12 +973,10 @@ bool AdmissionController::HasAvailableSlots(const ScheduleState& state,
     const string host_id = NetworkAddressPBToString(host);
     int64_t admission_slots = entry.second.be_desc.admission_slots();
     int64_t agg_slots_in_use_on_host = host_stats_[host_id].slots_in_use;
-    // Aggregate num of slots in use across all queries admitted by other coordinators.
-    for (const auto& remote_entry : remote_per_host_stats_) {
-      auto remote_stat_itr = remote_entry.second.find(host_id);
-      if (remote_stat_itr != remote_entry.second.end()) {
-        agg_slots_in_use_on_host += remote_stat_itr->second.slots_in_use;
-      }
+    // Add num of slots in use across all queries admitted by other coordinators.
+    auto remote_totals_it = remote_host_stats_totals_.find(host_id);
+    if (remote_totals_it != remote_host_stats_totals_.end()) {
+      agg_slots_in_use_on_host += remote_totals_it->second.slots_in_use;
     }
     VLOG_ROW << "Checking available slot on host=" << host_id
              << " slots_in_use=" << agg_slots_in_use_on_host << " needs="
@@ -1205,6 +1258,10 @@ Status AdmissionController::SubmitForAdmission(const AdmissionRequest& request,
   RETURN_IF_ERROR(ResolvePoolAndGetConfig(
       request.request.query_ctx, &queue_node->pool_name, &queue_node->pool_cfg));
   request.summary_profile->AddInfoString("Request Pool", queue_node->pool_name);
+  if (FLAGS_enable_mem_estimate_history) {
+    // Computed before taking 'admission_ctrl_lock_' since it serializes the plan.
+    queue_node->plan_fingerprint = ComputePlanFingerprint(request.request);
+  }
 
   {
     // Take lock to ensure the Dequeue thread does not modify the request queue.
@@ -1423,6 +1480,11 @@ void AdmissionController::ReleaseQuery(const UniqueIdPB& query_id,
     num_released_backends_.erase(num_released_backends_.find(query_id));
     PoolStats* stats = GetPoolStats(running_query.request_pool);
     stats->ReleaseQuery(peak_mem_consumption);
+    if (running_query.plan_fingerprint != 0 && peak_mem_consumption > 0) {
+      stats->RecordPeakMem(running_query.plan_fingerprint,
+          running_query.estimated_mem_to_admit, running_query.mem_estimate_from_history,
+          peak_mem_consumption);
+    }
     // No need to update the Host Stats as they should have been updated in
     // ReleaseQueryBackends.
     pools_for_updates_.insert(running_query.request_pool);
@@ -1651,7 +1713,7 @@ void AdmissionController::HandleTopicUpdates(const vector<TTopicItem>& topic_upd
       topic_backend_id = topic_key_suffix;
       if (topic_backend_id == host_id_) continue;
       if (item.deleted) {
-        remote_per_host_stats_.erase(topic_backend_id);
+        UpdateRemoteHostStats(topic_backend_id, nullptr);
         continue;
       }
       TPerHostStatsUpdate remote_update;
@@ -1663,16 +1725,61 @@ void AdmissionController::HandleTopicUpdates(const vector<TTopicItem>& topic_upd
         VLOG_QUERY << "Error deserializing stats update with key: " << item.key;
         continue;
       }
-      PerHostStats& stats = remote_per_host_stats_[topic_backend_id];
-      for(const auto& elem: remote_update.per_host_stats) {
-        stats[elem.host_addr] = elem.stats;
-      }
+      UpdateRemoteHostStats(topic_backend_id, &remote_update);
     } else {
       VLOG_QUERY << "Invalid topic key prefix: " << topic_key_prefix;
     }
   }
 }
 
+// Adds 'sign' times the admission counts of 'stats' to 'totals'.
+static void AddHostStatsToTotals(const THostStats& stats, int sign, THostStats* totals) {
+  totals->mem_admitted += sign * stats.mem_admitted;
+  totals->num_admitted += sign * stats.num_admitted;
+  totals->slots_in_use += sign * stats.slots_in_use;
+}
+
+// Removes the entry 'it' from 'totals' if all of its admission counts are zero. Hosts
+// without an entry count as zero, so this keeps 'totals' from growing with every host
+// that was ever reported.
+static void EraseIfZero(AdmissionController::PerHostStats::iterator it,
+    AdmissionController::PerHostStats* totals) {
+  const THostStats& stats = it->second;
+  if (stats.mem_admitted == 0 && stats.num_admitted == 0 && stats.slots_in_use == 0) {
+    totals->erase(it);
+  }
+}
+
+void AdmissionController::UpdateRemoteHostStats(
+    const string& coord_id, const TPerHostStatsUpdate* update) {
+  if (update == nullptr) {
+    auto it = remote_per_host_stats_.find(coord_id);
+    if (it == remote_per_host_stats_.end()) return;
+    for (const auto& elem : it->second) {
+      auto totals_it = remote_host_stats_totals_.emplace(elem.first, THostStats()).first;
+      AddHostStatsToTotals(elem.second, -1, &totals_it->second);
+      EraseIfZero(totals_it, &remote_host_stats_totals_);
+    }
+    remote_per_host_stats_.erase(it);
+    return;
+  }
+  PerHostStats& stats = remote_per_host_stats_[coord_id];
+  for (const auto& elem : update->per_host_stats) {
+    auto totals_it =
+        remote_host_stats_totals_.emplace(elem.host_addr, THostStats()).first;
+    THostStats& totals = totals_it->second;
+    auto it = stats.find(elem.host_addr);
+    if (it != stats.end()) {
+      AddHostStatsToTotals(it->second, -1, &totals);
+      it->second = elem.stats;
+    } else {
+      stats.emplace(elem.host_addr, elem.stats);
+    }
+    AddHostStatsToTotals(elem.stats, 1, &totals);
+    EraseIfZero(totals_it, &remote_host_stats_totals_);
+  }
+}
+
 void AdmissionController::PoolStats::UpdateAggregates(HostMemMap* host_mem_reserved) {
   const string& coord_id = parent_->host_id_;
   int64_t num_running = 0;
@@ -1866,6 +1973,10 @@ bool AdmissionController::FindGroupToAdmitOrReject(
   for (GroupScheduleState& group_state : queue_node->group_states) {
     const ExecutorGroup& executor_group = group_state.executor_group;
     ScheduleState* state = group_state.state.get();
+    if (queue_node->plan_fingerprint != 0) {
+      state->set_mem_estimate_from_history(
+          pool_stats->GetMemEstimateFromHistory(queue_node->plan_fingerprint));
+    }
     state->UpdateMemoryRequirements(pool_config);
 
     const string& group_name = executor_group.name();
@@ -1998,95 +2109,116 @@ void AdmissionController::DequeueLoop() {
     // be empty.
     if (membership_snapshot->executor_groups.empty()) continue;
 
-    for (const PoolConfigMap::value_type& entry: pool_config_map_) {
-      const string& pool_name = entry.first;
-      const TPoolConfig& pool_config = entry.second;
-      PoolStats* stats = GetPoolStats(pool_name, /* dcheck_exists=*/true);
-
-      if (stats->local_stats().num_queued == 0) continue; // Nothing to dequeue
-      DCHECK_GE(stats->agg_num_queued(), stats->local_stats().num_queued);
-
-      RequestQueue& queue = request_queue_map_[pool_name];
-      int64_t max_to_dequeue = GetMaxToDequeue(queue, stats, pool_config);
-      VLOG_RPC << "Dequeue thread will try to admit " << max_to_dequeue << " requests"
-               << ", pool=" << pool_name
-               << ", num_queued=" << stats->local_stats().num_queued
-               << " cluster_size=" << GetClusterSize(*membership_snapshot);
-      if (max_to_dequeue == 0) continue; // to next pool.
-
-      while (max_to_dequeue > 0 && !queue.empty()) {
-        QueueNode* queue_node = queue.head();
-        DCHECK(queue_node != nullptr);
-        // Find a group that can admit the query
-        bool is_cancelled = queue_node->admit_outcome->IsSet()
-            && queue_node->admit_outcome->Get() == AdmissionOutcome::CANCELLED;
-
-        bool coordinator_resource_limited = false;
-        bool is_rejected = !is_cancelled
-            && !FindGroupToAdmitOrReject(membership_snapshot, pool_config,
-                /* admit_from_queue=*/true, stats, queue_node,
-                coordinator_resource_limited);
-
-        if (!is_cancelled && !is_rejected
-            && queue_node->admitted_schedule.get() == nullptr) {
-          // If no group was found, stop trying to dequeue.
-          // TODO(IMPALA-2968): Requests further in the queue may be blocked
-          // unnecessarily. Consider a better policy once we have better test scenarios.
-          LogDequeueFailed(queue_node, queue_node->not_admitted_reason);
-          if (coordinator_resource_limited) {
-            // Dequeue failed because of a resource issue that can't be solved by adding
-            // more executor groups. The common reason for this is that we are hitting a
-            // limit on the coordinator.
-            total_dequeue_failed_coordinator_limited_->Increment(1);
-          }
-          break;
-        }
+    // Collect the pools to dequeue from first. The lock is released between pools, so
+    // 'pool_config_map_' may be modified while the pools are processed.
+    vector<string> pools_to_dequeue;
+    for (const PoolConfigMap::value_type& entry : pool_config_map_) {
+      if (GetPoolStats(entry.first, /* dcheck_exists=*/true)->local_stats().num_queued
+          > 0) {
+        pools_to_dequeue.push_back(entry.first);
+      }
+    }
+    bool first_pool = true;
+    for (const string& pool_name : pools_to_dequeue) {
+      if (!first_pool) {
+        // Let other threads make progress between the batches of different pools.
+        lock.unlock();
+        lock.lock();
+        if (done_) return;
+      }
+      first_pool = false;
+      DequeuePool(pool_name, membership_snapshot);
+    }
+  }
+}
 
-        // At this point we know that the query must be taken off the queue
-        queue.Dequeue();
-        --max_to_dequeue;
-        VLOG(3) << "Dequeueing from stats for pool " << pool_name;
-        stats->Dequeue(false);
-
-        if (is_rejected) {
-          AdmissionOutcome outcome =
-              queue_node->admit_outcome->Set(AdmissionOutcome::REJECTED);
-          if (outcome == AdmissionOutcome::REJECTED) {
-            stats->metrics()->total_rejected->Increment(1);
-            continue; // next query
-          } else {
-            DCHECK_ENUM_EQ(outcome, AdmissionOutcome::CANCELLED);
-            is_cancelled = true;
-          }
-        }
-        DCHECK(is_cancelled || queue_node->admitted_schedule != nullptr);
-
-        const UniqueIdPB& query_id = queue_node->admission_request.query_id;
-        if (!is_cancelled) {
-          VLOG_QUERY << "Admitting from queue: query=" << PrintId(query_id);
-          AdmissionOutcome outcome =
-              queue_node->admit_outcome->Set(AdmissionOutcome::ADMITTED);
-          if (outcome != AdmissionOutcome::ADMITTED) {
-            DCHECK_ENUM_EQ(outcome, AdmissionOutcome::CANCELLED);
-            is_cancelled = true;
-          }
-        }
+void AdmissionController::DequeuePool(const string& pool_name,
+    const ClusterMembershipMgr::SnapshotPtr& membership_snapshot) {
+  const TPoolConfig& pool_config = pool_config_map_[pool_name];
+  PoolStats* stats = GetPoolStats(pool_name, /* dcheck_exists=*/true);
 
-        if (is_cancelled) {
-          VLOG_QUERY << "Dequeued cancelled query=" << PrintId(query_id);
-          continue; // next query
-        }
+  if (stats->local_stats().num_queued == 0) return; // Nothing to dequeue
+  DCHECK_GE(stats->agg_num_queued(), stats->local_stats().num_queued);
+
+  RequestQueue& queue = request_queue_map_[pool_name];
+  int64_t max_to_dequeue = GetMaxToDequeue(queue, stats, pool_config);
+  VLOG_RPC << "Dequeue thread will try to admit " << max_to_dequeue << " requests"
+           << ", pool=" << pool_name
+           << ", num_queued=" << stats->local_stats().num_queued
+           << " cluster_size=" << GetClusterSize(*membership_snapshot);
+  if (max_to_dequeue == 0) return;
+
+  while (max_to_dequeue > 0 && !queue.empty()) {
+    QueueNode* queue_node = queue.head();
+    DCHECK(queue_node != nullptr);
+    // Find a group that can admit the query
+    bool is_cancelled = queue_node->admit_outcome->IsSet()
+        && queue_node->admit_outcome->Get() == AdmissionOutcome::CANCELLED;
+
+    bool coordinator_resource_limited = false;
+    bool is_rejected = !is_cancelled
+        && !FindGroupToAdmitOrReject(membership_snapshot, pool_config,
+            /* admit_from_queue=*/true, stats, queue_node,
+            coordinator_resource_limited);
+
+    if (!is_cancelled && !is_rejected
+        && queue_node->admitted_schedule.get() == nullptr) {
+      // If no group was found, stop trying to dequeue.
+      // TODO(IMPALA-2968): Requests further in the queue may be blocked
+      // unnecessarily. Consider a better policy once we have better test scenarios.
+      LogDequeueFailed(queue_node, queue_node->not_admitted_reason);
+      if (coordinator_resource_limited) {
+        // Dequeue failed because of a resource issue that can't be solved by adding
+        // more executor groups. The common reason for this is that we are hitting a
+        // limit on the coordinator.
+        total_dequeue_failed_coordinator_limited_->Increment(1);
+      }
+      break;
+    }
+
+    // At this point we know that the query must be taken off the queue
+    queue.Dequeue();
+    --max_to_dequeue;
+    VLOG(3) << "Dequeueing from stats for pool " << pool_name;
+    stats->Dequeue(false);
+
+    if (is_rejected) {
+      AdmissionOutcome outcome =
+          queue_node->admit_outcome->Set(AdmissionOutcome::REJECTED);
+      if (outcome == AdmissionOutcome::REJECTED) {
+        stats->metrics()->total_rejected->Increment(1);
+        continue; // next query
+      } else {
+        DCHECK_ENUM_EQ(outcome, AdmissionOutcome::CANCELLED);
+        is_cancelled = true;
+      }
+    }
+    DCHECK(is_cancelled || queue_node->admitted_schedule != nullptr);
 
-        DCHECK(queue_node->admit_outcome->IsSet());
-        DCHECK_ENUM_EQ(queue_node->admit_outcome->Get(), AdmissionOutcome::ADMITTED);
-        DCHECK(!is_cancelled);
-        DCHECK(!is_rejected);
-        DCHECK(queue_node->admitted_schedule != nullptr);
-        AdmitQuery(queue_node, true);
+    const UniqueIdPB& query_id = queue_node->admission_request.query_id;
+    if (!is_cancelled) {
+      VLOG_QUERY << "Admitting from queue: query=" << PrintId(query_id);
+      AdmissionOutcome outcome =
+          queue_node->admit_outcome->Set(AdmissionOutcome::ADMITTED);
+      if (outcome != AdmissionOutcome::ADMITTED) {
+        DCHECK_ENUM_EQ(outcome, AdmissionOutcome::CANCELLED);
+        is_cancelled = true;
       }
-      pools_for_updates_.insert(pool_name);
     }
+
+    if (is_cancelled) {
+      VLOG_QUERY << "Dequeued cancelled query=" << PrintId(query_id);
+      continue; // next query
+    }
+
+    DCHECK(queue_node->admit_outcome->IsSet());
+    DCHECK_ENUM_EQ(queue_node->admit_outcome->Get(), AdmissionOutcome::ADMITTED);
+    DCHECK(!is_cancelled);
+    DCHECK(!is_rejected);
+    DCHECK(queue_node->admitted_schedule != nullptr);
+    AdmitQuery(queue_node, true);
   }
+  pools_for_updates_.insert(pool_name);
 }
 
 int64_t AdmissionController::GetQueueTimeoutForPoolMs(const TPoolConfig& pool_config) {
@@ -2210,6 +2342,41 @@ void AdmissionController::AdmitQuery(QueueNode* node, bool was_queued) {
     allocation.slots_to_use = entry.second.exec_params->slots_to_use();
     allocation.mem_to_admit = GetMemToAdmit(*state, entry.second);
   }
+  running_query.plan_fingerprint = node->plan_fingerprint;
+  const TQueryOptions& query_options = state->query_options();
+  if (!query_options.__isset.mem_limit || query_options.mem_limit <= 0) {
+    running_query.estimated_mem_to_admit = state->per_backend_mem_to_admit();
+    running_query.mem_estimate_from_history = state->mem_estimate_from_history() > 0;
+    if (node->plan_fingerprint != 0) {
+      PoolStats* pool_stats = GetPoolStats(*state);
+      if (running_query.mem_estimate_from_history) {
+        pool_stats->metrics()->mem_estimate_history_hits->Increment(1);
+      } else {
+        pool_stats->metrics()->mem_estimate_history_misses->Increment(1);
+      }
+    }
+  }
+  if (running_query.mem_estimate_from_history) {
+    state->summary_profile()->AddInfoString(PROFILE_INFO_KEY_MEM_ESTIMATE_FROM_HISTORY,
+        PrintBytes(state->mem_estimate_from_history()));
+  }
+}
+
+uint64_t AdmissionController::ComputePlanFingerprint(const TQueryExecRequest& request) {
+  ThriftSerializer serializer(/* compact */ true);
+  uint64_t hash = 0;
+  for (const TPlanExecInfo& plan_exec_info : request.plan_exec_info) {
+    for (const TPlanFragment& fragment : plan_exec_info.fragments) {
+      uint8_t* buffer;
+      uint32_t len;
+      // The fingerprint is only a hint, so a fragment that can't be serialized is
+      // ignored.
+      if (!serializer.SerializeToBuffer(&fragment, &len, &buffer).ok()) continue;
+      hash = HashUtil::FastHash64(buffer, len, hash);
+    }
+  }
+  // 0 means that there is no fingerprint.
+  return hash == 0 ? 1 : hash;
 }
 
 string AdmissionController::GetStalenessDetail(const string& prefix,
@@ -2348,6 +2515,14 @@ void AdmissionController::PoolStats::ToJson(
   pool->AddMember("clamp_mem_limit_query_option",
       metrics_.clamp_mem_limit_query_option->GetValue(), document->GetAllocator());
   pool->AddMember("wait_time_ms_ema", wait_time_ms_ema_, document->GetAllocator());
+  pool->AddMember("mem_estimate_history_hits",
+      metrics_.mem_estimate_history_hits->GetValue(), document->GetAllocator());
+  pool->AddMember("mem_estimate_history_misses",
+      metrics_.mem_estimate_history_misses->GetValue(), document->GetAllocator());
+  pool->AddMember("mem_estimate_history_num_plans",
+      mem_estimate_history_.num_fingerprints(), document->GetAllocator());
+  history_estimate_accuracy_.ToJson("history_estimate", pool, document);
+  planner_estimate_accuracy_.ToJson("planner_estimate", pool, document);
   Value histogram(kArrayType);
   for (int bucket = 0; bucket < peak_mem_histogram_.size(); bucket++) {
     Value histogram_elem(kArrayType);
@@ -2358,6 +2533,20 @@ void AdmissionController::PoolStats::ToJson(
   pool->AddMember("peak_mem_usage_histogram", histogram, document->GetAllocator());
 }
 
+void AdmissionController::PoolStats::MemEstimateAccuracy::ToJson(const string& prefix,
+    rapidjson::Value* pool, rapidjson::Document* document) const {
+  using namespace rapidjson;
+  auto add_member = [&](const string& suffix, Value value) {
+    Value name(Substitute("$0_$1", prefix, suffix).c_str(), document->GetAllocator());
+    pool->AddMember(name, value, document->GetAllocator());
+  };
+  add_member("num_queries", Value(num_queries));
+  add_member("num_underestimates", Value(num_underestimates));
+  // The average ratio of memory admitted to peak memory, where 1 is a perfect estimate.
+  add_member("avg_admitted_to_peak_ratio",
+      Value(num_queries == 0 ? 0.0 : sum_admitted_to_peak_ratio / num_queries));
+}
+
 void AdmissionController::ResetPoolInformationalStats(const string& pool_name) {
   lock_guard<mutex> lock(admission_ctrl_lock_);
   auto it = pool_stats_.find(pool_name);
@@ -2373,6 +2562,8 @@ void AdmissionController::ResetAllPoolInformationalStats() {
 void AdmissionController::PoolStats::ResetInformationalStats() {
   std::fill(peak_mem_histogram_.begin(), peak_mem_histogram_.end(), 0);
   wait_time_ms_ema_ = 0.0;
+  history_estimate_accuracy_ = MemEstimateAccuracy();
+  planner_estimate_accuracy_ = MemEstimateAccuracy();
   // Reset only metrics keeping track of totals since last reset.
   metrics()->total_admitted->SetValue(0);
   metrics()->total_rejected->SetValue(0);
@@ -2381,6 +2572,8 @@ void AdmissionController::PoolStats::ResetInformationalStats() {
   metrics()->total_timed_out->SetValue(0);
   metrics()->total_released->SetValue(0);
   metrics()->time_in_queue_ms->SetValue(0);
+  metrics()->mem_estimate_history_hits->SetValue(0);
+  metrics()->mem_estimate_history_misses->SetValue(0);
 }
 
 void AdmissionController::PoolStats::InitMetrics() {
@@ -2398,6 +2591,10 @@ void AdmissionController::PoolStats::InitMetrics() {
       TOTAL_RELEASED_METRIC_KEY_FORMAT, 0, name_);
   metrics_.time_in_queue_ms = parent_->metrics_group_->AddCounter(
       TIME_IN_QUEUE_METRIC_KEY_FORMAT, 0, name_);
+  metrics_.mem_estimate_history_hits = parent_->metrics_group_->AddCounter(
+      MEM_ESTIMATE_HISTORY_HITS_METRIC_KEY_FORMAT, 0, name_);
+  metrics_.mem_estimate_history_misses = parent_->metrics_group_->AddCounter(
+      MEM_ESTIMATE_HISTORY_MISSES_METRIC_KEY_FORMAT, 0, name_);
 
   metrics_.agg_num_running = parent_->metrics_group_->AddGauge(
       AGG_NUM_RUNNING_METRIC_KEY_FORMAT, 0, name_);
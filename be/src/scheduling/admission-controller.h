@@ -30,6 +30,7 @@
 
 #include "common/status.h"
 #include "scheduling/cluster-membership-mgr.h"
+#include "scheduling/mem-estimate-history.h"
 #include "scheduling/request-pool-service.h"
 #include "scheduling/schedule-state.h"
 #include "statestore/statestore-subscriber.h"
@@ -337,6 +338,7 @@ class AdmissionController {
   static const std::string PROFILE_INFO_VAL_INITIAL_QUEUE_REASON;
   static const std::string PROFILE_INFO_KEY_LAST_QUEUED_REASON;
   static const std::string PROFILE_INFO_KEY_ADMITTED_MEM;
+  static const std::string PROFILE_INFO_KEY_MEM_ESTIMATE_FROM_HISTORY;
   static const std::string PROFILE_INFO_KEY_EXECUTOR_GROUP;
   static const std::string PROFILE_INFO_KEY_STALENESS_WARNING;
   static const std::string PROFILE_TIME_SINCE_LAST_UPDATE_COUNTER_NAME;
@@ -502,6 +504,13 @@ class AdmissionController {
   /// decisions. Updated via statestore updates.
   std::unordered_map<std::string, PerHostStats> remote_per_host_stats_;
 
+  /// The per-host sum of 'mem_admitted', 'num_admitted' and 'slots_in_use' over all
+  /// entries of 'remote_per_host_stats_'. Kept up to date incrementally by
+  /// UpdateRemoteHostStats() so that an admission decision looks up a single entry per
+  /// host instead of aggregating the views of all other coordinators. Hosts whose
+  /// counts are all zero have no entry.
+  PerHostStats remote_host_stats_totals_;
+
   /// Counter of the number of times dequeuing a query failed because of a resource
   /// issue on the coordinator (which therefore cannot be resolved by adding more
   /// executor groups).
@@ -521,6 +530,12 @@ class AdmissionController {
       IntCounter* total_released;
       IntCounter* time_in_queue_ms;
 
+      /// Number of queries admitted based on a memory estimate that was found in, or
+      /// missing from, the memory estimate history. Only counted if the history is
+      /// enabled and the query did not set MEM_LIMIT.
+      IntCounter* mem_estimate_history_hits;
+      IntCounter* mem_estimate_history_misses;
+
       /// The following mirror the current values in PoolStats.
       /// TODO: Avoid duplication: replace the int64_t fields on PoolStats with these.
       IntGauge* agg_num_running;
@@ -545,12 +560,7 @@ class AdmissionController {
       BooleanProperty* clamp_mem_limit_query_option;
     };
 
-    PoolStats(AdmissionController* parent, const std::string& name)
-      : name_(name), parent_(parent), agg_num_running_(0), agg_num_queued_(0),
-        agg_mem_reserved_(0), local_mem_admitted_(0), wait_time_ms_ema_(0.0) {
-      peak_mem_histogram_.resize(HISTOGRAM_NUM_OF_BINS, 0);
-      InitMetrics();
-    }
+    PoolStats(AdmissionController* parent, const std::string& name);
 
     int64_t agg_num_running() const { return agg_num_running_; }
     int64_t agg_num_queued() const { return agg_num_queued_; }
@@ -570,6 +580,19 @@ class AdmissionController {
     /// Updates the pool stats when the request represented by 'state is dequeued.
     void Dequeue(bool timed_out);
 
+    // MEMORY ESTIMATE HISTORY METHODS
+    /// Returns the per-backend memory estimate for queries with 'plan_fingerprint'
+    /// derived from the peak memory of previous runs, or -1 if there are not enough of
+    /// them.
+    int64_t GetMemEstimateFromHistory(uint64_t plan_fingerprint);
+    /// Records the per-host peak memory 'peak_mem_consumption' of a released query with
+    /// 'plan_fingerprint' in the history. If 'estimated_mem_to_admit' is not -1, the
+    /// query was admitted with that estimate, which came from the history if
+    /// 'estimate_from_history' is true and from the planner otherwise, and the accuracy
+    /// stats of that source are updated.
+    void RecordPeakMem(uint64_t plan_fingerprint, int64_t estimated_mem_to_admit,
+        bool estimate_from_history, int64_t peak_mem_consumption);
+
     // STATESTORE CALLBACK METHODS
     /// Updates the local_stats_.backend_mem_reserved with the pool mem tracker. Called
     /// before sending local_stats().
@@ -682,6 +705,24 @@ class AdmissionController {
     double wait_time_ms_ema_;
     static const double EMA_MULTIPLIER;
 
+    /// Peak memory of the queries that ran in this pool by plan fingerprint.
+    MemEstimateHistory mem_estimate_history_;
+
+    /// How well the memory admitted for queries matched their actual per-host peak.
+    struct MemEstimateAccuracy {
+      /// Number of released queries with a known peak.
+      int64_t num_queries = 0;
+      /// Number of queries whose peak exceeded the memory admitted for them.
+      int64_t num_underestimates = 0;
+      /// Sum over all queries of the memory admitted divided by the peak.
+      double sum_admitted_to_peak_ratio = 0;
+
+      void ToJson(const std::string& prefix, rapidjson::Value* pool,
+          rapidjson::Document* document) const;
+    };
+    MemEstimateAccuracy history_estimate_accuracy_;
+    MemEstimateAccuracy planner_estimate_accuracy_;
+
     void InitMetrics();
 
     // Return a string about the content of a TPoolStats object.
@@ -698,6 +739,7 @@ class AdmissionController {
     FRIEND_TEST(AdmissionControllerTest, GetMaxToDequeue);
     FRIEND_TEST(AdmissionControllerTest, QueryRejection);
     FRIEND_TEST(AdmissionControllerTest, TopNQueryCheck);
+    FRIEND_TEST(AdmissionControllerTest, MemEstimateFromHistory);
     friend class AdmissionControllerTest;
   };
 
@@ -807,6 +849,10 @@ class AdmissionController {
     /// with most memory consumption and aggregated stats across all pools in that host.
     std::string not_admitted_details;
 
+    /// Fingerprint of the query's plan, used to look up its memory estimate in the
+    /// memory estimate history of its pool. 0 if the history is disabled.
+    uint64_t plan_fingerprint = 0;
+
     /// The Admission outcome of the queued request.
     Promise<AdmissionOutcome, PromiseMode::MULTIPLE_PRODUCER>* const admit_outcome;
 
@@ -855,6 +901,16 @@ class AdmissionController {
     /// Map from backend addresses to the resouces this query was allocated on them. When
     /// backends are released, they are removed from this map.
     std::unordered_map<NetworkAddressPB, BackendAllocation> per_backend_resources;
+
+    /// See QueueNode::plan_fingerprint.
+    uint64_t plan_fingerprint = 0;
+
+    /// The memory admitted per executor if it was derived from an estimate because the
+    /// query did not set MEM_LIMIT, or -1 otherwise.
+    int64_t estimated_mem_to_admit = -1;
+
+    /// True if 'estimated_mem_to_admit' came from the memory estimate history.
+    bool mem_estimate_from_history = false;
   };
 
   /// Map from host id to a map from query id of currently running queries to information
@@ -910,6 +966,13 @@ class AdmissionController {
   /// statestore. Called by UpdatePoolStats(). Must hold admission_ctrl_lock_.
   void HandleTopicUpdates(const std::vector<TTopicItem>& topic_updates);
 
+  /// Replaces the per-host stats received from the coordinator 'coord_id' with the
+  /// entries of 'update' and adjusts 'remote_host_stats_totals_' by the difference.
+  /// Hosts not present in 'update' keep their previous stats. If 'update' is nullptr,
+  /// all stats of 'coord_id' are removed. Must hold admission_ctrl_lock_.
+  void UpdateRemoteHostStats(
+      const std::string& coord_id, const TPerHostStatsUpdate* update);
+
   /// Re-computes the per-pool aggregate stats and the per-host aggregates in host_stats_
   /// using each pool's remote_stats_ and local_stats_.
   /// Called by UpdatePoolStats() after handling updates and deletions.
@@ -937,10 +1000,22 @@ class AdmissionController {
       const TPoolConfig& pool_config, bool admit_from_queue, PoolStats* pool_stats,
       QueueNode* queue_node, bool& coordinator_resource_limited);
 
+  /// Returns a fingerprint of the plan fragments of 'request' that identifies repeated
+  /// runs of the same query. Never returns 0.
+  static uint64_t ComputePlanFingerprint(const TQueryExecRequest& request);
+
   /// Dequeues the queued queries when notified by dequeue_cv_ and admits them if they
-  /// have not been cancelled yet.
+  /// have not been cancelled yet. Each pass admits a batch of queries from one pool at
+  /// a time and releases admission_ctrl_lock_ between pools, so that submissions,
+  /// releases and statestore updates are not blocked for a whole pass when many pools
+  /// have queued queries.
   void DequeueLoop();
 
+  /// Tries to admit up to GetMaxToDequeue() queries from the head of the queue of
+  /// 'pool_name'. Called by DequeueLoop(). Must hold admission_ctrl_lock_.
+  void DequeuePool(const std::string& pool_name,
+      const ClusterMembershipMgr::SnapshotPtr& membership_snapshot);
+
   /// Returns true if schedule can be admitted to the pool with pool_cfg.
   /// admit_from_queue is true if attempting to admit from the queue. Otherwise, returns
   /// false and not_admitted_reason specifies why the request can not be admitted
@@ -1178,7 +1253,10 @@ class AdmissionController {
   FRIEND_TEST(AdmissionControllerTest, QueryRejection);
   FRIEND_TEST(AdmissionControllerTest, DedicatedCoordScheduleState);
   FRIEND_TEST(AdmissionControllerTest, DedicatedCoordAdmissionChecks);
+  FRIEND_TEST(AdmissionControllerTest, MemEstimateFromHistory);
   FRIEND_TEST(AdmissionControllerTest, TopNQueryCheck);
+  FRIEND_TEST(AdmissionControllerTest, RemoteHostStatsTotals);
+  FRIEND_TEST(AdmissionControllerTest, AdmissionStress);
   friend class AdmissionControllerTest;
 };
 
@@ -0,0 +1,66 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "scheduling/mem-estimate-history.h"
+#include "testutil/gtest-util.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+TEST(MemEstimateHistoryTest, Percentile) {
+  MemEstimateHistory history(10, 100);
+  EXPECT_EQ(-1, history.GetEstimate(1, 95, 1));
+  for (int i = 100; i >= 1; --i) history.AddSample(1, i);
+  EXPECT_EQ(95, history.GetEstimate(1, 95, 1));
+  EXPECT_EQ(50, history.GetEstimate(1, 50, 1));
+  EXPECT_EQ(100, history.GetEstimate(1, 100, 1));
+  EXPECT_EQ(1, history.GetEstimate(1, 0, 1));
+  // Other fingerprints are not affected.
+  EXPECT_EQ(-1, history.GetEstimate(2, 95, 1));
+}
+
+TEST(MemEstimateHistoryTest, MinSamples) {
+  MemEstimateHistory history(10, 10);
+  history.AddSample(1, 1000);
+  history.AddSample(1, 2000);
+  EXPECT_EQ(-1, history.GetEstimate(1, 100, 3));
+  history.AddSample(1, 3000);
+  EXPECT_EQ(3000, history.GetEstimate(1, 100, 3));
+}
+
+TEST(MemEstimateHistoryTest, OldSamplesAreReplaced) {
+  MemEstimateHistory history(10, 3);
+  for (int i = 0; i < 3; ++i) history.AddSample(1, 1000);
+  EXPECT_EQ(1000, history.GetEstimate(1, 100, 3));
+  for (int i = 0; i < 3; ++i) history.AddSample(1, 10);
+  EXPECT_EQ(10, history.GetEstimate(1, 100, 3));
+}
+
+TEST(MemEstimateHistoryTest, LruEviction) {
+  MemEstimateHistory history(2, 10);
+  history.AddSample(1, 100);
+  history.AddSample(2, 200);
+  // Using the first fingerprint makes the second one the least recently used.
+  EXPECT_EQ(100, history.GetEstimate(1, 100, 1));
+  history.AddSample(3, 300);
+  EXPECT_EQ(2, history.num_fingerprints());
+  EXPECT_EQ(100, history.GetEstimate(1, 100, 1));
+  EXPECT_EQ(-1, history.GetEstimate(2, 100, 1));
+  EXPECT_EQ(300, history.GetEstimate(3, 100, 1));
+}
+}
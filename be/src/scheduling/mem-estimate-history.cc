@@ -0,0 +1,75 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "scheduling/mem-estimate-history.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "common/logging.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+void MemEstimateHistory::AddSample(uint64_t fingerprint, int64_t peak_mem) {
+  if (max_fingerprints_ <= 0 || max_samples_ <= 0) return;
+  auto it = entries_.find(fingerprint);
+  if (it == entries_.end()) {
+    if (num_fingerprints() >= max_fingerprints_) {
+      auto lru = lru_order_.begin();
+      entries_.erase(lru->second);
+      lru_order_.erase(lru);
+    }
+    it = entries_.emplace(fingerprint, Entry()).first;
+  }
+  Touch(fingerprint, &it->second);
+  Entry& entry = it->second;
+  if (entry.samples.size() < static_cast<size_t>(max_samples_)) {
+    entry.samples.push_back(peak_mem);
+  } else {
+    entry.samples[entry.next_idx] = peak_mem;
+    entry.next_idx = (entry.next_idx + 1) % max_samples_;
+  }
+}
+
+int64_t MemEstimateHistory::GetEstimate(
+    uint64_t fingerprint, double percentile, int min_samples) {
+  DCHECK_GE(percentile, 0);
+  DCHECK_LE(percentile, 100);
+  auto it = entries_.find(fingerprint);
+  if (it == entries_.end()) return -1;
+  Entry& entry = it->second;
+  if (entry.samples.empty() || entry.samples.size() < static_cast<size_t>(min_samples)) {
+    return -1;
+  }
+  Touch(fingerprint, &entry);
+  // Nearest-rank percentile.
+  vector<int64_t> samples = entry.samples;
+  int rank = static_cast<int>(ceil(percentile / 100 * samples.size()));
+  int idx = max(0, min<int>(rank - 1, samples.size() - 1));
+  nth_element(samples.begin(), samples.begin() + idx, samples.end());
+  return samples[idx];
+}
+
+void MemEstimateHistory::Touch(uint64_t fingerprint, Entry* entry) {
+  // A new entry has not been used yet and has no element in 'lru_order_'.
+  if (entry->last_used != 0) lru_order_.erase(entry->last_used);
+  entry->last_used = ++clock_;
+  lru_order_.emplace(entry->last_used, fingerprint);
+}
+}
@@ -0,0 +1,76 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace impala {
+
+/// Keeps the peak per-host memory consumption of recently completed queries, grouped by
+/// a fingerprint of their plan, so that the memory of later runs of the same plan can
+/// be estimated from observed peaks instead of from the planner's estimate.
+///
+/// The memory used is bounded: at most 'max_fingerprints' fingerprints are kept, evicting
+/// the least recently used one, each with its last 'max_samples' peaks.
+///
+/// Not thread-safe.
+class MemEstimateHistory {
+ public:
+  MemEstimateHistory(int max_fingerprints, int max_samples)
+    : max_fingerprints_(max_fingerprints), max_samples_(max_samples) {}
+
+  /// Records that a query with 'fingerprint' had a peak per-host memory consumption of
+  /// 'peak_mem' bytes.
+  void AddSample(uint64_t fingerprint, int64_t peak_mem);
+
+  /// Returns the 'percentile' (in [0, 100]) of the recorded peaks for 'fingerprint', or
+  /// -1 if fewer than 'min_samples' peaks are recorded for it.
+  int64_t GetEstimate(uint64_t fingerprint, double percentile, int min_samples);
+
+  int num_fingerprints() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    /// Ring buffer of the last 'max_samples_' peaks.
+    std::vector<int64_t> samples;
+    /// Index in 'samples' of the next peak to overwrite once it is full.
+    int next_idx = 0;
+    /// The value of 'clock_' when the entry was last used. Its key in 'lru_order_'.
+    uint64_t last_used = 0;
+  };
+
+  /// Marks 'entry' for 'fingerprint' as the most recently used one.
+  void Touch(uint64_t fingerprint, Entry* entry);
+
+  const int max_fingerprints_;
+  const int max_samples_;
+
+  /// Incremented on every use of an entry.
+  uint64_t clock_ = 0;
+
+  /// Map from the time an entry was last used to its fingerprint, so the first element is
+  /// the least recently used one. Unlike list iterators, the keys stay valid when the
+  /// object is copied.
+  std::map<uint64_t, uint64_t> lru_order_;
+
+  std::unordered_map<uint64_t, Entry> entries_;
+};
+}
@@ -273,9 +273,18 @@ void ScheduleState::UpdateMemoryRequirements(const TPoolConfig& pool_cfg) {
     coord_backend_mem_to_admit = use_dedicated_coord_estimates ?
         GetDedicatedCoordMemoryEstimate() :
         GetPerExecutorMemoryEstimate();
+    if (mem_estimate_from_history_ > 0) {
+      // The observed peaks of previous runs replace the planner's estimate. They are
+      // per-host peaks, so they don't tell us anything about a dedicated coordinator.
+      per_backend_mem_to_admit = mem_estimate_from_history_;
+      if (!use_dedicated_coord_estimates) {
+        coord_backend_mem_to_admit = mem_estimate_from_history_;
+      }
+    }
     VLOG(3) << "use_dedicated_coord_estimates=" << use_dedicated_coord_estimates
             << " coord_backend_mem_to_admit=" << coord_backend_mem_to_admit
-            << " per_backend_mem_to_admit=" << per_backend_mem_to_admit;
+            << " per_backend_mem_to_admit=" << per_backend_mem_to_admit
+            << " mem_estimate_from_history=" << mem_estimate_from_history_;
     if (!mimic_old_behaviour) {
       int64_t min_mem_limit_required =
           ReservationUtil::GetMinMemLimitFromReservation(largest_min_reservation());
@@ -268,6 +268,15 @@ class ScheduleState {
     coord_min_reservation_ = coord_min_reservation;
   }
 
+  /// The per-backend memory estimate derived from the peak memory of previous runs of
+  /// the same plan, or -1 if there is none. Set by the admission controller before
+  /// UpdateMemoryRequirements() is called.
+  int64_t mem_estimate_from_history() const { return mem_estimate_from_history_; }
+
+  void set_mem_estimate_from_history(int64_t mem_estimate) {
+    mem_estimate_from_history_ = mem_estimate;
+  }
+
   /// Returns the Cluster wide memory admitted by the admission controller.
   /// Must call UpdateMemoryRequirements() at least once before calling this.
   int64_t GetClusterMemoryToAdmit() const;
@@ -333,6 +342,9 @@ class ScheduleState {
   /// The coordinator's backend memory reservation. Set in Scheduler::Schedule().
   int64_t coord_min_reservation_ = 0;
 
+  /// See mem_estimate_from_history().
+  int64_t mem_estimate_from_history_ = -1;
+
   /// The name of the executor group that this schedule was computed for. Set by the
   /// Scheduler and only valid after scheduling completes successfully.
   std::string executor_group_;
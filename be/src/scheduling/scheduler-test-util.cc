@@ -102,6 +102,7 @@ ClusterMembershipMgr::BeDescSharedPtr BuildBackendDescriptor(const Host& host) {
   be_desc->set_is_coordinator(host.is_coordinator);
   be_desc->set_is_executor(host.is_executor);
   be_desc->set_is_quiescing(false);
+  if (!host.rack.empty()) be_desc->set_rack(host.rack);
   ExecutorGroupDescPB* exec_desc = be_desc->add_executor_groups();
   exec_desc->set_name(ImpalaServer::DEFAULT_EXECUTOR_GROUP_NAME);
   exec_desc->set_min_size(1);
@@ -135,6 +136,11 @@ void Cluster::AddHosts(int num_hosts, bool has_backend, bool has_datanode,
   for (int i = 0; i < num_hosts; ++i) AddHost(has_backend, has_datanode, is_executor);
 }
 
+void Cluster::SetRack(int host_idx, const string& rack) {
+  DCHECK_LT(host_idx, hosts_.size());
+  hosts_[host_idx].rack = rack;
+}
+
 void Cluster::GetBackendAddress(int host_idx, TNetworkAddress* addr) const {
   DCHECK_LT(host_idx, hosts_.size());
   addr->hostname = hosts_[host_idx].ip;
@@ -117,6 +117,7 @@ struct Host {
   int dn_port; // Datanode port
   bool is_coordinator; // True if this is a coordinator host
   bool is_executor; // True if this is an executor host
+  std::string rack; // Rack label of the backend, empty if unknown
 };
 
 /// A cluster stores a list of hosts and provides various methods to add hosts to the
@@ -133,6 +134,9 @@ class Cluster {
   void AddHosts(int num_hosts, bool has_backend, bool has_datanode,
       bool is_executor = true);
 
+  /// Set the rack label of the host with index 'host_idx'.
+  void SetRack(int host_idx, const std::string& rack);
+
   /// Return the backend address (ip, port) for the host with index 'host_idx'.
   void GetBackendAddress(int host_idx, TNetworkAddress* addr) const;
 
@@ -21,14 +21,25 @@
 #include "common/logging.h"
 #include "gen-cpp/control_service.pb.h"
 #include "scheduling/cluster-membership-mgr.h"
+#include "scheduling/cluster-membership-test-util.h"
 #include "scheduling/scheduler.h"
 #include "scheduling/scheduler-test-util.h"
+#include "service/impala-server.h"
 #include "testutil/gtest-util.h"
 #include "testutil/rand-util.h"
+#include "util/metrics.h"
+
+#include "common/names.h"
 
 using namespace impala;
 using namespace impala::test;
 
+DECLARE_int32(scheduler_parallel_assignment_threshold);
+DECLARE_int32(scheduler_assignment_threads);
+DECLARE_int64(scheduler_assignment_reuse_window_ms);
+DECLARE_bool(scheduler_rack_aware_remote_reads);
+DECLARE_string(scheduler_host_racks);
+
 namespace impala {
 
 class SchedulerTest : public testing::Test {
@@ -470,6 +481,94 @@ TEST_F(SchedulerTest, ManyScanRanges) {
   EXPECT_LE(result.MaxNumAssignedBytesPerHost(), 140 * Block::DEFAULT_BLOCK_SIZE);
 }
 
+/// Expects that 'a' and 'b' assign the same scan ranges to the same hosts in the same
+/// order.
+static void ExpectSameAssignment(
+    const FragmentScanRangeAssignment& a, const FragmentScanRangeAssignment& b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (const auto& host_entry : a) {
+    auto b_host_it = b.find(host_entry.first);
+    ASSERT_TRUE(b_host_it != b.end()) << host_entry.first.DebugString();
+    ASSERT_EQ(host_entry.second.size(), b_host_it->second.size());
+    for (const auto& node_entry : host_entry.second) {
+      auto b_node_it = b_host_it->second.find(node_entry.first);
+      ASSERT_TRUE(b_node_it != b_host_it->second.end());
+      const vector<ScanRangeParamsPB>& ranges = node_entry.second;
+      ASSERT_EQ(ranges.size(), b_node_it->second.size());
+      for (int i = 0; i < ranges.size(); ++i) {
+        EXPECT_EQ(
+            ranges[i].SerializeAsString(), b_node_it->second[i].SerializeAsString());
+      }
+    }
+  }
+}
+
+/// Verify that assigning scan ranges on multiple threads results in the same assignment
+/// as assigning them on a single thread, for local and remote reads.
+TEST_F(SchedulerTest, ParallelAssignmentMatchesSerial) {
+  gflags::FlagSaver saver;
+  Cluster cluster;
+  for (int i = 0; i < 20; ++i) cluster.AddHost(i < 10, true);
+
+  Schema schema(cluster);
+  schema.AddMultiBlockTable("T", 2000, ReplicaPlacement::RANDOM, 3);
+
+  for (int num_remote_executor_candidates : {0, 3}) {
+    Plan plan(schema);
+    plan.AddTableScan("T");
+    plan.SetNumRemoteExecutorCandidates(num_remote_executor_candidates);
+    SchedulerWrapper scheduler(plan);
+
+    Result serial_result(plan);
+    FLAGS_scheduler_parallel_assignment_threshold = 0;
+    srand(0);
+    ASSERT_OK(scheduler.Compute(&serial_result));
+    EXPECT_EQ(2000, serial_result.NumTotalAssignments());
+    EXPECT_GT(serial_result.NumRemoteAssignments(), 0);
+
+    Result parallel_result(plan);
+    FLAGS_scheduler_parallel_assignment_threshold = 1;
+    FLAGS_scheduler_assignment_threads = 4;
+    srand(0);
+    ASSERT_OK(scheduler.Compute(&parallel_result));
+    ExpectSameAssignment(serial_result.GetAssignment(), parallel_result.GetAssignment());
+  }
+}
+
+/// Verify that the assignment of a plan node is reused for identical plan nodes within
+/// the reuse window, but not once an executor is gone.
+TEST_F(SchedulerTest, ReuseAssignment) {
+  gflags::FlagSaver saver;
+  FLAGS_scheduler_parallel_assignment_threshold = 1;
+  FLAGS_scheduler_assignment_reuse_window_ms = 60 * 1000;
+  Cluster cluster;
+  for (int i = 0; i < 20; ++i) cluster.AddHost(i < 10, true);
+
+  Schema schema(cluster);
+  schema.AddMultiBlockTable("T", 100, ReplicaPlacement::RANDOM, 3);
+
+  Plan plan(schema);
+  plan.AddTableScan("T");
+
+  Result result(plan);
+  SchedulerWrapper scheduler(plan);
+  srand(0);
+  ASSERT_OK(scheduler.Compute(&result));
+  // Remote reads are assigned in a random order, which may differ for the second plan
+  // node, but the earlier assignment is reused.
+  srand(1);
+  ASSERT_OK(scheduler.Compute(&result));
+  ExpectSameAssignment(result.GetAssignment(0), result.GetAssignment(1));
+
+  // Host 1 ran scan ranges of the earlier assignment, which must not be reused.
+  EXPECT_GT(result.NumTotalAssignments(1), 0);
+  scheduler.RemoveBackend(cluster.hosts()[1]);
+  result.Reset();
+  ASSERT_OK(scheduler.Compute(&result));
+  EXPECT_EQ(100, result.NumTotalAssignments());
+  EXPECT_EQ(0, result.NumTotalAssignments(1));
+}
+
 /// Compute a schedule in a split cluster (disjoint set of backends and datanodes).
 TEST_F(SchedulerTest, DisjointClusterWithRemoteReads) {
   Cluster cluster;
@@ -491,6 +590,119 @@ TEST_F(SchedulerTest, DisjointClusterWithRemoteReads) {
   for (int i = 10; i < 20; ++i) EXPECT_EQ(0, result.NumTotalAssignments(i));
 }
 
+/// Verify that remote reads are assigned to the executors in the racks of their replicas
+/// and are balanced across them.
+TEST_F(SchedulerTest, RackLocalRemoteReads) {
+  gflags::FlagSaver saver;
+  // Assignments are reused between plan nodes, which must not hide changes to the rack
+  // awareness.
+  FLAGS_scheduler_parallel_assignment_threshold = 1;
+  FLAGS_scheduler_assignment_reuse_window_ms = 60 * 1000;
+  Cluster cluster;
+  // Hosts 0-5 run executors in two racks, host 6 stores the replicas in the first rack.
+  cluster.AddHosts(6, true, false);
+  cluster.AddHost(false, true);
+  for (int i = 0; i < 6; ++i) cluster.SetRack(i, i < 3 ? "rack1" : "rack2");
+  FLAGS_scheduler_host_racks = Substitute("$0:rack1", cluster.hosts()[6].ip);
+
+  Schema schema(cluster);
+  schema.AddMultiBlockTable("T1", 30, ReplicaPlacement::REMOTE_ONLY, 1);
+
+  Plan plan(schema);
+  plan.AddTableScan("T1");
+  plan.SetNumRemoteExecutorCandidates(0);
+
+  Result result(plan);
+  SchedulerWrapper scheduler(plan);
+  ASSERT_OK(scheduler.Compute(&result));
+  EXPECT_EQ(30, result.NumRemoteAssignments());
+  for (int i = 0; i < 3; ++i) EXPECT_EQ(10, result.NumTotalAssignments(i));
+  for (int i = 3; i < 7; ++i) EXPECT_EQ(0, result.NumTotalAssignments(i));
+
+  // The consistent remote executor candidates are narrowed to the rack-local ones.
+  plan.SetNumRemoteExecutorCandidates(6);
+  result.Reset();
+  ASSERT_OK(scheduler.Compute(&result));
+  EXPECT_EQ(30, result.NumRemoteAssignments());
+  for (int i = 3; i < 7; ++i) EXPECT_EQ(0, result.NumTotalAssignments(i));
+
+  // Without rack awareness the reads are spread evenly over all executors.
+  plan.SetNumRemoteExecutorCandidates(0);
+  FLAGS_scheduler_rack_aware_remote_reads = false;
+  result.Reset();
+  ASSERT_OK(scheduler.Compute(&result));
+  for (int i = 0; i < 6; ++i) EXPECT_EQ(5, result.NumTotalAssignments(i));
+
+  // A plan node that asks for remote reads spreads them evenly over all executors, too.
+  FLAGS_scheduler_rack_aware_remote_reads = true;
+  plan.SetReplicaPreference(TReplicaPreference::REMOTE);
+  result.Reset();
+  ASSERT_OK(scheduler.Compute(&result));
+  for (int i = 0; i < 6; ++i) EXPECT_EQ(5, result.NumTotalAssignments(i));
+}
+
+/// Verify that remote reads of replicas in an unknown rack, or in a rack without
+/// executors, are spread over all executors.
+TEST_F(SchedulerTest, RackLocalRemoteReadsUnknownRack) {
+  gflags::FlagSaver saver;
+  Cluster cluster;
+  cluster.AddHosts(6, true, false);
+  cluster.AddHosts(2, false, true);
+  for (int i = 0; i < 6; ++i) cluster.SetRack(i, i < 3 ? "rack1" : "rack2");
+  // Host 7 is not listed, malformed entries are ignored.
+  FLAGS_scheduler_host_racks =
+      Substitute("$0:rack3,:rack1,$1:", cluster.hosts()[6].ip, cluster.hosts()[7].ip);
+
+  Schema schema(cluster);
+  schema.AddMultiBlockTable("T1", 30, ReplicaPlacement::REMOTE_ONLY, 1);
+
+  Plan plan(schema);
+  plan.AddTableScan("T1");
+  plan.SetNumRemoteExecutorCandidates(0);
+
+  Result result(plan);
+  SchedulerWrapper scheduler(plan);
+  ASSERT_OK(scheduler.Compute(&result));
+  EXPECT_EQ(30, result.NumRemoteAssignments());
+  for (int i = 0; i < 6; ++i) EXPECT_EQ(5, result.NumTotalAssignments(i));
+}
+
+/// Verify that interior unpartitioned fragments are placed on an input instance in the
+/// rack of the coordinator if there is one.
+TEST_F(SchedulerTest, InteriorFragmentPrefersCoordinatorRack) {
+  MetricGroup metrics("scheduler-test");
+  Scheduler scheduler(&metrics, nullptr);
+  ExecutorGroup group(ImpalaServer::DEFAULT_EXECUTOR_GROUP_NAME);
+  vector<NetworkAddressPB> input_hosts;
+  for (int i = 0; i < 6; ++i) {
+    BackendDescriptorPB be_desc = MakeBackendDescriptor(i);
+    be_desc.set_rack(i < 2 ? "rack1" : "rack2");
+    group.AddExecutor(be_desc);
+    input_hosts.push_back(be_desc.address());
+  }
+  BackendDescriptorPB coord_desc = MakeBackendDescriptor(6);
+  coord_desc.set_rack("rack1");
+  Scheduler::ExecutorConfig executor_config = {group, coord_desc};
+  set<int> selected;
+  for (int i = 0; i < 100; ++i) {
+    selected.insert(
+        scheduler.SelectInteriorFragmentInput(executor_config, input_hosts, &rng_));
+  }
+  EXPECT_EQ(set<int>({0, 1}), selected);
+
+  // Without input instances in the coordinator's rack, any instance may be selected.
+  // The chance that one of them is not selected 200 times is negligible.
+  for (const string& coord_rack : {"rack3", ""}) {
+    coord_desc.set_rack(coord_rack);
+    selected.clear();
+    for (int i = 0; i < 200; ++i) {
+      selected.insert(
+          scheduler.SelectInteriorFragmentInput(executor_config, input_hosts, &rng_));
+    }
+    EXPECT_EQ(6, selected.size()) << coord_rack;
+  }
+}
+
 /// Verify that cached replicas take precedence.
 TEST_F(SchedulerTest, TestCachedReadPreferred) {
   Cluster cluster;
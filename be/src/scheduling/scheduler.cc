@@ -19,11 +19,14 @@
 
 #include <stdlib.h>
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <limits>
 #include <random>
 #include <unordered_map>
 #include <vector>
 #include <boost/unordered_set.hpp>
+#include <gutil/strings/split.h>
 #include <gutil/strings/substitute.h>
 
 #include "common/logging.h"
@@ -45,6 +48,8 @@
 #include "util/network-util.h"
 #include "util/pretty-printer.h"
 #include "util/runtime-profile-counters.h"
+#include "util/thread.h"
+#include "util/time.h"
 #include "util/uid-util.h"
 
 #include "common/names.h"
@@ -55,11 +60,38 @@ using namespace apache::thrift;
 using namespace org::apache::impala::fb;
 using namespace strings;
 
+DEFINE_int32(scheduler_parallel_assignment_threshold, 100000, "(Advanced) Plan nodes "
+    "with at least this many scan ranges prepare and build their scan range assignment "
+    "on up to --scheduler_assignment_threads threads. Executors are still selected in "
+    "the same order, so the assignment does not depend on the number of threads. "
+    "0 disables parallel assignment.");
+DEFINE_int32(scheduler_assignment_threads, 8, "(Advanced) Maximum number of threads "
+    "used to assign the scan ranges of a single plan node, see "
+    "--scheduler_parallel_assignment_threshold.");
+DEFINE_int64(scheduler_assignment_reuse_window_ms, 0, "(Advanced) If greater than 0, "
+    "plan nodes with at least --scheduler_parallel_assignment_threshold scan ranges "
+    "reuse the executors selected for an identical plan node, i.e. one with the same "
+    "scan ranges, replicas, executors and scheduling options, that was scheduled at "
+    "most this many milliseconds earlier. Plan nodes that schedule replicas randomly "
+    "never reuse assignments.");
+DEFINE_bool(scheduler_rack_aware_remote_reads, true, "If true, scan ranges that are "
+    "read remotely are assigned to executors in the racks of their replicas if the "
+    "racks of the replica hosts are known. The rack of a host is the --rack label of the "
+    "executor on it, or else its entry in --scheduler_host_racks. Has no effect if no "
+    "executor has a --rack label or if REPLICA_PREFERENCE is REMOTE, which spreads the "
+    "scan ranges evenly over all executors.");
+DEFINE_string(scheduler_host_racks, "", "Comma-separated list of <host>:<rack> pairs "
+    "with the racks of the storage hosts that don't run an executor, e.g. "
+    "'dn1.example.com:rack1,dn2.example.com:rack2'. The hosts must be named like in the "
+    "block locations of the table metadata. Used to keep remote reads rack-local, see "
+    "--scheduler_rack_aware_remote_reads.");
+
 namespace impala {
 
 static const string LOCAL_ASSIGNMENTS_KEY("simple-scheduler.local-assignments.total");
 static const string ASSIGNMENTS_KEY("simple-scheduler.assignments.total");
 static const string SCHEDULER_INIT_KEY("simple-scheduler.initialized");
+static const string REUSED_ASSIGNMENTS_KEY("simple-scheduler.reused-assignments.total");
 
 static const vector<TPlanNodeType::type> SCAN_NODE_TYPES{TPlanNodeType::HDFS_SCAN_NODE,
     TPlanNodeType::HBASE_SCAN_NODE, TPlanNodeType::DATA_SOURCE_NODE,
@@ -75,6 +107,116 @@ static const vector<TPlanNodeType::type> SCAN_NODE_TYPES{TPlanNodeType::HDFS_SCA
 // candidates. See GetRemoteExecutorCandidates() for a deeper description.
 static const int MAX_ITERATIONS_PER_EXECUTOR_CANDIDATE = 8;
 
+// Maximum number of selections kept for reuse. Only plan nodes with many scan ranges are
+// kept, so this bounds the memory held by the scheduler.
+static const int MAX_REUSABLE_SELECTIONS = 16;
+
+// Calls 'fn(begin, end)' for consecutive chunks of [0, num_items). If 'num_items' is at
+// least FLAGS_scheduler_parallel_assignment_threshold, the chunks are processed by up to
+// FLAGS_scheduler_assignment_threads threads, including the calling one. Otherwise 'fn'
+// is called once on the calling thread. 'fn' must be safe to call concurrently for
+// disjoint chunks.
+static void ForEachChunk(
+    int64_t num_items, const std::function<void(int64_t, int64_t)>& fn) {
+  int num_threads = 1;
+  if (FLAGS_scheduler_parallel_assignment_threshold > 0
+      && num_items >= FLAGS_scheduler_parallel_assignment_threshold) {
+    num_threads = max(1, FLAGS_scheduler_assignment_threads);
+  }
+  if (num_threads == 1 || num_items == 0) {
+    fn(0, num_items);
+    return;
+  }
+  const int64_t chunk_size = (num_items + num_threads - 1) / num_threads;
+  ThreadGroup threads;
+  for (int64_t begin = chunk_size; begin < num_items; begin += chunk_size) {
+    const int64_t end = min(num_items, begin + chunk_size);
+    unique_ptr<Thread> thread;
+    Status status = Thread::Create("scheduler",
+        Substitute("assign-scan-ranges-$0", begin / chunk_size),
+        [&fn, begin, end]() { fn(begin, end); }, &thread);
+    if (status.ok()) {
+      threads.AddThread(move(thread));
+    } else {
+      // Not being able to create a thread only makes the assignment slower.
+      LOG(WARNING) << "Could not create scan range assignment thread: "
+                   << status.GetDetail();
+      fn(begin, end);
+    }
+  }
+  fn(0, chunk_size);
+  threads.JoinAll();
+}
+
+// Returns the number of bytes a scan range is accounted for when balancing assignments.
+static int64_t GetScanRangeLength(const TScanRange& scan_range) {
+  if (scan_range.__isset.hdfs_file_split) return scan_range.hdfs_file_split.length;
+  // Hack so that kudu ranges are well distributed.
+  // TODO: KUDU-1133 Use the tablet size instead.
+  if (scan_range.__isset.kudu_scan_token) return 1000;
+  return 0;
+}
+
+void TScanRangeToScanRangePB(const TScanRange& tscan_range, ScanRangePB* scan_range_pb) {
+  if (tscan_range.__isset.hdfs_file_split) {
+    HdfsFileSplitPB* hdfs_file_split = scan_range_pb->mutable_hdfs_file_split();
+    hdfs_file_split->set_relative_path(tscan_range.hdfs_file_split.relative_path);
+    hdfs_file_split->set_offset(tscan_range.hdfs_file_split.offset);
+    hdfs_file_split->set_length(tscan_range.hdfs_file_split.length);
+    hdfs_file_split->set_partition_id(tscan_range.hdfs_file_split.partition_id);
+    hdfs_file_split->set_file_length(tscan_range.hdfs_file_split.file_length);
+    hdfs_file_split->set_file_compression(
+        THdfsCompressionToProto(tscan_range.hdfs_file_split.file_compression));
+    hdfs_file_split->set_mtime(tscan_range.hdfs_file_split.mtime);
+    hdfs_file_split->set_partition_path_hash(
+        tscan_range.hdfs_file_split.partition_path_hash);
+  }
+  if (tscan_range.__isset.hbase_key_range) {
+    HBaseKeyRangePB* hbase_key_range = scan_range_pb->mutable_hbase_key_range();
+    hbase_key_range->set_startkey(tscan_range.hbase_key_range.startKey);
+    hbase_key_range->set_stopkey(tscan_range.hbase_key_range.stopKey);
+  }
+  if (tscan_range.__isset.kudu_scan_token) {
+    scan_range_pb->set_kudu_scan_token(tscan_range.kudu_scan_token);
+  }
+  if (tscan_range.__isset.file_metadata) {
+    scan_range_pb->set_file_metadata(tscan_range.file_metadata);
+  }
+}
+
+template <typename T>
+static uint64_t HashValue(const T& value, uint64_t seed) {
+  return HashUtil::FastHash64(&value, sizeof(value), seed);
+}
+
+static uint64_t HashString(const string& value, uint64_t seed) {
+  return HashUtil::FastHash64(value.data(), value.size(), seed);
+}
+
+// Returns a hash of the inputs of the executor selection for a plan node other than its
+// scan ranges. 'replica_racks' holds the rack of each host in 'host_list', or is empty if
+// remote reads are not rack-aware.
+static uint64_t HashSelectionOptions(const ExecutorGroup& executor_group,
+    const vector<TNetworkAddress>& host_list, const vector<string>& replica_racks,
+    bool exec_at_coord, TReplicaPreference::type base_distance,
+    int num_remote_executor_candidates) {
+  uint64_t hash = HashValue(exec_at_coord, 0);
+  hash = HashValue(base_distance, hash);
+  hash = HashValue(num_remote_executor_candidates, hash);
+  hash = HashValue(FLAGS_scheduler_rack_aware_remote_reads, hash);
+  for (const TNetworkAddress& host : host_list) hash = HashString(host.hostname, hash);
+  for (const string& rack : replica_racks) hash = HashString(rack, hash);
+  // The order of the executors in the group is not defined, so their hashes are summed.
+  uint64_t executors_hash = 0;
+  for (const BackendDescriptorPB& executor : executor_group.GetAllExecutorDescriptors()) {
+    uint64_t executor_hash = HashString(executor.address().hostname(), 0);
+    executor_hash = HashValue(executor.address().port(), executor_hash);
+    executor_hash = HashString(executor.rack(), executor_hash);
+    executors_hash += HashString(executor.ip_address(), executor_hash);
+  }
+  return HashValue(executors_hash, hash);
+}
+
 Scheduler::Scheduler(MetricGroup* metrics, RequestPoolService* request_pool_service)
   : metrics_(metrics->GetOrCreateChildGroup("scheduler")),
     request_pool_service_(request_pool_service) {
@@ -82,8 +224,22 @@ Scheduler::Scheduler(MetricGroup* metrics, RequestPoolService* request_pool_serv
   if (metrics_ != nullptr) {
     total_assignments_ = metrics_->AddCounter(ASSIGNMENTS_KEY, 0);
     total_local_assignments_ = metrics_->AddCounter(LOCAL_ASSIGNMENTS_KEY, 0);
+    total_reused_assignments_ = metrics_->AddCounter(REUSED_ASSIGNMENTS_KEY, 0);
     initialized_ = metrics_->AddProperty(SCHEDULER_INIT_KEY, true);
   }
+  // Hosts and racks are separated by ':'. Malformed entries are skipped, since they only
+  // make remote reads of the host's replicas cross racks.
+  for (const StringPiece& entry :
+      strings::Split(FLAGS_scheduler_host_racks, ",", strings::SkipEmpty())) {
+    size_t colon_idx = entry.find_first_of(':');
+    if (colon_idx == StringPiece::npos || colon_idx == 0
+        || colon_idx == entry.size() - 1) {
+      LOG(WARNING) << "Ignoring invalid entry in --scheduler_host_racks: " << entry;
+      continue;
+    }
+    host_racks_[entry.substr(0, colon_idx).as_string()] =
+        entry.substr(colon_idx + 1).as_string();
+  }
 }
 
 const BackendDescriptorPB& Scheduler::LookUpBackendDesc(
@@ -99,6 +255,24 @@ const BackendDescriptorPB& Scheduler::LookUpBackendDesc(
   return *desc;
 }
 
+int Scheduler::SelectInteriorFragmentInput(const ExecutorConfig& executor_config,
+    const vector<NetworkAddressPB>& input_hosts, std::mt19937* rng) {
+  DCHECK(!input_hosts.empty());
+  const string& coord_rack = executor_config.coord_desc.rack();
+  vector<int> rack_local_idxs;
+  if (!coord_rack.empty()) {
+    for (int i = 0; i < input_hosts.size(); ++i) {
+      if (LookUpBackendDesc(executor_config, input_hosts[i]).rack() == coord_rack) {
+        rack_local_idxs.push_back(i);
+      }
+    }
+  }
+  int num_candidates =
+      rack_local_idxs.empty() ? input_hosts.size() : rack_local_idxs.size();
+  int idx = std::uniform_int_distribution<int>(0, num_candidates - 1)(*rng);
+  return rack_local_idxs.empty() ? idx : rack_local_idxs[idx];
+}
+
 NetworkAddressPB Scheduler::LookUpKrpcHost(
     const ExecutorConfig& executor_config, const NetworkAddressPB& backend_host) {
   const BackendDescriptorPB& backend_descriptor =
@@ -237,6 +411,7 @@ void Scheduler::ComputeFragmentExecParams(
         DCHECK(desc.has_krpc_address());
         DCHECK(IsResolvedAddress(desc.krpc_address()));
         *dest->mutable_krpc_backend() = desc.krpc_address();
+        if (desc.has_rack()) dest->set_rack(desc.rack());
       }
 
       // enumerate senders consecutively;
@@ -294,12 +469,17 @@ void Scheduler::ComputeFragmentExecParams(const ExecutorConfig& executor_config,
       krpc_host = coord_desc.krpc_address();
     } else if (fragment_state->exchange_input_fragments.size() > 0) {
       // Interior unpartitioned fragments can be scheduled on an arbitrary executor.
-      // Pick a random instance from the first input fragment.
+      // Pick an instance from the first input fragment.
       const FragmentScheduleState& input_fragment_state =
           *state->GetFragmentScheduleState(fragment_state->exchange_input_fragments[0]);
-      int num_input_instances = input_fragment_state.instance_states.size();
+      vector<NetworkAddressPB> input_hosts;
+      input_hosts.reserve(input_fragment_state.instance_states.size());
+      for (const FInstanceScheduleState& instance :
+          input_fragment_state.instance_states) {
+        input_hosts.push_back(instance.host);
+      }
       int instance_idx =
-          std::uniform_int_distribution<int>(0, num_input_instances - 1)(*state->rng());
+          SelectInteriorFragmentInput(executor_config, input_hosts, state->rng());
       host = input_fragment_state.instance_states[instance_idx].host;
       krpc_host = input_fragment_state.instance_states[instance_idx].krpc_host;
     } else {
@@ -642,35 +822,72 @@ Status Scheduler::ComputeScanRangeAssignment(const ExecutorConfig& executor_conf
   const BackendDescriptorPB& coord_desc = executor_config.coord_desc;
   coord_only_executor_group.AddExecutor(coord_desc);
   VLOG_ROW << "Exec at coord is " << (exec_at_coord ? "true" : "false");
-  AssignmentCtx assignment_ctx(exec_at_coord ? coord_only_executor_group : executor_group,
-      total_assignments_, total_local_assignments_, rng);
+  const ExecutorGroup& assignment_group =
+      exec_at_coord ? coord_only_executor_group : executor_group;
+  const vector<IpAddr> replica_ips = ResolveReplicaHosts(assignment_group, host_list);
+  int num_remote_executor_candidates =
+      min(query_options.num_remote_executor_candidates, executor_group.NumExecutors());
+  // Remote reads are kept in the racks of their replicas unless the plan asks for remote
+  // reads, in which case they are spread evenly over all executors.
+  vector<string> replica_racks;
+  if (FLAGS_scheduler_rack_aware_remote_reads && !exec_at_coord
+      && base_distance < TReplicaPreference::REMOTE) {
+    replica_racks = ResolveReplicaRacks(assignment_group, host_list, replica_ips);
+  }
+
+  // Large plan nodes can reuse the executors selected for an identical plan node. With
+  // random replicas the selection is meant to differ between plan nodes.
+  bool reuse_selection = FLAGS_scheduler_assignment_reuse_window_ms > 0
+      && FLAGS_scheduler_parallel_assignment_threshold > 0
+      && locations.size() >= FLAGS_scheduler_parallel_assignment_threshold
+      && !random_replica;
+  uint64_t fingerprint = 0;
+  if (reuse_selection) {
+    fingerprint = ComputeSelectionFingerprint(
+        HashSelectionOptions(assignment_group, host_list, replica_racks, exec_at_coord,
+            base_distance, num_remote_executor_candidates),
+        locations);
+    shared_ptr<const ScanRangeSelection> selection =
+        LookUpReusableSelection(fingerprint, locations.size(), assignment_group);
+    if (selection != nullptr) {
+      VLOG_QUERY << "Reusing the scan range assignment of an identical plan node for "
+                 << "node_id=" << node_id;
+      if (total_reused_assignments_ != nullptr) {
+        total_reused_assignments_->Increment(selection->ranges.size());
+      }
+      MaterializeScanRangeAssignment(
+          *selection, node_id, locations, replica_ips, assignment);
+      return Status::OK();
+    }
+  }
 
-  // Holds scan ranges that must be assigned for remote reads.
-  vector<const TScanRangeLocationList*> remote_scan_range_locations;
+  AssignmentCtx assignment_ctx(assignment_group, rng);
+  assignment_ctx.selection()->ranges.reserve(locations.size());
+
+  // Holds the indexes of scan ranges that must be assigned for remote reads.
+  vector<int> remote_scan_range_idxs;
 
   // Loop over all scan ranges, select an executor for those with local impalads and
   // collect all others for later processing.
-  for (const TScanRangeLocationList& scan_range_locations : locations) {
+  for (int i = 0; i < locations.size(); ++i) {
+    const TScanRangeLocationList& scan_range_locations = locations[i];
     TReplicaPreference::type min_distance = TReplicaPreference::REMOTE;
 
     // Select executor for the current scan range.
     if (exec_at_coord) {
       DCHECK(assignment_ctx.executor_group().LookUpExecutorIp(
           coord_desc.address().hostname(), nullptr));
-      assignment_ctx.RecordScanRangeAssignment(
-          coord_desc, node_id, host_list, scan_range_locations, assignment);
+      assignment_ctx.RecordScanRangeAssignment(coord_desc, i, scan_range_locations);
     } else {
       // Collect executor candidates with smallest memory distance.
       vector<IpAddr> executor_candidates;
       if (base_distance < TReplicaPreference::REMOTE) {
         for (const TScanRangeLocation& location : scan_range_locations.locations) {
-          const TNetworkAddress& replica_host = host_list[location.host_idx];
           // Determine the adjusted memory distance to the closest executor for the
           // replica host.
           TReplicaPreference::type memory_distance = TReplicaPreference::REMOTE;
-          IpAddr executor_ip;
-          bool has_local_executor = assignment_ctx.executor_group().LookUpExecutorIp(
-              replica_host.hostname, &executor_ip);
+          const IpAddr& executor_ip = replica_ips[location.host_idx];
+          bool has_local_executor = !executor_ip.empty();
           if (has_local_executor) {
             if (location.is_cached) {
               memory_distance = TReplicaPreference::CACHE_LOCAL;
@@ -707,7 +924,7 @@ Status Scheduler::ComputeScanRangeAssignment(const ExecutorConfig& executor_conf
       bool local_executor = min_distance != TReplicaPreference::REMOTE;
 
       if (!local_executor) {
-        remote_scan_range_locations.push_back(&scan_range_locations);
+        remote_scan_range_idxs.push_back(i);
         continue;
       }
       // For local reads we want to break ties by executor rank in these cases:
@@ -719,48 +936,285 @@ Status Scheduler::ComputeScanRangeAssignment(const ExecutorConfig& executor_conf
       const IpAddr* executor_ip = nullptr;
       executor_ip = assignment_ctx.SelectExecutorFromCandidates(
           executor_candidates, decide_local_assignment_by_rank);
-      BackendDescriptorPB executor;
-      assignment_ctx.SelectExecutorOnHost(*executor_ip, &executor);
-      assignment_ctx.RecordScanRangeAssignment(
-          executor, node_id, host_list, scan_range_locations, assignment);
+      const BackendDescriptorPB* executor =
+          assignment_ctx.SelectExecutorOnHost(*executor_ip);
+      assignment_ctx.RecordScanRangeAssignment(*executor, i, scan_range_locations);
     } // End of executor selection.
   } // End of for loop over scan ranges.
 
-  // Assign remote scans to executors.
-  int num_remote_executor_candidates =
-      min(query_options.num_remote_executor_candidates, executor_group.NumExecutors());
-  for (const TScanRangeLocationList* scan_range_locations : remote_scan_range_locations) {
+  // Limit the number of remote executor candidates:
+  // 1. When enabled by setting 'num_remote_executor_candidates' > 0
+  // AND
+  // 2. This is an HDFS file split
+  // Otherwise, fall back to the normal method of selecting executors for remote
+  // ranges, which allows for execution on any backend.
+  // The candidates only depend on the file split, so they are computed up front.
+  vector<vector<IpAddr>> remote_executor_candidates;
+  if (num_remote_executor_candidates > 0) {
+    remote_executor_candidates.resize(remote_scan_range_idxs.size());
+    ForEachChunk(remote_scan_range_idxs.size(), [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const TScanRange& scan_range = locations[remote_scan_range_idxs[i]].scan_range;
+        if (!scan_range.__isset.hdfs_file_split) continue;
+        assignment_ctx.GetRemoteExecutorCandidates(&scan_range.hdfs_file_split,
+            num_remote_executor_candidates, &remote_executor_candidates[i]);
+      }
+    });
+  }
+
+  // Assign remote scans to executors. If the racks of the replicas are known, the
+  // executors in those racks are preferred so that the reads do not cross racks. The
+  // reads are balanced across the executors of those racks.
+  bool rack_aware = !replica_racks.empty() && assignment_ctx.HasRacks();
+  vector<IpAddr> rack_local_executors;
+  vector<IpAddr> rack_local_candidates;
+  for (int i = 0; i < remote_scan_range_idxs.size(); ++i) {
     DCHECK(!exec_at_coord);
+    const TScanRangeLocationList& scan_range_locations =
+        locations[remote_scan_range_idxs[i]];
+    rack_local_executors.clear();
+    if (rack_aware) {
+      assignment_ctx.GetRackLocalExecutors(
+          scan_range_locations, replica_racks, &rack_local_executors);
+    }
     const IpAddr* executor_ip;
-    vector<IpAddr> remote_executor_candidates;
-    // Limit the number of remote executor candidates:
-    // 1. When enabled by setting 'num_remote_executor_candidates' > 0
-    // AND
-    // 2. This is an HDFS file split
-    // Otherwise, fall back to the normal method of selecting executors for remote
-    // ranges, which allows for execution on any backend.
-    if (scan_range_locations->scan_range.__isset.hdfs_file_split &&
+    if (scan_range_locations.scan_range.__isset.hdfs_file_split &&
         num_remote_executor_candidates > 0) {
-      assignment_ctx.GetRemoteExecutorCandidates(
-          &scan_range_locations->scan_range.hdfs_file_split,
-          num_remote_executor_candidates, &remote_executor_candidates);
+      const vector<IpAddr>* candidates = &remote_executor_candidates[i];
+      if (!rack_local_executors.empty()) {
+        // Keep the consistent candidates that are rack-local, if there are any.
+        rack_local_candidates.clear();
+        for (const IpAddr& ip : *candidates) {
+          if (find(rack_local_executors.begin(), rack_local_executors.end(), ip)
+              != rack_local_executors.end()) {
+            rack_local_candidates.push_back(ip);
+          }
+        }
+        if (!rack_local_candidates.empty()) candidates = &rack_local_candidates;
+      }
       // Like the local case, schedule_random_replica determines how to break ties.
-      executor_ip = assignment_ctx.SelectExecutorFromCandidates(
-          remote_executor_candidates, random_replica);
+      executor_ip =
+          assignment_ctx.SelectExecutorFromCandidates(*candidates, random_replica);
+    } else if (!rack_local_executors.empty()) {
+      executor_ip =
+          assignment_ctx.SelectExecutorFromCandidates(rack_local_executors, true);
     } else {
       executor_ip = assignment_ctx.SelectRemoteExecutor();
     }
-    BackendDescriptorPB executor;
-    assignment_ctx.SelectExecutorOnHost(*executor_ip, &executor);
+    const BackendDescriptorPB* executor =
+        assignment_ctx.SelectExecutorOnHost(*executor_ip);
     assignment_ctx.RecordScanRangeAssignment(
-        executor, node_id, host_list, *scan_range_locations, assignment);
+        *executor, remote_scan_range_idxs[i], scan_range_locations);
   }
 
-  if (VLOG_FILE_IS_ON) assignment_ctx.PrintAssignment(*assignment);
-
+  if (reuse_selection) {
+    shared_ptr<ScanRangeSelection> selection =
+        make_shared<ScanRangeSelection>(move(*assignment_ctx.selection()));
+    MaterializeScanRangeAssignment(
+        *selection, node_id, locations, replica_ips, assignment);
+    AddReusableSelection(fingerprint, move(selection));
+  } else {
+    MaterializeScanRangeAssignment(
+        *assignment_ctx.selection(), node_id, locations, replica_ips, assignment);
+  }
   return Status::OK();
 }
 
+vector<IpAddr> Scheduler::ResolveReplicaHosts(
+    const ExecutorGroup& executor_group, const vector<TNetworkAddress>& host_list) {
+  vector<IpAddr> replica_ips(host_list.size());
+  for (int i = 0; i < host_list.size(); ++i) {
+    executor_group.LookUpExecutorIp(host_list[i].hostname, &replica_ips[i]);
+  }
+  return replica_ips;
+}
+
+vector<string> Scheduler::ResolveReplicaRacks(const ExecutorGroup& executor_group,
+    const vector<TNetworkAddress>& host_list, const vector<IpAddr>& replica_ips) const {
+  vector<string> replica_racks(host_list.size());
+  for (int i = 0; i < host_list.size(); ++i) {
+    if (!replica_ips[i].empty()) {
+      // All executors on a host are in the same rack.
+      replica_racks[i] =
+          executor_group.GetExecutorsForHost(replica_ips[i]).front().rack();
+    }
+    if (!replica_racks[i].empty()) continue;
+    auto it = host_racks_.find(host_list[i].hostname);
+    if (it != host_racks_.end()) replica_racks[i] = it->second;
+  }
+  return replica_racks;
+}
+
+uint64_t Scheduler::ComputeSelectionFingerprint(
+    uint64_t options_hash, const vector<TScanRangeLocationList>& locations) {
+  // The hashes of the scan ranges are summed up so that chunks can be hashed
+  // independently. Each hash includes the index of the scan range, which makes the
+  // fingerprint depend on the order of the scan ranges.
+  std::atomic<uint64_t> fingerprint(HashValue(locations.size(), options_hash));
+  ForEachChunk(locations.size(), [&](int64_t begin, int64_t end) {
+    uint64_t sum = 0;
+    for (int64_t i = begin; i < end; ++i) {
+      const TScanRange& scan_range = locations[i].scan_range;
+      uint64_t hash = HashValue(i, options_hash);
+      hash = HashValue(GetScanRangeLength(scan_range), hash);
+      if (scan_range.__isset.hdfs_file_split) {
+        const THdfsFileSplit& split = scan_range.hdfs_file_split;
+        hash = HashString(split.relative_path, hash);
+        hash = HashValue(split.partition_path_hash, hash);
+        hash = HashValue(split.offset, hash);
+      }
+      for (const TScanRangeLocation& location : locations[i].locations) {
+        hash = HashValue(location.host_idx, hash);
+        hash = HashValue(location.is_cached, hash);
+      }
+      sum += hash;
+    }
+    fingerprint += sum;
+  });
+  return fingerprint;
+}
+
+shared_ptr<const Scheduler::ScanRangeSelection> Scheduler::LookUpReusableSelection(
+    uint64_t fingerprint, int num_ranges, const ExecutorGroup& executor_group) {
+  shared_ptr<const ScanRangeSelection> selection;
+  {
+    const int64_t now = MonotonicMillis();
+    lock_guard<mutex> l(reusable_selections_lock_);
+    while (!reusable_selections_.empty()
+        && reusable_selections_.front().expiration_ms <= now) {
+      reusable_selections_.pop_front();
+    }
+    for (auto it = reusable_selections_.rbegin(); it != reusable_selections_.rend();
+         ++it) {
+      if (it->fingerprint == fingerprint) {
+        selection = it->selection;
+        break;
+      }
+    }
+  }
+  if (selection == nullptr || selection->ranges.size() != num_ranges) return nullptr;
+  // The fingerprint covers the executors of the group, but a stale selection must never
+  // reference an executor that is gone.
+  for (int i = 0; i < selection->executors.size(); ++i) {
+    IpAddr ip;
+    if (executor_group.LookUpBackendDesc(selection->executors[i].address()) == nullptr
+        || !executor_group.LookUpExecutorIp(
+            selection->executors[i].address().hostname(), &ip)
+        || ip != selection->executor_ips[i]) {
+      return nullptr;
+    }
+  }
+  return selection;
+}
+
+void Scheduler::AddReusableSelection(
+    uint64_t fingerprint, shared_ptr<const ScanRangeSelection> selection) {
+  const int64_t expiration_ms =
+      MonotonicMillis() + FLAGS_scheduler_assignment_reuse_window_ms;
+  lock_guard<mutex> l(reusable_selections_lock_);
+  reusable_selections_.push_back({fingerprint, expiration_ms, move(selection)});
+  while (reusable_selections_.size() > MAX_REUSABLE_SELECTIONS) {
+    reusable_selections_.pop_front();
+  }
+}
+
+void Scheduler::MaterializeScanRangeAssignment(const ScanRangeSelection& selection,
+    PlanNodeId node_id, const vector<TScanRangeLocationList>& locations,
+    const vector<IpAddr>& replica_ips, FragmentScanRangeAssignment* assignment) {
+  const int64_t num_ranges = selection.ranges.size();
+  vector<ScanRangeParamsPB> scan_range_params(num_ranges);
+  std::atomic<int64_t> remote_bytes(0);
+  std::atomic<int64_t> local_bytes(0);
+  std::atomic<int64_t> cached_bytes(0);
+  std::atomic<int64_t> num_local_assignments(0);
+  // Build the ScanRangeParamsPB, which involves copying the file names.
+  ForEachChunk(num_ranges, [&](int64_t begin, int64_t end) {
+    AssignmentByteCounters byte_counters;
+    int64_t num_local = 0;
+    for (int64_t i = begin; i < end; ++i) {
+      const TScanRangeLocationList& scan_range_locations =
+          locations[selection.ranges[i].first];
+      const IpAddr& executor_ip = selection.executor_ips[selection.ranges[i].second];
+      DCHECK(!executor_ip.empty());
+      const int64_t scan_range_length =
+          GetScanRangeLength(scan_range_locations.scan_range);
+
+      // See if the read will be remote. This is not the case if the impalad runs on one
+      // of the replica's datanodes.
+      bool remote_read = true;
+      // For local reads we can set volume_id and try_hdfs_cache. For remote reads HDFS
+      // will decide which replica to use so we keep those at default values.
+      int volume_id = -1;
+      bool try_hdfs_cache = false;
+      for (const TScanRangeLocation& location : scan_range_locations.locations) {
+        if (executor_ip == replica_ips[location.host_idx]) {
+          remote_read = false;
+          volume_id = location.volume_id;
+          try_hdfs_cache = location.is_cached;
+          break;
+        }
+      }
+
+      if (remote_read) {
+        byte_counters.remote_bytes += scan_range_length;
+      } else {
+        byte_counters.local_bytes += scan_range_length;
+        if (try_hdfs_cache) byte_counters.cached_bytes += scan_range_length;
+        ++num_local;
+      }
+
+      ScanRangeParamsPB* params = &scan_range_params[i];
+      TScanRangeToScanRangePB(
+          scan_range_locations.scan_range, params->mutable_scan_range());
+      params->set_volume_id(volume_id);
+      params->set_try_hdfs_cache(try_hdfs_cache);
+      params->set_is_remote(remote_read);
+    }
+    remote_bytes += byte_counters.remote_bytes;
+    local_bytes += byte_counters.local_bytes;
+    cached_bytes += byte_counters.cached_bytes;
+    num_local_assignments += num_local;
+  });
+
+  if (total_assignments_ != nullptr) {
+    DCHECK(total_local_assignments_ != nullptr);
+    total_assignments_->Increment(num_ranges);
+    total_local_assignments_->Increment(num_local_assignments);
+  }
+
+  // Add the scan ranges to 'assignment' in the order in which they were selected.
+  vector<vector<ScanRangeParamsPB>*> scan_range_params_lists(
+      selection.executors.size(), nullptr);
+  for (int64_t i = 0; i < num_ranges; ++i) {
+    const int executor_idx = selection.ranges[i].second;
+    const BackendDescriptorPB& executor = selection.executors[executor_idx];
+    vector<ScanRangeParamsPB>*& scan_range_params_list =
+        scan_range_params_lists[executor_idx];
+    if (scan_range_params_list == nullptr) {
+      PerNodeScanRanges* scan_ranges =
+          FindOrInsert(assignment, executor.address(), PerNodeScanRanges());
+      scan_range_params_list =
+          FindOrInsert(scan_ranges, node_id, vector<ScanRangeParamsPB>());
+    }
+    scan_range_params_list->emplace_back();
+    scan_range_params_list->back().Swap(&scan_range_params[i]);
+
+    if (VLOG_FILE_IS_ON) {
+      VLOG_FILE << "Scheduler assignment to executor: " << executor.address() << "("
+                << (scan_range_params_list->back().is_remote() ? "remote" : "local")
+                << " selection)";
+    }
+  }
+
+  if (VLOG_FILE_IS_ON) {
+    AssignmentByteCounters byte_counters;
+    byte_counters.remote_bytes = remote_bytes;
+    byte_counters.local_bytes = local_bytes;
+    byte_counters.cached_bytes = cached_bytes;
+    PrintAssignment(byte_counters, *assignment);
+  }
+}
+
 bool Scheduler::ContainsNode(const TPlan& plan, TPlanNodeType::type type) {
   for (int i = 0; i < plan.nodes.size(); ++i) {
     if (plan.nodes[i].node_type == type) return true;
@@ -939,18 +1393,20 @@ void Scheduler::ComputeBackendExecParams(
       "Per Host Number of Fragment Instances", num_fragment_instances_ss.str());
 }
 
-Scheduler::AssignmentCtx::AssignmentCtx(const ExecutorGroup& executor_group,
-    IntCounter* total_assignments, IntCounter* total_local_assignments, std::mt19937* rng)
-  : executor_group_(executor_group),
-    first_unused_executor_idx_(0),
-    total_assignments_(total_assignments),
-    total_local_assignments_(total_local_assignments) {
+Scheduler::AssignmentCtx::AssignmentCtx(
+    const ExecutorGroup& executor_group, std::mt19937* rng)
+  : executor_group_(executor_group), first_unused_executor_idx_(0) {
   DCHECK_GT(executor_group.NumExecutors(), 0);
   random_executor_order_ = executor_group.GetAllExecutorIps();
   std::shuffle(random_executor_order_.begin(), random_executor_order_.end(), *rng);
   // Initialize inverted map for executor rank lookups
   int i = 0;
   for (const IpAddr& ip : random_executor_order_) random_executor_rank_[ip] = i++;
+  // All executors on a host are in the same rack, so the first one is representative.
+  for (const IpAddr& ip : random_executor_order_) {
+    const string& rack = executor_group.GetExecutorsForHost(ip).front().rack();
+    if (!rack.empty()) executor_ips_by_rack_[rack].push_back(ip);
+  }
 }
 
 const IpAddr* Scheduler::AssignmentCtx::SelectExecutorFromCandidates(
@@ -987,7 +1443,7 @@ const IpAddr* Scheduler::AssignmentCtx::SelectExecutorFromCandidates(
 
 void Scheduler::AssignmentCtx::GetRemoteExecutorCandidates(
     const THdfsFileSplit* hdfs_file_split, int num_candidates,
-    vector<IpAddr>* remote_executor_candidates) {
+    vector<IpAddr>* remote_executor_candidates) const {
   // This should be given an empty vector
   DCHECK_EQ(remote_executor_candidates->size(), 0);
   // This function should not be called with 'num_candidates' exceeding the number of
@@ -1062,6 +1518,26 @@ const IpAddr* Scheduler::AssignmentCtx::SelectRemoteExecutor() {
   return candidate_ip;
 }
 
+void Scheduler::AssignmentCtx::GetRackLocalExecutors(
+    const TScanRangeLocationList& scan_range_locations,
+    const vector<string>& replica_racks, vector<IpAddr>* rack_local_executors) const {
+  DCHECK(rack_local_executors->empty());
+  // Replicas are usually spread over two racks, so a linear search suffices.
+  vector<const string*> racks;
+  for (const TScanRangeLocation& location : scan_range_locations.locations) {
+    const string* rack = &replica_racks[location.host_idx];
+    if (rack->empty()) continue;
+    auto same_rack = [rack](const string* other) { return *other == *rack; };
+    if (find_if(racks.begin(), racks.end(), same_rack) != racks.end()) continue;
+    racks.push_back(rack);
+    // The rack may not have any executors.
+    auto rack_it = executor_ips_by_rack_.find(*rack);
+    if (rack_it == executor_ips_by_rack_.end()) continue;
+    rack_local_executors->insert(rack_local_executors->end(), rack_it->second.begin(),
+        rack_it->second.end());
+  }
+}
+
 bool Scheduler::AssignmentCtx::HasUnusedExecutors() const {
   return first_unused_executor_idx_ < random_executor_order_.size();
 }
@@ -1078,143 +1554,65 @@ int Scheduler::AssignmentCtx::GetExecutorRank(const IpAddr& ip) const {
   return it->second;
 }
 
-void Scheduler::AssignmentCtx::SelectExecutorOnHost(
-    const IpAddr& executor_ip, BackendDescriptorPB* executor) {
+const BackendDescriptorPB* Scheduler::AssignmentCtx::SelectExecutorOnHost(
+    const IpAddr& executor_ip) {
   DCHECK(executor_group_.LookUpExecutorIp(executor_ip, nullptr));
   const ExecutorGroup::Executors& executors_on_host =
       executor_group_.GetExecutorsForHost(executor_ip);
   DCHECK(executors_on_host.size() > 0);
-  if (executors_on_host.size() == 1) {
-    *executor = *executors_on_host.begin();
-  } else {
-    ExecutorGroup::Executors::const_iterator* next_executor_on_host;
-    next_executor_on_host =
-        FindOrInsert(&next_executor_per_host_, executor_ip, executors_on_host.begin());
-    auto eq = [next_executor_on_host](auto& elem) {
-      const BackendDescriptorPB& next_executor = **next_executor_on_host;
-      // The IP addresses must already match, so it is sufficient to check the port.
-      DCHECK_EQ(next_executor.ip_address(), elem.ip_address());
-      return next_executor.address().port() == elem.address().port();
-    };
-    DCHECK(find_if(executors_on_host.begin(), executors_on_host.end(), eq)
-        != executors_on_host.end());
-    *executor = **next_executor_on_host;
-    // Rotate
-    ++(*next_executor_on_host);
-    if (*next_executor_on_host == executors_on_host.end()) {
-      *next_executor_on_host = executors_on_host.begin();
-    }
-  }
-}
-
-void TScanRangeToScanRangePB(const TScanRange& tscan_range, ScanRangePB* scan_range_pb) {
-  if (tscan_range.__isset.hdfs_file_split) {
-    HdfsFileSplitPB* hdfs_file_split = scan_range_pb->mutable_hdfs_file_split();
-    hdfs_file_split->set_relative_path(tscan_range.hdfs_file_split.relative_path);
-    hdfs_file_split->set_offset(tscan_range.hdfs_file_split.offset);
-    hdfs_file_split->set_length(tscan_range.hdfs_file_split.length);
-    hdfs_file_split->set_partition_id(tscan_range.hdfs_file_split.partition_id);
-    hdfs_file_split->set_file_length(tscan_range.hdfs_file_split.file_length);
-    hdfs_file_split->set_file_compression(
-        THdfsCompressionToProto(tscan_range.hdfs_file_split.file_compression));
-    hdfs_file_split->set_mtime(tscan_range.hdfs_file_split.mtime);
-    hdfs_file_split->set_partition_path_hash(
-        tscan_range.hdfs_file_split.partition_path_hash);
-  }
-  if (tscan_range.__isset.hbase_key_range) {
-    HBaseKeyRangePB* hbase_key_range = scan_range_pb->mutable_hbase_key_range();
-    hbase_key_range->set_startkey(tscan_range.hbase_key_range.startKey);
-    hbase_key_range->set_stopkey(tscan_range.hbase_key_range.stopKey);
-  }
-  if (tscan_range.__isset.kudu_scan_token) {
-    scan_range_pb->set_kudu_scan_token(tscan_range.kudu_scan_token);
-  }
-  if (tscan_range.__isset.file_metadata) {
-    scan_range_pb->set_file_metadata(tscan_range.file_metadata);
+  if (executors_on_host.size() == 1) return &*executors_on_host.begin();
+  ExecutorGroup::Executors::const_iterator* next_executor_on_host;
+  next_executor_on_host =
+      FindOrInsert(&next_executor_per_host_, executor_ip, executors_on_host.begin());
+  auto eq = [next_executor_on_host](auto& elem) {
+    const BackendDescriptorPB& next_executor = **next_executor_on_host;
+    // The IP addresses must already match, so it is sufficient to check the port.
+    DCHECK_EQ(next_executor.ip_address(), elem.ip_address());
+    return next_executor.address().port() == elem.address().port();
+  };
+  DCHECK(find_if(executors_on_host.begin(), executors_on_host.end(), eq)
+      != executors_on_host.end());
+  const BackendDescriptorPB* executor = &**next_executor_on_host;
+  // Rotate
+  ++(*next_executor_on_host);
+  if (*next_executor_on_host == executors_on_host.end()) {
+    *next_executor_on_host = executors_on_host.begin();
   }
+  return executor;
 }
 
 void Scheduler::AssignmentCtx::RecordScanRangeAssignment(
-    const BackendDescriptorPB& executor, PlanNodeId node_id,
-    const vector<TNetworkAddress>& host_list,
-    const TScanRangeLocationList& scan_range_locations,
-    FragmentScanRangeAssignment* assignment) {
-  int64_t scan_range_length = 0;
-  if (scan_range_locations.scan_range.__isset.hdfs_file_split) {
-    scan_range_length = scan_range_locations.scan_range.hdfs_file_split.length;
-  } else if (scan_range_locations.scan_range.__isset.kudu_scan_token) {
-    // Hack so that kudu ranges are well distributed.
-    // TODO: KUDU-1133 Use the tablet size instead.
-    scan_range_length = 1000;
-  }
-
-  IpAddr executor_ip;
-  bool ret =
-      executor_group_.LookUpExecutorIp(executor.address().hostname(), &executor_ip);
-  DCHECK(ret);
-  DCHECK(!executor_ip.empty());
-  assignment_heap_.InsertOrUpdate(
-      executor_ip, scan_range_length, GetExecutorRank(executor_ip));
-
-  // See if the read will be remote. This is not the case if the impalad runs on one of
-  // the replica's datanodes.
-  bool remote_read = true;
-  // For local reads we can set volume_id and try_hdfs_cache. For remote reads HDFS will
-  // decide which replica to use so we keep those at default values.
-  int volume_id = -1;
-  bool try_hdfs_cache = false;
-  for (const TScanRangeLocation& location : scan_range_locations.locations) {
-    const TNetworkAddress& replica_host = host_list[location.host_idx];
-    IpAddr replica_ip;
-    if (executor_group_.LookUpExecutorIp(replica_host.hostname, &replica_ip)
-        && executor_ip == replica_ip) {
-      remote_read = false;
-      volume_id = location.volume_id;
-      try_hdfs_cache = location.is_cached;
-      break;
-    }
-  }
-
-  if (remote_read) {
-    assignment_byte_counters_.remote_bytes += scan_range_length;
+    const BackendDescriptorPB& executor, int range_idx,
+    const TScanRangeLocationList& scan_range_locations) {
+  int executor_idx;
+  auto executor_it = selected_executor_idx_.find(&executor);
+  if (executor_it == selected_executor_idx_.end()) {
+    IpAddr executor_ip;
+    bool ret =
+        executor_group_.LookUpExecutorIp(executor.address().hostname(), &executor_ip);
+    DCHECK(ret);
+    DCHECK(!executor_ip.empty());
+    executor_idx = selection_.executors.size();
+    selected_executor_idx_.emplace(&executor, executor_idx);
+    selection_.executors.push_back(executor);
+    selection_.executor_ips.push_back(move(executor_ip));
   } else {
-    assignment_byte_counters_.local_bytes += scan_range_length;
-    if (try_hdfs_cache) assignment_byte_counters_.cached_bytes += scan_range_length;
-  }
-
-  if (total_assignments_ != nullptr) {
-    DCHECK(total_local_assignments_ != nullptr);
-    total_assignments_->Increment(1);
-    if (!remote_read) total_local_assignments_->Increment(1);
-  }
-
-  PerNodeScanRanges* scan_ranges =
-      FindOrInsert(assignment, executor.address(), PerNodeScanRanges());
-  vector<ScanRangeParamsPB>* scan_range_params_list =
-      FindOrInsert(scan_ranges, node_id, vector<ScanRangeParamsPB>());
-  // Add scan range.
-  ScanRangeParamsPB scan_range_params;
-  TScanRangeToScanRangePB(
-      scan_range_locations.scan_range, scan_range_params.mutable_scan_range());
-  scan_range_params.set_volume_id(volume_id);
-  scan_range_params.set_try_hdfs_cache(try_hdfs_cache);
-  scan_range_params.set_is_remote(remote_read);
-  scan_range_params_list->push_back(scan_range_params);
-
-  if (VLOG_FILE_IS_ON) {
-    VLOG_FILE << "Scheduler assignment to executor: " << executor.address() << "("
-              << (remote_read ? "remote" : "local") << " selection)";
+    executor_idx = executor_it->second;
   }
+  const IpAddr& executor_ip = selection_.executor_ips[executor_idx];
+  assignment_heap_.InsertOrUpdate(executor_ip,
+      GetScanRangeLength(scan_range_locations.scan_range), GetExecutorRank(executor_ip));
+  selection_.ranges.emplace_back(range_idx, executor_idx);
 }
 
-void Scheduler::AssignmentCtx::PrintAssignment(
+void Scheduler::PrintAssignment(const AssignmentByteCounters& byte_counters,
     const FragmentScanRangeAssignment& assignment) {
   VLOG_FILE << "Total remote scan volume = "
-            << PrettyPrinter::Print(assignment_byte_counters_.remote_bytes, TUnit::BYTES);
+            << PrettyPrinter::Print(byte_counters.remote_bytes, TUnit::BYTES);
   VLOG_FILE << "Total local scan volume = "
-            << PrettyPrinter::Print(assignment_byte_counters_.local_bytes, TUnit::BYTES);
+            << PrettyPrinter::Print(byte_counters.local_bytes, TUnit::BYTES);
   VLOG_FILE << "Total cached scan volume = "
-            << PrettyPrinter::Print(assignment_byte_counters_.cached_bytes, TUnit::BYTES);
+            << PrettyPrinter::Print(byte_counters.cached_bytes, TUnit::BYTES);
 
   for (const FragmentScanRangeAssignment::value_type& entry : assignment) {
     VLOG_FILE << "ScanRangeAssignment: server=" << entry.first.DebugString();
@@ -17,6 +17,9 @@
 
 #pragma once
 
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <random>
 #include <string>
 #include <vector>
@@ -143,6 +146,28 @@ class Scheduler {
     ExecutorHandleMap executor_handles_;
   };
 
+  /// A struct to track various counts of assigned bytes during scheduling.
+  struct AssignmentByteCounters {
+    int64_t remote_bytes = 0;
+    int64_t local_bytes = 0;
+    int64_t cached_bytes = 0;
+  };
+
+  /// The executors selected for the scan ranges of a plan node. Selecting the executors
+  /// is inherently sequential, since every selection depends on the bytes assigned by
+  /// the previous ones. Turning the selection into a FragmentScanRangeAssignment is not
+  /// and is done by MaterializeScanRangeAssignment(). Selections are self-contained so
+  /// that they can be reused for identical inputs, see LookUpReusableSelection().
+  struct ScanRangeSelection {
+    /// The distinct executors that were selected and their IP addresses.
+    std::vector<BackendDescriptorPB> executors;
+    std::vector<IpAddr> executor_ips;
+
+    /// Pairs of (index into the scan range locations, index into 'executors'), in the
+    /// order in which the scan ranges were assigned.
+    std::vector<std::pair<int, int>> ranges;
+  };
+
   /// Class to store context information on assignments during scheduling. It is
   /// initialized with a copy of the executor group and assigns a random rank to each
   /// executor to break ties in cases where multiple executors have been assigned the same
@@ -151,8 +176,7 @@ class Scheduler {
   /// ComputeScanRangeAssignment() and thus don't need to be thread safe.
   class AssignmentCtx {
    public:
-    AssignmentCtx(const ExecutorGroup& executor_group, IntCounter* total_assignments,
-        IntCounter* total_local_assignments, std::mt19937* rng);
+    AssignmentCtx(const ExecutorGroup& executor_group, std::mt19937* rng);
 
     /// Among hosts in 'data_locations', select the one with the minimum number of
     /// assigned bytes. If executors have been assigned equal amounts of work and
@@ -169,8 +193,9 @@ class Scheduler {
     /// name / offset and same set of executors, this function is deterministic. The hash
     /// ring also limits the disruption when executors are added or removed. Note that
     /// 'num_candidates' cannot be 0 and must be less than the total number of executors.
+    /// Does not depend on previous assignments and may be called concurrently.
     void GetRemoteExecutorCandidates(const THdfsFileSplit* hdfs_file_split,
-        int num_remote_replicas, vector<IpAddr>* remote_executor_candidates);
+        int num_remote_replicas, vector<IpAddr>* remote_executor_candidates) const;
 
     /// Select an executor for a remote read. If there are unused executor hosts, then
     /// those will be preferred. Otherwise the one with the lowest number of assigned
@@ -178,37 +203,38 @@ class Scheduler {
     /// executor rank is used to break ties.
     const IpAddr* SelectRemoteExecutor();
 
+    /// Returns true if any executor of the group has a rack label.
+    bool HasRacks() const { return !executor_ips_by_rack_.empty(); }
+
+    /// Populates 'rack_local_executors' with all executors in the racks of the replicas
+    /// in 'scan_range_locations'. 'replica_racks' holds the rack of each replica host,
+    /// see ResolveReplicaRacks(). Replicas in an unknown rack are ignored, so the result
+    /// is empty if the racks of all replicas are unknown or have no executors.
+    void GetRackLocalExecutors(const TScanRangeLocationList& scan_range_locations,
+        const std::vector<std::string>& replica_racks,
+        std::vector<IpAddr>* rack_local_executors) const;
+
     /// Return the next executor that has not been assigned to. This assumes that a
     /// returned executor will also be assigned to. The caller must make sure that
     /// HasUnusedExecutors() is true.
     const IpAddr* GetNextUnusedExecutorAndIncrement();
 
     /// Pick an executor in round-robin fashion from multiple executors on a single host.
-    void SelectExecutorOnHost(const IpAddr& executor_ip, BackendDescriptorPB* executor);
-
-    /// Build a new ScanRangeParamsPB object and append it to the assignment list for the
-    /// tuple (executor, node_id) in 'assignment'. Also, update assignment_heap_ and
-    /// assignment_byte_counters_, increase the counters 'total_assignments_' and
-    /// 'total_local_assignments_'. 'scan_range_locations' contains information about the
-    /// scan range and its replica locations.
-    void RecordScanRangeAssignment(const BackendDescriptorPB& executor,
-        PlanNodeId node_id, const vector<TNetworkAddress>& host_list,
-        const TScanRangeLocationList& scan_range_locations,
-        FragmentScanRangeAssignment* assignment);
+    /// The returned descriptor is owned by the executor group.
+    const BackendDescriptorPB* SelectExecutorOnHost(const IpAddr& executor_ip);
+
+    /// Record the assignment of the scan range at index 'range_idx' of the scan range
+    /// locations to 'executor' in selection_ and update assignment_heap_.
+    /// 'scan_range_locations' contains information about the scan range. 'executor' must
+    /// outlive this object.
+    void RecordScanRangeAssignment(const BackendDescriptorPB& executor, int range_idx,
+        const TScanRangeLocationList& scan_range_locations);
 
     const ExecutorGroup& executor_group() const { return executor_group_; }
 
-    /// Print the assignment and statistics to VLOG_FILE.
-    void PrintAssignment(const FragmentScanRangeAssignment& assignment);
+    ScanRangeSelection* selection() { return &selection_; }
 
    private:
-    /// A struct to track various counts of assigned bytes during scheduling.
-    struct AssignmentByteCounters {
-      int64_t remote_bytes = 0;
-      int64_t local_bytes = 0;
-      int64_t cached_bytes = 0;
-    };
-
     /// Used to look up hostnames to IP addresses and IP addresses to executors.
     const ExecutorGroup& executor_group_;
 
@@ -230,13 +256,15 @@ class Scheduler {
     /// Track round robin information per executor host.
     NextExecutorPerHost next_executor_per_host_;
 
-    /// Track number of assigned bytes that have been read from cache, locally, or
-    /// remotely.
-    AssignmentByteCounters assignment_byte_counters_;
+    /// The executor hosts in each rack, in the order of random_executor_order_. Only
+    /// contains executors with a rack label.
+    boost::unordered_map<std::string, std::vector<IpAddr>> executor_ips_by_rack_;
+
+    /// The executors selected so far.
+    ScanRangeSelection selection_;
 
-    /// Pointers to the scheduler's counters.
-    IntCounter* total_assignments_;
-    IntCounter* total_local_assignments_;
+    /// Maps the executors in selection_ to their index in selection_.executors.
+    boost::unordered_map<const BackendDescriptorPB*, int> selected_executor_idx_;
 
     /// Return whether there are executors that have not been assigned a scan range.
     bool HasUnusedExecutors() const;
@@ -245,6 +273,14 @@ class Scheduler {
     int GetExecutorRank(const IpAddr& ip) const;
   };
 
+  /// A selection computed for a large plan node that can be reused for identical inputs
+  /// until 'expiration_ms'. See LookUpReusableSelection().
+  struct ReusableSelection {
+    uint64_t fingerprint;
+    int64_t expiration_ms;
+    std::shared_ptr<const ScanRangeSelection> selection;
+  };
+
   /// Total number of scan ranges assigned to executors during the lifetime of the
   /// scheduler.
   int64_t num_assignments_;
@@ -256,9 +292,22 @@ class Scheduler {
   IntCounter* total_assignments_ = nullptr;
   IntCounter* total_local_assignments_ = nullptr;
 
+  /// Number of scan ranges whose assignment was reused from an earlier plan node.
+  IntCounter* total_reused_assignments_ = nullptr;
+
+  /// Protects reusable_selections_.
+  std::mutex reusable_selections_lock_;
+
+  /// Recently computed selections, most recent last. Holds at most
+  /// MAX_REUSABLE_SELECTIONS entries.
+  std::deque<ReusableSelection> reusable_selections_;
+
   /// Initialization metric
   BooleanProperty* initialized_ = nullptr;
 
+  /// The rack of each host in --scheduler_host_racks.
+  boost::unordered_map<std::string, std::string> host_racks_;
+
   /// Used for user-to-pool resolution and looking up pool configurations. Not owned by
   /// us.
   RequestPoolService* request_pool_service_;
@@ -269,6 +318,13 @@ class Scheduler {
   const BackendDescriptorPB& LookUpBackendDesc(
       const ExecutorConfig& executor_config, const NetworkAddressPB& host);
 
+  /// Returns the index of the host in 'input_hosts' to schedule an interior
+  /// unpartitioned fragment on. The hosts are those of the instances of its first input
+  /// fragment. Picks a random host, preferring hosts in the coordinator's rack since the
+  /// output of these fragments usually flows to the coordinator.
+  int SelectInteriorFragmentInput(const ExecutorConfig& executor_config,
+      const std::vector<NetworkAddressPB>& input_hosts, std::mt19937* rng);
+
   /// Returns the KRPC host in 'executor_config' based on the thrift backend address
   /// 'backend_host'. Will DCHECK if the KRPC address is not valid.
   NetworkAddressPB LookUpKrpcHost(
@@ -334,6 +390,14 @@ class Scheduler {
   ///   default setting is false. Selection between equivalent replicas with memory
   ///   distance of CACHE_LOCAL or REMOTE happens based on a random order.
   ///
+  /// Executors are selected in a single pass over the scan ranges, since each selection
+  /// depends on the bytes assigned so far. For plan nodes with at least
+  /// --scheduler_parallel_assignment_threshold scan ranges the work that does not depend
+  /// on earlier selections, i.e. computing remote executor candidates and building the
+  /// ScanRangeParamsPB, is split across threads. The resulting assignment is the same.
+  /// If --scheduler_assignment_reuse_window_ms is set, such plan nodes also reuse the
+  /// selection of an identical plan node that was scheduled shortly before.
+  ///
   /// The method takes the following parameters:
   ///
   /// executor_config:          Executor configuration to use for scheduling.
@@ -354,6 +418,48 @@ class Scheduler {
       const TQueryOptions& query_options, RuntimeProfile::Counter* timer,
       std::mt19937* rng, FragmentScanRangeAssignment* assignment);
 
+  /// Resolves the hosts in 'host_list' to the IP addresses of the executors in
+  /// 'executor_group' that run on them. The IP address is empty for hosts without an
+  /// executor.
+  static std::vector<IpAddr> ResolveReplicaHosts(const ExecutorGroup& executor_group,
+      const std::vector<TNetworkAddress>& host_list);
+
+  /// Returns the rack of each host in 'host_list', or an empty string if it is unknown.
+  /// The rack of a host with an executor, as given by 'replica_ips', is the --rack label
+  /// of that executor. Other hosts are looked up in --scheduler_host_racks.
+  std::vector<std::string> ResolveReplicaRacks(const ExecutorGroup& executor_group,
+      const std::vector<TNetworkAddress>& host_list,
+      const std::vector<IpAddr>& replica_ips) const;
+
+  /// Returns a fingerprint of all inputs of ComputeScanRangeAssignment() that influence
+  /// which executors are selected. 'options_hash' covers everything but the scan
+  /// ranges and is combined with a hash of each entry of 'locations'.
+  static uint64_t ComputeSelectionFingerprint(uint64_t options_hash,
+      const std::vector<TScanRangeLocationList>& locations);
+
+  /// Returns a selection that was computed for 'fingerprint' within the last
+  /// FLAGS_scheduler_assignment_reuse_window_ms, or nullptr if there is none. The
+  /// selection must have 'num_ranges' scan ranges and all of its executors must still be
+  /// part of 'executor_group'.
+  std::shared_ptr<const ScanRangeSelection> LookUpReusableSelection(
+      uint64_t fingerprint, int num_ranges, const ExecutorGroup& executor_group);
+
+  /// Makes 'selection' available for reuse by LookUpReusableSelection().
+  void AddReusableSelection(
+      uint64_t fingerprint, std::shared_ptr<const ScanRangeSelection> selection);
+
+  /// Builds the ScanRangeParamsPB for the scan ranges in 'selection' and appends them to
+  /// 'assignment' in the order in which they were selected. 'replica_ips' holds the
+  /// executor IP address for each host in the host list of 'locations', as returned by
+  /// ResolveReplicaHosts(). Updates the scheduler's assignment metrics.
+  void MaterializeScanRangeAssignment(const ScanRangeSelection& selection,
+      PlanNodeId node_id, const std::vector<TScanRangeLocationList>& locations,
+      const std::vector<IpAddr>& replica_ips, FragmentScanRangeAssignment* assignment);
+
+  /// Print the assignment and statistics to VLOG_FILE.
+  static void PrintAssignment(const AssignmentByteCounters& byte_counters,
+      const FragmentScanRangeAssignment& assignment);
+
   /// Computes execution parameters for all backends assigned in the query and always one
   /// for the coordinator backend since it participates in execution regardless. Must be
   /// called after ComputeFragmentExecParams().
@@ -441,6 +547,7 @@ class Scheduler {
   FRIEND_TEST(SimpleAssignmentTest, ComputeAssignmentRandomDiskLocal);
   FRIEND_TEST(SimpleAssignmentTest, ComputeAssignmentRandomRemote);
   FRIEND_TEST(SchedulerTest, TestMultipleFinstances);
+  FRIEND_TEST(SchedulerTest, InteriorFragmentPrefersCoordinatorRack);
 };
 
 }
@@ -46,6 +46,7 @@
 #include "service/frontend.h"
 #include "service/impala-server.h"
 #include "service/query-options.h"
+#include "service/query-result-cache.h"
 #include "service/query-result-set.h"
 #include "util/auth-util.h"
 #include "util/debug-util.h"
@@ -96,6 +97,7 @@ static const string TABLES_WITH_CORRUPT_STATS_KEY = "Tables With Corrupt Table S
 static const string TABLES_WITH_MISSING_DISK_IDS_KEY = "Tables With Missing Disk Ids";
 
 static const string QUERY_STATUS_KEY = "Query Status";
+static const string QUERY_RESULT_CACHE_KEY = "Query Result Cache";
 static const string RETRY_STATUS_KEY = "Retry Status";
 
 ClientRequestState::ClientRequestState(const TQueryCtx& query_ctx, Frontend* frontend,
@@ -130,6 +132,11 @@ ClientRequestState::ClientRequestState(const TQueryCtx& query_ctx, Frontend* fro
   num_rows_fetched_from_cache_counter_ =
       ADD_COUNTER(server_profile_, "NumRowsFetchedFromCache", TUnit::UNIT);
   client_wait_timer_ = ADD_TIMER(server_profile_, "ClientFetchWaitTimer");
+  // Must be read before planning, see QueryResultCache.
+  QueryResultCache* query_result_cache = parent_server_->query_result_cache();
+  if (query_result_cache != nullptr) {
+    query_result_cache_generation_ = query_result_cache->generation();
+  }
   bool is_external_fe = session_type() == TSessionType::EXTERNAL_FRONTEND;
   // "Impala Backend Timeline" was specifically chosen to exploit the lexicographical
   // ordering defined by the underlying std::map holding the timelines displayed in
@@ -239,6 +246,9 @@ Status ClientRequestState::Exec() {
     case TStmtType::QUERY:
     case TStmtType::DML:
       DCHECK(exec_request_->__isset.query_exec_request);
+      if (exec_request_->stmt_type == TStmtType::QUERY && LookupQueryResultCache()) {
+        break;
+      }
       RETURN_IF_ERROR(
           ExecQueryOrDmlRequest(exec_request_->query_exec_request, true /*async*/));
       break;
@@ -949,6 +959,7 @@ Status ClientRequestState::Finalize(bool check_inflight, const Status* cause) {
     // Update result set cache metrics, and update mem limit accounting before tearing
     // down the coordinator.
     ClearResultCache();
+    ClearResultCapture();
   }
   // Wait until the audit events are flushed.
   if (wait_thread_.get() != nullptr) {
@@ -1229,6 +1240,17 @@ Status ClientRequestState::FetchRowsInternal(const int32_t max_rows,
     return Status::OK();
   }
 
+  if (cached_result_ != nullptr) {
+    QueryResultSet* cached_rows = cached_result_->rows();
+    const int64_t num_cached_rows = cached_rows->size();
+    int num_rows = fetched_rows->AddRows(cached_rows, num_rows_fetched_,
+        max_rows <= 0 ? num_cached_rows : max_rows);
+    num_rows_fetched_ += num_rows;
+    COUNTER_ADD(num_rows_fetched_counter_, num_rows);
+    eos_.Store(num_rows_fetched_ == num_cached_rows);
+    return Status::OK();
+  }
+
   Coordinator* coordinator = GetCoordinator();
   if (coordinator == nullptr) {
     return Status("Client tried to fetch rows on a query that produces no results.");
@@ -1279,6 +1301,9 @@ Status ClientRequestState::FetchRowsInternal(const int32_t max_rows,
       eos_.Store(true);
       return query_status_;
     }
+    if (result_capture_ != nullptr) {
+      CaptureQueryResult(fetched_rows, before, num_fetched);
+    }
   }
 
   // Update the result cache if necessary.
@@ -1631,6 +1656,97 @@ void ClientRequestState::ClearResultCache() {
   result_cache_.reset();
 }
 
+bool ClientRequestState::UseArrowResultFormat() const {
+  if (!query_options().arrow_result_format) return false;
+  if (session_type() != TSessionType::HIVESERVER2) return false;
+  if (session_->hs2_version < TProtocolVersion::HIVE_CLI_SERVICE_PROTOCOL_V6) {
+    return false;
+  }
+  // Child queries return their results in row-major format to the parent query.
+  if (query_ctx_.__isset.parent_query_id) return false;
+  if (exec_request_ == nullptr || exec_request_->stmt_type != TStmtType::QUERY) {
+    return false;
+  }
+  return QueryResultSet::IsArrowCompatible(result_metadata_);
+}
+
+bool ClientRequestState::LookupQueryResultCache() {
+  QueryResultCache* query_result_cache = parent_server_->query_result_cache();
+  if (query_result_cache == nullptr || query_result_cache_generation_ < 0) return false;
+  // A retried query was planned before 'query_result_cache_generation_' was read.
+  if (IsRetriedQuery()) return false;
+  vector<string> tables;
+  if (!QueryResultCache::IsCacheable(*exec_request_, &tables)) return false;
+  QueryResultCache::ResultFormat format;
+  if (session_type() == TSessionType::BEESWAX) {
+    format = QueryResultCache::ASCII;
+  } else if (UseArrowResultFormat()) {
+    format = QueryResultCache::ARROW;
+  } else if (session_->hs2_version < TProtocolVersion::HIVE_CLI_SERVICE_PROTOCOL_V6) {
+    format = QueryResultCache::HS2_ROW_ORIENTED;
+  } else {
+    format = QueryResultCache::HS2_COLUMNAR;
+  }
+  Status status = QueryResultCache::ComputeKey(
+      *exec_request_, effective_user(), format, &query_result_cache_key_);
+  if (!status.ok()) {
+    VLOG_QUERY << "Not using the query result cache for query_id=" << PrintId(query_id())
+               << ": " << status.GetDetail();
+    return false;
+  }
+  cached_result_ = query_result_cache->Lookup(query_result_cache_key_);
+  if (cached_result_ != nullptr) {
+    summary_profile_->AddInfoString(QUERY_RESULT_CACHE_KEY, "Hit");
+    query_events_->MarkEvent("Result found in query result cache");
+    return true;
+  }
+  summary_profile_->AddInfoString(QUERY_RESULT_CACHE_KEY, "Miss");
+  result_capture_.reset(new QueryResultCache::Entry(format, result_metadata_));
+  result_capture_->tables = move(tables);
+  return false;
+}
+
+void ClientRequestState::CaptureQueryResult(
+    QueryResultSet* fetched_rows, int start_idx, int num_rows) {
+  DCHECK(result_capture_ != nullptr);
+  QueryResultCache* query_result_cache = parent_server_->query_result_cache();
+  DCHECK(query_result_cache != nullptr);
+  const int64_t delta_bytes = fetched_rows->ByteSize(start_idx, num_rows);
+  if (result_capture_bytes_ + delta_bytes > query_result_cache->max_entry_bytes()) {
+    ClearResultCapture();
+    return;
+  }
+  // Count the captured rows towards the mem limit of the query until they are handed to
+  // the cache. Caching is optional, so the capture is dropped if that fails.
+  Coordinator* coordinator = GetCoordinator();
+  DCHECK(coordinator != nullptr);
+  if (!coordinator->query_mem_tracker()->TryConsume(delta_bytes)) {
+    VLOG_QUERY << "Not enough memory to capture the result of query_id="
+               << PrintId(query_id()) << " for the query result cache";
+    ClearResultCapture();
+    return;
+  }
+  result_capture_bytes_ += delta_bytes;
+  result_capture_->rows()->AddRows(fetched_rows, start_idx, num_rows);
+  if (eos_.Load()) {
+    // The cache tracks the memory of its entries itself.
+    unique_ptr<QueryResultCache::Entry> entry = move(result_capture_);
+    ClearResultCapture();
+    query_result_cache->Insert(
+        query_result_cache_key_, query_result_cache_generation_, move(entry));
+  }
+}
+
+void ClientRequestState::ClearResultCapture() {
+  if (result_capture_bytes_ > 0) {
+    Coordinator* coordinator = GetCoordinator();
+    DCHECK(coordinator != nullptr);
+    coordinator->query_mem_tracker()->Release(result_capture_bytes_);
+    result_capture_bytes_ = 0;
+  }
+  result_capture_.reset();
+}
+
 void ClientRequestState::UpdateExecState(ExecState exec_state) {
   exec_state_.Store(exec_state);
   summary_profile_->AddInfoString("Query State", PrintThriftEnum(BeeswaxQueryState()));
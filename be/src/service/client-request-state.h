@@ -23,6 +23,7 @@
 #include "exec/catalog-op-executor.h"
 #include "service/child-query.h"
 #include "service/impala-server.h"
+#include "service/query-result-cache.h"
 #include "service/query-result-set.h"
 #include "util/condition-variable.h"
 #include "util/runtime-profile.h"
@@ -305,6 +306,13 @@ class ClientRequestState {
   /// Returns 0:0 if this is a root query
   TUniqueId parent_query_id() const { return query_ctx_.parent_query_id; }
 
+  /// Returns true if the rows of this query are returned to the client in the Arrow IPC
+  /// streaming format, see QueryResultSet::CreateArrowResultSet(). This is the case for
+  /// queries of HS2 sessions with protocol version V6 and above that set the
+  /// ARROW_RESULT_FORMAT query option, unless they are child queries or return complex
+  /// types. Must only be called once the result metadata is set.
+  bool UseArrowResultFormat() const;
+
   const std::vector<std::string>& GetAnalysisWarnings() const {
     return exec_request_->analysis_warnings;
   }
@@ -532,6 +540,28 @@ class ClientRequestState {
   /// Max size of the result_cache_ in number of rows. A value <= 0 means no caching.
   int64_t result_cache_max_size_ = -1;
 
+  /// Generation of the server's QueryResultCache before this query was planned, or -1
+  /// if the cache is disabled.
+  int64_t query_result_cache_generation_ = -1;
+
+  /// Key of this query in the server's QueryResultCache. Only set if the query is
+  /// cacheable.
+  std::string query_result_cache_key_;
+
+  /// The cached result that this query returns instead of executing. Set by Exec() if
+  /// the QueryResultCache had an entry for this query.
+  std::shared_ptr<const QueryResultCache::Entry> cached_result_;
+
+  /// The result that is being fetched from the coordinator, collected for insertion into
+  /// the QueryResultCache once all rows were fetched. Set by Exec() if the query is
+  /// cacheable but was not cached. Reset if the result becomes too large to cache or
+  /// cannot be tracked against the mem limit of the query.
+  std::unique_ptr<QueryResultCache::Entry> result_capture_;
+
+  /// Approximate size of the rows in 'result_capture_' in bytes, which is consumed from
+  /// the query's MemTracker.
+  int64_t result_capture_bytes_ = 0;
+
   ObjectPool profile_pool_;
 
   /// The ClientRequestState builds three separate profiles.
@@ -766,6 +796,19 @@ class ClientRequestState {
   /// This function is a no-op if the cache has already been cleared.
   void ClearResultCache();
 
+  /// Looks up the result of this query in the server's QueryResultCache. Returns true
+  /// and sets 'cached_result_' on a hit. Otherwise returns false and, if the query is
+  /// cacheable, sets up 'result_capture_'.
+  bool LookupQueryResultCache();
+
+  /// Appends the 'num_rows' rows starting at 'start_idx' that were fetched from the
+  /// coordinator into 'fetched_rows' to 'result_capture_', and inserts it into the
+  /// QueryResultCache once all rows were fetched.
+  void CaptureQueryResult(QueryResultSet* fetched_rows, int start_idx, int num_rows);
+
+  /// Drops 'result_capture_' and releases its memory from the query's MemTracker.
+  void ClearResultCapture();
+
   /// Update the operation state and the "Query State" summary profile string.
   /// Does not take lock_, but requires it: caller must ensure lock_ is taken before
   /// calling UpdateExecState.
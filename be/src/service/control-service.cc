@@ -20,6 +20,7 @@
 #include "common/constant-strings.h"
 #include "common/thread-debug-info.h"
 #include "exec/kudu-util.h"
+#include "gutil/walltime.h"
 #include "kudu/rpc/rpc_context.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "rpc/rpc-mgr.h"
@@ -34,6 +35,7 @@
 #include "service/client-request-state.h"
 #include "service/impala-server.h"
 #include "util/debug-util.h"
+#include "util/impalad-metrics.h"
 #include "util/memory-metrics.h"
 #include "util/parse-util.h"
 #include "util/uid-util.h"
@@ -116,6 +118,7 @@ Status ControlService::GetProfile(const ReportExecStatusRequestPB& request,
       request.thrift_profiles_sidecar_idx(), &thrift_profiles_slice),
       "Failed to get thrift profile sidecar");
   uint32_t len = thrift_profiles_slice.size();
+  ImpaladMetrics::PROFILE_UPDATE_BYTES_RECEIVED->Increment(len);
   RETURN_IF_ERROR(DeserializeThriftMsg(thrift_profiles_slice.data(),
       &len, true, thrift_profiles));
   return Status::OK();
@@ -185,6 +188,7 @@ void ControlService::ReportExecStatus(const ReportExecStatusRequestPB* request,
   // sidecar and deserialize the thrift profile if there is any. The sender may have
   // failed to serialize the Thrift profile so an empty thrift profile is valid.
   // TODO: Fix IMPALA-7232 to indicate incomplete profile in this case.
+  const MicrosecondsInt64 start_cpu_us = GetThreadCpuTimeMicros();
   TRuntimeProfileForest thrift_profiles;
   if (LIKELY(request->has_thrift_profiles_sidecar_idx())) {
     const Status& profile_status =
@@ -193,13 +197,17 @@ void ControlService::ReportExecStatus(const ReportExecStatusRequestPB* request,
       LOG(ERROR) << Substitute("ReportExecStatus(): Failed to deserialize profile "
           "for query ID $0: $1", PrintId(query_handle->query_id()),
           profile_status.GetDetail());
-      // Do not expose a partially deserialized profile.
+      // Do not expose a partially deserialized profile. The profile may only contain
+      // the changes since the last report, so ask for the full profile with the next one.
       TRuntimeProfileForest empty_profiles;
       swap(thrift_profiles, empty_profiles);
+      response->set_resend_full_profile(true);
     }
   }
 
   Status resp_status = query_handle->UpdateBackendExecStatus(*request, thrift_profiles);
+  ImpaladMetrics::PROFILE_UPDATE_CPU_TIME_US->Increment(
+      GetThreadCpuTimeMicros() - start_cpu_us);
   RespondAndReleaseRpc(resp_status, response, rpc_context);
 }
 
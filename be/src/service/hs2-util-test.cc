@@ -17,13 +17,29 @@
 
 #include "service/hs2-util.h"
 
+#include <cstring>
+#include <limits>
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "common/init.h"
+#include "common/object-pool.h"
+#include "exprs/scalar-expr-evaluator.h"
+#include "exprs/slot-ref.h"
+#include "gen-cpp/Descriptors_types.h"
+#include "runtime/descriptors.h"
+#include "runtime/mem-pool.h"
+#include "runtime/mem-tracker.h"
+#include "runtime/row-batch.h"
+#include "runtime/string-value.h"
+#include "runtime/tuple-row.h"
+#include "runtime/tuple.h"
 #include "common/names.h"
 #include "testutil/gtest-util.h"
 
+using namespace apache::hive::service::cli;
 using namespace impala;
 using namespace std;
 
@@ -158,3 +174,161 @@ TEST(PrintTColumnValueTest, TestAllTypes) {
   }
 }
 
+
+// The rows of SlotRefHS2ColumnTest have a single nullable tuple with one nullable slot.
+// The null indicator is bit 1 of the first byte and the slot starts at byte 1, see
+// SlotRef(ColumnType, int, bool).
+static const int SLOT_OFFSET = 1;
+static const int NUM_ROWS = 100;
+
+// Tests that SlotRefValuesToHS2TColumn() produces the same columns as evaluating the
+// SlotRef once per row with EvalExprValuesToHS2TColumn().
+class SlotRefHS2ColumnTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    TDescriptorTable thrift_desc_tbl;
+    TTupleDescriptor tuple_desc;
+    tuple_desc.__set_id(0);
+    tuple_desc.__set_byteSize(SLOT_OFFSET + sizeof(StringValue));
+    tuple_desc.__set_numNullBytes(1);
+    thrift_desc_tbl.tupleDescriptors.push_back(tuple_desc);
+    ASSERT_OK(DescriptorTbl::CreateInternal(&pool_, thrift_desc_tbl, &desc_tbl_));
+    row_desc_.reset(new RowDescriptor(*desc_tbl_, {0}, {true}));
+  }
+
+  virtual void TearDown() {
+    ScalarExprEvaluator::Close(evals_, nullptr);
+    ScalarExpr::Close(exprs_);
+    desc_tbl_->ReleaseResources();
+    mem_pool_.FreeAll();
+    pool_.Clear();
+  }
+
+  // Returns true if row 'i' of the batches created by CreateBatch() is NULL: every 7th
+  // slot is NULL and every 50th tuple is NULL.
+  static bool IsNullRow(int i) { return i % 7 == 0 || i % 50 == 1; }
+
+  // Returns a batch of NUM_ROWS rows whose slot values cycle through 'values'.
+  template <typename T>
+  RowBatch* CreateBatch(const vector<T>& values) {
+    RowBatch* batch = pool_.Add(new RowBatch(row_desc_.get(), NUM_ROWS, &tracker_));
+    for (int i = 0; i < NUM_ROWS; ++i) {
+      Tuple* tuple = Tuple::Create(SLOT_OFFSET + sizeof(T), batch->tuple_data_pool());
+      const T& value = values[i % values.size()];
+      memcpy(tuple->GetSlot(SLOT_OFFSET), &value, sizeof(T));
+      if (i % 7 == 0) tuple->SetNull(NullIndicatorOffset(0, SLOT_OFFSET));
+      int idx = batch->AddRow();
+      batch->GetRow(idx)->SetTuple(0, i % 50 == 1 ? nullptr : tuple);
+      batch->CommitLastRow();
+    }
+    return batch;
+  }
+
+  ScalarExprEvaluator* CreateSlotRefEval(const ColumnType& type) {
+    SlotRef* expr = pool_.Add(new SlotRef(type, SLOT_OFFSET, true /* nullable */));
+    EXPECT_OK(expr->Init(RowDescriptor(), true, nullptr));
+    exprs_.push_back(expr);
+    ScalarExprEvaluator* eval = nullptr;
+    EXPECT_OK(ScalarExprEvaluator::Create(
+        *expr, nullptr, &pool_, &mem_pool_, &mem_pool_, &eval));
+    EXPECT_OK(eval->Open(nullptr));
+    evals_.push_back(eval);
+    return eval;
+  }
+
+  // Converts the rows of a batch with 'values' into a column of type 'type' with both
+  // functions and checks that the columns are the same. The rows are converted in two
+  // calls that don't start at a byte boundary of the nulls bitmap. 'hs2_vals' returns
+  // the values and nulls of the column that 'type' is converted to.
+  template <typename T, typename HS2_VALS>
+  void CheckParity(const ColumnType& type, const vector<T>& values,
+      HS2_VALS thrift::TColumn::*hs2_vals) {
+    SCOPED_TRACE(type.DebugString());
+    RowBatch* batch = CreateBatch(values);
+    ScalarExprEvaluator* eval = CreateSlotRefEval(type);
+    const TColumnType ttype = type.ToThrift();
+    const int split = 37;
+    thrift::TColumn expected;
+    EvalExprValuesToHS2TColumn(eval, ttype, batch, 0, split, 0, &expected);
+    EvalExprValuesToHS2TColumn(
+        eval, ttype, batch, split, NUM_ROWS - split, split, &expected);
+    thrift::TColumn actual;
+    ASSERT_TRUE(SlotRefValuesToHS2TColumn(eval, ttype, batch, 0, split, 0, &actual));
+    ASSERT_TRUE(SlotRefValuesToHS2TColumn(
+        eval, ttype, batch, split, NUM_ROWS - split, split, &actual));
+    thrift::TColumn dispatched;
+    ExprValuesToHS2TColumn(eval, ttype, batch, 0, NUM_ROWS, 0, &dispatched);
+
+    // TColumn::operator==() only compares the fields marked as set, which the
+    // conversion functions don't do, so compare the converted field.
+    EXPECT_EQ(NUM_ROWS, (actual.*hs2_vals).values.size());
+    EXPECT_TRUE((expected.*hs2_vals).values == (actual.*hs2_vals).values);
+    EXPECT_EQ((expected.*hs2_vals).nulls, (actual.*hs2_vals).nulls);
+    EXPECT_TRUE((expected.*hs2_vals).values == (dispatched.*hs2_vals).values);
+    EXPECT_EQ((expected.*hs2_vals).nulls, (dispatched.*hs2_vals).nulls);
+
+    // The nulls bitmap has a bit for each row, set for NULLs.
+    const string& nulls = (actual.*hs2_vals).nulls;
+    ASSERT_EQ((NUM_ROWS + 7) / 8, nulls.size());
+    for (int i = 0; i < NUM_ROWS; ++i) {
+      EXPECT_EQ(IsNullRow(i), ((nulls[i / 8] >> (i % 8)) & 1) != 0) << "row " << i;
+    }
+  }
+
+  ObjectPool pool_;
+  MemTracker tracker_;
+  MemPool mem_pool_{&tracker_};
+  DescriptorTbl* desc_tbl_ = nullptr;
+  unique_ptr<RowDescriptor> row_desc_;
+  vector<ScalarExpr*> exprs_;
+  vector<ScalarExprEvaluator*> evals_;
+};
+
+TEST_F(SlotRefHS2ColumnTest, FixedWidthTypes) {
+  CheckParity<bool>(ColumnType(TYPE_BOOLEAN), {true, false, false},
+      &thrift::TColumn::boolVal);
+  CheckParity<int8_t>(ColumnType(TYPE_TINYINT), {1, -128, 127, 0},
+      &thrift::TColumn::byteVal);
+  CheckParity<int16_t>(ColumnType(TYPE_SMALLINT), {1, -32768, 32767, 0},
+      &thrift::TColumn::i16Val);
+  CheckParity<int32_t>(ColumnType(TYPE_INT),
+      {1, numeric_limits<int32_t>::min(), numeric_limits<int32_t>::max(), 0},
+      &thrift::TColumn::i32Val);
+  CheckParity<int64_t>(ColumnType(TYPE_BIGINT),
+      {1, numeric_limits<int64_t>::min(), numeric_limits<int64_t>::max(), 0},
+      &thrift::TColumn::i64Val);
+  // FLOAT values are widened to double.
+  CheckParity<float>(ColumnType(TYPE_FLOAT),
+      {1.5f, -0.0f, numeric_limits<float>::max(), numeric_limits<float>::infinity()},
+      &thrift::TColumn::doubleVal);
+  CheckParity<double>(ColumnType(TYPE_DOUBLE),
+      {1.5, -0.0, numeric_limits<double>::lowest(), numeric_limits<double>::min()},
+      &thrift::TColumn::doubleVal);
+}
+
+TEST_F(SlotRefHS2ColumnTest, StringTypes) {
+  vector<StringValue> values = {StringValue("abc"), StringValue(""),
+      StringValue("a longer string with spaces"), StringValue("x")};
+  CheckParity<StringValue>(ColumnType(TYPE_STRING), values,
+      &thrift::TColumn::stringVal);
+  CheckParity<StringValue>(ColumnType::CreateVarcharType(30), values,
+      &thrift::TColumn::stringVal);
+}
+
+// Other exprs and types are not converted and the column is left unchanged.
+TEST_F(SlotRefHS2ColumnTest, Unsupported) {
+  RowBatch* batch = CreateBatch<int64_t>({1, 2, 3});
+  thrift::TColumn column;
+  // A type that is formatted as a string.
+  const ColumnType decimal_type = ColumnType::CreateDecimalType(18, 2);
+  ScalarExprEvaluator* eval = CreateSlotRefEval(decimal_type);
+  EXPECT_FALSE(SlotRefValuesToHS2TColumn(
+      eval, decimal_type.ToThrift(), batch, 0, NUM_ROWS, 0, &column));
+  // A result type that differs from the slot type.
+  eval = CreateSlotRefEval(ColumnType(TYPE_BIGINT));
+  EXPECT_FALSE(SlotRefValuesToHS2TColumn(
+      eval, ColumnType(TYPE_STRING).ToThrift(), batch, 0, NUM_ROWS, 0, &column));
+  EXPECT_TRUE(column.i64Val.values.empty());
+  EXPECT_TRUE(column.stringVal.values.empty());
+  EXPECT_TRUE(column.stringVal.nulls.empty());
+}
@@ -25,6 +25,7 @@
 #include "common/logging.h"
 #include "exprs/scalar-expr.h"
 #include "exprs/scalar-expr-evaluator.h"
+#include "exprs/slot-ref.h"
 #include "runtime/date-value.h"
 #include "runtime/decimal-value.inline.h"
 #include "runtime/raw-value.inline.h"
@@ -423,10 +424,129 @@ static void ArrayExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval,
   }
 }
 
+// Batch implementations of ExprValuesToHS2TColumn for SlotRefs.
+
+// Grows the values and null bits of 'hs2Vals' to 'num_output_rows' so that the values
+// and null bits of the new rows can be set by index instead of being appended one at a
+// time. New values are default-initialized and new null bits are unset.
+template <typename T>
+static void ResizeForRows(uint32_t num_output_rows, T* hs2Vals) {
+  DCHECK_GE(num_output_rows, hs2Vals->values.size());
+  hs2Vals->values.resize(num_output_rows);
+  int64_t num_null_bytes = BitUtil::RoundUpNumBytes(num_output_rows);
+  DCHECK_GE(num_null_bytes, hs2Vals->nulls.size());
+  hs2Vals->nulls.resize(num_null_bytes, '\0');
+}
+
+// Copies the values of the fixed-length slot of type SLOT_TYPE that 'slot_ref' refers to
+// in rows [start_idx, start_idx + num_rows) of 'batch' into 'hs2Vals'. Null slots are
+// written as 0, like the Expr implementations above do.
+template <typename SLOT_TYPE, typename T>
+static void SlotValuesToHS2Values(const SlotRef& slot_ref, RowBatch* batch,
+    int start_idx, int num_rows, uint32_t output_row_idx, T* hs2Vals) {
+  ReserveSpace(num_rows, output_row_idx, hs2Vals);
+  ResizeForRows(output_row_idx + num_rows, hs2Vals);
+  const int tuple_idx = slot_ref.GetTupleIdx();
+  const int slot_offset = slot_ref.GetSlotOffset();
+  const NullIndicatorOffset null_offset = slot_ref.GetNullIndicatorOffset();
+  char* nulls = &hs2Vals->nulls[0];
+  FOREACH_ROW_LIMIT(batch, start_idx, num_rows, it) {
+    const Tuple* tuple = it.Get()->GetTuple(tuple_idx);
+    const bool is_null = tuple == nullptr || tuple->IsNull(null_offset);
+    hs2Vals->values[output_row_idx] = is_null ?
+        0 : *reinterpret_cast<const SLOT_TYPE*>(tuple->GetSlot(slot_offset));
+    nulls[output_row_idx / 8] |= is_null << (output_row_idx % 8);
+    ++output_row_idx;
+  }
+}
+
+// Implementation for STRING and VARCHAR slots.
+static void StringSlotValuesToHS2Values(const SlotRef& slot_ref, RowBatch* batch,
+    int start_idx, int num_rows, uint32_t output_row_idx,
+    apache::hive::service::cli::thrift::TStringColumn* hs2Vals) {
+  ReserveSpace(num_rows, output_row_idx, hs2Vals);
+  ResizeForRows(output_row_idx + num_rows, hs2Vals);
+  const int tuple_idx = slot_ref.GetTupleIdx();
+  const int slot_offset = slot_ref.GetSlotOffset();
+  const NullIndicatorOffset null_offset = slot_ref.GetNullIndicatorOffset();
+  char* nulls = &hs2Vals->nulls[0];
+  FOREACH_ROW_LIMIT(batch, start_idx, num_rows, it) {
+    const Tuple* tuple = it.Get()->GetTuple(tuple_idx);
+    const bool is_null = tuple == nullptr || tuple->IsNull(null_offset);
+    if (!is_null) {
+      const StringValue* sv =
+          reinterpret_cast<const StringValue*>(tuple->GetSlot(slot_offset));
+      hs2Vals->values[output_row_idx].assign(sv->ptr, sv->len);
+    }
+    nulls[output_row_idx / 8] |= is_null << (output_row_idx % 8);
+    ++output_row_idx;
+  }
+}
+
+bool impala::SlotRefValuesToHS2TColumn(ScalarExprEvaluator* expr_eval,
+    const TColumnType& type, RowBatch* batch, int start_idx, int num_rows,
+    uint32_t output_row_idx, apache::hive::service::cli::thrift::TColumn* column) {
+  if (!expr_eval->root().IsSlotRef()) return false;
+  if (type.types.size() != 1 || type.types[0].type != TTypeNodeType::SCALAR) {
+    return false;
+  }
+  const SlotRef& slot_ref = static_cast<const SlotRef&>(expr_eval->root());
+  const PrimitiveType slot_type = slot_ref.type().type;
+  if (slot_type != ThriftToType(type.types[0].scalar_type.type)) return false;
+  switch (slot_type) {
+    case TYPE_BOOLEAN:
+      SlotValuesToHS2Values<bool>(
+          slot_ref, batch, start_idx, num_rows, output_row_idx, &column->boolVal);
+      return true;
+    case TYPE_TINYINT:
+      SlotValuesToHS2Values<int8_t>(
+          slot_ref, batch, start_idx, num_rows, output_row_idx, &column->byteVal);
+      return true;
+    case TYPE_SMALLINT:
+      SlotValuesToHS2Values<int16_t>(
+          slot_ref, batch, start_idx, num_rows, output_row_idx, &column->i16Val);
+      return true;
+    case TYPE_INT:
+      SlotValuesToHS2Values<int32_t>(
+          slot_ref, batch, start_idx, num_rows, output_row_idx, &column->i32Val);
+      return true;
+    case TYPE_BIGINT:
+      SlotValuesToHS2Values<int64_t>(
+          slot_ref, batch, start_idx, num_rows, output_row_idx, &column->i64Val);
+      return true;
+    case TYPE_FLOAT:
+      SlotValuesToHS2Values<float>(
+          slot_ref, batch, start_idx, num_rows, output_row_idx, &column->doubleVal);
+      return true;
+    case TYPE_DOUBLE:
+      SlotValuesToHS2Values<double>(
+          slot_ref, batch, start_idx, num_rows, output_row_idx, &column->doubleVal);
+      return true;
+    case TYPE_STRING:
+    case TYPE_VARCHAR:
+      StringSlotValuesToHS2Values(
+          slot_ref, batch, start_idx, num_rows, output_row_idx, &column->stringVal);
+      return true;
+    default:
+      return false;
+  }
+}
+
 // For V6 and above
 void impala::ExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval,
     const TColumnType& type, RowBatch* batch, int start_idx, int num_rows,
     uint32_t output_row_idx, apache::hive::service::cli::thrift::TColumn* column) {
+  if (SlotRefValuesToHS2TColumn(
+          expr_eval, type, batch, start_idx, num_rows, output_row_idx, column)) {
+    return;
+  }
+  EvalExprValuesToHS2TColumn(
+      expr_eval, type, batch, start_idx, num_rows, output_row_idx, column);
+}
+
+void impala::EvalExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval,
+    const TColumnType& type, RowBatch* batch, int start_idx, int num_rows,
+    uint32_t output_row_idx, apache::hive::service::cli::thrift::TColumn* column) {
   // Dispatch to a templated function for the loop over rows. This avoids branching on
   // the type for every row.
   // TODO: instead of relying on stamped out implementations, we could codegen this loop
@@ -36,11 +36,29 @@ void TColumnValueToHS2TColumn(const TColumnValue& col_val, const TColumnType& ty
 /// Evaluate 'expr_eval' over the row [start_idx, start_idx + num_rows) from 'batch' into
 /// 'column' with 'type' starting at output_row_idx. The caller is responsible for
 /// calling RuntimeState::GetQueryStatus() to check for expression evaluation errors.
+/// Uses SlotRefValuesToHS2TColumn() if possible and EvalExprValuesToHS2TColumn()
+/// otherwise.
 /// For V6->
 void ExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval, const TColumnType& type,
     RowBatch* batch, int start_idx, int num_rows, uint32_t output_row_idx,
     apache::hive::service::cli::thrift::TColumn* column);
 
+/// Same as ExprValuesToHS2TColumn(), but calls 'expr_eval' once per row.
+/// For V6->
+void EvalExprValuesToHS2TColumn(ScalarExprEvaluator* expr_eval, const TColumnType& type,
+    RowBatch* batch, int start_idx, int num_rows, uint32_t output_row_idx,
+    apache::hive::service::cli::thrift::TColumn* column);
+
+/// Same as ExprValuesToHS2TColumn() for an 'expr_eval' whose root is a SlotRef of a
+/// BOOLEAN, integer, floating point, STRING or VARCHAR type. Reads the slots directly
+/// from the tuples in 'batch' in a loop that is specialized for the slot type, and sizes
+/// the values and null bits of 'column' once for all rows. Returns false without
+/// modifying 'column' for any other 'expr_eval'.
+/// For V6->
+bool SlotRefValuesToHS2TColumn(ScalarExprEvaluator* expr_eval, const TColumnType& type,
+    RowBatch* batch, int start_idx, int num_rows, uint32_t output_row_idx,
+    apache::hive::service::cli::thrift::TColumn* column);
+
 /// For V1->V5
 void TColumnValueToHS2TColumnValue(const TColumnValue& col_val, const TColumnType& type,
     apache::hive::service::cli::thrift::TColumnValue* hs2_col_val);
@@ -218,10 +218,17 @@ Status ImpalaServer::FetchInternal(TUniqueId query_id, SessionState* session,
   bool is_child_query = query_handle->parent_query_id() != TUniqueId();
   TProtocolVersion::type version = is_child_query ?
       TProtocolVersion::HIVE_CLI_SERVICE_PROTOCOL_V1 : session->hs2_version;
-  scoped_ptr<QueryResultSet> result_set(QueryResultSet::CreateHS2ResultSet(
-      version, *(query_handle->result_metadata()), &(fetch_results->results)));
+  scoped_ptr<QueryResultSet> result_set;
+  if (query_handle->UseArrowResultFormat()) {
+    result_set.reset(QueryResultSet::CreateArrowResultSet(
+        *(query_handle->result_metadata()), &(fetch_results->results)));
+  } else {
+    result_set.reset(QueryResultSet::CreateHS2ResultSet(
+        version, *(query_handle->result_metadata()), &(fetch_results->results)));
+  }
   RETURN_IF_ERROR(
       query_handle->FetchRows(fetch_size, result_set.get(), block_on_wait_time_us));
+  RETURN_IF_ERROR(result_set->Finalize());
   *num_results = result_set->size();
   fetch_results->__isset.results = true;
   fetch_results->__set_hasMoreRows(!query_handle->eos());
@@ -394,16 +401,18 @@ void ImpalaServer::OpenSession(TOpenSessionResp& return_val,
   return_val.configuration.insert(make_pair("http_addr", http_addr));
 
   {
-    lock_guard<mutex> l(connection_to_sessions_map_lock_);
     const TUniqueId& connection_id = ThriftServer::GetThreadConnectionId();
-    connection_to_sessions_map_[connection_id].insert(session_id);
+    ScopedShardedMapRef<set<TUniqueId>> map_ref(
+        connection_id, &connection_to_sessions_map_);
+    (*map_ref.get())[connection_id].insert(session_id);
     state->connections.insert(connection_id);
   }
 
   // Put the session state in session_state_map_
   {
-    lock_guard<mutex> l(session_state_map_lock_);
-    session_state_map_.insert(make_pair(session_id, state));
+    ScopedShardedMapRef<shared_ptr<SessionState>> map_ref(
+        session_id, &session_state_map_);
+    map_ref->insert(make_pair(session_id, state));
   }
 
   ImpaladMetrics::IMPALA_SERVER_NUM_OPEN_HS2_SESSIONS->Increment(1);
@@ -540,7 +549,10 @@ Status ImpalaServer::SetupResultsCacheing(const QueryHandle& query_handle,
   // Optionally enable result caching on the ClientRequestState.
   if (cache_num_rows > 0) {
     const TResultSetMetadata* result_set_md = query_handle->result_metadata();
-    QueryResultSet* result_set =
+    // The cached rows are copied into the result set of each fetch, so they must have
+    // the same format.
+    QueryResultSet* result_set = query_handle->UseArrowResultFormat() ?
+        QueryResultSet::CreateArrowResultSet(*result_set_md, nullptr) :
         QueryResultSet::CreateHS2ResultSet(session->hs2_version, *result_set_md, nullptr);
     RETURN_IF_ERROR(query_handle->SetResultCache(result_set, cache_num_rows));
   }
@@ -1271,8 +1283,9 @@ void ImpalaServer::AddSessionToConnection(
     const TUniqueId& session_id, SessionState* session) {
   const TUniqueId& connection_id = ThriftServer::GetThreadConnectionId();
   {
-    lock_guard<mutex> l(connection_to_sessions_map_lock_);
-    connection_to_sessions_map_[connection_id].insert(session_id);
+    ScopedShardedMapRef<set<TUniqueId>> map_ref(
+        connection_id, &connection_to_sessions_map_);
+    (*map_ref.get())[connection_id].insert(session_id);
   }
 
   std::lock_guard<std::mutex> session_lock(session->lock);
@@ -540,10 +540,9 @@ void ImpalaHttpHandler::QueryStateHandler(const Webserver::WebRequest& req,
       document->GetAllocator());
 
   Value query_locations(kArrayType);
-  {
-    lock_guard<mutex> l(server_->query_locations_lock_);
-    for (const ImpalaServer::QueryLocations::value_type& location :
-        server_->query_locations_) {
+  server_->query_locations_.DoFuncForAllShards(
+      [&](std::unordered_map<BackendIdPB, ImpalaServer::QueryLocationInfo>* shard) {
+    for (const auto& location : *shard) {
       Value location_json(kObjectType);
       Value location_name(NetworkAddressPBToString(location.second.address).c_str(),
           document->GetAllocator());
@@ -555,18 +554,24 @@ void ImpalaHttpHandler::QueryStateHandler(const Webserver::WebRequest& req,
           document->GetAllocator());
       query_locations.PushBack(location_json, document->GetAllocator());
     }
-  }
+  });
   document->AddMember("query_locations", query_locations, document->GetAllocator());
 }
 
 void ImpalaHttpHandler::SessionsHandler(const Webserver::WebRequest& req,
     Document* document) {
-  lock_guard<mutex> l(server_->session_state_map_lock_);
   Value sessions(kArrayType);
+  uint64_t num_sessions = 0;
   int num_active = 0;
-  for (const ImpalaServer::SessionStateMap::value_type& session:
-           server_->session_state_map_) {
-    shared_ptr<ImpalaServer::SessionState> state = session.second;
+  // The sessions are collected one shard at a time, so the page is not a consistent
+  // snapshot of all sessions if they are opened or closed concurrently. The shard locks
+  // are spinlocks and are not held while the page is built.
+  vector<shared_ptr<ImpalaServer::SessionState>> session_states;
+  server_->session_state_map_.DoFuncForAllEntries(
+      [&](const shared_ptr<ImpalaServer::SessionState>& state) {
+        session_states.push_back(state);
+      });
+  for (const shared_ptr<ImpalaServer::SessionState>& state : session_states) {
     Value session_json(kObjectType);
     Value type(PrintThriftEnum(state->session_type).c_str(), document->GetAllocator());
     session_json.AddMember("type", type, document->GetAllocator());
@@ -583,7 +588,7 @@ void ImpalaHttpHandler::SessionsHandler(const Webserver::WebRequest& req,
     Value delegated_user(state->do_as_user.c_str(), document->GetAllocator());
     session_json.AddMember("delegated_user", delegated_user, document->GetAllocator());
 
-    Value session_id(PrintId(session.first).c_str(), document->GetAllocator());
+    Value session_id(PrintId(state->session_id).c_str(), document->GetAllocator());
     session_json.AddMember("session_id", session_id, document->GetAllocator());
 
     Value network_address(TNetworkAddressToString(state->network_address).c_str(),
@@ -593,17 +598,17 @@ void ImpalaHttpHandler::SessionsHandler(const Webserver::WebRequest& req,
     Value default_db(state->database.c_str(), document->GetAllocator());
     session_json.AddMember("default_database", default_db, document->GetAllocator());
 
-    Value start_time(ToStringFromUnixMillis(session.second->start_time_ms,
+    Value start_time(ToStringFromUnixMillis(state->start_time_ms,
         TimePrecision::Second).c_str(), document->GetAllocator());
     session_json.AddMember("start_time", start_time, document->GetAllocator());
     session_json.AddMember(
-        "start_time_sort", session.second->start_time_ms, document->GetAllocator());
+        "start_time_sort", state->start_time_ms, document->GetAllocator());
 
-    Value last_accessed(ToStringFromUnixMillis(session.second->last_accessed_ms,
+    Value last_accessed(ToStringFromUnixMillis(state->last_accessed_ms,
         TimePrecision::Second).c_str(), document->GetAllocator());
     session_json.AddMember("last_accessed", last_accessed, document->GetAllocator());
     session_json.AddMember(
-        "last_accessed_sort", session.second->last_accessed_ms, document->GetAllocator());
+        "last_accessed_sort", state->last_accessed_ms, document->GetAllocator());
 
     session_json.AddMember("session_timeout", state->session_timeout,
         document->GetAllocator());
@@ -612,14 +617,13 @@ void ImpalaHttpHandler::SessionsHandler(const Webserver::WebRequest& req,
     if (!state->expired && !state->closed) ++num_active;
     session_json.AddMember("ref_count", state->ref_count, document->GetAllocator());
     sessions.PushBack(session_json, document->GetAllocator());
+    ++num_sessions;
   }
 
   document->AddMember("sessions", sessions, document->GetAllocator());
-  document->AddMember("num_sessions",
-      static_cast<uint64_t>(server_->session_state_map_.size()),
-      document->GetAllocator());
+  document->AddMember("num_sessions", num_sessions, document->GetAllocator());
   document->AddMember("num_active", num_active, document->GetAllocator());
-  document->AddMember("num_inactive", server_->session_state_map_.size() - num_active,
+  document->AddMember("num_inactive", num_sessions - num_active,
       document->GetAllocator());
 }
 
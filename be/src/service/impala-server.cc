@@ -83,6 +83,7 @@
 #include "service/client-request-state.h"
 #include "service/frontend.h"
 #include "service/impala-http-handler.h"
+#include "service/query-result-cache.h"
 #include "util/auth-util.h"
 #include "util/bit-util.h"
 #include "util/coding-util.h"
@@ -177,6 +178,17 @@ DEFINE_int64(max_result_cache_size, 100000L, "Maximum number of query results a
     "option guards against unreasonably large result caches requested by clients. "
     "Requests exceeding this maximum will be rejected.");
 
+DEFINE_int64(query_result_cache_capacity_bytes, 0, "Maximum total size in bytes of the "
+    "results of SELECT statements that a coordinator caches across sessions and serves "
+    "to identical statements until the tables they read are modified. If 0, results "
+    "are not cached.");
+DEFINE_int64(query_result_cache_max_entry_bytes, 16L * 1024L * 1024L, "Maximum size in "
+    "bytes of a single result in the query result cache. Larger results are not "
+    "cached.");
+DEFINE_int64(query_result_cache_ttl_s, 600, "Number of seconds after which an entry in "
+    "the query result cache expires, regardless of catalog updates. If 0, entries only "
+    "expire when the tables they read are modified.");
+
 DEFINE_int32(max_audit_event_log_file_size, 5000, "The maximum size (in queries) of the "
     "audit event log file before a new one is created (if event logging is enabled)");
 DEFINE_string(audit_event_log_dir, "", "The directory in which audit event log files are "
@@ -285,6 +297,10 @@ DEFINE_string(executor_groups, "",
     "default-pool-1:3. Default minimum size is 1. Only when the cluster membership "
     "contains at least that number of executors for the group will it be considered "
     "healthy for admission. Currently only a single group may be specified.");
+DEFINE_string(rack, "", "Topology label of the rack (or other network failure domain) "
+    "this Impala daemon runs in. If set on the executors, the scheduler prefers "
+    "executors in the racks of the replicas for remote reads and the exchange senders "
+    "report the bytes they send to other racks in the query profile.");
 
 DEFINE_int32(num_expected_executors, 20,
     "The number of executors that are expected to "
@@ -509,6 +525,13 @@ ImpalaServer::ImpalaServer(ExecEnv* exec_env)
 
   ABORT_IF_ERROR(ExternalDataSourceExecutor::InitJNI(exec_env_->metrics()));
 
+  if (FLAGS_is_coordinator && FLAGS_query_result_cache_capacity_bytes > 0) {
+    query_result_cache_.reset(new QueryResultCache(
+        FLAGS_query_result_cache_capacity_bytes, FLAGS_query_result_cache_max_entry_bytes,
+        FLAGS_query_result_cache_ttl_s * 1000L, exec_env_->process_mem_tracker(),
+        exec_env_->metrics()));
+  }
+
   // Register the catalog update callback if running in a real cluster as a coordinator.
   if (!TestInfo::is_test() && FLAGS_is_coordinator) {
     auto catalog_cb = [this] (const StatestoreSubscriber::TopicDeltaMap& state,
@@ -1503,17 +1526,16 @@ void ImpalaServer::CloseClientRequestState(const QueryHandle& query_handle) {
   if (query_handle->schedule() != nullptr) {
     const RepeatedPtrField<BackendExecParamsPB>& backend_exec_params =
         query_handle->schedule()->backend_exec_params();
-    if (!backend_exec_params.empty()) {
-      lock_guard<mutex> l(query_locations_lock_);
-      for (const BackendExecParamsPB& param : backend_exec_params) {
-        // Query may have been removed already by cancellation path. In particular, if
-        // node to fail was last sender to an exchange, the coordinator will realise and
-        // fail the query at the same time the failure detection path does the same
-        // thing. They will harmlessly race to remove the query from this map.
-        auto it = query_locations_.find(param.backend_id());
-        if (it != query_locations_.end()) {
-          it->second.query_ids.erase(query_handle->query_id());
-        }
+    for (const BackendExecParamsPB& param : backend_exec_params) {
+      // Query may have been removed already by cancellation path. In particular, if
+      // node to fail was last sender to an exchange, the coordinator will realise and
+      // fail the query at the same time the failure detection path does the same
+      // thing. They will harmlessly race to remove the query from this map.
+      ScopedShardedMapPBRef<QueryLocationInfo> map_ref(
+          param.backend_id(), &query_locations_);
+      auto it = map_ref->find(param.backend_id());
+      if (it != map_ref->end()) {
+        it->second.query_ids.erase(query_handle->query_id());
       }
     }
   }
@@ -1644,13 +1666,14 @@ Status ImpalaServer::CloseSessionInternal(const TUniqueId& session_id,
   // Find the session_state and remove it from the map.
   shared_ptr<SessionState> session_state;
   {
-    lock_guard<mutex> l(session_state_map_lock_);
-    SessionStateMap::iterator entry = session_state_map_.find(session_id);
-    if (entry == session_state_map_.end() || !secret.Validate(entry->second->secret)) {
+    ScopedShardedMapRef<shared_ptr<SessionState>> map_ref(
+        session_id, &session_state_map_);
+    auto entry = map_ref->find(session_id);
+    if (entry == map_ref->end() || !secret.Validate(entry->second->secret)) {
       if (ignore_if_absent) {
         return Status::OK();
       } else {
-        if (entry != session_state_map_.end()) {
+        if (entry != map_ref->end()) {
           // Log invalid attempts to connect. Be careful not to log secret.
           VLOG(1) << "Client tried to connect to session " << PrintId(session_id)
                   << " with invalid secret.";
@@ -1661,23 +1684,30 @@ Status ImpalaServer::CloseSessionInternal(const TUniqueId& session_id,
       }
     }
     session_state = entry->second;
-    session_state_map_.erase(session_id);
+    map_ref->erase(entry);
   }
   DCHECK(session_state != nullptr);
-  if (session_state->session_type == TSessionType::BEESWAX) {
-    ImpaladMetrics::IMPALA_SERVER_NUM_OPEN_BEESWAX_SESSIONS->Increment(-1L);
-  } else {
-    ImpaladMetrics::IMPALA_SERVER_NUM_OPEN_HS2_SESSIONS->Increment(-1L);
-  }
   unordered_set<TUniqueId> inflight_queries;
   {
     lock_guard<mutex> l(session_state->lock);
-    DCHECK(!session_state->closed);
+    // SessionMaintenance() may have closed the session after it was looked up in the
+    // map. Whoever sets 'closed' is responsible for cleaning up the session.
+    if (session_state->closed) {
+      if (ignore_if_absent) return Status::OK();
+      string err_msg = Substitute("Invalid session id: $0", PrintId(session_id));
+      VLOG(1) << "CloseSessionInternal(): " << err_msg;
+      return Status::Expected(err_msg);
+    }
     session_state->closed = true;
     // Since closed is true, no more queries will be added to the inflight list.
     inflight_queries.insert(session_state->inflight_queries.begin(),
         session_state->inflight_queries.end());
   }
+  if (session_state->session_type == TSessionType::BEESWAX) {
+    ImpaladMetrics::IMPALA_SERVER_NUM_OPEN_BEESWAX_SESSIONS->Increment(-1L);
+  } else {
+    ImpaladMetrics::IMPALA_SERVER_NUM_OPEN_HS2_SESSIONS->Increment(-1L);
+  }
   // Unregister all open queries from this session.
   Status status = Status::Expected("Session closed");
   for (const TUniqueId& query_id: inflight_queries) {
@@ -1692,43 +1722,49 @@ Status ImpalaServer::CloseSessionInternal(const TUniqueId& session_id,
 
 Status ImpalaServer::GetSessionState(const TUniqueId& session_id, const SecretArg& secret,
     shared_ptr<SessionState>* session_state, bool mark_active) {
-  lock_guard<mutex> l(session_state_map_lock_);
-  SessionStateMap::iterator i = session_state_map_.find(session_id);
-  // TODO: consider factoring out the lookup and secret validation into a separate method.
-  // This would require rethinking the locking protocol for 'session_state_map_lock_' -
-  // it probably doesn't not need to be held for the full duration of this function.
-  if (i == session_state_map_.end() || !secret.Validate(i->second->secret)) {
-    if (i != session_state_map_.end()) {
+  shared_ptr<SessionState> state;
+  {
+    // Only the lookup and the secret validation happen under the shard lock, which is a
+    // spinlock, so that it is never held while waiting for SessionState::lock.
+    ScopedShardedMapRef<shared_ptr<SessionState>> map_ref(
+        session_id, &session_state_map_);
+    auto i = map_ref->find(session_id);
+    if (i != map_ref->end() && secret.Validate(i->second->secret)) state = i->second;
+    if (i != map_ref->end() && state == nullptr) {
       // Log invalid attempts to connect. Be careful not to log secret.
       VLOG(1) << "Client tried to connect to session " << PrintId(session_id)
               << " with invalid "
               << (secret.is_session_secret() ? "session" : "operation") << " secret.";
     }
+  }
+  if (state == nullptr) {
     *session_state = shared_ptr<SessionState>();
     string err_msg = secret.is_session_secret() ?
         Substitute("Invalid session id: $0", PrintId(session_id)) :
         Substitute(LEGACY_INVALID_QUERY_HANDLE_TEMPLATE, PrintId(secret.query_id()));
     VLOG(1) << "GetSessionState(): " << err_msg;
     return Status::Expected(err_msg);
-  } else {
-    if (mark_active) {
-      lock_guard<mutex> session_lock(i->second->lock);
-      if (i->second->expired) {
-        stringstream ss;
-        ss << "Client session expired due to more than " << i->second->session_timeout
-           << "s of inactivity (last activity was at: "
-           << ToStringFromUnixMillis(i->second->last_accessed_ms) << ").";
-        return Status::Expected(ss.str());
-      }
-      if (i->second->closed) {
-        VLOG(1) << "GetSessionState(): session " << PrintId(session_id) << " is closed.";
-        return Status::Expected("Session is closed");
-      }
-      ++i->second->ref_count;
-    }
-    *session_state = i->second;
-    return Status::OK();
   }
+  if (mark_active) {
+    // The session may have been expired or closed since it was looked up. Both are
+    // checked under the same lock that SessionMaintenance() and CloseSessionInternal()
+    // set them under, so a session that is returned here is not closed concurrently.
+    lock_guard<mutex> session_lock(state->lock);
+    if (state->expired) {
+      stringstream ss;
+      ss << "Client session expired due to more than " << state->session_timeout
+         << "s of inactivity (last activity was at: "
+         << ToStringFromUnixMillis(state->last_accessed_ms) << ").";
+      return Status::Expected(ss.str());
+    }
+    if (state->closed) {
+      VLOG(1) << "GetSessionState(): session " << PrintId(session_id) << " is closed.";
+      return Status::Expected("Session is closed");
+    }
+    ++state->ref_count;
+  }
+  *session_state = move(state);
+  return Status::OK();
 }
 
 void ImpalaServer::InitializeConfigVariables() {
@@ -2043,7 +2079,12 @@ void ImpalaServer::CatalogUpdateCallback(
     // Dropped all cached lib files (this behaves as if all functions and data
     // sources are dropped).
     LibCache::instance()->DropCache();
+    if (query_result_cache_ != nullptr) query_result_cache_->InvalidateAll();
   } else {
+    if (query_result_cache_ != nullptr) {
+      query_result_cache_->InvalidateCatalogTopicEntries(
+          delta.topic_entries, delta.is_delta);
+    }
     {
       unique_lock<mutex> unique_lock(catalog_version_lock_);
       if (catalog_update_info_.catalog_version != resp.new_catalog_version) {
@@ -2137,6 +2178,10 @@ void ImpalaServer::WaitForMinCatalogUpdate(const int64_t min_req_catalog_object_
 Status ImpalaServer::ProcessCatalogUpdateResult(
     const TCatalogUpdateResult& catalog_update_result, bool wait_for_all_subscribers) {
   const TUniqueId& catalog_service_id = catalog_update_result.catalog_service_id;
+  // Don't wait for the topic update to drop results that this operation made stale.
+  if (query_result_cache_ != nullptr) {
+    query_result_cache_->InvalidateCatalogObjects(catalog_update_result);
+  }
   if (!catalog_update_result.__isset.updated_catalog_objects &&
       !catalog_update_result.__isset.removed_catalog_objects) {
     // Operation with no result set. Use the version specified in
@@ -2215,17 +2260,17 @@ void ImpalaServer::RegisterQueryLocations(
     const RepeatedPtrField<BackendExecParamsPB>& backend_params,
     const TUniqueId& query_id) {
   VLOG_QUERY << "Registering query locations";
-  if (!backend_params.empty()) {
-    lock_guard<mutex> l(query_locations_lock_);
-    for (const BackendExecParamsPB& param : backend_params) {
-      const BackendIdPB& backend_id = param.backend_id();
-      auto it = query_locations_.find(backend_id);
-      if (it == query_locations_.end()) {
-        query_locations_.emplace(
-            backend_id, QueryLocationInfo(param.address(), query_id));
-      } else {
-        it->second.query_ids.insert(query_id);
-      }
+  // The backends are registered one shard at a time. A backend that fails while this
+  // runs is still caught by the next membership update, since its entry is only
+  // removed once it is absent from the membership.
+  for (const BackendExecParamsPB& param : backend_params) {
+    const BackendIdPB& backend_id = param.backend_id();
+    ScopedShardedMapPBRef<QueryLocationInfo> map_ref(backend_id, &query_locations_);
+    auto it = map_ref->find(backend_id);
+    if (it == map_ref->end()) {
+      map_ref->emplace(backend_id, QueryLocationInfo(param.address(), query_id));
+    } else {
+      it->second.query_ids.insert(query_id);
     }
   }
 }
@@ -2241,19 +2286,21 @@ void ImpalaServer::CancelQueriesOnFailedBackends(
   {
     // Build a list of queries that are running on failed hosts (as evidenced by their
     // absence from the membership list).
-    lock_guard<mutex> l(query_locations_lock_);
-    QueryLocations::const_iterator loc_entry = query_locations_.begin();
-    while (loc_entry != query_locations_.end()) {
-      if (current_membership.find(loc_entry->first) == current_membership.end()) {
-        // Add failed backend locations to all queries that ran on that backend.
-        for (const auto& query_id : loc_entry->second.query_ids) {
-          queries_to_cancel[query_id].push_back(loc_entry->second.address);
-        }
-        loc_entry = query_locations_.erase(loc_entry);
-      } else {
-        ++loc_entry;
-      }
-    }
+    query_locations_.DoFuncForAllShards(
+        [&](std::unordered_map<BackendIdPB, QueryLocationInfo>* shard) {
+          auto loc_entry = shard->begin();
+          while (loc_entry != shard->end()) {
+            if (current_membership.find(loc_entry->first) == current_membership.end()) {
+              // Add failed backend locations to all queries that ran on that backend.
+              for (const auto& query_id : loc_entry->second.query_ids) {
+                queries_to_cancel[query_id].push_back(loc_entry->second.address);
+              }
+              loc_entry = shard->erase(loc_entry);
+            } else {
+              ++loc_entry;
+            }
+          }
+        });
   }
 
   if (cancellation_thread_pool_->GetQueueSize() + queries_to_cancel.size() >
@@ -2327,6 +2374,7 @@ void ImpalaServer::BuildLocalBackendDescriptorInternal(BackendDescriptorPB* be_d
   be_desc->set_admit_mem_limit(exec_env_->admit_mem_limit());
   be_desc->set_admission_slots(exec_env_->admission_slots());
   be_desc->set_is_quiescing(is_quiescing);
+  if (!FLAGS_rack.empty()) be_desc->set_rack(FLAGS_rack);
   SetExecutorGroups(FLAGS_executor_groups, be_desc);
 }
 
@@ -2437,15 +2485,16 @@ void ImpalaServer::ConnectionStart(
     RegisterSessionTimeout(session_state->session_timeout);
 
     {
-      lock_guard<mutex> l(session_state_map_lock_);
-      bool success =
-          session_state_map_.insert(make_pair(session_id, session_state)).second;
+      ScopedShardedMapRef<shared_ptr<SessionState>> map_ref(
+          session_id, &session_state_map_);
+      bool success = map_ref->insert(make_pair(session_id, session_state)).second;
       // The session should not have already existed.
       DCHECK(success);
     }
     {
-      lock_guard<mutex> l(connection_to_sessions_map_lock_);
-      connection_to_sessions_map_[connection_context.connection_id].insert(session_id);
+      ScopedShardedMapRef<set<TUniqueId>> map_ref(
+          connection_context.connection_id, &connection_to_sessions_map_);
+      (*map_ref.get())[connection_context.connection_id].insert(session_id);
     }
     ImpaladMetrics::IMPALA_SERVER_NUM_OPEN_BEESWAX_SESSIONS->Increment(1L);
   }
@@ -2455,12 +2504,12 @@ void ImpalaServer::ConnectionEnd(
     const ThriftServer::ConnectionContext& connection_context) {
   set<TUniqueId> disconnected_sessions;
   {
-    unique_lock<mutex> l(connection_to_sessions_map_lock_);
-    ConnectionToSessionMap::iterator it =
-        connection_to_sessions_map_.find(connection_context.connection_id);
+    ScopedShardedMapRef<set<TUniqueId>> map_ref(
+        connection_context.connection_id, &connection_to_sessions_map_);
+    auto it = map_ref->find(connection_context.connection_id);
 
     // Not every connection must have an associated session
-    if (it == connection_to_sessions_map_.end()) return;
+    if (it == map_ref->end()) return;
 
     // Sessions are not removed from the map even after they are closed and an entry
     // won't be added to the map unless a session is established.
@@ -2469,7 +2518,7 @@ void ImpalaServer::ConnectionEnd(
     // We don't expect a large number of sessions per connection, so we copy it, so that
     // we can drop the map lock early.
     disconnected_sessions = std::move(it->second);
-    connection_to_sessions_map_.erase(it);
+    map_ref->erase(it);
   }
 
   const string connection_id = PrintId(connection_context.connection_id);
@@ -2515,11 +2564,12 @@ bool ImpalaServer::IsIdleConnection(
   std::set<TUniqueId> session_ids;
   {
     TUniqueId connection_id = connection_context.connection_id;
-    unique_lock<mutex> l(connection_to_sessions_map_lock_);
-    ConnectionToSessionMap::iterator it = connection_to_sessions_map_.find(connection_id);
+    ScopedShardedMapRef<set<TUniqueId>> map_ref(
+        connection_id, &connection_to_sessions_map_);
+    auto it = map_ref->find(connection_id);
 
     // Not every connection must have an associated session
-    if (it == connection_to_sessions_map_.end()) return false;
+    if (it == map_ref->end()) return false;
 
     session_ids = it->second;
 
@@ -2529,18 +2579,22 @@ bool ImpalaServer::IsIdleConnection(
     DCHECK(!session_ids.empty());
   }
 
-  // Check if all the sessions associated with the connection are idle.
-  {
-    lock_guard<mutex> map_lock(session_state_map_lock_);
-    for (const TUniqueId& session_id : session_ids) {
-      const auto it = session_state_map_.find(session_id);
-      if (it == session_state_map_.end()) continue;
-
-      // If any session associated with this connection is not idle,
-      // the connection is not idle.
-      lock_guard<mutex> state_lock(it->second->lock);
-      if (!it->second->expired) return false;
+  // Check if all the sessions associated with the connection are idle. The sessions
+  // may live in different shards, so they are looked up one at a time.
+  for (const TUniqueId& session_id : session_ids) {
+    shared_ptr<SessionState> session_state;
+    {
+      ScopedShardedMapRef<shared_ptr<SessionState>> map_ref(
+          session_id, &session_state_map_);
+      const auto it = map_ref->find(session_id);
+      if (it == map_ref->end()) continue;
+      session_state = it->second;
     }
+
+    // If any session associated with this connection is not idle,
+    // the connection is not idle.
+    lock_guard<mutex> state_lock(session_state->lock);
+    if (!session_state->expired) return false;
   }
   return true;
 }
@@ -2578,75 +2632,104 @@ void ImpalaServer::UnregisterSessionTimeout(int32_t session_timeout) {
     int64_t now = UnixMillis();
     int expired_cnt = 0;
     VLOG(3) << "Session maintenance thread waking up";
-    {
-      // TODO: If holding session_state_map_lock_ for the duration of this loop is too
-      // expensive, consider a priority queue.
-      lock_guard<mutex> map_lock(session_state_map_lock_);
-      vector<TUniqueId> sessions_to_remove;
-      for (SessionStateMap::value_type& map_entry : session_state_map_) {
-        const TUniqueId& session_id = map_entry.first;
-        std::shared_ptr<SessionState> session_state = map_entry.second;
-        unordered_set<TUniqueId> inflight_queries;
-        Status query_cancel_status;
-        {
-          lock_guard<mutex> state_lock(session_state->lock);
-          if (session_state->ref_count > 0) continue;
-          // A session closed by other means is in the process of being removed, and it's
-          // best not to interfere.
-          if (session_state->closed) continue;
-
-          if (session_state->connections.size() == 0
-              && (now - session_state->disconnected_ms)
-                  >= FLAGS_disconnected_session_timeout * 1000L) {
-            // This session has no active connections and is past the disconnected session
-            // timeout, so close it.
-            DCHECK(session_state->session_type == TSessionType::HIVESERVER2 ||
-                session_state->session_type == TSessionType::EXTERNAL_FRONTEND);
-            LOG(INFO) << "Closing session: " << PrintId(session_id)
-                      << ", user: " << session_state->connected_user
-                      << ", because it no longer  has any open connections. The last "
-                      << "connection was closed at: "
-                      << ToStringFromUnixMillis(session_state->disconnected_ms);
-            session_state->closed = true;
-            sessions_to_remove.push_back(session_id);
-            ImpaladMetrics::IMPALA_SERVER_NUM_OPEN_HS2_SESSIONS->Increment(-1L);
-            UnregisterSessionTimeout(FLAGS_disconnected_session_timeout);
-            query_cancel_status =
-                Status::Expected(TErrorCode::DISCONNECTED_SESSION_CLOSED);
-          } else {
-            // Check if the session should be expired.
-            if (session_state->expired || session_state->session_timeout == 0) {
-              continue;
+    // Only take a snapshot of the sessions while the shard locks are held. They are
+    // spinlocks, so the session locks are taken and the cancellations are queued after
+    // they were released. 'closed' and 'ref_count' are checked under the session lock,
+    // which makes this safe against concurrent calls to GetSessionState() and
+    // CloseSessionInternal().
+    // The snapshot is sized outside of the shard locks so that copying the sessions
+    // under them doesn't allocate. If sessions were opened in the meantime and don't
+    // fit, the snapshot is sized again and retaken.
+    vector<pair<TUniqueId, shared_ptr<SessionState>>> sessions;
+    size_t num_sessions = 0;
+    session_state_map_.DoFuncForAllShards(
+        [&](std::unordered_map<TUniqueId, shared_ptr<SessionState>>* shard) {
+          num_sessions += shard->size();
+        });
+    bool copied_all = false;
+    while (!copied_all) {
+      sessions.clear();
+      sessions.reserve(num_sessions + num_sessions / 8 + 16);
+      copied_all = true;
+      num_sessions = 0;
+      session_state_map_.DoFuncForAllShards(
+          [&](std::unordered_map<TUniqueId, shared_ptr<SessionState>>* shard) {
+            num_sessions += shard->size();
+            if (sessions.size() + shard->size() > sessions.capacity()) {
+              copied_all = false;
+              return;
             }
-
-            int64_t last_accessed_ms = session_state->last_accessed_ms;
-            int64_t session_timeout_ms = session_state->session_timeout * 1000;
-            if (now - last_accessed_ms <= session_timeout_ms) continue;
-            LOG(INFO) << "Expiring session: " << PrintId(session_id)
-                      << ", user: " << session_state->connected_user
-                      << ", last active: " << ToStringFromUnixMillis(last_accessed_ms);
-            session_state->expired = true;
-            ++expired_cnt;
-            ImpaladMetrics::NUM_SESSIONS_EXPIRED->Increment(1L);
-            query_cancel_status = Status::Expected(TErrorCode::INACTIVE_SESSION_EXPIRED);
+            sessions.insert(sessions.end(), shard->begin(), shard->end());
+          });
+    }
+    vector<pair<TUniqueId, shared_ptr<SessionState>>> sessions_to_remove;
+    for (const auto& map_entry : sessions) {
+      const TUniqueId& session_id = map_entry.first;
+      const shared_ptr<SessionState>& session_state = map_entry.second;
+      unordered_set<TUniqueId> inflight_queries;
+      Status query_cancel_status;
+      {
+        lock_guard<mutex> state_lock(session_state->lock);
+        if (session_state->ref_count > 0) continue;
+        // A session closed by other means is in the process of being removed, and it's
+        // best not to interfere.
+        if (session_state->closed) continue;
+
+        if (session_state->connections.size() == 0
+            && (now - session_state->disconnected_ms)
+                >= FLAGS_disconnected_session_timeout * 1000L) {
+          // This session has no active connections and is past the disconnected session
+          // timeout, so close it.
+          DCHECK(session_state->session_type == TSessionType::HIVESERVER2 ||
+              session_state->session_type == TSessionType::EXTERNAL_FRONTEND);
+          LOG(INFO) << "Closing session: " << PrintId(session_id)
+                    << ", user: " << session_state->connected_user
+                    << ", because it no longer  has any open connections. The last "
+                    << "connection was closed at: "
+                    << ToStringFromUnixMillis(session_state->disconnected_ms);
+          session_state->closed = true;
+          sessions_to_remove.push_back(map_entry);
+          ImpaladMetrics::IMPALA_SERVER_NUM_OPEN_HS2_SESSIONS->Increment(-1L);
+          UnregisterSessionTimeout(FLAGS_disconnected_session_timeout);
+          query_cancel_status =
+              Status::Expected(TErrorCode::DISCONNECTED_SESSION_CLOSED);
+        } else {
+          // Check if the session should be expired.
+          if (session_state->expired || session_state->session_timeout == 0) {
+            continue;
           }
 
-          // Since either expired or closed is true no more queries will be added to the
-          // inflight list.
-          inflight_queries.insert(session_state->inflight_queries.begin(),
-              session_state->inflight_queries.end());
-        }
-        // Unregister all open queries from this session.
-        for (const TUniqueId& query_id : inflight_queries) {
-          cancellation_thread_pool_->Offer(
-              CancellationWork::TerminatedByServer(query_id, query_cancel_status, true));
+          int64_t last_accessed_ms = session_state->last_accessed_ms;
+          int64_t session_timeout_ms = session_state->session_timeout * 1000;
+          if (now - last_accessed_ms <= session_timeout_ms) continue;
+          LOG(INFO) << "Expiring session: " << PrintId(session_id)
+                    << ", user: " << session_state->connected_user
+                    << ", last active: " << ToStringFromUnixMillis(last_accessed_ms);
+          session_state->expired = true;
+          ++expired_cnt;
+          ImpaladMetrics::NUM_SESSIONS_EXPIRED->Increment(1L);
+          query_cancel_status = Status::Expected(TErrorCode::INACTIVE_SESSION_EXPIRED);
         }
+
+        // Since either expired or closed is true no more queries will be added to the
+        // inflight list.
+        inflight_queries.insert(session_state->inflight_queries.begin(),
+            session_state->inflight_queries.end());
       }
-      // Remove any sessions that were closed from the map.
-      for (const TUniqueId& session_id : sessions_to_remove) {
-        session_state_map_.erase(session_id);
+      // Unregister all open queries from this session.
+      for (const TUniqueId& query_id : inflight_queries) {
+        cancellation_thread_pool_->Offer(
+            CancellationWork::TerminatedByServer(query_id, query_cancel_status, true));
       }
     }
+    // Remove any sessions that were closed from the map. CloseSessionInternal() may
+    // have removed them already.
+    for (const auto& map_entry : sessions_to_remove) {
+      ScopedShardedMapRef<shared_ptr<SessionState>> map_ref(
+          map_entry.first, &session_state_map_);
+      auto it = map_ref->find(map_entry.first);
+      if (it != map_ref->end() && it->second == map_entry.second) map_ref->erase(it);
+    }
     LOG_IF(INFO, expired_cnt > 0) << "Expired sessions. Count: " << expired_cnt;
   }
 }
@@ -76,6 +76,7 @@ class ClientRequestState;
 class QueryDriver;
 struct QueryHandle;
 class SimpleLogger;
+class QueryResultCache;
 class UpdateFilterParamsPB;
 class UpdateFilterResultPB;
 class TQueryExecRequest;
@@ -175,21 +176,24 @@ class TQueryExecRequest;
 /// This class is partially thread-safe. To ensure freedom from deadlock, if multiple
 /// locks are acquired, lower-numbered locks must be acquired before higher-numbered
 /// locks:
-/// 1. session_state_map_lock_
-/// 2. SessionState::lock
-/// 3. query_expiration_lock_
-/// 4. ClientRequestState::fetch_rows_lock
-/// 5. ClientRequestState::lock
-/// 6. ClientRequestState::expiration_data_lock_
-/// 7. Coordinator::exec_summary_lock
+/// 1. SessionState::lock
+/// 2. query_expiration_lock_
+/// 3. ClientRequestState::fetch_rows_lock
+/// 4. ClientRequestState::lock
+/// 5. ClientRequestState::expiration_data_lock_
+/// 6. Coordinator::exec_summary_lock
 ///
 /// The following locks are not held in conjunction with other locks:
+/// * the lock of a session_state_map_ shard. The shard locks are spinlocks, so a
+///   session is copied out of the map before its SessionState::lock is taken.
 /// * query_log_lock_
 /// * session_timeout_lock_
-/// * query_locations_lock_
+/// * the lock of a query_locations_ shard
 /// * uuid_lock_
 /// * catalog_version_lock_
-/// * connection_to_sessions_map_lock_
+/// * the lock of a connection_to_sessions_map_ shard
+///
+/// At most one shard lock of a sharded map is held at a time.
 ///
 /// TODO: The same doesn't apply to the execution state of an individual plan
 /// fragment: the originating coordinator might die, but we can get notified of
@@ -457,6 +461,9 @@ class ImpalaServer : public ImpalaServiceIf,
   /// Returns true if this is an executor, false otherwise.
   bool IsExecutor();
 
+  /// Returns the server-wide cache of query results, or nullptr if it is disabled.
+  QueryResultCache* query_result_cache() const { return query_result_cache_.get(); }
+
   /// Returns whether this backend is healthy, i.e. able to accept queries.
   bool IsHealthy();
 
@@ -1248,6 +1255,10 @@ class ImpalaServer : public ImpalaServiceIf,
   /// is called on all QueryHandles added to this pool.
   boost::scoped_ptr<ThreadPool<QueryHandle>> unreg_thread_pool_;
 
+  /// Cache of the results of SELECT statements, shared by all sessions. Only created on
+  /// coordinators if --query_result_cache_capacity_bytes > 0.
+  boost::scoped_ptr<QueryResultCache> query_result_cache_;
+
   /// Thread that runs SessionMaintenance. It will wake up periodically to check for
   /// sessions which are idle for more their timeout values.
   std::unique_ptr<Thread> session_maintenance_thread_;
@@ -1417,23 +1428,18 @@ class ImpalaServer : public ImpalaServiceIf,
   /// For access to GetSessionState() / MarkSessionInactive()
   friend class ScopedSessionState;
 
-  /// Protects session_state_map_. See "Locking" in the class comment for lock
-  /// acquisition order.
-  std::mutex session_state_map_lock_;
-
-  /// A map from session identifier to a structure containing per-session information
-  typedef boost::unordered_map<TUniqueId, std::shared_ptr<SessionState>> SessionStateMap;
+  /// A map from session identifier to a structure containing per-session information.
+  /// Sharded by session id so that the lookups done by every client RPC don't contend
+  /// on a single lock. See "Locking" in the class comment for lock acquisition order.
+  typedef ShardedQueryMap<std::shared_ptr<SessionState>> SessionStateMap;
   SessionStateMap session_state_map_;
 
-  /// Protects connection_to_sessions_map_. See "Locking" in the class comment for lock
-  /// acquisition order.
-  std::mutex connection_to_sessions_map_lock_;
-
   /// Map from a connection ID to the associated list of sessions so that all can be
   /// closed when the connection ends. HS2 allows for multiplexing several sessions across
   /// a single connection. If a session has already been closed (only possible via HS2) it
-  /// is not removed from this map to avoid the cost of looking it up.
-  typedef boost::unordered_map<TUniqueId, std::set<TUniqueId>> ConnectionToSessionMap;
+  /// is not removed from this map to avoid the cost of looking it up. Sharded by
+  /// connection id.
+  typedef ShardedQueryMap<std::set<TUniqueId>> ConnectionToSessionMap;
   ConnectionToSessionMap connection_to_sessions_map_;
 
   /// Returns session state for given session_id.
@@ -1464,9 +1470,6 @@ class ImpalaServer : public ImpalaServiceIf,
   /// 'connection_to_sessions_map_' and 'SessionState::connections'.
   void AddSessionToConnection(const TUniqueId& session_id, SessionState* session);
 
-  /// Protects query_locations_. Not held in conjunction with other locks.
-  std::mutex query_locations_lock_;
-
   /// Entries in the 'query_locations' map.
   struct QueryLocationInfo {
     QueryLocationInfo(NetworkAddressPB address, TUniqueId query_id) : address(address) {
@@ -1482,8 +1485,9 @@ class ImpalaServer : public ImpalaServiceIf,
   };
 
   /// Contains info about what queries are running on each backend, so that they can be
-  /// cancelled if the backend goes down.
-  typedef std::unordered_map<BackendIdPB, QueryLocationInfo> QueryLocations;
+  /// cancelled if the backend goes down. Sharded by backend id; the shard locks are not
+  /// held in conjunction with other locks.
+  typedef ShardedQueryPBMap<QueryLocationInfo> QueryLocations;
   QueryLocations query_locations_;
 
   /// The local backend descriptor. Updated in GetLocalBackendDescriptor() and protected
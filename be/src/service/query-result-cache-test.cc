@@ -0,0 +1,234 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gen-cpp/CatalogService_types.h"
+#include "gen-cpp/Frontend_types.h"
+#include "gen-cpp/StatestoreService_types.h"
+#include "runtime/mem-tracker.h"
+#include "service/query-result-cache.h"
+#include "testutil/gtest-util.h"
+#include "util/metrics.h"
+#include "util/time.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+class QueryResultCacheTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    TColumn col;
+    col.columnName = "s";
+    metadata_.columns.push_back(col);
+  }
+
+  virtual void TearDown() {
+    cache_.reset();
+    mem_tracker_.Close();
+  }
+
+  void CreateCache(int64_t capacity_bytes, int64_t ttl_ms = 0) {
+    cache_.reset(new QueryResultCache(
+        capacity_bytes, capacity_bytes, ttl_ms, &mem_tracker_, &metrics_));
+  }
+
+  /// Returns an entry with 'num_rows' rows that depends on 'tables'.
+  unique_ptr<QueryResultCache::Entry> MakeEntry(
+      const vector<string>& tables, int num_rows = 1) {
+    unique_ptr<QueryResultCache::Entry> entry(
+        new QueryResultCache::Entry(QueryResultCache::ASCII, metadata_));
+    entry->tables = tables;
+    for (int i = 0; i < num_rows; ++i) {
+      TResultRow row;
+      row.colVals.resize(1);
+      row.colVals[0].__set_string_val("0123456789");
+      EXPECT_OK(entry->rows()->AddOneRow(row));
+    }
+    return entry;
+  }
+
+  static TTopicItem TopicItem(const string& key) {
+    TTopicItem item;
+    item.key = key;
+    return item;
+  }
+
+  TResultSetMetadata metadata_;
+  MetricGroup metrics_{"query-result-cache-test"};
+  MemTracker mem_tracker_;
+  unique_ptr<QueryResultCache> cache_;
+};
+
+TEST_F(QueryResultCacheTest, NormalizeStatement) {
+  EXPECT_EQ("select * from t",
+      QueryResultCache::NormalizeStatement("  select *\n\tfrom   t ;  "));
+  // Whitespace in quotes is preserved.
+  EXPECT_EQ("select 'a  b', \"c  d\", `e  f` from t",
+      QueryResultCache::NormalizeStatement("select 'a  b',  \"c  d\", `e  f`  from t"));
+  EXPECT_EQ("select 'it\\'s  ok'",
+      QueryResultCache::NormalizeStatement("select   'it\\'s  ok'"));
+  // The line break that ends a comment is significant.
+  EXPECT_EQ("select 1 -- comment\n , 2",
+      QueryResultCache::NormalizeStatement("select 1 -- comment\n  , 2"));
+}
+
+// Cacheability of statements with non-deterministic functions is decided by the
+// frontend, which also sees calls in view definitions and UDFs. The statement text is
+// not inspected.
+TEST_F(QueryResultCacheTest, IsCacheable) {
+  TExecRequest exec_request;
+  exec_request.stmt_type = TStmtType::QUERY;
+  exec_request.__set_result_set_metadata(metadata_);
+  exec_request.__isset.query_exec_request = true;
+  exec_request.query_exec_request.query_ctx.client_request.stmt =
+      "select 'rand()' /* uuid() */";
+  vector<string> tables;
+  EXPECT_TRUE(QueryResultCache::IsCacheable(exec_request, &tables));
+  EXPECT_TRUE(tables.empty());
+
+  exec_request.query_exec_request.query_ctx.client_request.stmt = "select * from v";
+  exec_request.query_exec_request.__set_has_nondeterministic_fn(true);
+  EXPECT_FALSE(QueryResultCache::IsCacheable(exec_request, &tables));
+}
+
+TEST_F(QueryResultCacheTest, InsertAndLookup) {
+  CreateCache(1024 * 1024);
+  EXPECT_EQ(nullptr, cache_->Lookup("q1"));
+  cache_->Insert("q1", cache_->generation(), MakeEntry({"db.t1"}, 3));
+  shared_ptr<const QueryResultCache::Entry> entry = cache_->Lookup("q1");
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(3, entry->rows()->size());
+  EXPECT_EQ(nullptr, cache_->Lookup("q2"));
+  EXPECT_EQ(1, cache_->num_entries());
+  EXPECT_GT(mem_tracker_.consumption(), 0);
+}
+
+TEST_F(QueryResultCacheTest, LruEviction) {
+  const int64_t entry_bytes = MakeEntry({})->rows()->ByteSize();
+  CreateCache(2 * entry_bytes);
+  cache_->Insert("q1", cache_->generation(), MakeEntry({"db.t1"}));
+  cache_->Insert("q2", cache_->generation(), MakeEntry({"db.t2"}));
+  // Make q1 the most recently used entry.
+  EXPECT_NE(nullptr, cache_->Lookup("q1"));
+  cache_->Insert("q3", cache_->generation(), MakeEntry({"db.t3"}));
+  EXPECT_EQ(2, cache_->num_entries());
+  EXPECT_NE(nullptr, cache_->Lookup("q1"));
+  EXPECT_EQ(nullptr, cache_->Lookup("q2"));
+  EXPECT_NE(nullptr, cache_->Lookup("q3"));
+  // Entries larger than the capacity are not cached.
+  cache_->Insert("q4", cache_->generation(), MakeEntry({"db.t4"}, 3));
+  EXPECT_EQ(nullptr, cache_->Lookup("q4"));
+  EXPECT_EQ(2 * entry_bytes, mem_tracker_.consumption());
+}
+
+// An entry that cannot be tracked against the memory limit is not inserted and does
+// not evict or replace any cached entries.
+TEST_F(QueryResultCacheTest, MemLimitKeepsEntries) {
+  const int64_t entry_bytes = MakeEntry({})->rows()->ByteSize();
+  MemTracker limited_tracker(2 * entry_bytes);
+  {
+    QueryResultCache cache(
+        4 * entry_bytes, 4 * entry_bytes, 0, &limited_tracker, &metrics_);
+    cache.Insert("q1", cache.generation(), MakeEntry({"db.t1"}));
+    cache.Insert("q2", cache.generation(), MakeEntry({"db.t2"}));
+    EXPECT_EQ(2 * entry_bytes, limited_tracker.consumption());
+    cache.Insert("q3", cache.generation(), MakeEntry({"db.t3"}));
+    EXPECT_EQ(nullptr, cache.Lookup("q3"));
+    // A failed replacement keeps the existing entry.
+    cache.Insert("q1", cache.generation(), MakeEntry({"db.t1"}, 2));
+    shared_ptr<const QueryResultCache::Entry> entry = cache.Lookup("q1");
+    ASSERT_NE(nullptr, entry);
+    EXPECT_EQ(1, entry->rows()->size());
+    EXPECT_NE(nullptr, cache.Lookup("q2"));
+    EXPECT_EQ(2, cache.num_entries());
+    EXPECT_EQ(2 * entry_bytes, limited_tracker.consumption());
+  }
+  EXPECT_EQ(0, limited_tracker.consumption());
+  limited_tracker.Close();
+}
+
+TEST_F(QueryResultCacheTest, TopicInvalidation) {
+  CreateCache(1024 * 1024);
+  cache_->Insert("q1", cache_->generation(), MakeEntry({"db.t1"}));
+  cache_->Insert("q2", cache_->generation(), MakeEntry({"db.t2", "db.t3"}));
+  cache_->Insert("q3", cache_->generation(), MakeEntry({"other.t1"}));
+
+  // Privilege changes do not affect cached results.
+  cache_->InvalidateCatalogTopicEntries({TopicItem("1:PRIVILEGE:role.server")}, true);
+  EXPECT_EQ(3, cache_->num_entries());
+
+  cache_->InvalidateCatalogTopicEntries({TopicItem("1:TABLE:db.T1")}, true);
+  EXPECT_EQ(nullptr, cache_->Lookup("q1"));
+  EXPECT_NE(nullptr, cache_->Lookup("q2"));
+
+  cache_->InvalidateCatalogTopicEntries(
+      {TopicItem("2:HDFS_PARTITION:db.t3:p=1")}, true);
+  EXPECT_EQ(nullptr, cache_->Lookup("q2"));
+  EXPECT_NE(nullptr, cache_->Lookup("q3"));
+
+  cache_->InvalidateCatalogTopicEntries({TopicItem("1:DATABASE:other")}, true);
+  EXPECT_EQ(0, cache_->num_entries());
+
+  // A full topic update invalidates everything.
+  cache_->Insert("q1", cache_->generation(), MakeEntry({"db.t1"}));
+  cache_->InvalidateCatalogTopicEntries({}, false);
+  EXPECT_EQ(0, cache_->num_entries());
+  EXPECT_EQ(0, mem_tracker_.consumption());
+}
+
+TEST_F(QueryResultCacheTest, CatalogObjectInvalidation) {
+  CreateCache(1024 * 1024);
+  cache_->Insert("q1", cache_->generation(), MakeEntry({"db.t1"}));
+  cache_->Insert("q2", cache_->generation(), MakeEntry({"db.t2"}));
+  TCatalogUpdateResult result;
+  TCatalogObject object;
+  object.type = TCatalogObjectType::TABLE;
+  object.table.db_name = "DB";
+  object.table.tbl_name = "t2";
+  result.__set_updated_catalog_objects({object});
+  cache_->InvalidateCatalogObjects(result);
+  EXPECT_NE(nullptr, cache_->Lookup("q1"));
+  EXPECT_EQ(nullptr, cache_->Lookup("q2"));
+}
+
+TEST_F(QueryResultCacheTest, InvalidatedWhileRunning) {
+  CreateCache(1024 * 1024);
+  // The query reads the generation before planning, then a table it reads changes
+  // before its result is inserted.
+  int64_t generation = cache_->generation();
+  cache_->InvalidateCatalogTopicEntries({TopicItem("1:TABLE:db.t1")}, true);
+  cache_->Insert("q1", generation, MakeEntry({"db.t1"}));
+  EXPECT_EQ(nullptr, cache_->Lookup("q1"));
+  // Changes to other tables don't matter.
+  generation = cache_->generation();
+  cache_->InvalidateCatalogTopicEntries({TopicItem("1:TABLE:db.t2")}, true);
+  cache_->Insert("q1", generation, MakeEntry({"db.t1"}));
+  EXPECT_NE(nullptr, cache_->Lookup("q1"));
+}
+
+TEST_F(QueryResultCacheTest, Expiration) {
+  CreateCache(1024 * 1024, 1);
+  cache_->Insert("q1", cache_->generation(), MakeEntry({"db.t1"}));
+  SleepForMs(10);
+  EXPECT_EQ(nullptr, cache_->Lookup("q1"));
+  EXPECT_EQ(0, cache_->num_entries());
+}
+}
@@ -0,0 +1,421 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "service/query-result-cache.h"
+
+#include <cctype>
+#include <boost/algorithm/string.hpp>
+#include <gutil/strings/substitute.h>
+
+#include "gen-cpp/CatalogService_types.h"
+#include "gen-cpp/CatalogService_constants.h"
+#include "gen-cpp/Frontend_types.h"
+#include "gen-cpp/StatestoreService_types.h"
+#include "rpc/thrift-util.h"
+#include "runtime/mem-tracker.h"
+#include "service/query-options.h"
+#include "util/hash-util.h"
+#include "util/metrics.h"
+#include "util/time.h"
+
+#include "common/names.h"
+
+using apache::hive::service::cli::thrift::TProtocolVersion;
+using boost::algorithm::to_lower_copy;
+using strings::Substitute;
+
+namespace impala {
+
+static const string QUERY_RESULT_CACHE_HITS = "impala-server.query-result-cache.hits";
+static const string QUERY_RESULT_CACHE_MISSES = "impala-server.query-result-cache.misses";
+static const string QUERY_RESULT_CACHE_EVICTIONS =
+    "impala-server.query-result-cache.evictions";
+static const string QUERY_RESULT_CACHE_INVALIDATIONS =
+    "impala-server.query-result-cache.invalidations";
+static const string QUERY_RESULT_CACHE_NUM_ENTRIES =
+    "impala-server.query-result-cache.num-entries";
+static const string QUERY_RESULT_CACHE_TOTAL_BYTES =
+    "impala-server.query-result-cache.total-bytes";
+
+QueryResultCache::Entry::Entry(ResultFormat format, const TResultSetMetadata& metadata)
+  : metadata_(metadata) {
+  switch (format) {
+    case ASCII:
+      rows_.reset(QueryResultSet::CreateAsciiQueryResultSet(metadata_, &ascii_rows_));
+      break;
+    case HS2_ROW_ORIENTED:
+      rows_.reset(QueryResultSet::CreateHS2ResultSet(
+          TProtocolVersion::HIVE_CLI_SERVICE_PROTOCOL_V1, metadata_, nullptr));
+      break;
+    case HS2_COLUMNAR:
+      rows_.reset(QueryResultSet::CreateHS2ResultSet(
+          TProtocolVersion::HIVE_CLI_SERVICE_PROTOCOL_V6, metadata_, nullptr));
+      break;
+    case ARROW:
+      rows_.reset(QueryResultSet::CreateArrowResultSet(metadata_, nullptr));
+      break;
+  }
+  DCHECK(rows_ != nullptr);
+}
+
+QueryResultCache::QueryResultCache(int64_t capacity_bytes, int64_t max_entry_bytes,
+    int64_t ttl_ms, MemTracker* parent_mem_tracker, MetricGroup* metrics)
+  : capacity_bytes_(capacity_bytes),
+    max_entry_bytes_(max_entry_bytes),
+    ttl_ms_(ttl_ms),
+    mem_tracker_(new MemTracker(-1, "Query Result Cache", parent_mem_tracker)) {
+  DCHECK_GT(capacity_bytes_, 0);
+  hits_ = metrics->AddCounter(QUERY_RESULT_CACHE_HITS, 0);
+  misses_ = metrics->AddCounter(QUERY_RESULT_CACHE_MISSES, 0);
+  evictions_ = metrics->AddCounter(QUERY_RESULT_CACHE_EVICTIONS, 0);
+  invalidations_ = metrics->AddCounter(QUERY_RESULT_CACHE_INVALIDATIONS, 0);
+  num_entries_metric_ = metrics->AddGauge(QUERY_RESULT_CACHE_NUM_ENTRIES, 0);
+  total_bytes_metric_ = metrics->AddGauge(QUERY_RESULT_CACHE_TOTAL_BYTES, 0);
+}
+
+QueryResultCache::~QueryResultCache() {
+  {
+    lock_guard<mutex> l(lock_);
+    for (auto it = cache_.begin(); it != cache_.end();) it = EraseLocked(it);
+  }
+  mem_tracker_->Close();
+}
+
+bool QueryResultCache::IsCacheable(
+    const TExecRequest& exec_request, vector<string>* tables) {
+  if (exec_request.stmt_type != TStmtType::QUERY) return false;
+  if (!exec_request.__isset.query_exec_request) return false;
+  if (!exec_request.__isset.result_set_metadata
+      || exec_request.result_set_metadata.columns.empty()) {
+    return false;
+  }
+  const TQueryExecRequest& query_exec_request = exec_request.query_exec_request;
+  const TQueryCtx& query_ctx = query_exec_request.query_ctx;
+  // Child queries, e.g. of COMPUTE STATS, always return row-oriented results and are
+  // not repeated by clients.
+  if (query_ctx.__isset.parent_query_id) return false;
+  if (query_ctx.__isset.transaction_id && query_ctx.transaction_id > 0) return false;
+  // Set by the frontend for calls to non-deterministic builtins such as rand() or
+  // now() and to UDFs anywhere in the analyzed statement, including view definitions.
+  if (query_exec_request.has_nondeterministic_fn) return false;
+
+  // HDFS tables only change through the catalog: the coordinator does not see files
+  // that were added outside of Impala until the table is refreshed, which also
+  // invalidates the cached results. Kudu, HBase and external data sources are read
+  // directly, so their results must not be cached.
+  bool has_scan = false;
+  for (const TPlanExecInfo& plan_exec_info : query_exec_request.plan_exec_info) {
+    for (const TPlanFragment& fragment : plan_exec_info.fragments) {
+      if (!fragment.__isset.plan) continue;
+      for (const TPlanNode& node : fragment.plan.nodes) {
+        switch (node.node_type) {
+          case TPlanNodeType::HBASE_SCAN_NODE:
+          case TPlanNodeType::KUDU_SCAN_NODE:
+          case TPlanNodeType::DATA_SOURCE_NODE:
+            return false;
+          case TPlanNodeType::HDFS_SCAN_NODE:
+            has_scan = true;
+            break;
+          default:
+            break;
+        }
+      }
+    }
+  }
+
+  tables->clear();
+  if (exec_request.__isset.access_events) {
+    for (const TAccessEvent& event : exec_request.access_events) {
+      if (event.object_type == TCatalogObjectType::TABLE
+          || event.object_type == TCatalogObjectType::VIEW) {
+        tables->push_back(to_lower_copy(event.name));
+      }
+    }
+  }
+  // Without the list of tables the result could not be invalidated.
+  if (has_scan && tables->empty()) return false;
+  return true;
+}
+
+string QueryResultCache::NormalizeStatement(const string& stmt) {
+  string result;
+  result.reserve(stmt.size());
+  char quote = 0;
+  bool in_line_comment = false;
+  bool pending_space = false;
+  for (size_t i = 0; i < stmt.size(); ++i) {
+    const char c = stmt[i];
+    if (quote != 0) {
+      result.push_back(c);
+      if (c == '\\' && i + 1 < stmt.size()) {
+        result.push_back(stmt[++i]);
+      } else if (c == quote) {
+        quote = 0;
+      }
+      continue;
+    }
+    if (in_line_comment && c == '\n') {
+      // The line break is significant since it ends the comment.
+      result.push_back('\n');
+      in_line_comment = false;
+      pending_space = false;
+      continue;
+    }
+    if (isspace(static_cast<unsigned char>(c))) {
+      pending_space = !result.empty();
+      continue;
+    }
+    if (pending_space) {
+      result.push_back(' ');
+      pending_space = false;
+    }
+    result.push_back(c);
+    if (in_line_comment) continue;
+    if (c == '\'' || c == '"' || c == '`') {
+      quote = c;
+    } else if (c == '-' && i + 1 < stmt.size() && stmt[i + 1] == '-') {
+      result.push_back(stmt[++i]);
+      in_line_comment = true;
+    }
+  }
+  while (!result.empty()
+      && (result.back() == ';' || isspace(static_cast<unsigned char>(result.back())))) {
+    result.pop_back();
+  }
+  return result;
+}
+
+Status QueryResultCache::ComputeKey(const TExecRequest& exec_request,
+    const string& effective_user, ResultFormat format, string* key) {
+  DCHECK(exec_request.__isset.query_exec_request);
+  const TQueryCtx& query_ctx = exec_request.query_exec_request.query_ctx;
+  ThriftSerializer serializer(/* compact */ true);
+  uint64_t plan_hash = 0;
+  for (const TPlanExecInfo& plan_exec_info :
+       exec_request.query_exec_request.plan_exec_info) {
+    for (const TPlanFragment& fragment : plan_exec_info.fragments) {
+      uint8_t* buffer;
+      uint32_t len;
+      RETURN_IF_ERROR(serializer.SerializeToBuffer(&fragment, &len, &buffer));
+      plan_hash = HashUtil::FastHash64(buffer, len, plan_hash);
+    }
+  }
+  // Fields are separated by a character that cannot appear in any of them other than
+  // the statement, which is last.
+  *key = Substitute("$0\x01$1\x01$2\x01$3\x01$4\x01$5", format, effective_user,
+      query_ctx.session.database, plan_hash,
+      DebugQueryOptions(query_ctx.client_request.query_options),
+      NormalizeStatement(query_ctx.client_request.stmt));
+  return Status::OK();
+}
+
+shared_ptr<const QueryResultCache::Entry> QueryResultCache::Lookup(const string& key) {
+  lock_guard<mutex> l(lock_);
+  auto it = cache_.find(key);
+  if (it == cache_.end()) {
+    misses_->Increment(1);
+    return nullptr;
+  }
+  const Entry& entry = *it->second.entry;
+  if (entry.expiration_time_ms_ >= 0 && UnixMillis() > entry.expiration_time_ms_) {
+    EraseLocked(it);
+    evictions_->Increment(1);
+    misses_->Increment(1);
+    return nullptr;
+  }
+  lru_list_.splice(lru_list_.begin(), lru_list_, it->second.lru_it);
+  hits_->Increment(1);
+  return it->second.entry;
+}
+
+int64_t QueryResultCache::generation() {
+  lock_guard<mutex> l(lock_);
+  return generation_;
+}
+
+void QueryResultCache::Insert(
+    const string& key, int64_t generation, unique_ptr<Entry> entry) {
+  entry->byte_size_ = entry->rows_->ByteSize();
+  if (entry->byte_size_ > max_entry_bytes_ || entry->byte_size_ > capacity_bytes_) return;
+  if (ttl_ms_ > 0) entry->expiration_time_ms_ = UnixMillis() + ttl_ms_;
+
+  lock_guard<mutex> l(lock_);
+  if (all_invalidated_at_ > generation) return;
+  for (const string& table : entry->tables) {
+    if (InvalidatedSince(table, generation)) return;
+  }
+  // Consume the memory before making room for the entry, so that the cached results
+  // are kept if the entry cannot be inserted.
+  if (!mem_tracker_->TryConsume(entry->byte_size_)) {
+    VLOG(2) << "Not enough memory to cache a result of " << entry->byte_size_
+            << " bytes";
+    return;
+  }
+  auto existing = cache_.find(key);
+  if (existing != cache_.end()) EraseLocked(existing);
+  // Make room for the new entry.
+  while (total_bytes_ + entry->byte_size_ > capacity_bytes_ && !lru_list_.empty()) {
+    EraseLocked(cache_.find(lru_list_.back()));
+    evictions_->Increment(1);
+  }
+  total_bytes_ += entry->byte_size_;
+  total_bytes_metric_->Increment(entry->byte_size_);
+  num_entries_metric_->Increment(1);
+  lru_list_.push_front(key);
+  cache_.emplace(
+      key, CacheValue{shared_ptr<const Entry>(move(entry)), lru_list_.begin()});
+}
+
+void QueryResultCache::InvalidateCatalogTopicEntries(
+    const vector<TTopicItem>& items, bool is_delta) {
+  if (!is_delta) {
+    InvalidateAll();
+    return;
+  }
+  unordered_set<string> tables;
+  unordered_set<string> dbs;
+  for (const TTopicItem& item : items) {
+    // Keys look like "<topic version prefix><object type>:<object name>", see
+    // Catalog.toCatalogObjectKey().
+    const string& key = item.key;
+    size_t type_start = 0;
+    for (const string* prefix : {&g_CatalogService_constants.CATALOG_TOPIC_V1_PREFIX,
+             &g_CatalogService_constants.CATALOG_TOPIC_V2_PREFIX}) {
+      if (key.compare(0, prefix->size(), *prefix) == 0) {
+        type_start = prefix->size();
+        break;
+      }
+    }
+    const size_t type_end = key.find(':', type_start);
+    if (type_end == string::npos) continue;
+    const string type = key.substr(type_start, type_end - type_start);
+    const string name = to_lower_copy(key.substr(type_end + 1));
+    if (type == "TABLE") {
+      tables.insert(name);
+    } else if (type == "HDFS_PARTITION") {
+      // The name is "<db>.<table>:<partition name>".
+      tables.insert(name.substr(0, name.find(':')));
+    } else if (type == "DATABASE") {
+      dbs.insert(name);
+    } else if (type == "FUNCTION" || type == "DATA_SOURCE") {
+      // Results may depend on the implementation of a function, which cannot be traced
+      // back to the tables.
+      InvalidateAll();
+      return;
+    }
+    // Privileges are checked during planning, which runs for every statement. Cache
+    // pools and the catalog version do not affect results.
+  }
+  if (!tables.empty() || !dbs.empty()) Invalidate(tables, dbs);
+}
+
+void QueryResultCache::InvalidateCatalogObjects(const TCatalogUpdateResult& result) {
+  // Operations that don't list the changed objects wait for the catalog topic update
+  // that contains them, which invalidates the affected entries.
+  if (!result.__isset.updated_catalog_objects
+      && !result.__isset.removed_catalog_objects) {
+    return;
+  }
+  unordered_set<string> tables;
+  unordered_set<string> dbs;
+  for (const vector<TCatalogObject>* objects :
+       {&result.updated_catalog_objects, &result.removed_catalog_objects}) {
+    for (const TCatalogObject& object : *objects) {
+      switch (object.type) {
+        case TCatalogObjectType::TABLE:
+        case TCatalogObjectType::VIEW:
+          tables.insert(to_lower_copy(
+              Substitute("$0.$1", object.table.db_name, object.table.tbl_name)));
+          break;
+        case TCatalogObjectType::HDFS_PARTITION:
+          tables.insert(to_lower_copy(Substitute(
+              "$0.$1", object.hdfs_partition.db_name, object.hdfs_partition.tbl_name)));
+          break;
+        case TCatalogObjectType::DATABASE:
+          dbs.insert(to_lower_copy(object.db.db_name));
+          break;
+        case TCatalogObjectType::FUNCTION:
+        case TCatalogObjectType::DATA_SOURCE:
+          InvalidateAll();
+          return;
+        default:
+          break;
+      }
+    }
+  }
+  if (!tables.empty() || !dbs.empty()) Invalidate(tables, dbs);
+}
+
+void QueryResultCache::InvalidateAll() {
+  lock_guard<mutex> l(lock_);
+  ++generation_;
+  all_invalidated_at_ = generation_;
+  table_invalidated_at_.clear();
+  db_invalidated_at_.clear();
+  invalidations_->Increment(cache_.size());
+  for (auto it = cache_.begin(); it != cache_.end();) it = EraseLocked(it);
+}
+
+int64_t QueryResultCache::num_entries() {
+  lock_guard<mutex> l(lock_);
+  return cache_.size();
+}
+
+void QueryResultCache::Invalidate(
+    const unordered_set<string>& tables, const unordered_set<string>& dbs) {
+  lock_guard<mutex> l(lock_);
+  ++generation_;
+  for (const string& table : tables) table_invalidated_at_[table] = generation_;
+  for (const string& db : dbs) db_invalidated_at_[db] = generation_;
+  for (auto it = cache_.begin(); it != cache_.end();) {
+    bool invalidated = false;
+    for (const string& table : it->second.entry->tables) {
+      if (InvalidatedSince(table, generation_ - 1)) {
+        invalidated = true;
+        break;
+      }
+    }
+    if (invalidated) {
+      it = EraseLocked(it);
+      invalidations_->Increment(1);
+    } else {
+      ++it;
+    }
+  }
+}
+
+bool QueryResultCache::InvalidatedSince(const string& table, int64_t generation) const {
+  auto table_it = table_invalidated_at_.find(table);
+  if (table_it != table_invalidated_at_.end() && table_it->second > generation) {
+    return true;
+  }
+  auto db_it = db_invalidated_at_.find(table.substr(0, table.find('.')));
+  return db_it != db_invalidated_at_.end() && db_it->second > generation;
+}
+
+unordered_map<string, QueryResultCache::CacheValue>::iterator
+QueryResultCache::EraseLocked(unordered_map<string, CacheValue>::iterator it) {
+  DCHECK(it != cache_.end());
+  const int64_t byte_size = it->second.entry->byte_size_;
+  total_bytes_ -= byte_size;
+  total_bytes_metric_->Increment(-byte_size);
+  num_entries_metric_->Increment(-1);
+  mem_tracker_->Release(byte_size);
+  lru_list_.erase(it->second.lru_it);
+  return cache_.erase(it);
+}
+}
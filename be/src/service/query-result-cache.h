@@ -0,0 +1,223 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "common/status.h"
+#include "gen-cpp/Results_types.h"
+#include "service/query-result-set.h"
+
+namespace impala {
+
+class IntCounter;
+class IntGauge;
+class MemTracker;
+class MetricGroup;
+class TCatalogUpdateResult;
+class TExecRequest;
+class TTopicItem;
+
+/// Server-wide cache of the result sets of SELECT statements, shared by all sessions
+/// of a coordinator. BI tools tend to issue the same statements against slowly changing
+/// tables over and over again; a hit skips admission, scheduling and execution and
+/// streams the cached rows through the regular fetch path. Planning still runs for every
+/// statement, so authorization is enforced by the frontend as usual.
+///
+/// Entries are keyed by the normalized statement text, the query options, the effective
+/// user, the session's default database, the client result format and the plan (see
+/// ComputeKey()). Results are cached in the wire format of the client protocol, i.e. as
+/// a QueryResultSet, so hits are served by copying rows without any conversion.
+///
+/// Entries are invalidated when the catalog objects they depend on change. The
+/// coordinator calls InvalidateCatalogTopicEntries() for every catalog topic update and
+/// InvalidateCatalogObjects() for the result of every DDL/DML that it runs itself. To
+/// avoid caching results that were computed against a catalog version that has since
+/// been invalidated, queries call generation() before planning and pass the value to
+/// Insert(), which drops the entry if any of its tables were invalidated in between.
+///
+/// The cache is bounded by 'capacity_bytes' and evicts in LRU order. Results larger than
+/// 'max_entry_bytes' are not cached. Memory is tracked against a child of
+/// 'parent_mem_tracker' and entries are not inserted if the process is out of memory.
+/// Entries also expire 'ttl_ms' after they were inserted if 'ttl_ms' > 0.
+///
+/// Thread-safe.
+class QueryResultCache {
+ public:
+  /// The client protocol format that a result is cached in.
+  enum ResultFormat {
+    /// Tab-separated strings, as returned by Beeswax.
+    ASCII,
+    /// HS2 protocol versions < V6.
+    HS2_ROW_ORIENTED,
+    /// HS2 protocol versions >= V6.
+    HS2_COLUMNAR,
+    /// HS2 protocol versions >= V6 with the ARROW_RESULT_FORMAT query option.
+    ARROW,
+  };
+
+  /// A cached result set and the state needed to serve and invalidate it. Immutable
+  /// once inserted.
+  class Entry {
+   public:
+    Entry(ResultFormat format, const TResultSetMetadata& metadata);
+
+    /// The cached rows. Only accessed through QueryResultSet::AddRows(), which does not
+    /// modify the source result set, so this can be read by several queries at once.
+    QueryResultSet* rows() const { return rows_.get(); }
+
+    /// Lower-case "db.table" names of the tables and views that the result depends on.
+    std::vector<std::string> tables;
+
+   private:
+    friend class QueryResultCache;
+
+    /// Referenced by 'rows_', so must outlive it.
+    const TResultSetMetadata metadata_;
+
+    /// Backing storage for 'rows_' if 'format' is ASCII.
+    std::vector<std::string> ascii_rows_;
+
+    std::unique_ptr<QueryResultSet> rows_;
+
+    /// Approximate size of 'rows_' in bytes. Set by Insert().
+    int64_t byte_size_ = 0;
+
+    /// Time in ms since the epoch after which this entry must not be returned, or -1.
+    int64_t expiration_time_ms_ = -1;
+  };
+
+  QueryResultCache(int64_t capacity_bytes, int64_t max_entry_bytes, int64_t ttl_ms,
+      MemTracker* parent_mem_tracker, MetricGroup* metrics);
+  ~QueryResultCache();
+
+  /// Returns false if the results of 'exec_request' must not be cached, e.g. because
+  /// the statement is not a plain SELECT, reads from tables whose contents can change
+  /// without a catalog update or calls non-deterministic functions. Otherwise returns
+  /// true and sets 'tables' to the tables that the result depends on.
+  static bool IsCacheable(const TExecRequest& exec_request,
+      std::vector<std::string>* tables);
+
+  /// Computes the cache key of 'exec_request' for 'effective_user' and 'format' and
+  /// stores it in 'key'. Besides the normalized statement text, the query options and the
+  /// session's default database, the key contains a fingerprint of the plan fragments.
+  /// The plan reflects column masking and row filtering policies as well as the
+  /// partitions and files that were selected, and it changes with every execution if
+  /// the statement calls a function like now() that the planner folds into a constant.
+  static Status ComputeKey(const TExecRequest& exec_request,
+      const std::string& effective_user, ResultFormat format, std::string* key)
+      WARN_UNUSED_RESULT;
+
+  /// Returns 'stmt' with runs of whitespace outside of quotes and comments collapsed into
+  /// a single space, and leading and trailing whitespace and semicolons removed.
+  static std::string NormalizeStatement(const std::string& stmt);
+
+  /// Returns the entry for 'key' or nullptr if there is none.
+  std::shared_ptr<const Entry> Lookup(const std::string& key);
+
+  /// Returns the current invalidation generation. See the class comment.
+  int64_t generation();
+
+  /// Inserts 'entry' under 'key', replacing any existing entry. 'generation' is the
+  /// value that generation() returned before the query that produced 'entry' was
+  /// planned. Drops 'entry' if it is too large, cannot be tracked against the memory
+  /// limit or if one of its tables was invalidated after 'generation'.
+  void Insert(const std::string& key, int64_t generation, std::unique_ptr<Entry> entry);
+
+  /// Invalidates the entries that depend on the catalog objects in the catalog topic
+  /// update 'items'. Invalidates all entries if the update is not a delta.
+  void InvalidateCatalogTopicEntries(
+      const std::vector<TTopicItem>& items, bool is_delta);
+
+  /// Invalidates the entries that depend on the catalog objects that were changed by a
+  /// catalog operation. Does nothing if 'result' does not list the changed objects.
+  void InvalidateCatalogObjects(const TCatalogUpdateResult& result);
+
+  /// Removes all entries and marks all tables as invalidated.
+  void InvalidateAll();
+
+  /// Returns the number of cached entries.
+  int64_t num_entries();
+
+  int64_t max_entry_bytes() const { return max_entry_bytes_; }
+
+ private:
+  struct CacheValue {
+    std::shared_ptr<const Entry> entry;
+    /// Position of the key in 'lru_list_'.
+    std::list<std::string>::iterator lru_it;
+  };
+
+  /// Invalidates the entries that depend on any of 'tables' or on a table in any of
+  /// 'dbs'. Names must be lower case.
+  void Invalidate(const std::unordered_set<std::string>& tables,
+      const std::unordered_set<std::string>& dbs);
+
+  /// Returns true if 'table' or its database were invalidated after 'generation'.
+  /// 'lock_' must be held.
+  bool InvalidatedSince(const std::string& table, int64_t generation) const;
+
+  /// Removes the entry at 'it' and updates the memory accounting and metrics. Returns
+  /// an iterator to the next entry. 'lock_' must be held.
+  std::unordered_map<std::string, CacheValue>::iterator EraseLocked(
+      std::unordered_map<std::string, CacheValue>::iterator it);
+
+  const int64_t capacity_bytes_;
+  const int64_t max_entry_bytes_;
+  const int64_t ttl_ms_;
+
+  std::unique_ptr<MemTracker> mem_tracker_;
+
+  /// Metrics.
+  IntCounter* hits_;
+  IntCounter* misses_;
+  IntCounter* evictions_;
+  IntCounter* invalidations_;
+  IntGauge* num_entries_metric_;
+  IntGauge* total_bytes_metric_;
+
+  /// Protects all members below.
+  std::mutex lock_;
+
+  std::unordered_map<std::string, CacheValue> cache_;
+
+  /// Keys of 'cache_', most recently used first.
+  std::list<std::string> lru_list_;
+
+  /// Sum of the byte sizes of the entries in 'cache_'.
+  int64_t total_bytes_ = 0;
+
+  /// Incremented on every invalidation.
+  int64_t generation_ = 0;
+
+  /// The generation at which InvalidateAll() was last called.
+  int64_t all_invalidated_at_ = 0;
+
+  /// The generation at which each table or database was last invalidated. Only grows
+  /// with the number of distinct tables and databases and is cleared by InvalidateAll().
+  std::unordered_map<std::string, int64_t> table_invalidated_at_;
+  std::unordered_map<std::string, int64_t> db_invalidated_at_;
+};
+}
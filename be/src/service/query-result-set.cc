@@ -19,17 +19,21 @@
 
 #include <sstream>
 #include <boost/scoped_ptr.hpp>
+#include <gutil/strings/substitute.h>
 
 #include "exprs/scalar-expr-evaluator.h"
 #include "exprs/slot-ref.h"
 #include "rpc/thrift-util.h"
+#include "runtime/date-value.h"
 #include "runtime/descriptors.h"
 #include "runtime/raw-value.h"
 #include "runtime/row-batch.h"
+#include "runtime/timestamp-value.inline.h"
 #include "runtime/tuple.h"
 #include "runtime/tuple-row.h"
 #include "runtime/types.h"
 #include "service/hs2-util.h"
+#include "util/arrow-ipc-writer.h"
 #include "util/bit-util.h"
 
 #include "common/names.h"
@@ -39,6 +43,7 @@ using ThriftTColumnValue = apache::hive::service::cli::thrift::TColumnValue;
 using apache::hive::service::cli::thrift::TProtocolVersion;
 using apache::hive::service::cli::thrift::TRow;
 using apache::hive::service::cli::thrift::TRowSet;
+using strings::Substitute;
 
 namespace {
 
@@ -154,6 +159,51 @@ class HS2RowOrientedResultSet : public QueryResultSet {
   scoped_ptr<TRowSet> owned_result_set_;
 };
 
+/// Result set for HiveServer2 clients with protocol versions >= V6 that set the
+/// ARROW_RESULT_FORMAT query option. Rows are accumulated column-wise in the Arrow
+/// layout and encoded into an Arrow IPC stream in TRowSet.binaryColumns by Finalize().
+class ArrowResultSet : public QueryResultSet {
+ public:
+  ArrowResultSet(const TResultSetMetadata& metadata, TRowSet* rowset);
+
+  virtual ~ArrowResultSet() {}
+
+  /// Evaluate 'expr_evals' over rows in 'batch' and append the values to the Arrow
+  /// columns, one column at a time.
+  virtual Status AddRows(const vector<ScalarExprEvaluator*>& expr_evals, RowBatch* batch,
+      int start_idx, int num_rows) override;
+
+  /// Only used for the results of metadata operations, which don't use this format. Not
+  /// supported for TIMESTAMP, DATE and DECIMAL columns, whose values are strings in
+  /// 'row'.
+  virtual Status AddOneRow(const TResultRow& row) override;
+
+  virtual int AddRows(const QueryResultSet* other, int start_idx, int num_rows) override;
+  virtual int64_t ByteSize(int start_idx, int num_rows) override;
+  virtual size_t size() override { return num_rows_; }
+
+  /// Writes the schema, a record batch with all rows, unless there are none, and the
+  /// end-of-stream marker to TRowSet.binaryColumns.
+  virtual Status Finalize() override;
+
+ private:
+  /// Metadata of the result set
+  const TResultSetMetadata& metadata_;
+
+  /// Points to the TRowSet to be filled. The row set this points to may be owned by
+  /// this object, in which case owned_result_set_ is set.
+  TRowSet* result_set_;
+
+  /// Set to result_set_ if result_set_ is owned.
+  scoped_ptr<TRowSet> owned_result_set_;
+
+  /// The Arrow schema and one column per field.
+  vector<ArrowField> fields_;
+  vector<ArrowColumnBuilder> columns_;
+
+  int64_t num_rows_ = 0;
+};
+
 QueryResultSet* QueryResultSet::CreateAsciiQueryResultSet(
     const TResultSetMetadata& metadata, vector<string>* rowset) {
   return new AsciiQueryResultSet(metadata, rowset);
@@ -168,6 +218,12 @@ QueryResultSet* QueryResultSet::CreateHS2ResultSet(
   }
 }
 
+QueryResultSet* QueryResultSet::CreateArrowResultSet(
+    const TResultSetMetadata& metadata, TRowSet* rowset) {
+  DCHECK(IsArrowCompatible(metadata));
+  return new ArrowResultSet(metadata, rowset);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 
 Status AsciiQueryResultSet::AddRows(const vector<ScalarExprEvaluator*>& expr_evals,
@@ -254,7 +310,7 @@ int64_t AsciiQueryResultSet::ByteSize(int start_idx, int num_rows) {
   int64_t bytes = 0;
   const int end = min(static_cast<size_t>(num_rows), result_set_->size() - start_idx);
   for (int i = start_idx; i < start_idx + end; ++i) {
-    bytes += sizeof(result_set_[i]) + result_set_[i].size();
+    bytes += sizeof((*result_set_)[i]) + (*result_set_)[i].size();
   }
   return bytes;
 }
@@ -542,4 +598,346 @@ int64_t HS2RowOrientedResultSet::ByteSize(int start_idx, int num_rows) {
   }
   return bytes;
 }
+
+// Sets 'field' to the Arrow field for 'column'. Returns false if the type of 'column' is
+// not supported.
+static bool ToArrowField(const TColumn& column, ArrowField* field) {
+  const vector<TTypeNode>& type_nodes = column.columnType.types;
+  if (type_nodes.size() != 1 || type_nodes[0].type != TTypeNodeType::SCALAR) {
+    return false;
+  }
+  const TScalarType& scalar_type = type_nodes[0].scalar_type;
+  field->name = column.columnName;
+  switch (scalar_type.type) {
+    case TPrimitiveType::NULL_TYPE:
+    case TPrimitiveType::BOOLEAN:
+      field->type = ArrowType::BOOL;
+      return true;
+    case TPrimitiveType::TINYINT:
+      field->type = ArrowType::INT8;
+      return true;
+    case TPrimitiveType::SMALLINT:
+      field->type = ArrowType::INT16;
+      return true;
+    case TPrimitiveType::INT:
+      field->type = ArrowType::INT32;
+      return true;
+    case TPrimitiveType::BIGINT:
+      field->type = ArrowType::INT64;
+      return true;
+    case TPrimitiveType::FLOAT:
+      field->type = ArrowType::FLOAT;
+      return true;
+    case TPrimitiveType::DOUBLE:
+      field->type = ArrowType::DOUBLE;
+      return true;
+    case TPrimitiveType::STRING:
+    case TPrimitiveType::VARCHAR:
+    case TPrimitiveType::CHAR:
+      field->type = ArrowType::UTF8;
+      return true;
+    case TPrimitiveType::DATE:
+      field->type = ArrowType::DATE32;
+      return true;
+    case TPrimitiveType::TIMESTAMP:
+      field->type = ArrowType::TIMESTAMP_MICROS;
+      return true;
+    case TPrimitiveType::DECIMAL:
+      field->type = ArrowType::DECIMAL128;
+      field->precision = scalar_type.precision;
+      field->scale = scalar_type.scale;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool QueryResultSet::IsArrowCompatible(const TResultSetMetadata& metadata) {
+  ArrowField field;
+  for (const TColumn& column : metadata.columns) {
+    if (!ToArrowField(column, &field)) return false;
+  }
+  return true;
+}
+
+// Appends the values returned by 'get_value' for the rows [start_idx, start_idx +
+// num_rows) of 'batch' to 'column'. 'get_value' returns nullptr for NULLs and a pointer
+// to the value otherwise, which is passed to 'append_value'.
+template <typename GetValueFn, typename AppendValueFn>
+static void AppendValues(RowBatch* batch, int start_idx, int num_rows,
+    const GetValueFn& get_value, const AppendValueFn& append_value,
+    ArrowColumnBuilder* column) {
+  FOREACH_ROW_LIMIT(batch, start_idx, num_rows, it) {
+    const void* value = get_value(it.Get());
+    if (value == nullptr) {
+      column->AppendNull();
+    } else {
+      append_value(value);
+    }
+  }
+}
+
+// Implementation for fixed width values that are stored as T in Impala and Arrow.
+template <typename T, typename GetValueFn>
+static void AppendFixedValues(RowBatch* batch, int start_idx, int num_rows,
+    const GetValueFn& get_value, ArrowColumnBuilder* column) {
+  AppendValues(batch, start_idx, num_rows, get_value,
+      [column](const void* value) {
+        column->AppendFixed(*reinterpret_cast<const T*>(value));
+      },
+      column);
+}
+
+// Implementation for DECIMAL values that are stored as T in Impala.
+template <typename T, typename GetValueFn>
+static void AppendDecimalValues(RowBatch* batch, int start_idx, int num_rows,
+    const GetValueFn& get_value, ArrowColumnBuilder* column) {
+  AppendValues(batch, start_idx, num_rows, get_value,
+      [column](const void* value) {
+        column->AppendFixed(static_cast<__int128_t>(*reinterpret_cast<const T*>(value)));
+      },
+      column);
+}
+
+// Appends the values returned by 'get_value', which have type 'type', to 'column'.
+// Dispatches on the type once per column rather than once per value.
+template <typename GetValueFn>
+static void AppendValuesOfType(const ColumnType& type, RowBatch* batch, int start_idx,
+    int num_rows, const GetValueFn& get_value, ArrowColumnBuilder* column) {
+  switch (type.type) {
+    case TYPE_NULL:
+      for (int i = 0; i < num_rows; ++i) column->AppendNull();
+      break;
+    case TYPE_BOOLEAN:
+      AppendValues(batch, start_idx, num_rows, get_value,
+          [column](const void* value) {
+            column->AppendBool(*reinterpret_cast<const bool*>(value));
+          },
+          column);
+      break;
+    case TYPE_TINYINT:
+      AppendFixedValues<int8_t>(batch, start_idx, num_rows, get_value, column);
+      break;
+    case TYPE_SMALLINT:
+      AppendFixedValues<int16_t>(batch, start_idx, num_rows, get_value, column);
+      break;
+    case TYPE_INT:
+      AppendFixedValues<int32_t>(batch, start_idx, num_rows, get_value, column);
+      break;
+    case TYPE_BIGINT:
+      AppendFixedValues<int64_t>(batch, start_idx, num_rows, get_value, column);
+      break;
+    case TYPE_FLOAT:
+      AppendFixedValues<float>(batch, start_idx, num_rows, get_value, column);
+      break;
+    case TYPE_DOUBLE:
+      AppendFixedValues<double>(batch, start_idx, num_rows, get_value, column);
+      break;
+    case TYPE_STRING:
+    case TYPE_VARCHAR:
+      AppendValues(batch, start_idx, num_rows, get_value,
+          [column](const void* value) {
+            const StringValue* sv = reinterpret_cast<const StringValue*>(value);
+            column->AppendString(sv->ptr, sv->len);
+          },
+          column);
+      break;
+    case TYPE_CHAR: {
+      // CHAR values are fixed length and not stored as StringValue.
+      const int len = type.len;
+      AppendValues(batch, start_idx, num_rows, get_value,
+          [column, len](const void* value) {
+            column->AppendString(reinterpret_cast<const char*>(value), len);
+          },
+          column);
+      break;
+    }
+    case TYPE_DATE:
+      AppendValues(batch, start_idx, num_rows, get_value,
+          [column](const void* value) {
+            int32_t days;
+            if (reinterpret_cast<const DateValue*>(value)->ToDaysSinceEpoch(&days)) {
+              column->AppendFixed(days);
+            } else {
+              column->AppendNull();
+            }
+          },
+          column);
+      break;
+    case TYPE_TIMESTAMP:
+      // Impala timestamps have no time zone, so they are returned as the microseconds
+      // since the epoch of their wall clock time, which is how Arrow represents
+      // timestamps without a time zone. Nanoseconds are truncated.
+      AppendValues(batch, start_idx, num_rows, get_value,
+          [column](const void* value) {
+            int64_t micros;
+            const TimestampValue* ts = reinterpret_cast<const TimestampValue*>(value);
+            if (ts->FloorUtcToUnixTimeMicros(&micros)) {
+              column->AppendFixed(micros);
+            } else {
+              column->AppendNull();
+            }
+          },
+          column);
+      break;
+    case TYPE_DECIMAL:
+      switch (type.GetByteSize()) {
+        case 4:
+          AppendDecimalValues<int32_t>(batch, start_idx, num_rows, get_value, column);
+          break;
+        case 8:
+          AppendDecimalValues<int64_t>(batch, start_idx, num_rows, get_value, column);
+          break;
+        case 16:
+          AppendDecimalValues<__int128_t>(batch, start_idx, num_rows, get_value, column);
+          break;
+        default:
+          DCHECK(false) << "Unexpected decimal byte size: " << type.GetByteSize();
+      }
+      break;
+    default:
+      DCHECK(false) << "Unsupported type: " << type.DebugString();
+  }
+}
+
+ArrowResultSet::ArrowResultSet(const TResultSetMetadata& metadata, TRowSet* rowset)
+  : metadata_(metadata), result_set_(rowset) {
+  if (rowset == nullptr) {
+    owned_result_set_.reset(new TRowSet());
+    result_set_ = owned_result_set_.get();
+  }
+  for (const TColumn& column : metadata_.columns) {
+    fields_.emplace_back();
+    bool supported = ToArrowField(column, &fields_.back());
+    DCHECK(supported);
+    columns_.emplace_back(fields_.back().type);
+  }
+}
+
+Status ArrowResultSet::AddRows(const vector<ScalarExprEvaluator*>& expr_evals,
+    RowBatch* batch, int start_idx, int num_rows) {
+  DCHECK_GE(batch->num_rows(), start_idx + num_rows);
+  DCHECK_EQ(expr_evals.size(), columns_.size());
+  for (int i = 0; i < columns_.size(); ++i) {
+    ScalarExprEvaluator* expr_eval = expr_evals[i];
+    const ColumnType& type = expr_eval->root().type();
+    if (expr_eval->root().IsSlotRef()) {
+      // Read the values of plain slots directly from the tuples.
+      const SlotRef& slot_ref = static_cast<const SlotRef&>(expr_eval->root());
+      const int tuple_idx = slot_ref.GetTupleIdx();
+      const int slot_offset = slot_ref.GetSlotOffset();
+      const NullIndicatorOffset null_offset = slot_ref.GetNullIndicatorOffset();
+      AppendValuesOfType(type, batch, start_idx, num_rows,
+          [=](const TupleRow* row) -> const void* {
+            const Tuple* tuple = row->GetTuple(tuple_idx);
+            if (tuple == nullptr || tuple->IsNull(null_offset)) return nullptr;
+            return tuple->GetSlot(slot_offset);
+          },
+          &columns_[i]);
+    } else {
+      AppendValuesOfType(type, batch, start_idx, num_rows,
+          [expr_eval](const TupleRow* row) -> const void* {
+            return expr_eval->GetValue(row);
+          },
+          &columns_[i]);
+    }
+  }
+  num_rows_ += num_rows;
+  return Status::OK();
+}
+
+template <typename T>
+static void AppendFixedOrNull(bool is_set, T value, ArrowColumnBuilder* column) {
+  if (is_set) {
+    column->AppendFixed(value);
+  } else {
+    column->AppendNull();
+  }
+}
+
+Status ArrowResultSet::AddOneRow(const TResultRow& row) {
+  DCHECK_EQ(row.colVals.size(), columns_.size());
+  for (const TColumn& column : metadata_.columns) {
+    TPrimitiveType::type type = column.columnType.types[0].scalar_type.type;
+    if (type == TPrimitiveType::TIMESTAMP || type == TPrimitiveType::DATE
+        || type == TPrimitiveType::DECIMAL) {
+      return Status(Substitute("Unsupported type in Arrow result row: $0",
+          TypeToString(ThriftToType(type))));
+    }
+  }
+  for (int i = 0; i < columns_.size(); ++i) {
+    const TColumnValue& value = row.colVals[i];
+    ArrowColumnBuilder* column = &columns_[i];
+    switch (metadata_.columns[i].columnType.types[0].scalar_type.type) {
+      case TPrimitiveType::NULL_TYPE:
+      case TPrimitiveType::BOOLEAN:
+        if (value.__isset.bool_val) {
+          column->AppendBool(value.bool_val);
+        } else {
+          column->AppendNull();
+        }
+        break;
+      case TPrimitiveType::TINYINT:
+        AppendFixedOrNull<int8_t>(value.__isset.byte_val, value.byte_val, column);
+        break;
+      case TPrimitiveType::SMALLINT:
+        AppendFixedOrNull<int16_t>(value.__isset.short_val, value.short_val, column);
+        break;
+      case TPrimitiveType::INT:
+        AppendFixedOrNull<int32_t>(value.__isset.int_val, value.int_val, column);
+        break;
+      case TPrimitiveType::BIGINT:
+        AppendFixedOrNull<int64_t>(value.__isset.long_val, value.long_val, column);
+        break;
+      case TPrimitiveType::FLOAT:
+        AppendFixedOrNull<float>(value.__isset.double_val, value.double_val, column);
+        break;
+      case TPrimitiveType::DOUBLE:
+        AppendFixedOrNull<double>(value.__isset.double_val, value.double_val, column);
+        break;
+      default:
+        if (value.__isset.string_val) {
+          column->AppendString(value.string_val.data(), value.string_val.size());
+        } else {
+          column->AppendNull();
+        }
+        break;
+    }
+  }
+  ++num_rows_;
+  return Status::OK();
+}
+
+int ArrowResultSet::AddRows(const QueryResultSet* other, int start_idx, int num_rows) {
+  const ArrowResultSet* o = static_cast<const ArrowResultSet*>(other);
+  DCHECK_EQ(columns_.size(), o->columns_.size());
+  if (start_idx >= o->num_rows_) return 0;
+  const int rows_added = min<int64_t>(num_rows, o->num_rows_ - start_idx);
+  for (int i = 0; i < columns_.size(); ++i) {
+    columns_[i].AppendRange(o->columns_[i], start_idx, rows_added);
+  }
+  num_rows_ += rows_added;
+  return rows_added;
+}
+
+int64_t ArrowResultSet::ByteSize(int start_idx, int num_rows) {
+  if (start_idx >= num_rows_) return 0;
+  const int64_t n = min<int64_t>(num_rows, num_rows_ - start_idx);
+  int64_t bytes = 0;
+  for (const ArrowColumnBuilder& column : columns_) {
+    bytes += column.ByteSize(start_idx, n);
+  }
+  return bytes;
+}
+
+Status ArrowResultSet::Finalize() {
+  string* stream = &result_set_->binaryColumns;
+  stream->clear();
+  ArrowIpcWriter::WriteSchema(fields_, stream);
+  if (num_rows_ > 0) ArrowIpcWriter::WriteRecordBatch(columns_, stream);
+  ArrowIpcWriter::WriteEndOfStream(stream);
+  result_set_->__isset.binaryColumns = true;
+  result_set_->__set_columnCount(columns_.size());
+  return Status::OK();
+}
 }
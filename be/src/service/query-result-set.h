@@ -66,6 +66,10 @@ class QueryResultSet {
   /// Returns the size of this result set in number of rows.
   virtual size_t size() = 0;
 
+  /// Called once all rows of a fetch were added, before the result set is returned to
+  /// the client. Result sets that encode the rows of a fetch as a whole do so here.
+  virtual Status Finalize() { return Status::OK(); }
+
   /// Returns a result set suitable for Beeswax-based clients.
   static QueryResultSet* CreateAsciiQueryResultSet(
       const TResultSetMetadata& metadata, std::vector<std::string>* rowset);
@@ -77,6 +81,18 @@ class QueryResultSet {
       const TResultSetMetadata& metadata,
       apache::hive::service::cli::thrift::TRowSet* rowset);
 
+  /// Returns a result set for HS2-based clients that returns the rows in the Arrow IPC
+  /// streaming format in 'rowset->binaryColumns'. Finalize() writes a self-contained
+  /// stream with the schema and a single record batch with the rows of the fetch.
+  /// 'metadata' must satisfy IsArrowCompatible(). If 'rowset' is nullptr, the returned
+  /// object will allocate and manage its own rowset.
+  static QueryResultSet* CreateArrowResultSet(const TResultSetMetadata& metadata,
+      apache::hive::service::cli::thrift::TRowSet* rowset);
+
+  /// Returns true if all columns of 'metadata' have a type that can be returned in the
+  /// Arrow format, i.e. a scalar type other than BINARY.
+  static bool IsArrowCompatible(const TResultSetMetadata& metadata);
+
 protected:
   /// Wrapper to call RawValue::PrintArrayValue for a given collection column.
   /// expr_eval must be a SlotRef on a collection slot.
@@ -34,6 +34,8 @@
 #include "rpc/rpc-trace.h"
 #include "rpc/thrift-util.h"
 #include "statestore/statestore-service-client-wrapper.h"
+#include "statestore/topic-delta-util.h"
+#include "util/binary-diff.h"
 #include "util/container-util.h"
 #include "util/collection-metrics.h"
 #include "util/debug-util.h"
@@ -68,6 +70,14 @@ DEFINE_int64_hidden(statestore_subscriber_recovery_grace_period_ms, 30000L, "Per
     "cluster membership will only become effective after this period has elapsed.");
 DEFINE_int32(statestore_client_rpc_timeout_ms, 300000, "(Advanced) The underlying "
     "TSocket send/recv timeout in milliseconds for a catalog client RPC.");
+DEFINE_bool(statestore_subscriber_accept_compressed_updates, true, "(Advanced) If true, "
+    "the subscriber lets the statestore send compressed topic updates. The statestore "
+    "only compresses them if --statestore_compress_topic_updates is set.");
+DEFINE_bool(statestore_subscriber_accept_topic_entry_diffs, false, "(Advanced) If "
+    "true, the subscriber lets the statestore send binary diffs of updated topic entries "
+    "instead of their new values. To apply them, the subscriber keeps a copy of the last "
+    "value of every entry of the topics it subscribes to. The statestore only sends "
+    "diffs if --statestore_send_topic_entry_diffs is set.");
 
 DECLARE_string(debug_actions);
 DECLARE_string(ssl_client_ca_certificate);
@@ -173,6 +183,7 @@ Status StatestoreSubscriber::AddTopic(const Statestore::TopicId& topic_id,
   registration.populate_min_subscriber_topic_version =
       populate_min_subscriber_topic_version;
   registration.filter_prefix = std::move(filter_prefix);
+  registration.accepts_entry_diffs = FLAGS_statestore_subscriber_accept_topic_entry_diffs;
   return Status::OK();
 }
 
@@ -186,6 +197,9 @@ Status StatestoreSubscriber::Register() {
     thrift_topic.populate_min_subscriber_topic_version =
         registration.second.populate_min_subscriber_topic_version;
     thrift_topic.__set_filter_prefix(registration.second.filter_prefix);
+    thrift_topic.__set_accepts_compressed_updates(
+        FLAGS_statestore_subscriber_accept_compressed_updates);
+    thrift_topic.__set_accepts_entry_diffs(registration.second.accepts_entry_diffs);
     request.topic_registrations.push_back(thrift_topic);
   }
 
@@ -365,6 +379,36 @@ void StatestoreSubscriber::Heartbeat(const RegistrationId& registration_id) {
   }
 }
 
+Status StatestoreSubscriber::DecodeTopicDelta(
+    const TopicRegistration& registration, TTopicDelta* delta) {
+  RETURN_IF_ERROR(DecompressTopicEntries(delta));
+  for (TTopicItem& item : delta->topic_entries) {
+    if (!item.__isset.value_is_diff || !item.value_is_diff) continue;
+    auto it = registration.entry_values.find(item.key);
+    if (it == registration.entry_values.end()) {
+      return Status(Substitute("No previous value of topic entry '$0' to apply a diff to",
+          item.key));
+    }
+    string value;
+    RETURN_IF_ERROR(BinaryDiff::Apply(it->second, item.value, &value));
+    item.value = move(value);
+    item.__set_value_is_diff(false);
+  }
+  return Status::OK();
+}
+
+void StatestoreSubscriber::UpdateEntryValues(
+    const TTopicDelta& delta, TopicRegistration* registration) {
+  if (!delta.is_delta) registration->entry_values.clear();
+  for (const TTopicItem& item : delta.topic_entries) {
+    if (item.deleted) {
+      registration->entry_values.erase(item.key);
+    } else {
+      registration->entry_values[item.key] = item.value;
+    }
+  }
+}
+
 Status StatestoreSubscriber::UpdateState(const TopicDeltaMap& incoming_topic_deltas,
     const RegistrationId& registration_id, vector<TTopicDelta>* subscriber_topic_updates,
     bool* skipped) {
@@ -439,6 +483,10 @@ Status StatestoreSubscriber::UpdateState(const TopicDeltaMap& incoming_topic_del
 
   MonotonicStopWatch sw;
   sw.Start();
+  // The deltas passed to the callbacks. Replaced by a copy of 'incoming_topic_deltas'
+  // once a delta with compressed entries or diffs needs to be decoded.
+  const TopicDeltaMap* topic_deltas = &incoming_topic_deltas;
+  unique_ptr<TopicDeltaMap> decoded_topic_deltas;
   // Second, do the actual processing of topic updates that we validated and acquired
   // locks for above.
   for (int i = 0; i < deltas_to_process.size(); ++i) {
@@ -464,11 +512,41 @@ Status StatestoreSubscriber::UpdateState(const TopicDeltaMap& incoming_topic_del
       update.__set_from_version(registration.current_topic_version);
       continue;
     }
-    // The topic version in the update is valid, process the update.
+    // The topic version in the update is valid. Decode it if needed.
+    const TTopicDelta* decoded_delta = &delta;
+    bool has_diffs = false;
+    for (const TTopicItem& item : delta.topic_entries) {
+      has_diffs |= item.__isset.value_is_diff && item.value_is_diff;
+    }
+    if (delta.__isset.compressed_topic_entries || has_diffs) {
+      if (decoded_topic_deltas == nullptr) {
+        decoded_topic_deltas.reset(new TopicDeltaMap(incoming_topic_deltas));
+        topic_deltas = decoded_topic_deltas.get();
+      }
+      TTopicDelta* delta_to_decode = &(*decoded_topic_deltas)[delta.topic_name];
+      Status status = DecodeTopicDelta(registration, delta_to_decode);
+      if (!status.ok()) {
+        // Drop the state the diffs are based on and request a non-delta update, which
+        // the statestore sends to subscribers at version 0.
+        LOG(ERROR) << "Failed to decode update to topic '" << delta.topic_name
+                   << "': " << status.GetDetail() << ". Requesting a full update.";
+        registration.entry_values.clear();
+        subscriber_topic_updates->push_back(TTopicDelta());
+        TTopicDelta& update = subscriber_topic_updates->back();
+        update.topic_name = delta.topic_name;
+        update.__set_from_version(0);
+        continue;
+      }
+      decoded_delta = delta_to_decode;
+    }
+    if (registration.accepts_entry_diffs) {
+      UpdateEntryValues(*decoded_delta, &registration);
+    }
+    // Process the update.
     MonotonicStopWatch update_callback_sw;
     update_callback_sw.Start();
     for (const UpdateCallback& callback : registration.callbacks) {
-      callback(incoming_topic_deltas, subscriber_topic_updates);
+      callback(*topic_deltas, subscriber_topic_updates);
     }
     update_callback_sw.Stop();
     registration.current_topic_version = delta.to_version;
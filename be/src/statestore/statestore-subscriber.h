@@ -240,6 +240,14 @@ class StatestoreSubscriber {
     /// Only subscribe to keys with the provided prefix.
     std::string filter_prefix;
 
+    /// Whether the statestore may send diffs of the values of this topic. Set from
+    /// --statestore_subscriber_accept_topic_entry_diffs.
+    bool accepts_entry_diffs = false;
+
+    /// The last value of every entry of the topic, which diffs are applied to. Only
+    /// maintained if 'accepts_entry_diffs' is true.
+    boost::unordered_map<std::string, std::string> entry_values;
+
     /// The last version of the topic this subscriber processed.
     /// -1 if no updates have been processed yet.
     int64_t current_topic_version = -1;
@@ -291,6 +299,17 @@ class StatestoreSubscriber {
       const RegistrationId& registration_id,
       std::vector<TTopicDelta>* subscriber_topic_updates, bool* skipped);
 
+  /// Decompresses the entries of 'delta' and replaces the diffs in it with the values
+  /// they produce from 'registration.entry_values'. Returns an error if the entries
+  /// can't be decompressed or a diff can't be applied, in which case the subscriber must
+  /// request a full update of the topic.
+  static Status DecodeTopicDelta(
+      const TopicRegistration& registration, TTopicDelta* delta) WARN_UNUSED_RESULT;
+
+  /// Updates 'registration->entry_values' with the decoded 'delta'.
+  static void UpdateEntryValues(
+      const TTopicDelta& delta, TopicRegistration* registration);
+
   /// Called when the statestore sends a heartbeat message. Updates the failure detector.
   void Heartbeat(const RegistrationId& registration_id);
 
@@ -15,8 +15,11 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <gutil/strings/substitute.h>
+
 #include "common/init.h"
 #include "statestore/statestore-subscriber.h"
+#include "statestore/topic-delta-util.h"
 #include "testutil/gtest-util.h"
 #include "util/asan.h"
 #include "util/metrics.h"
@@ -117,6 +120,34 @@ TEST(StatestoreSslTest, InvalidCertSmokeTest) {
   SslSmokeTestHelper(GetValidServerCert(), invalid_server_cert.str(), false);
 }
 
+TEST(StatestoreTest, CompressTopicEntries) {
+  TTopicDelta delta;
+  delta.topic_name = "topic";
+  for (int i = 0; i < 100; ++i) {
+    TTopicItem item;
+    item.key = strings::Substitute("key-$0", i);
+    item.value = string(1000, 'a' + i % 26);
+    item.deleted = i % 10 == 0;
+    delta.topic_entries.push_back(item);
+  }
+  vector<TTopicItem> entries = delta.topic_entries;
+  string compressed;
+  ASSERT_OK(CompressTopicEntries(entries, &compressed));
+  EXPECT_LT(compressed.size(), 100 * 1000 / 10);
+  delta.topic_entries.clear();
+  delta.__set_compressed_topic_entries(compressed);
+  ASSERT_OK(DecompressTopicEntries(&delta));
+  EXPECT_FALSE(delta.__isset.compressed_topic_entries);
+  EXPECT_EQ(entries, delta.topic_entries);
+
+  // Deltas without compressed entries are left alone.
+  ASSERT_OK(DecompressTopicEntries(&delta));
+  EXPECT_EQ(entries, delta.topic_entries);
+
+  delta.__set_compressed_topic_entries(compressed.substr(0, 2));
+  EXPECT_FALSE(DecompressTopicEntries(&delta).ok());
+}
+
 } // namespace impala
 
 int main(int argc, char** argv) {
@@ -32,6 +32,8 @@
 #include "rpc/thrift-util.h"
 #include "statestore/failure-detector.h"
 #include "statestore/statestore-subscriber-client-wrapper.h"
+#include "statestore/topic-delta-util.h"
+#include "util/binary-diff.h"
 #include "util/collection-metrics.h"
 #include "util/container-util.h"
 #include "util/debug-util.h"
@@ -51,6 +53,8 @@ using boost::shared_mutex;
 using boost::upgrade_lock;
 using boost::upgrade_to_unique_lock;
 using std::forward_as_tuple;
+using std::make_pair;
+using std::pair;
 using std::piecewise_construct;
 using namespace apache::thrift;
 using namespace impala;
@@ -106,6 +110,16 @@ DEFINE_int32(statestore_update_tcp_timeout_seconds, 300, "(Advanced) The time af
     "badly hung machines that are not able to respond to the update RPC in short "
     "order.");
 
+DEFINE_bool(statestore_compress_topic_updates, false, "(Advanced) If true, the entries "
+    "of topic updates larger than --statestore_compress_topic_updates_min_bytes are sent "
+    "LZ4-compressed to subscribers that support it.");
+DEFINE_int64(statestore_compress_topic_updates_min_bytes, 16 * 1024, "(Advanced) The "
+    "minimum size of the keys and values of a topic update for it to be compressed.");
+DEFINE_bool(statestore_send_topic_entry_diffs, false, "(Advanced) If true, the "
+    "statestore computes a binary diff from the previous value of every large topic "
+    "entry that is updated and sends the diff instead of the new value to subscribers "
+    "that support it and already have the previous value.");
+
 DECLARE_string(debug_actions);
 DECLARE_string(ssl_server_certificate);
 DECLARE_string(ssl_private_key);
@@ -124,6 +138,8 @@ const string STATESTORE_UPDATE_DURATION = "statestore.topic-update-durations";
 const string STATESTORE_PRIORITY_UPDATE_DURATION =
     "statestore.priority-topic-update-durations";
 const string STATESTORE_HEARTBEAT_DURATION = "statestore.heartbeat-durations";
+const string STATESTORE_TOPIC_BYTES_SENT = "statestore.topic-$0.bytes-sent";
+const string STATESTORE_SUBSCRIBER_BYTES_SENT = "statestore.subscriber-$0.bytes-sent";
 
 // Initial version for each Topic registered by a Subscriber. Generally, the Topic will
 // have a Version that is the MAX() of all entries in the Topic, but this initial
@@ -135,6 +151,12 @@ const Statestore::TopicEntry::Version Statestore::Subscriber::TOPIC_INITIAL_VERS
 // Updates or heartbeats that miss their deadline by this much are logged.
 const uint32_t DEADLINE_MISS_THRESHOLD_MS = 2000;
 
+// Diffs are only computed for values of at least this size and only kept if they are at
+// most a quarter of the size of the value. Smaller diffs save little compared to the
+// cost of computing them and of the subscribers keeping the values to apply them to.
+const int64_t MIN_DIFF_VALUE_SIZE = 1024;
+const int64_t MAX_DIFF_SIZE_FRACTION = 4;
+
 const char* Statestore::IMPALA_MEMBERSHIP_TOPIC = "impala-membership";
 const char* Statestore::IMPALA_REQUEST_QUEUE_TOPIC = "impala-request-queue";
 
@@ -166,17 +188,41 @@ void Statestore::TopicEntry::SetValue(const Statestore::TopicEntry::Value& bytes
   version_ = version;
 }
 
+map<int, pair<Statestore::TopicEntry::Version, Statestore::TopicEntry::Value>>
+Statestore::Topic::ComputeDiffs(const vector<TTopicItem>& entries) {
+  map<int, pair<TopicEntry::Version, TopicEntry::Value>> diffs;
+  // Acquire shared lock - we are only reading the current values.
+  shared_lock<shared_mutex> read_lock(lock_);
+  for (int i = 0; i < entries.size(); ++i) {
+    const TTopicItem& entry = entries[i];
+    if (entry.deleted || entry.value.size() < MIN_DIFF_VALUE_SIZE) continue;
+    TopicEntryMap::const_iterator entry_it = entries_.find(entry.key);
+    if (entry_it == entries_.end() || entry_it->second.is_deleted()) continue;
+    string diff = BinaryDiff::Encode(entry_it->second.value(), entry.value);
+    if (diff.size() * MAX_DIFF_SIZE_FRACTION > entry.value.size()) continue;
+    diffs.emplace(i, make_pair(entry_it->second.version(), move(diff)));
+  }
+  return diffs;
+}
+
 vector<Statestore::TopicEntry::Version> Statestore::Topic::Put(
     const std::vector<TTopicItem>& entries) {
   vector<Statestore::TopicEntry::Version> versions;
   versions.reserve(entries.size());
+  // Diffs are computed before acquiring the exclusive lock so that updates can still be
+  // built while they are computed. They are only used if the value didn't change again
+  // in the meantime.
+  map<int, pair<TopicEntry::Version, TopicEntry::Value>> diffs;
+  if (FLAGS_statestore_send_topic_entry_diffs) diffs = ComputeDiffs(entries);
 
   // Acquire exclusive lock - we are modifying the topic.
   lock_guard<shared_mutex> write_lock(lock_);
-  for (const TTopicItem& entry: entries) {
+  for (int i = 0; i < entries.size(); ++i) {
+    const TTopicItem& entry = entries[i];
     TopicEntryMap::iterator entry_it = entries_.find(entry.key);
     int64_t key_size_delta = 0;
     int64_t value_size_delta = 0;
+    TopicEntry::Version prev_version = Subscriber::TOPIC_INITIAL_VERSION;
     if (entry_it == entries_.end()) {
       entry_it = entries_.emplace(entry.key, TopicEntry()).first;
       key_size_delta += entry.key.size();
@@ -184,13 +230,20 @@ vector<Statestore::TopicEntry::Version> Statestore::Topic::Put(
       // Delete the old entry from the version history. There is no need to search the
       // version_history because there should only be at most a single entry in the
       // history at any given time.
-      topic_update_log_.erase(entry_it->second.version());
+      prev_version = entry_it->second.version();
+      topic_update_log_.erase(prev_version);
       value_size_delta -= entry_it->second.value().size();
     }
     value_size_delta += entry.value.size();
 
     entry_it->second.SetValue(entry.value, ++last_version_);
     entry_it->second.SetDeleted(entry.deleted);
+    auto diff_it = diffs.find(i);
+    if (diff_it != diffs.end() && diff_it->second.first == prev_version) {
+      entry_it->second.SetDiff(move(diff_it->second.second), prev_version);
+    } else {
+      entry_it->second.ClearDiff();
+    }
     topic_update_log_.emplace(entry_it->second.version(), entry.key);
 
     total_key_size_bytes_ += key_size_delta;
@@ -219,6 +272,7 @@ void Statestore::Topic::DeleteIfVersionsMatch(TopicEntry::Version version,
     topic_size_metric_->Increment(entry_it->second.value().size());
     entry_it->second.SetDeleted(true);
     entry_it->second.SetVersion(last_version_);
+    entry_it->second.ClearDiff();
   }
 }
 
@@ -237,23 +291,48 @@ void Statestore::Topic::ClearAllEntries() {
       topic_size_metric_val - (total_value_size_bytes_ + total_key_size_bytes_)));
   total_value_size_bytes_ = 0;
   total_key_size_bytes_ = 0;
+  lock_guard<mutex> l(compressed_delta_lock_);
+  last_compressed_delta_ = CompressedDelta();
 }
 
-void Statestore::Topic::BuildDelta(const SubscriberId& subscriber_id,
-    TopicEntry::Version last_processed_version,
-    const string& filter_prefix, TTopicDelta* delta) {
+int64_t Statestore::Topic::BuildDelta(const SubscriberId& subscriber_id,
+    TopicEntry::Version last_processed_version, const string& filter_prefix,
+    bool send_diffs, bool compress, TTopicDelta* delta) {
   // If the subscriber version is > 0, send this update as a delta. Otherwise, this is
   // a new subscriber so send them a non-delta update that includes all entries in the
   // topic.
   delta->is_delta = last_processed_version > Subscriber::TOPIC_INITIAL_VERSION;
   delta->__set_from_version(last_processed_version);
+  // A subscriber that gets a non-delta update doesn't have any values to apply diffs to.
+  send_diffs &= delta->is_delta;
+  int64_t topic_size = 0;
   {
     // Acquire shared lock - we are not modifying the topic.
     shared_lock<shared_mutex> read_lock(lock_);
+    if (topic_update_log_.size() > 0) {
+      // The largest version for this topic will be the last entry in the version history
+      // map.
+      delta->__set_to_version(topic_update_log_.rbegin()->first);
+    } else {
+      // There are no updates in the version history
+      delta->__set_to_version(Subscriber::TOPIC_INITIAL_VERSION);
+    }
+
+    if (compress) {
+      // Reuse the entries compressed for another subscriber that was at the same version.
+      lock_guard<mutex> l(compressed_delta_lock_);
+      const CompressedDelta& cached = last_compressed_delta_;
+      if (cached.compressed_entries != nullptr
+          && cached.from_version == last_processed_version
+          && cached.to_version == delta->to_version
+          && cached.filter_prefix == filter_prefix && cached.send_diffs == send_diffs) {
+        delta->__set_compressed_topic_entries(*cached.compressed_entries);
+        return cached.compressed_entries->size();
+      }
+    }
+
     TopicUpdateLog::const_iterator next_update =
         topic_update_log_.upper_bound(last_processed_version);
-
-    uint64_t topic_size = 0;
     for (; next_update != topic_update_log_.end(); ++next_update) {
       TopicEntryMap::const_iterator itr = entries_.find(next_update->second);
       DCHECK(itr != entries_.end());
@@ -268,7 +347,15 @@ void Statestore::Topic::BuildDelta(const SubscriberId& subscriber_id,
       delta->topic_entries.push_back(TTopicItem());
       TTopicItem& delta_entry = delta->topic_entries.back();
       delta_entry.key = itr->first;
-      delta_entry.value = topic_entry.value();
+      // The subscriber has the value the diff applies to if it processed the version
+      // of the entry that the diff is based on.
+      if (send_diffs && topic_entry.has_diff()
+          && topic_entry.diff_base_version() <= last_processed_version) {
+        delta_entry.value = topic_entry.diff();
+        delta_entry.__set_value_is_diff(true);
+      } else {
+        delta_entry.value = topic_entry.value();
+      }
       delta_entry.deleted = topic_entry.is_deleted();
       topic_size += delta_entry.key.size() + delta_entry.value.size();
     }
@@ -279,17 +366,30 @@ void Statestore::Topic::BuildDelta(const SubscriberId& subscriber_id,
                  << " topic update for " << subscriber_id << ". Size = "
                  << PrettyPrinter::Print(topic_size, TUnit::BYTES);
     }
+  }
 
-    if (topic_update_log_.size() > 0) {
-      // The largest version for this topic will be the last entry in the version history
-      // map.
-      delta->__set_to_version(topic_update_log_.rbegin()->first);
-    } else {
-      // There are no updates in the version history
-      delta->__set_to_version(Subscriber::TOPIC_INITIAL_VERSION);
-    }
+  if (!compress || topic_size < FLAGS_statestore_compress_topic_updates_min_bytes) {
+    return topic_size;
   }
+  shared_ptr<string> compressed_entries = make_shared<string>();
+  Status status = CompressTopicEntries(delta->topic_entries, compressed_entries.get());
+  if (!status.ok()) {
+    LOG(WARNING) << "Failed to compress " << delta->topic_name << " topic update for "
+                 << subscriber_id << ": " << status.GetDetail();
+    return topic_size;
+  }
+  if (compressed_entries->size() >= topic_size) return topic_size;
+  delta->topic_entries.clear();
+  delta->__set_compressed_topic_entries(*compressed_entries);
+  lock_guard<mutex> l(compressed_delta_lock_);
+  last_compressed_delta_.from_version = last_processed_version;
+  last_compressed_delta_.to_version = delta->to_version;
+  last_compressed_delta_.filter_prefix = filter_prefix;
+  last_compressed_delta_.send_diffs = send_diffs;
+  last_compressed_delta_.compressed_entries = move(compressed_entries);
+  return delta->compressed_topic_entries.size();
 }
+
 void Statestore::Topic::ToJson(Document* document, Value* topic_json) {
   // Acquire shared lock - we are not modifying the topic.
   shared_lock<shared_mutex> read_lock(lock_);
@@ -318,17 +418,24 @@ void Statestore::Topic::ToJson(Document* document, Value* topic_json) {
 
 Statestore::Subscriber::Subscriber(const SubscriberId& subscriber_id,
     const RegistrationId& registration_id, const TNetworkAddress& network_address,
-    const vector<TTopicRegistration>& subscribed_topics)
+    const vector<TTopicRegistration>& subscribed_topics,
+    const vector<IntCounter*>& bytes_sent_metrics)
   : subscriber_id_(subscriber_id),
     registration_id_(registration_id),
     network_address_(network_address) {
+  DCHECK_EQ(subscribed_topics.size(), bytes_sent_metrics.size());
   RefreshLastHeartbeatTimestamp();
-  for (const TTopicRegistration& topic : subscribed_topics) {
+  for (int i = 0; i < subscribed_topics.size(); ++i) {
+    const TTopicRegistration& topic = subscribed_topics[i];
     GetTopicsMapForId(topic.topic_name)
         ->emplace(piecewise_construct, forward_as_tuple(topic.topic_name),
             forward_as_tuple(
                 topic.is_transient, topic.populate_min_subscriber_topic_version,
-                topic.filter_prefix));
+                topic.filter_prefix,
+                topic.__isset.accepts_compressed_updates
+                    && topic.accepts_compressed_updates,
+                topic.__isset.accepts_entry_diffs && topic.accepts_entry_diffs,
+                bytes_sent_metrics[i]));
   }
 }
 
@@ -620,7 +727,8 @@ Status Statestore::RegisterSubscriber(const SubscriberId& subscriber_id,
                   << "' on behalf of subscriber: '" << subscriber_id;
         topics_.emplace(piecewise_construct, forward_as_tuple(topic.topic_name),
             forward_as_tuple(topic.topic_name, key_size_metric_, value_size_metric_,
-            topic_size_metric_));
+            topic_size_metric_,
+            metrics_->AddCounter(STATESTORE_TOPIC_BYTES_SENT, 0, topic.topic_name)));
       }
     }
   }
@@ -633,8 +741,13 @@ Status Statestore::RegisterSubscriber(const SubscriberId& subscriber_id,
     }
 
     UUIDToTUniqueId(subscriber_uuid_generator_(), registration_id);
-    shared_ptr<Subscriber> current_registration(
-        new Subscriber(subscriber_id, *registration_id, location, topic_registrations));
+    vector<IntCounter*> bytes_sent_metrics;
+    for (const TTopicRegistration& topic : topic_registrations) {
+      bytes_sent_metrics.push_back(
+          GetSubscriberBytesSentMetric(subscriber_id, topic.topic_name));
+    }
+    shared_ptr<Subscriber> current_registration(new Subscriber(subscriber_id,
+        *registration_id, location, topic_registrations, bytes_sent_metrics));
     subscribers_.emplace(subscriber_id, current_registration);
     failure_detector_->UpdateHeartbeat(subscriber_id, true);
     num_subscribers_metric_->SetValue(subscribers_.size());
@@ -672,7 +785,8 @@ Status Statestore::SendTopicUpdate(Subscriber* subscriber, UpdateKind update_kin
 
   // First thing: make a list of updates to send
   TUpdateStateRequest update_state_request;
-  GatherTopicUpdates(*subscriber, update_kind, &update_state_request);
+  vector<pair<IntCounter*, int64_t>> bytes_sent;
+  GatherTopicUpdates(*subscriber, update_kind, &update_state_request, &bytes_sent);
   // 'subscriber' may not be subscribed to any updates of 'update_kind'.
   if (update_state_request.topic_deltas.empty()) {
     *update_skipped = false;
@@ -692,6 +806,9 @@ Status Statestore::SendTopicUpdate(Subscriber* subscriber, UpdateKind update_kin
   TUpdateStateResponse response;
   RETURN_IF_ERROR(client.DoRpc(
       &StatestoreSubscriberClientWrapper::UpdateState, update_state_request, &response));
+  for (const auto& metric_and_bytes : bytes_sent) {
+    metric_and_bytes.first->Increment(metric_and_bytes.second);
+  }
 
   StatsMetric<double>* update_duration_metric =
       update_kind == UpdateKind::PRIORITY_TOPIC_UPDATE ?
@@ -769,7 +886,8 @@ Status Statestore::SendTopicUpdate(Subscriber* subscriber, UpdateKind update_kin
 }
 
 void Statestore::GatherTopicUpdates(const Subscriber& subscriber, UpdateKind update_kind,
-    TUpdateStateRequest* update_state_request) {
+    TUpdateStateRequest* update_state_request,
+    vector<pair<IntCounter*, int64_t>>* bytes_sent) {
   DCHECK(update_kind == UpdateKind::TOPIC_UPDATE
       || update_kind == UpdateKind::PRIORITY_TOPIC_UPDATE)
       << static_cast<int>(update_kind);
@@ -792,9 +910,16 @@ void Statestore::GatherTopicUpdates(const Subscriber& subscriber, UpdateKind upd
       TTopicDelta& topic_delta =
           update_state_request->topic_deltas[subscribed_topic.first];
       topic_delta.topic_name = subscribed_topic.first;
-      topic_it->second.BuildDelta(subscriber.id(), last_processed_version,
-          subscribed_topic.second.filter_prefix, &topic_delta);
-      if (subscribed_topic.second.populate_min_subscriber_topic_version) {
+      const Subscriber::TopicSubscription& subscription = subscribed_topic.second;
+      int64_t delta_bytes = topic_it->second.BuildDelta(subscriber.id(),
+          last_processed_version, subscription.filter_prefix,
+          FLAGS_statestore_send_topic_entry_diffs && subscription.accepts_entry_diffs,
+          FLAGS_statestore_compress_topic_updates
+              && subscription.accepts_compressed_updates,
+          &topic_delta);
+      bytes_sent->emplace_back(topic_it->second.bytes_sent_metric(), delta_bytes);
+      bytes_sent->emplace_back(subscription.bytes_sent_metric, delta_bytes);
+      if (subscription.populate_min_subscriber_topic_version) {
         deltas_needing_min_version.push_back(&topic_delta);
       }
     }
@@ -831,6 +956,17 @@ Statestore::TopicEntry::Version Statestore::GetMinSubscriberTopicVersion(
   return found ? min_topic_version : Subscriber::TOPIC_INITIAL_VERSION;
 }
 
+IntCounter* Statestore::GetSubscriberBytesSentMetric(
+    const SubscriberId& subscriber_id, const TopicId& topic_id) {
+  string metric_arg = Substitute("$0.topic-$1", subscriber_id, topic_id);
+  auto it = subscriber_bytes_sent_metrics_.find(metric_arg);
+  if (it != subscriber_bytes_sent_metrics_.end()) return it->second;
+  IntCounter* metric =
+      metrics_->AddCounter(STATESTORE_SUBSCRIBER_BYTES_SENT, 0, metric_arg);
+  subscriber_bytes_sent_metrics_.emplace(metric_arg, metric);
+  return metric;
+}
+
 bool Statestore::IsPrioritizedTopic(const string& topic) {
   return topic == IMPALA_MEMBERSHIP_TOPIC || topic == IMPALA_REQUEST_QUEUE_TOPIC;
 }
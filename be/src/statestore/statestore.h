@@ -21,6 +21,7 @@
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -212,6 +213,19 @@ class Statestore : public CacheLineAligned {
     /// Sets the is_deleted_ flag for this entry.
     void SetDeleted(bool is_deleted) { is_deleted_ = is_deleted; }
 
+    /// Sets the diff from the value of this entry at 'diff_base_version' to the current
+    /// value. Must be called after SetValue().
+    void SetDiff(Value diff, Version diff_base_version) {
+      diff_ = std::move(diff);
+      diff_base_version_ = diff_base_version;
+    }
+
+    /// Drops the diff, e.g. because the value changed without one being computed.
+    void ClearDiff() {
+      diff_.clear();
+      diff_.shrink_to_fit();
+    }
+
     TopicEntry() : version_(TOPIC_ENTRY_INITIAL_VERSION),
         is_deleted_(false) { }
 
@@ -219,6 +233,9 @@ class Statestore : public CacheLineAligned {
     uint64_t version() const { return version_; }
     uint32_t length() const { return value_.size(); }
     bool is_deleted() const { return is_deleted_; }
+    bool has_diff() const { return !diff_.empty(); }
+    const Value& diff() const { return diff_; }
+    Version diff_base_version() const { return diff_base_version_; }
 
    private:
     /// Byte string value, owned by this TopicEntry. The value is opaque to the
@@ -233,6 +250,13 @@ class Statestore : public CacheLineAligned {
     /// Indicates if the entry has been deleted. If true, the entry will still be
     /// retained to track changes to send to subscribers.
     bool is_deleted_;
+
+    /// If not empty, a binary diff (see util/binary-diff.h) from the value this entry
+    /// had at 'diff_base_version_' to 'value_'. Only computed if
+    /// --statestore_send_topic_entry_diffs is true. Sent instead of the value to
+    /// subscribers that accept diffs and have processed 'diff_base_version_'.
+    Value diff_;
+    Version diff_base_version_ = 0;
   };
 
   /// Map from TopicEntryKey to TopicEntry, maintained by a Topic object.
@@ -250,15 +274,18 @@ class Statestore : public CacheLineAligned {
   class Topic {
    public:
     Topic(const TopicId& topic_id, IntGauge* key_size_metric,
-        IntGauge* value_size_metric, IntGauge* topic_size_metric)
+        IntGauge* value_size_metric, IntGauge* topic_size_metric,
+        IntCounter* bytes_sent_metric)
         : topic_id_(topic_id), last_version_(0L), total_key_size_bytes_(0L),
           total_value_size_bytes_(0L), key_size_metric_(key_size_metric),
-          value_size_metric_(value_size_metric), topic_size_metric_(topic_size_metric) { }
+          value_size_metric_(value_size_metric), topic_size_metric_(topic_size_metric),
+          bytes_sent_metric_(bytes_sent_metric) { }
 
     /// Add entries with the given keys and values. If is_deleted is true for an entry,
     /// it is considered deleted, and may be garbage collected in the future. Each entry
     /// is assigned a new version number by the Topic, and the version numbers are
-    /// returned.
+    /// returned. If --statestore_send_topic_entry_diffs is true, a diff from the previous
+    /// value is computed for updated entries, without holding the exclusive lock.
     ///
     /// Safe to call concurrently from multiple threads (for different subscribers).
     /// Acquires an exclusive write lock for the topic.
@@ -286,17 +313,39 @@ class Statestore : public CacheLineAligned {
 
     /// Build a delta update to send to 'subscriber_id' including the deltas greater
     /// than 'last_processed_version' (not inclusive). Only those items whose keys
-    /// start with 'filter_prefix' are included in the update.
+    /// start with 'filter_prefix' are included in the update. If 'send_diffs' is true,
+    /// entries with a diff against a version the subscriber processed are sent as the
+    /// diff. If 'compress' is true and the entries are larger than
+    /// --statestore_compress_topic_updates_min_bytes, they are sent compressed. Returns
+    /// the number of bytes of keys and values (or compressed entries) in the update.
     ///
     /// Safe to call concurrently from multiple threads (for different subscribers).
     /// Acquires a shared read lock for the topic.
-    void BuildDelta(const SubscriberId& subscriber_id,
+    int64_t BuildDelta(const SubscriberId& subscriber_id,
         TopicEntry::Version last_processed_version, const std::string& filter_prefix,
-        TTopicDelta* delta);
+        bool send_diffs, bool compress, TTopicDelta* delta);
+
+    IntCounter* bytes_sent_metric() const { return bytes_sent_metric_; }
 
     /// Adds entries representing the current topic state to 'topic_json'.
     void ToJson(rapidjson::Document* document, rapidjson::Value* topic_json);
    private:
+    /// The compressed entries of the last compressed delta built for this topic. Most
+    /// subscribers are at the same version, so they can share the result.
+    struct CompressedDelta {
+      TopicEntry::Version from_version = -1;
+      TopicEntry::Version to_version = -1;
+      std::string filter_prefix;
+      bool send_diffs = false;
+      std::shared_ptr<const std::string> compressed_entries;
+    };
+
+    /// Computes the diffs for the entries of 'entries' that replace an existing value.
+    /// Returns a map from the index in 'entries' to the version of the current value and
+    /// the diff from it. Acquires a shared read lock for the topic.
+    std::map<int, std::pair<TopicEntry::Version, TopicEntry::Value>> ComputeDiffs(
+        const std::vector<TTopicItem>& entries);
+
     /// Unique identifier for this topic. Should be human-readable.
     const TopicId topic_id_;
 
@@ -334,6 +383,13 @@ class Statestore : public CacheLineAligned {
     IntGauge* key_size_metric_;
     IntGauge* value_size_metric_;
     IntGauge* topic_size_metric_;
+
+    /// Total bytes of updates to this topic sent to all subscribers.
+    IntCounter* bytes_sent_metric_;
+
+    /// Protects 'last_compressed_delta_'. Acquired after 'lock_' if both are held.
+    std::mutex compressed_delta_lock_;
+    CompressedDelta last_compressed_delta_;
   };
 
   /// Protects the 'topics_' map. Should be held shared when reading or holding a
@@ -354,17 +410,24 @@ class Statestore : public CacheLineAligned {
   /// subscriber's ID and network location.
   class Subscriber {
    public:
+    /// 'bytes_sent_metrics' holds the counter of bytes sent to this subscriber for each
+    /// topic in 'subscribed_topics'.
     Subscriber(const SubscriberId& subscriber_id, const RegistrationId& registration_id,
         const TNetworkAddress& network_address,
-        const std::vector<TTopicRegistration>& subscribed_topics);
+        const std::vector<TTopicRegistration>& subscribed_topics,
+        const std::vector<IntCounter*>& bytes_sent_metrics);
 
     /// Information about a subscriber's subscription to a specific topic.
     struct TopicSubscription {
       TopicSubscription(bool is_transient, bool populate_min_subscriber_topic_version,
-          std::string filter_prefix)
+          std::string filter_prefix, bool accepts_compressed_updates,
+          bool accepts_entry_diffs, IntCounter* bytes_sent_metric)
         : is_transient(is_transient),
           populate_min_subscriber_topic_version(populate_min_subscriber_topic_version),
-          filter_prefix(std::move(filter_prefix)) {}
+          filter_prefix(std::move(filter_prefix)),
+          accepts_compressed_updates(accepts_compressed_updates),
+          accepts_entry_diffs(accepts_entry_diffs),
+          bytes_sent_metric(bytes_sent_metric) {}
 
       /// Whether entries written by this subscriber should be considered transient.
       const bool is_transient;
@@ -376,6 +439,15 @@ class Statestore : public CacheLineAligned {
       /// The prefix for which the subscriber wants to see updates.
       const std::string filter_prefix;
 
+      /// Whether the subscriber can handle compressed entries and diffs of values in
+      /// updates of this topic.
+      const bool accepts_compressed_updates;
+      const bool accepts_entry_diffs;
+
+      /// Bytes of updates of this topic sent to this subscriber. Shared by all
+      /// registrations of the subscriber.
+      IntCounter* const bytes_sent_metric;
+
       /// The last topic entry version successfully processed by this subscriber. Only
       /// written by a single thread at a time but can be read concurrently.
       AtomicInt64 last_version{TOPIC_INITIAL_VERSION};
@@ -503,6 +575,12 @@ class Statestore : public CacheLineAligned {
     SubscriberMap;
   SubscriberMap subscribers_;
 
+  /// Counters of the bytes of topic updates sent to each subscriber, keyed by the metric
+  /// argument "<topic>.<subscriber id>". Kept when a subscriber unregisters so that the
+  /// counters of a subscriber that registers again continue to grow. Protected by
+  /// subscribers_lock_.
+  boost::unordered_map<std::string, IntCounter*> subscriber_bytes_sent_metrics_;
+
   /// Used to generated unique IDs for each new registration.
   boost::uuids::random_generator subscriber_uuid_generator_;
 
@@ -615,6 +693,11 @@ class Statestore : public CacheLineAligned {
   /// Same as above, but for SendHeartbeat() RPCs.
   StatsMetric<double>* heartbeat_duration_metric_;
 
+  /// Returns the counter of the bytes of updates of 'topic_id' sent to 'subscriber_id',
+  /// creating it on first use. Assumes that subscribers_lock_ is held by the caller.
+  IntCounter* GetSubscriberBytesSentMetric(
+      const SubscriberId& subscriber_id, const TopicId& topic_id);
+
   /// Utility method to add an update to the given thread pool, and to fail if the thread
   /// pool is already at capacity. Assumes that subscribers_lock_ is held by the caller.
   Status OfferUpdate(const ScheduledSubscriberUpdate& update,
@@ -661,8 +744,11 @@ class Statestore : public CacheLineAligned {
   /// over all updates in all priority or non-priority subscribed topics, based on
   /// 'update_kind'. The given TUpdateStateRequest object is populated with the
   /// changes to the subscribed topics. Takes the topics_map_lock_ and subscribers_lock_.
+  /// Adds the bytes-sent counters to increment once the update was sent and the number of
+  /// bytes for each to 'bytes_sent'.
   void GatherTopicUpdates(const Subscriber& subscriber, UpdateKind update_kind,
-      TUpdateStateRequest* update_state_request);
+      TUpdateStateRequest* update_state_request,
+      std::vector<std::pair<IntCounter*, int64_t>>* bytes_sent);
 
   /// Returns the minimum last processed topic version across all subscribers for the given
   /// topic ID. Calculated by enumerating all subscribers and looking at their
@@ -0,0 +1,81 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "statestore/topic-delta-util.h"
+
+#include <limits>
+
+#include <boost/scoped_ptr.hpp>
+
+#include "exec/read-write-util.h"
+#include "rpc/thrift-util.h"
+#include "util/codec.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+Status CompressTopicEntries(const vector<TTopicItem>& entries, string* compressed) {
+  TTopicItemList item_list;
+  item_list.items = entries;
+  ThriftSerializer serializer(true);
+  uint8_t* buffer;
+  uint32_t len;
+  RETURN_IF_ERROR(serializer.SerializeToBuffer(&item_list, &len, &buffer));
+  // LZ4 can't compress blocks of 2GB or more.
+  if (len > std::numeric_limits<int32_t>::max()) {
+    return Status("Topic entries are too large to compress");
+  }
+  scoped_ptr<Codec> compressor;
+  Codec::CodecInfo codec_info(THdfsCompression::LZ4);
+  RETURN_IF_ERROR(Codec::CreateCompressor(nullptr, false, codec_info, &compressor));
+  int64_t compressed_len = compressor->MaxOutputLen(len);
+  compressed->resize(compressed_len + sizeof(uint32_t));
+  uint8_t* output = reinterpret_cast<uint8_t*>(&(*compressed)[0]);
+  ReadWriteUtil::PutInt(output, len);
+  output += sizeof(uint32_t);
+  RETURN_IF_ERROR(compressor->ProcessBlock(true, len, buffer, &compressed_len, &output));
+  compressed->resize(compressed_len + sizeof(uint32_t));
+  return Status::OK();
+}
+
+Status DecompressTopicEntries(TTopicDelta* delta) {
+  if (!delta->__isset.compressed_topic_entries) return Status::OK();
+  const string& compressed = delta->compressed_topic_entries;
+  if (compressed.size() < sizeof(uint32_t)) {
+    return Status("Compressed topic entries are truncated");
+  }
+  const uint8_t* input = reinterpret_cast<const uint8_t*>(compressed.data());
+  int64_t len = ReadWriteUtil::GetInt<uint32_t>(input);
+  string serialized(len, '\0');
+  uint8_t* output = reinterpret_cast<uint8_t*>(&serialized[0]);
+  scoped_ptr<Codec> decompressor;
+  RETURN_IF_ERROR(
+      Codec::CreateDecompressor(nullptr, false, THdfsCompression::LZ4, &decompressor));
+  RETURN_IF_ERROR(decompressor->ProcessBlock(true, compressed.size() - sizeof(uint32_t),
+      input + sizeof(uint32_t), &len, &output));
+  TTopicItemList item_list;
+  uint32_t serialized_len = len;
+  RETURN_IF_ERROR(DeserializeThriftMsg(
+      reinterpret_cast<const uint8_t*>(serialized.data()), &serialized_len, true,
+      &item_list));
+  delta->topic_entries = move(item_list.items);
+  delta->compressed_topic_entries.clear();
+  delta->__isset.compressed_topic_entries = false;
+  return Status::OK();
+}
+}
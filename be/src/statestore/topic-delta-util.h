@@ -0,0 +1,37 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/status.h"
+#include "gen-cpp/StatestoreService_types.h"
+
+namespace impala {
+
+/// Serializes 'entries' as a TTopicItemList and compresses it with LZ4 into
+/// 'compressed', prefixed with the uncompressed size. The result can be sent in
+/// TTopicDelta.compressed_topic_entries.
+Status CompressTopicEntries(const std::vector<TTopicItem>& entries,
+    std::string* compressed) WARN_UNUSED_RESULT;
+
+/// If 'delta' has compressed entries, decompresses them into 'delta->topic_entries' and
+/// clears 'delta->compressed_topic_entries'. Otherwise does nothing.
+Status DecompressTopicEntries(TTopicDelta* delta) WARN_UNUSED_RESULT;
+}
@@ -0,0 +1,220 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "testutil/gtest-util.h"
+#include "util/arrow-ipc-writer.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+// Returns the int32 at 'offset' in 'stream'.
+static int32_t ReadInt32(const string& stream, int64_t offset) {
+  int32_t value;
+  memcpy(&value, stream.data() + offset, sizeof(value));
+  return value;
+}
+
+TEST(ArrowColumnBuilderTest, FixedWidth) {
+  ArrowColumnBuilder column(ArrowType::INT64);
+  column.AppendFixed<int64_t>(1);
+  column.AppendNull();
+  column.AppendFixed<int64_t>(3);
+  EXPECT_EQ(3, column.length());
+  EXPECT_EQ(1, column.null_count());
+  // One byte of validity bitmap and 8 bytes per value.
+  EXPECT_EQ(1 + 3 * 8, column.ByteSize(0, 3));
+  EXPECT_EQ(1 + 8, column.ByteSize(2, 1));
+
+  ArrowColumnBuilder copy(ArrowType::INT64);
+  copy.AppendRange(column, 1, 2);
+  EXPECT_EQ(2, copy.length());
+  EXPECT_EQ(1, copy.null_count());
+
+  column.Clear();
+  EXPECT_EQ(0, column.length());
+  EXPECT_EQ(0, column.null_count());
+}
+
+TEST(ArrowColumnBuilderTest, Bool) {
+  ArrowColumnBuilder column(ArrowType::BOOL);
+  for (int i = 0; i < 20; ++i) {
+    if (i % 5 == 0) {
+      column.AppendNull();
+    } else {
+      column.AppendBool(i % 2 == 0);
+    }
+  }
+  EXPECT_EQ(20, column.length());
+  EXPECT_EQ(4, column.null_count());
+  // A validity and a values bitmap.
+  EXPECT_EQ(2 * 3, column.ByteSize(0, 20));
+
+  // Copy a range that doesn't start at a byte boundary.
+  ArrowColumnBuilder copy(ArrowType::BOOL);
+  copy.AppendBool(true);
+  copy.AppendRange(column, 3, 15);
+  EXPECT_EQ(16, copy.length());
+  EXPECT_EQ(3, copy.null_count());
+}
+
+TEST(ArrowColumnBuilderTest, Utf8) {
+  ArrowColumnBuilder column(ArrowType::UTF8);
+  column.AppendString("abc", 3);
+  column.AppendNull();
+  column.AppendString("", 0);
+  column.AppendString("defgh", 5);
+  EXPECT_EQ(4, column.length());
+  EXPECT_EQ(1, column.null_count());
+  // One byte of validity bitmap, 4 bytes per offset plus the string data.
+  EXPECT_EQ(1 + 4 * 4 + 8, column.ByteSize(0, 4));
+  EXPECT_EQ(1 + 2 * 4 + 5, column.ByteSize(2, 2));
+
+  ArrowColumnBuilder copy(ArrowType::UTF8);
+  copy.AppendString("x", 1);
+  copy.AppendRange(column, 2, 2);
+  EXPECT_EQ(3, copy.length());
+  EXPECT_EQ(0, copy.null_count());
+  EXPECT_EQ(1 + 3 * 4 + 6, copy.ByteSize(0, 3));
+}
+
+// Checks the framing of the messages of a stream and the layout of the record batch
+// body. The flatbuffer metadata itself is not decoded.
+TEST(ArrowIpcWriterTest, StreamFraming) {
+  vector<ArrowField> fields = {{"i", ArrowType::INT32}, {"s", ArrowType::UTF8},
+      {"d", ArrowType::DECIMAL128, 38, 10}};
+  vector<ArrowColumnBuilder> columns;
+  for (const ArrowField& field : fields) columns.emplace_back(field.type);
+  for (int i = 0; i < 10; ++i) {
+    columns[0].AppendFixed<int32_t>(i);
+    columns[1].AppendString("value", 5);
+    columns[2].AppendFixed<__int128_t>(i);
+  }
+  string stream;
+  ArrowIpcWriter::WriteSchema(fields, &stream);
+  const int64_t schema_size = stream.size();
+  ArrowIpcWriter::WriteRecordBatch(columns, &stream);
+  ArrowIpcWriter::WriteEndOfStream(&stream);
+
+  // Every message starts with the continuation marker and the length of the metadata,
+  // which is padded to a multiple of 8.
+  EXPECT_EQ(-1, ReadInt32(stream, 0));
+  const int32_t schema_metadata_len = ReadInt32(stream, 4);
+  EXPECT_EQ(0, schema_metadata_len % 8);
+  // The schema message has no body.
+  EXPECT_EQ(schema_size, 8 + schema_metadata_len);
+  EXPECT_NE(string::npos, stream.find("s", 8));
+
+  EXPECT_EQ(-1, ReadInt32(stream, schema_size));
+  const int32_t batch_metadata_len = ReadInt32(stream, schema_size + 4);
+  EXPECT_EQ(0, batch_metadata_len % 8);
+  // The body holds the values buffers, each padded to a multiple of 8. There are no
+  // validity bitmaps because there are no NULLs.
+  const int64_t body_size = 40 + 48 + 56 + 160;
+  EXPECT_EQ(stream.size(), schema_size + 8 + batch_metadata_len + body_size + 8);
+  const int64_t body_offset = schema_size + 8 + batch_metadata_len;
+  EXPECT_EQ(9, ReadInt32(stream, body_offset + 9 * 4));
+  EXPECT_EQ("valuevalue", stream.substr(body_offset + 40 + 48, 10));
+
+  // The stream ends with the continuation marker and a zero length.
+  EXPECT_EQ(-1, ReadInt32(stream, stream.size() - 8));
+  EXPECT_EQ(0, ReadInt32(stream, stream.size() - 4));
+}
+
+// The stream for an INT32 and a UTF8 column with NULLs, as written by ArrowIpcWriter.
+// It was checked with pyarrow, which reads it back with pyarrow.ipc.open_stream() as
+// the table {'i': [1, None, -3], 's': ['ab', '', None]} that passes
+// Table.validate(full=True).
+static const uint8_t GOLDEN_STREAM[] = {
+    0xff, 0xff, 0xff, 0xff, 0xc8, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x0c, 0x00,
+    0x17, 0x00, 0x14, 0x00, 0x16, 0x00, 0x10, 0x00, 0x08, 0x00, 0x0c, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+    0x00, 0x00, 0x04, 0x00, 0x01, 0x00, 0x08, 0x00, 0x0a, 0x00, 0x08, 0x00, 0x04, 0x00,
+    0x08, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00,
+    0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x58, 0x00, 0x00, 0x00, 0x10, 0x00, 0x12, 0x00,
+    0x04, 0x00, 0x10, 0x00, 0x11, 0x00, 0x08, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x10, 0x00,
+    0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x1c, 0x00, 0x00, 0x00, 0x24, 0x00, 0x00, 0x00,
+    0x01, 0x02, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x69, 0x00, 0x08, 0x00, 0x09, 0x00,
+    0x04, 0x00, 0x08, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x12, 0x00, 0x04, 0x00,
+    0x10, 0x00, 0x11, 0x00, 0x08, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x10, 0x00, 0x00, 0x00,
+    0x10, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x01, 0x05,
+    0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x73, 0x00, 0x04, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff,
+    0xff, 0xff, 0xd0, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x17, 0x00,
+    0x14, 0x00, 0x16, 0x00, 0x10, 0x00, 0x08, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00,
+    0x04, 0x00, 0x03, 0x00, 0x0a, 0x00, 0x18, 0x00, 0x08, 0x00, 0x10, 0x00, 0x14, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x30, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfd, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00,
+    0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00,
+    0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x61, 0x62, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00
+};
+
+// The schema, the record batch metadata and the body, including NULL bitmaps and string
+// offsets, must not change, since other readers must be able to read them.
+TEST(ArrowIpcWriterTest, GoldenStream) {
+  vector<ArrowField> fields = {{"i", ArrowType::INT32}, {"s", ArrowType::UTF8}};
+  vector<ArrowColumnBuilder> columns;
+  for (const ArrowField& field : fields) columns.emplace_back(field.type);
+  columns[0].AppendFixed<int32_t>(1);
+  columns[0].AppendNull();
+  columns[0].AppendFixed<int32_t>(-3);
+  columns[1].AppendString("ab", 2);
+  columns[1].AppendString("", 0);
+  columns[1].AppendNull();
+  string stream;
+  ArrowIpcWriter::WriteSchema(fields, &stream);
+  ArrowIpcWriter::WriteRecordBatch(columns, &stream);
+  ArrowIpcWriter::WriteEndOfStream(&stream);
+  ASSERT_EQ(sizeof(GOLDEN_STREAM), stream.size());
+  for (size_t i = 0; i < stream.size(); ++i) {
+    EXPECT_EQ(GOLDEN_STREAM[i], static_cast<uint8_t>(stream[i])) << "offset " << i;
+  }
+
+  // The body of the record batch precedes the end-of-stream marker. Each buffer is
+  // padded to 8 bytes: validity bitmap and values of 'i', then validity bitmap,
+  // offsets and data of 's'.
+  const int64_t body_offset = stream.size() - 8 - 5 * 8 - 8;
+  EXPECT_EQ(0x05, stream[body_offset]);
+  EXPECT_EQ(1, ReadInt32(stream, body_offset + 8));
+  EXPECT_EQ(0, ReadInt32(stream, body_offset + 12));
+  EXPECT_EQ(-3, ReadInt32(stream, body_offset + 16));
+  EXPECT_EQ(0x03, stream[body_offset + 24]);
+  EXPECT_EQ(0, ReadInt32(stream, body_offset + 32));
+  EXPECT_EQ(2, ReadInt32(stream, body_offset + 36));
+  EXPECT_EQ(2, ReadInt32(stream, body_offset + 40));
+  EXPECT_EQ(2, ReadInt32(stream, body_offset + 44));
+  EXPECT_EQ("ab", stream.substr(body_offset + 48, 2));
+}
+}
@@ -0,0 +1,490 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/arrow-ipc-writer.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "util/bit-util.h"
+
+#include "common/names.h"
+
+using namespace impala;
+
+namespace {
+
+// Enum values and union type ids from the Arrow flatbuffer schemas, see
+// https://github.com/apache/arrow/blob/main/format/Message.fbs and Schema.fbs.
+constexpr int16_t METADATA_VERSION_V5 = 4;
+constexpr uint8_t MESSAGE_HEADER_SCHEMA = 1;
+constexpr uint8_t MESSAGE_HEADER_RECORD_BATCH = 3;
+constexpr uint8_t TYPE_ID_INT = 2;
+constexpr uint8_t TYPE_ID_FLOATING_POINT = 3;
+constexpr uint8_t TYPE_ID_UTF8 = 5;
+constexpr uint8_t TYPE_ID_BOOL = 6;
+constexpr uint8_t TYPE_ID_DECIMAL = 7;
+constexpr uint8_t TYPE_ID_DATE = 8;
+constexpr uint8_t TYPE_ID_TIMESTAMP = 10;
+constexpr int16_t PRECISION_SINGLE = 1;
+constexpr int16_t PRECISION_DOUBLE = 2;
+constexpr int16_t DATE_UNIT_DAY = 0;
+constexpr int16_t TIME_UNIT_MICROSECOND = 2;
+constexpr int16_t ENDIANNESS_LITTLE = 0;
+
+// Precedes the metadata of every message and, followed by a zero length, marks the end
+// of the stream.
+constexpr uint32_t CONTINUATION_MARKER = 0xFFFFFFFF;
+
+// Messages and buffers in the body are padded to multiples of this.
+constexpr int64_t IPC_ALIGNMENT = 8;
+
+int64_t PaddingFor(int64_t len, int64_t alignment) {
+  return BitUtil::RoundUp(len, alignment) - len;
+}
+
+template <typename T>
+void Put(T value, string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// A flatbuffer table that is assembled in memory and then encoded by FlatBufferWriter.
+// Fields are identified by their slot, i.e. their index in the table definition.
+struct FbTable {
+  struct Field {
+    enum RefType { NONE, TABLE, STRING, TABLE_VECTOR, STRUCT_VECTOR };
+    int slot;
+    // The type of the referenced object or NONE for scalar fields.
+    RefType ref_type;
+    // The little-endian bytes of a scalar field.
+    string scalar;
+    // The table of a TABLE field or the tables of a TABLE_VECTOR field.
+    vector<FbTable> tables;
+    // The characters of a STRING field or the concatenated structs of a STRUCT_VECTOR
+    // field.
+    string bytes;
+    int num_structs = 0;
+  };
+
+  template <typename T>
+  FbTable& AddScalar(int slot, T value) {
+    fields.push_back({slot, Field::NONE});
+    Put(value, &fields.back().scalar);
+    return *this;
+  }
+
+  FbTable& AddTable(int slot, FbTable table) {
+    fields.push_back({slot, Field::TABLE});
+    fields.back().tables.push_back(move(table));
+    return *this;
+  }
+
+  FbTable& AddString(int slot, const string& value) {
+    fields.push_back({slot, Field::STRING});
+    fields.back().bytes = value;
+    return *this;
+  }
+
+  FbTable& AddTableVector(int slot, vector<FbTable> tables) {
+    fields.push_back({slot, Field::TABLE_VECTOR});
+    fields.back().tables = move(tables);
+    return *this;
+  }
+
+  /// The structs must have an alignment of 8, which is the case for all structs in the
+  /// Arrow schema.
+  FbTable& AddStructVector(int slot, string structs, int num_structs) {
+    fields.push_back({slot, Field::STRUCT_VECTOR});
+    fields.back().bytes = move(structs);
+    fields.back().num_structs = num_structs;
+    return *this;
+  }
+
+  vector<Field> fields;
+};
+
+// Encodes a flatbuffer. Unlike the FlatBuffers library, which builds buffers back to
+// front, this writes front to back: every object is written before the objects that it
+// references, whose offsets are patched in once they were written. That keeps all
+// unsigned offsets positive, as the format requires. Scalars are aligned to their size
+// relative to the start of the buffer.
+class FlatBufferWriter {
+ public:
+  // Appends a flatbuffer with the root table 'root' to 'out'.
+  static void Write(const FbTable& root, string* out) {
+    FlatBufferWriter writer(out);
+    int64_t root_ref = writer.PutRef();
+    writer.PatchRef(root_ref, writer.WriteTable(root));
+  }
+
+ private:
+  explicit FlatBufferWriter(string* out) : out_(out), start_(out->size()) {}
+
+  int64_t pos() const { return out_->size() - start_; }
+
+  void Align(int64_t alignment) { out_->append(PaddingFor(pos(), alignment), '\0'); }
+
+  // Writes a placeholder for an offset and returns its position.
+  int64_t PutRef() {
+    Align(sizeof(uint32_t));
+    int64_t ref_pos = pos();
+    Put<uint32_t>(0, out_);
+    return ref_pos;
+  }
+
+  void PatchRef(int64_t ref_pos, int64_t target_pos) {
+    DCHECK_GT(target_pos, ref_pos);
+    uint32_t offset = target_pos - ref_pos;
+    memcpy(&(*out_)[start_ + ref_pos], &offset, sizeof(offset));
+  }
+
+  static int FieldSize(const FbTable::Field& field) {
+    if (field.ref_type == FbTable::Field::NONE) return field.scalar.size();
+    return sizeof(uint32_t);
+  }
+
+  // Writes the vtable of 'table' followed by the table and the objects it references.
+  // Returns the position of the table.
+  int64_t WriteTable(const FbTable& table) {
+    // Lay out the fields behind the offset to the vtable, largest first to avoid
+    // padding.
+    vector<const FbTable::Field*> fields;
+    for (const FbTable::Field& field : table.fields) fields.push_back(&field);
+    stable_sort(fields.begin(), fields.end(),
+        [](const FbTable::Field* a, const FbTable::Field* b) {
+          return FieldSize(*a) > FieldSize(*b);
+        });
+    vector<int> field_offsets;
+    int table_size = sizeof(int32_t);
+    int table_alignment = sizeof(int32_t);
+    int num_slots = 0;
+    for (const FbTable::Field* field : fields) {
+      int size = FieldSize(*field);
+      table_size = BitUtil::RoundUp(table_size, size);
+      field_offsets.push_back(table_size);
+      table_size += size;
+      table_alignment = max(table_alignment, size);
+      num_slots = max(num_slots, field->slot + 1);
+    }
+    vector<uint16_t> vtable(num_slots, 0);
+    for (size_t i = 0; i < fields.size(); ++i) vtable[fields[i]->slot] = field_offsets[i];
+
+    Align(sizeof(uint16_t));
+    int64_t vtable_pos = pos();
+    Put<uint16_t>(sizeof(uint16_t) * (2 + num_slots), out_);
+    Put<uint16_t>(table_size, out_);
+    for (uint16_t field_offset : vtable) Put(field_offset, out_);
+
+    Align(table_alignment);
+    int64_t table_pos = pos();
+    Put<int32_t>(table_pos - vtable_pos, out_);
+    vector<pair<const FbTable::Field*, int64_t>> refs;
+    for (size_t i = 0; i < fields.size(); ++i) {
+      out_->append(table_pos + field_offsets[i] - pos(), '\0');
+      if (fields[i]->ref_type == FbTable::Field::NONE) {
+        out_->append(fields[i]->scalar);
+      } else {
+        refs.emplace_back(fields[i], PutRef());
+      }
+    }
+    for (const auto& ref : refs) PatchRef(ref.second, WriteObject(*ref.first));
+    return table_pos;
+  }
+
+  // Writes the object referenced by 'field' and returns its position.
+  int64_t WriteObject(const FbTable::Field& field) {
+    int64_t object_pos;
+    switch (field.ref_type) {
+      case FbTable::Field::TABLE:
+        DCHECK_EQ(field.tables.size(), 1);
+        return WriteTable(field.tables[0]);
+      case FbTable::Field::STRING:
+        Align(sizeof(uint32_t));
+        object_pos = pos();
+        Put<uint32_t>(field.bytes.size(), out_);
+        out_->append(field.bytes);
+        out_->push_back('\0');
+        return object_pos;
+      case FbTable::Field::TABLE_VECTOR: {
+        Align(sizeof(uint32_t));
+        object_pos = pos();
+        Put<uint32_t>(field.tables.size(), out_);
+        vector<int64_t> refs;
+        for (size_t i = 0; i < field.tables.size(); ++i) refs.push_back(PutRef());
+        for (size_t i = 0; i < field.tables.size(); ++i) {
+          PatchRef(refs[i], WriteTable(field.tables[i]));
+        }
+        return object_pos;
+      }
+      case FbTable::Field::STRUCT_VECTOR:
+        // The structs follow the length and must be 8-byte aligned.
+        Align(sizeof(uint32_t));
+        if (pos() % 8 == 0) Put<uint32_t>(0, out_);
+        object_pos = pos();
+        Put<uint32_t>(field.num_structs, out_);
+        out_->append(field.bytes);
+        return object_pos;
+      default:
+        DCHECK(false);
+        return 0;
+    }
+  }
+
+  string* const out_;
+
+  // Position of the flatbuffer in 'out_'.
+  const int64_t start_;
+};
+
+// Appends an encapsulated message with the metadata 'message' and 'body' to 'out'.
+void WriteMessage(const FbTable& message, const string& body, string* out) {
+  DCHECK_EQ(body.size() % IPC_ALIGNMENT, 0);
+  Put(CONTINUATION_MARKER, out);
+  int64_t length_pos = out->size();
+  Put<int32_t>(0, out);
+  int64_t metadata_pos = out->size();
+  FlatBufferWriter::Write(message, out);
+  // Pad the metadata so that the body starts at a multiple of 8.
+  out->append(PaddingFor(out->size() - metadata_pos, IPC_ALIGNMENT), '\0');
+  int32_t metadata_length = out->size() - metadata_pos;
+  memcpy(&(*out)[length_pos], &metadata_length, sizeof(metadata_length));
+  out->append(body);
+}
+
+FbTable MessageTable(uint8_t header_type, FbTable header, int64_t body_length) {
+  FbTable message;
+  message.AddScalar<int16_t>(0, METADATA_VERSION_V5)
+      .AddScalar<uint8_t>(1, header_type)
+      .AddTable(2, move(header))
+      .AddScalar<int64_t>(3, body_length);
+  return message;
+}
+
+int ValueWidth(ArrowType type) {
+  switch (type) {
+    case ArrowType::BOOL:
+    case ArrowType::UTF8:
+      return 0;
+    case ArrowType::INT8:
+      return 1;
+    case ArrowType::INT16:
+      return 2;
+    case ArrowType::INT32:
+    case ArrowType::FLOAT:
+    case ArrowType::DATE32:
+      return 4;
+    case ArrowType::INT64:
+    case ArrowType::DOUBLE:
+    case ArrowType::TIMESTAMP_MICROS:
+      return 8;
+    case ArrowType::DECIMAL128:
+      return 16;
+  }
+  DCHECK(false);
+  return 0;
+}
+
+FbTable FieldTable(const ArrowField& field) {
+  FbTable type;
+  uint8_t type_id = 0;
+  switch (field.type) {
+    case ArrowType::BOOL:
+      type_id = TYPE_ID_BOOL;
+      break;
+    case ArrowType::INT8:
+    case ArrowType::INT16:
+    case ArrowType::INT32:
+    case ArrowType::INT64:
+      type_id = TYPE_ID_INT;
+      type.AddScalar<int32_t>(0, ValueWidth(field.type) * 8).AddScalar<uint8_t>(1, true);
+      break;
+    case ArrowType::FLOAT:
+      type_id = TYPE_ID_FLOATING_POINT;
+      type.AddScalar<int16_t>(0, PRECISION_SINGLE);
+      break;
+    case ArrowType::DOUBLE:
+      type_id = TYPE_ID_FLOATING_POINT;
+      type.AddScalar<int16_t>(0, PRECISION_DOUBLE);
+      break;
+    case ArrowType::UTF8:
+      type_id = TYPE_ID_UTF8;
+      break;
+    case ArrowType::DATE32:
+      // The default unit is MILLISECOND, so the unit must be set explicitly.
+      type_id = TYPE_ID_DATE;
+      type.AddScalar<int16_t>(0, DATE_UNIT_DAY);
+      break;
+    case ArrowType::TIMESTAMP_MICROS:
+      type_id = TYPE_ID_TIMESTAMP;
+      type.AddScalar<int16_t>(0, TIME_UNIT_MICROSECOND);
+      break;
+    case ArrowType::DECIMAL128:
+      type_id = TYPE_ID_DECIMAL;
+      type.AddScalar<int32_t>(0, field.precision)
+          .AddScalar<int32_t>(1, field.scale)
+          .AddScalar<int32_t>(2, 128);
+      break;
+  }
+  FbTable result;
+  // Readers require the children to be present, even if there are none.
+  result.AddString(0, field.name)
+      .AddScalar<uint8_t>(1, true)
+      .AddScalar<uint8_t>(2, type_id)
+      .AddTable(3, move(type))
+      .AddTableVector(5, {});
+  return result;
+}
+}
+
+ArrowColumnBuilder::ArrowColumnBuilder(ArrowType type)
+  : type_(type), value_width_(ValueWidth(type)) {
+  Clear();
+}
+
+void ArrowColumnBuilder::AppendNull() {
+  if (type_ == ArrowType::BOOL) {
+    AppendBit(length_, false, &values_);
+  } else if (type_ == ArrowType::UTF8) {
+    Put<int32_t>(data_.size(), &values_);
+  } else {
+    values_.append(value_width_, '\0');
+  }
+  AppendBit(length_, false, &validity_);
+  ++null_count_;
+  ++length_;
+}
+
+void ArrowColumnBuilder::AppendString(const char* ptr, int len) {
+  DCHECK(type_ == ArrowType::UTF8);
+  data_.append(ptr, len);
+  DCHECK_LE(data_.size(), numeric_limits<int32_t>::max());
+  Put<int32_t>(data_.size(), &values_);
+  AppendBit(length_, true, &validity_);
+  ++length_;
+}
+
+void ArrowColumnBuilder::AppendRange(
+    const ArrowColumnBuilder& other, int64_t start_idx, int64_t num_values) {
+  DCHECK(type_ == other.type_);
+  DCHECK_LE(start_idx + num_values, other.length_);
+  for (int64_t i = 0; i < num_values; ++i) {
+    bool valid = GetBit(other.validity_, start_idx + i);
+    AppendBit(length_ + i, valid, &validity_);
+    if (!valid) ++null_count_;
+  }
+  if (type_ == ArrowType::BOOL) {
+    for (int64_t i = 0; i < num_values; ++i) {
+      AppendBit(length_ + i, GetBit(other.values_, start_idx + i), &values_);
+    }
+  } else if (type_ == ArrowType::UTF8) {
+    const int32_t* offsets = reinterpret_cast<const int32_t*>(other.values_.data());
+    const int32_t begin = offsets[start_idx];
+    const int32_t end = offsets[start_idx + num_values];
+    const int64_t delta = static_cast<int64_t>(data_.size()) - begin;
+    data_.append(other.data_, begin, end - begin);
+    DCHECK_LE(data_.size(), numeric_limits<int32_t>::max());
+    for (int64_t i = 1; i <= num_values; ++i) {
+      Put<int32_t>(offsets[start_idx + i] + delta, &values_);
+    }
+  } else {
+    values_.append(other.values_, start_idx * value_width_, num_values * value_width_);
+  }
+  length_ += num_values;
+}
+
+int64_t ArrowColumnBuilder::ByteSize(int64_t start_idx, int64_t num_values) const {
+  DCHECK_LE(start_idx + num_values, length_);
+  const int64_t bitmap_bytes = BitUtil::Ceil(num_values, 8);
+  switch (type_) {
+    case ArrowType::BOOL:
+      return 2 * bitmap_bytes;
+    case ArrowType::UTF8: {
+      const int32_t* offsets = reinterpret_cast<const int32_t*>(values_.data());
+      return bitmap_bytes + num_values * sizeof(int32_t)
+          + offsets[start_idx + num_values] - offsets[start_idx];
+    }
+    default:
+      return bitmap_bytes + num_values * value_width_;
+  }
+}
+
+void ArrowColumnBuilder::Clear() {
+  length_ = 0;
+  null_count_ = 0;
+  validity_.clear();
+  values_.clear();
+  data_.clear();
+  // UTF8 values start with the offset of the first string.
+  if (type_ == ArrowType::UTF8) Put<int32_t>(0, &values_);
+}
+
+void ArrowIpcWriter::WriteSchema(const vector<ArrowField>& fields, string* out) {
+  vector<FbTable> fb_fields;
+  for (const ArrowField& field : fields) fb_fields.push_back(FieldTable(field));
+  FbTable schema;
+  schema.AddScalar<int16_t>(0, ENDIANNESS_LITTLE).AddTableVector(1, move(fb_fields));
+  WriteMessage(MessageTable(MESSAGE_HEADER_SCHEMA, move(schema), 0), "", out);
+}
+
+void ArrowIpcWriter::WriteRecordBatch(
+    const vector<ArrowColumnBuilder>& columns, string* out) {
+  const int64_t length = columns.empty() ? 0 : columns[0].length();
+  string body;
+  // FieldNode and Buffer structs, which both consist of two int64 values.
+  string nodes;
+  string buffers;
+  int num_buffers = 0;
+  auto add_buffer = [&](const string& data, int64_t len) {
+    DCHECK_LE(len, data.size());
+    Put<int64_t>(body.size(), &buffers);
+    Put<int64_t>(len, &buffers);
+    ++num_buffers;
+    body.append(data, 0, len);
+    body.append(PaddingFor(len, IPC_ALIGNMENT), '\0');
+  };
+  for (const ArrowColumnBuilder& column : columns) {
+    DCHECK_EQ(column.length(), length);
+    Put<int64_t>(length, &nodes);
+    Put<int64_t>(column.null_count(), &nodes);
+    // The validity bitmap may be omitted if there are no NULLs.
+    const int64_t bitmap_bytes = BitUtil::Ceil(length, 8);
+    add_buffer(column.validity_, column.null_count() > 0 ? bitmap_bytes : 0);
+    switch (column.type()) {
+      case ArrowType::BOOL:
+        add_buffer(column.values_, bitmap_bytes);
+        break;
+      case ArrowType::UTF8:
+        add_buffer(column.values_, (length + 1) * sizeof(int32_t));
+        add_buffer(column.data_, column.data_.size());
+        break;
+      default:
+        add_buffer(column.values_, length * column.value_width_);
+        break;
+    }
+  }
+  FbTable batch;
+  batch.AddScalar<int64_t>(0, length)
+      .AddStructVector(1, move(nodes), columns.size())
+      .AddStructVector(2, move(buffers), num_buffers);
+  FbTable message = MessageTable(MESSAGE_HEADER_RECORD_BATCH, move(batch), body.size());
+  WriteMessage(message, body, out);
+}
+
+void ArrowIpcWriter::WriteEndOfStream(string* out) {
+  Put(CONTINUATION_MARKER, out);
+  Put<int32_t>(0, out);
+}
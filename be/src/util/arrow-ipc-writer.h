@@ -0,0 +1,156 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/logging.h"
+
+namespace impala {
+
+/// The Arrow data types that ArrowColumnBuilder supports. All of them map to a single
+/// Arrow type without children.
+enum class ArrowType {
+  BOOL,
+  INT8,
+  INT16,
+  INT32,
+  INT64,
+  FLOAT,
+  DOUBLE,
+  /// Variable length UTF-8 strings with 32-bit offsets.
+  UTF8,
+  /// Days since the epoch.
+  DATE32,
+  /// Microseconds since the epoch, without a time zone.
+  TIMESTAMP_MICROS,
+  /// 128-bit little-endian two's complement unscaled values.
+  DECIMAL128,
+};
+
+/// A field of an Arrow schema.
+struct ArrowField {
+  std::string name;
+  ArrowType type;
+  /// Only used for DECIMAL128.
+  int precision = 0;
+  int scale = 0;
+};
+
+/// Accumulates the values of one column in the Arrow columnar layout, i.e. a validity
+/// bitmap and a values buffer, plus a data buffer for UTF8. The buffers are written out
+/// as is by ArrowIpcWriter::WriteRecordBatch().
+class ArrowColumnBuilder {
+ public:
+  explicit ArrowColumnBuilder(ArrowType type);
+
+  ArrowType type() const { return type_; }
+  int64_t length() const { return length_; }
+  int64_t null_count() const { return null_count_; }
+
+  void AppendNull();
+
+  /// Only valid for BOOL.
+  void AppendBool(bool value) {
+    DCHECK(type_ == ArrowType::BOOL);
+    AppendBit(length_, value, &values_);
+    AppendBit(length_, true, &validity_);
+    ++length_;
+  }
+
+  /// Appends a value of a fixed width type. sizeof(T) must be the width of type(), e.g.
+  /// int32_t for INT32 and DATE32 and __int128_t for DECIMAL128.
+  template <typename T>
+  void AppendFixed(T value) {
+    DCHECK_EQ(sizeof(T), value_width_);
+    values_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    AppendBit(length_, true, &validity_);
+    ++length_;
+  }
+
+  /// Only valid for UTF8.
+  void AppendString(const char* ptr, int len);
+
+  /// Appends the values in [start_idx, start_idx + num_values) of 'other', which must
+  /// have the same type and contain the range.
+  void AppendRange(const ArrowColumnBuilder& other, int64_t start_idx,
+      int64_t num_values);
+
+  /// Returns the approximate size of the given range of values in bytes.
+  int64_t ByteSize(int64_t start_idx, int64_t num_values) const;
+
+  /// Removes all values.
+  void Clear();
+
+ private:
+  friend class ArrowIpcWriter;
+
+  /// Appends 'bit' to 'bitmap', which holds 'idx' bits.
+  static void AppendBit(int64_t idx, bool bit, std::string* bitmap) {
+    if (idx % 8 == 0) bitmap->push_back(0);
+    if (bit) (*bitmap)[idx / 8] |= static_cast<char>(1 << (idx % 8));
+  }
+
+  static bool GetBit(const std::string& bitmap, int64_t idx) {
+    return (bitmap[idx / 8] >> (idx % 8)) & 1;
+  }
+
+  const ArrowType type_;
+
+  /// Width of a value in bytes for fixed width types, 0 for BOOL and UTF8.
+  const int value_width_;
+
+  int64_t length_ = 0;
+  int64_t null_count_ = 0;
+
+  /// One bit per value, set if the value is not NULL.
+  std::string validity_;
+
+  /// One bit per value for BOOL, (length_ + 1) int32 offsets into 'data_' for UTF8,
+  /// the values for all other types. NULL values have a zero value or an empty string.
+  std::string values_;
+
+  /// The concatenated strings for UTF8.
+  std::string data_;
+};
+
+/// Writes the Arrow IPC streaming format: a schema message followed by record batch
+/// messages and an optional end-of-stream marker. See
+/// https://arrow.apache.org/docs/format/Columnar.html#ipc-streaming-format.
+///
+/// Arrow is not a dependency of Impala, so the message metadata is encoded with a
+/// small flatbuffer encoder that only supports the parts of the Arrow schema used here:
+/// flat schemas of the types in ArrowType, little endian, metadata version V5 and no
+/// body compression, dictionaries or custom metadata.
+class ArrowIpcWriter {
+ public:
+  /// Appends the schema message for 'fields' to 'out'.
+  static void WriteSchema(const std::vector<ArrowField>& fields, std::string* out);
+
+  /// Appends a record batch message with the values of 'columns' to 'out'. 'columns'
+  /// must match the fields of the schema and have the same length.
+  static void WriteRecordBatch(
+      const std::vector<ArrowColumnBuilder>& columns, std::string* out);
+
+  /// Appends the end-of-stream marker to 'out'.
+  static void WriteEndOfStream(std::string* out);
+};
+}
@@ -0,0 +1,107 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <random>
+#include <string>
+
+#include "testutil/gtest-util.h"
+#include "util/binary-diff.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+static string RandomString(std::mt19937* rng, int len) {
+  string result(len, 0);
+  for (char& c : result) c = 'a' + (*rng)() % 16;
+  return result;
+}
+
+// Checks that applying the diff from 'base' to 'target' reproduces 'target' and returns
+// the size of the diff.
+static int64_t RoundTrip(const string& base, const string& target) {
+  string diff = BinaryDiff::Encode(base, target);
+  string result;
+  EXPECT_OK(BinaryDiff::Apply(base, diff, &result));
+  EXPECT_EQ(target, result);
+  return diff.size();
+}
+
+TEST(BinaryDiffTest, Basic) {
+  RoundTrip("", "");
+  RoundTrip("", "abc");
+  RoundTrip("abc", "");
+  RoundTrip("abc", "abd");
+  std::mt19937 rng(0);
+  string base = RandomString(&rng, 10000);
+  // Identical inputs only need a single copy.
+  EXPECT_LT(RoundTrip(base, base), 10);
+  // Unrelated inputs are one insert.
+  string other = RandomString(&rng, 10000);
+  EXPECT_LT(RoundTrip(base, other), other.size() + 10);
+}
+
+TEST(BinaryDiffTest, LocalChanges) {
+  std::mt19937 rng(0);
+  string base = RandomString(&rng, 100000);
+  // Overwrite a few bytes at both ends and in the middle, insert and delete a range.
+  string target = base;
+  target[0] = 'x';
+  target.replace(50000, 8, "12345678");
+  target[target.size() - 1] = 'y';
+  EXPECT_LT(RoundTrip(base, target), 100);
+  target = base;
+  target.insert(30000, RandomString(&rng, 100));
+  target.erase(70000, 100);
+  EXPECT_LT(RoundTrip(base, target), 200);
+  // Moved ranges are found as well.
+  target = base.substr(60000) + base.substr(0, 60000);
+  EXPECT_LT(RoundTrip(base, target), 20);
+}
+
+TEST(BinaryDiffTest, RandomEdits) {
+  std::mt19937 rng(0);
+  for (int i = 0; i < 200; ++i) {
+    string base = RandomString(&rng, rng() % 5000);
+    string target = base;
+    for (int j = 0; j < 5 && !target.empty(); ++j) {
+      int pos = rng() % target.size();
+      switch (rng() % 3) {
+        case 0: target.insert(pos, RandomString(&rng, rng() % 50)); break;
+        case 1: target.erase(pos, rng() % 50); break;
+        default: target[pos] = 'z';
+      }
+    }
+    RoundTrip(base, target);
+  }
+}
+
+TEST(BinaryDiffTest, Corrupt) {
+  std::mt19937 rng(0);
+  string base = RandomString(&rng, 1000);
+  string target = base;
+  target.replace(500, 10, "0123456789");
+  string diff = BinaryDiff::Encode(base, target);
+  string result;
+  // A truncated diff or a base that is too short are detected.
+  EXPECT_FALSE(BinaryDiff::Apply(base, diff.substr(0, diff.size() - 1), &result).ok());
+  EXPECT_FALSE(BinaryDiff::Apply(base.substr(0, 100), diff, &result).ok());
+  EXPECT_FALSE(BinaryDiff::Apply(base, "", &result).ok());
+  // An unknown opcode.
+  EXPECT_FALSE(BinaryDiff::Apply(base, string("\x01\x07", 2), &result).ok());
+}
+}
@@ -0,0 +1,159 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/binary-diff.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "common/names.h"
+
+namespace impala {
+
+// Instruction opcodes.
+static const uint8_t COPY = 0;
+static const uint8_t INSERT = 1;
+
+// Multiplier of the polynomial rolling hash.
+static const uint32_t HASH_MULTIPLIER = 0x01000193;
+
+static void PutVarint(uint64_t value, string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+// Reads a varint from 'in' at '*pos' and advances '*pos' past it. Returns false if 'in'
+// ends before the varint does.
+static bool GetVarint(const string& in, size_t* pos, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (*pos >= in.size()) return false;
+    uint8_t byte = static_cast<uint8_t>(in[(*pos)++]);
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+static uint32_t HashBlock(const char* data) {
+  uint32_t hash = 0;
+  for (int i = 0; i < BinaryDiff::BLOCK_SIZE; ++i) {
+    hash = hash * HASH_MULTIPLIER + static_cast<uint8_t>(data[i]);
+  }
+  return hash;
+}
+
+string BinaryDiff::Encode(const string& base, const string& target) {
+  string diff;
+  PutVarint(target.size(), &diff);
+  // Start of the target bytes that are not covered by an instruction yet.
+  size_t literal_start = 0;
+  auto append_insert = [&diff, &target](size_t start, size_t end) {
+    if (end == start) return;
+    diff.push_back(INSERT);
+    PutVarint(end - start, &diff);
+    diff.append(target, start, end - start);
+  };
+
+  if (base.size() >= BLOCK_SIZE && target.size() >= BLOCK_SIZE) {
+    // Index the blocks of the base by their hash. The first block with a given hash wins.
+    std::unordered_map<uint32_t, size_t> blocks;
+    blocks.reserve(base.size() / BLOCK_SIZE);
+    for (size_t offset = 0; offset + BLOCK_SIZE <= base.size(); offset += BLOCK_SIZE) {
+      blocks.emplace(HashBlock(base.data() + offset), offset);
+    }
+    // Factor of the byte that leaves the window when rolling the hash.
+    uint32_t out_factor = 1;
+    for (int i = 1; i < BLOCK_SIZE; ++i) out_factor *= HASH_MULTIPLIER;
+
+    size_t pos = 0;
+    uint32_t hash = HashBlock(target.data());
+    while (true) {
+      auto it = blocks.find(hash);
+      if (it != blocks.end()
+          && memcmp(base.data() + it->second, target.data() + pos, BLOCK_SIZE) == 0) {
+        // Extend the match backwards into the pending literal bytes and forwards as far
+        // as the inputs agree.
+        size_t base_start = it->second;
+        size_t target_start = pos;
+        while (target_start > literal_start && base_start > 0
+            && base[base_start - 1] == target[target_start - 1]) {
+          --base_start;
+          --target_start;
+        }
+        size_t len = pos + BLOCK_SIZE - target_start;
+        while (base_start + len < base.size() && target_start + len < target.size()
+            && base[base_start + len] == target[target_start + len]) {
+          ++len;
+        }
+        append_insert(literal_start, target_start);
+        diff.push_back(COPY);
+        PutVarint(base_start, &diff);
+        PutVarint(len, &diff);
+        pos = target_start + len;
+        literal_start = pos;
+        if (pos + BLOCK_SIZE > target.size()) break;
+        hash = HashBlock(target.data() + pos);
+      } else {
+        if (pos + BLOCK_SIZE >= target.size()) break;
+        hash = (hash - static_cast<uint8_t>(target[pos]) * out_factor) * HASH_MULTIPLIER
+            + static_cast<uint8_t>(target[pos + BLOCK_SIZE]);
+        ++pos;
+      }
+    }
+  }
+  append_insert(literal_start, target.size());
+  return diff;
+}
+
+Status BinaryDiff::Apply(const string& base, const string& diff, string* target) {
+  static const char* CORRUPT_DIFF = "Corrupt binary diff";
+  size_t pos = 0;
+  uint64_t target_size;
+  if (!GetVarint(diff, &pos, &target_size)) return Status(CORRUPT_DIFF);
+  target->clear();
+  // 'target_size' is only trusted as a hint once it is bounded by the inputs.
+  target->reserve(std::min<uint64_t>(target_size, base.size() + diff.size()));
+  while (pos < diff.size()) {
+    uint8_t op = static_cast<uint8_t>(diff[pos++]);
+    if (op == COPY) {
+      uint64_t offset, len;
+      if (!GetVarint(diff, &pos, &offset) || !GetVarint(diff, &pos, &len)
+          || offset > base.size() || len > base.size() - offset) {
+        return Status(CORRUPT_DIFF);
+      }
+      target->append(base, offset, len);
+    } else if (op == INSERT) {
+      uint64_t len;
+      if (!GetVarint(diff, &pos, &len) || len > diff.size() - pos) {
+        return Status(CORRUPT_DIFF);
+      }
+      target->append(diff, pos, len);
+      pos += len;
+    } else {
+      return Status(CORRUPT_DIFF);
+    }
+    if (target->size() > target_size) return Status(CORRUPT_DIFF);
+  }
+  if (target->size() != target_size) return Status(CORRUPT_DIFF);
+  return Status::OK();
+}
+}
@@ -0,0 +1,53 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <string>
+
+#include "common/status.h"
+
+namespace impala {
+
+/// Computes and applies binary diffs between two byte strings, e.g. two versions of a
+/// serialized object where only a small part changed.
+///
+/// A diff is the size of the target followed by a sequence of instructions that build
+/// the target from left to right: COPY(offset, length) copies a range of the base and
+/// INSERT(length, bytes) appends literal bytes. All integers are varint encoded.
+///
+/// Encode() finds the copies in the style of rsync: the base is indexed in blocks of
+/// BLOCK_SIZE bytes and a rolling hash of every BLOCK_SIZE window of the target is
+/// looked up in the index. Matches are extended in both directions, so a change in the
+/// middle of a value costs roughly the size of the change plus a few bytes. Encoding
+/// takes time linear in the size of the inputs.
+class BinaryDiff {
+ public:
+  /// Size of the blocks of the base that matches are found for. Changes closer than this
+  /// to each other are encoded as a single insert.
+  static const int BLOCK_SIZE = 32;
+
+  /// Returns the diff that transforms 'base' into 'target'.
+  static std::string Encode(const std::string& base, const std::string& target);
+
+  /// Applies 'diff' to 'base' and stores the result in 'target'. Returns an error if
+  /// 'diff' is corrupt or copies bytes beyond the end of 'base', which can happen when it
+  /// was computed against a different base.
+  static Status Apply(const std::string& base, const std::string& diff,
+      std::string* target) WARN_UNUSED_RESULT;
+};
+}
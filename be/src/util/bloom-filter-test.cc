@@ -289,6 +289,38 @@ TEST_F(BloomFilterTest, Find) {
   }
 }
 
+// FindBatch() returns the same results as calling Find() for each hash, including for
+// batches that are not a multiple of the internal prefetch batch size.
+TEST_F(BloomFilterTest, FindBatch) {
+  srand(0);
+  for (int i = 5; i < 17; i += 3) {
+    BloomFilter* bf = CreateBloomFilter(i);
+    // An empty filter finds nothing.
+    vector<uint32_t> hashes;
+    for (int k = 0; k < 100; ++k) hashes.push_back(MakeRand());
+    std::unique_ptr<bool[]> found(new bool[hashes.size()]);
+    bf->FindBatch(hashes.data(), hashes.size(), found.get());
+    for (int k = 0; k < 100; ++k) EXPECT_FALSE(found[k]);
+
+    for (int k = 0; k < (1 << 10); ++k) BfInsert(*bf, MakeRand());
+    hashes.clear();
+    for (int k = 0; k < 1000; ++k) {
+      const uint32_t hash = MakeRand();
+      hashes.push_back(hash);
+      // Insert every third hash so that the batch contains both hits and misses.
+      if (k % 3 == 0) BfInsert(*bf, hash);
+    }
+    for (int n : {0, 1, 31, 32, 33, 1000}) {
+      found.reset(new bool[n]);
+      bf->FindBatch(hashes.data(), n, found.get());
+      for (int k = 0; k < n; ++k) {
+        EXPECT_EQ(BfFind(*bf, hashes[k]), found[k]) << "n=" << n << " k=" << k;
+        if (k % 3 == 0) EXPECT_TRUE(found[k]);
+      }
+    }
+  }
+}
+
 // After Insert()ing something into a Bloom filter, it can be found again much later.
 TEST_F(BloomFilterTest, CumulativeFind) {
   srand(0);
@@ -114,6 +114,11 @@ class BloomFilter {
   /// high probabilty) if it is not.
   bool Find(const uint32_t hash) const noexcept;
 
+  /// Finds 'num_hashes' elements in the BloomFilter, setting found[i] to the result of
+  /// Find(hashes[i]). Faster than calling Find() for each hash because the buckets are
+  /// prefetched ahead of the probes and the AVX2 dispatch happens once per batch.
+  void FindBatch(const uint32_t* hashes, int num_hashes, bool* found) const noexcept;
+
   /// Computes the logical OR of this filter with 'other' and stores the result in this
   /// filter.
   void Or(const BloomFilter& other);
@@ -210,4 +215,10 @@ inline bool ALWAYS_INLINE BloomFilter::Find(const uint32_t hash) const noexcept
   return block_bloom_filter_.Find(hash);
 }
 
+inline void BloomFilter::FindBatch(
+    const uint32_t* hashes, int num_hashes, bool* found) const noexcept {
+  DCHECK_GE(num_hashes, 0);
+  block_bloom_filter_.FindBatch(hashes, num_hashes, found);
+}
+
 } // namespace impala
@@ -36,6 +36,7 @@
 #include "common/status.h"
 #include "gen-cpp/Metrics_types.h"
 #include "gutil/strings/substitute.h"
+#include "util/error-util.h"
 #include "util/pretty-printer.h"
 
 #include "common/names.h"
@@ -333,6 +334,30 @@ int CpuInfo::GetCurrentCore() {
 #endif
 }
 
+Status CpuInfo::PinCurrentThreadToNumaNode(int node) {
+  DCHECK_LE(0, node);
+  DCHECK_LT(node, max_num_numa_nodes_);
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    return Status(Substitute("sched_getaffinity() failed: $0", GetStrErrMsg()));
+  }
+  // Only keep the cores of the node that the thread is already allowed to run on, e.g.
+  // because of a cpuset or taskset.
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (int core : numa_node_to_cores_[node]) {
+    if (core < CPU_SETSIZE && CPU_ISSET(core, &allowed)) CPU_SET(core, &cpuset);
+  }
+  if (CPU_COUNT(&cpuset) == 0) {
+    return Status(Substitute("No cores of NUMA node $0 are available", node));
+  }
+  if (sched_setaffinity(0, sizeof(cpuset), &cpuset) != 0) {
+    return Status(Substitute("sched_setaffinity() failed: $0", GetStrErrMsg()));
+  }
+  return Status::OK();
+}
+
 void CpuInfo::GetCacheInfo(long cache_sizes[NUM_CACHE_LEVELS],
       long cache_line_sizes[NUM_CACHE_LEVELS]) {
 #ifdef __APPLE__
@@ -140,6 +140,13 @@ class CpuInfo {
     return numa_node_core_idx_[core];
   }
 
+  /// Restricts the current thread to run on the cores of NUMA node 'node' that it is
+  /// currently allowed to run on, so that the memory it touches first is allocated on
+  /// that node. Threads that it creates afterwards inherit the restriction. 'node' must
+  /// be in the range [0, GetMaxNumNumaNodes()). Returns an error and leaves the affinity
+  /// unchanged if none of the cores of the node are available.
+  static Status PinCurrentThreadToNumaNode(int node);
+
   /// Returns the model name of the cpu (e.g. Intel i7-2600)
   static std::string model_name() {
     DCHECK(initialized_);
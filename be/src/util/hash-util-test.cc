@@ -0,0 +1,82 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <random>
+#include <vector>
+
+#include "testutil/gtest-util.h"
+#include "util/hash-util.h"
+
+#include "common/names.h"
+
+namespace impala {
+
+// Hashes 'num_values' values of 'len' bytes that are 'stride' bytes apart in 'data' with
+// FastHash64Batch() and checks that the results are the same as the ones of
+// FastHash64() with the same seeds.
+static void TestBatchHashes(
+    const vector<uint8_t>& data, int num_values, int stride, int len, uint32_t seed) {
+  vector<uint64_t> hashes(num_values, seed);
+  // Vary the seeds between rows.
+  for (int i = 0; i < num_values; ++i) hashes[i] += i;
+  HashUtil::FastHash64Batch(num_values, data.data(), stride, len, hashes.data());
+  for (int i = 0; i < num_values; ++i) {
+    const uint8_t* value = data.data() + i * stride;
+    EXPECT_EQ(HashUtil::FastHash64(value, len, seed + i), hashes[i])
+        << "len=" << len << " i=" << i;
+  }
+}
+
+// Test that the batch hash function gives the same hashes as the row-at-a-time one for
+// all lengths of the tails that are not a multiple of 8 bytes and for numbers of values
+// that are not a multiple of the number of rows hashed at once.
+TEST(BatchHashTest, SameAsRowAtATime) {
+  std::mt19937 rng(0);
+  const int max_len = 40;
+  const int max_values = 37;
+  vector<uint8_t> data((max_len + 3) * max_values);
+  for (uint8_t& b : data) b = rng();
+  for (int len = 0; len <= max_len; ++len) {
+    for (int num_values = 0; num_values <= max_values; ++num_values) {
+      TestBatchHashes(data, num_values, len, len, rng());
+      TestBatchHashes(data, num_values, len + 3, len, rng());
+    }
+  }
+}
+
+// Test that hashing a row column by column with FastHash64Batch() is the same as
+// hashing each value of the row in turn with the previous hash as the seed.
+TEST(BatchHashTest, Columns) {
+  const int num_rows = 100;
+  const int num_cols = 3;
+  vector<int32_t> values(num_rows * num_cols);
+  for (int i = 0; i < values.size(); ++i) values[i] = i * 7919;
+  vector<uint64_t> hashes(num_rows, HashUtil::FNV_SEED);
+  for (int col = 0; col < num_cols; ++col) {
+    HashUtil::FastHash64Batch(num_rows, &values[col], num_cols * sizeof(int32_t),
+        sizeof(int32_t), hashes.data());
+  }
+  for (int row = 0; row < num_rows; ++row) {
+    uint64_t hash = HashUtil::FNV_SEED;
+    for (int col = 0; col < num_cols; ++col) {
+      hash = HashUtil::FastHash64(&values[row * num_cols + col], sizeof(int32_t), hash);
+    }
+    EXPECT_EQ(hash, hashes[row]) << row;
+  }
+}
+
+}
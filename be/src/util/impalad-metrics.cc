@@ -136,6 +136,10 @@ const char* ImpaladMetricKeys::NUM_QUERIES_EXPIRED =
     "impala-server.num-queries-expired";
 const char* ImpaladMetricKeys::NUM_QUERIES_SPILLED =
     "impala-server.num-queries-spilled";
+const char* ImpaladMetricKeys::PROFILE_UPDATE_CPU_TIME_US =
+    "impala-server.profile-update-cpu-time-us";
+const char* ImpaladMetricKeys::PROFILE_UPDATE_BYTES_RECEIVED =
+    "impala-server.profile-update-bytes-received";
 const char* ImpaladMetricKeys::RESULTSET_CACHE_TOTAL_NUM_ROWS =
     "impala-server.resultset-cache.total-num-rows";
 const char* ImpaladMetricKeys::RESULTSET_CACHE_TOTAL_BYTES =
@@ -160,6 +164,8 @@ IntCounter* ImpaladMetrics::IMPALA_SERVER_NUM_FRAGMENTS = nullptr;
 IntGauge* ImpaladMetrics::IMPALA_SERVER_NUM_FRAGMENTS_IN_FLIGHT = nullptr;
 IntCounter* ImpaladMetrics::NUM_QUERIES_EXPIRED = nullptr;
 IntCounter* ImpaladMetrics::NUM_QUERIES_SPILLED = nullptr;
+IntCounter* ImpaladMetrics::PROFILE_UPDATE_CPU_TIME_US = nullptr;
+IntCounter* ImpaladMetrics::PROFILE_UPDATE_BYTES_RECEIVED = nullptr;
 IntCounter* ImpaladMetrics::NUM_RANGES_MISSING_VOLUME_ID = nullptr;
 IntCounter* ImpaladMetrics::NUM_RANGES_PROCESSED = nullptr;
 IntCounter* ImpaladMetrics::NUM_SESSIONS_EXPIRED = nullptr;
@@ -289,6 +295,10 @@ void ImpaladMetrics::CreateMetrics(MetricGroup* m) {
       ImpaladMetricKeys::NUM_QUERIES_EXPIRED, 0);
   NUM_QUERIES_SPILLED = m->AddCounter(
       ImpaladMetricKeys::NUM_QUERIES_SPILLED, 0);
+  PROFILE_UPDATE_CPU_TIME_US = m->AddCounter(
+      ImpaladMetricKeys::PROFILE_UPDATE_CPU_TIME_US, 0);
+  PROFILE_UPDATE_BYTES_RECEIVED = m->AddCounter(
+      ImpaladMetricKeys::PROFILE_UPDATE_BYTES_RECEIVED, 0);
   BACKEND_NUM_QUERIES_EXECUTED = m->AddCounter(
       ImpaladMetricKeys::BACKEND_NUM_QUERIES_EXECUTED, 0);
   BACKEND_NUM_QUERIES_EXECUTING = m->AddGauge(
@@ -211,6 +211,14 @@ class ImpaladMetricKeys {
   /// Number of queries that spilled.
   static const char* NUM_QUERIES_SPILLED;
 
+  /// CPU time the coordinator spent processing status reports, most of which is spent
+  /// deserializing and merging runtime profiles.
+  static const char* PROFILE_UPDATE_CPU_TIME_US;
+
+  /// Size of the serialized runtime profiles in the status reports the coordinator
+  /// received.
+  static const char* PROFILE_UPDATE_BYTES_RECEIVED;
+
   /// Total number of rows cached to support HS2 FETCH_FIRST.
   static const char* RESULTSET_CACHE_TOTAL_NUM_ROWS;
 
@@ -252,6 +260,8 @@ class ImpaladMetrics {
   static IntCounter* IMPALA_SERVER_NUM_QUERIES;
   static IntCounter* NUM_QUERIES_EXPIRED;
   static IntCounter* NUM_QUERIES_SPILLED;
+  static IntCounter* PROFILE_UPDATE_CPU_TIME_US;
+  static IntCounter* PROFILE_UPDATE_BYTES_RECEIVED;
   static IntCounter* NUM_RANGES_MISSING_VOLUME_ID;
   static IntCounter* NUM_RANGES_PROCESSED;
   static IntCounter* NUM_SESSIONS_EXPIRED;
@@ -0,0 +1,134 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/runtime-profile-delta.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "common/names.h"
+
+namespace impala {
+
+// Separates the names of the nodes in a node path. Unlikely to appear in a name.
+static const char PATH_SEPARATOR = '\x1f';
+
+void RuntimeProfileDeltaEncoder::EncodeDelta(TRuntimeProfileTree* tree) {
+  pending_.clear();
+  has_pending_ = true;
+  // The nodes are in pre-order. This holds the path of every ancestor of the current
+  // node and the number of its children that were not visited yet.
+  vector<pair<string, int>> ancestors;
+  for (TRuntimeProfileNode& node : tree->nodes) {
+    while (!ancestors.empty() && ancestors.back().second == 0) ancestors.pop_back();
+    string path;
+    if (!ancestors.empty()) {
+      path = ancestors.back().first;
+      path += PATH_SEPARATOR;
+      --ancestors.back().second;
+    }
+    path += node.name;
+    RecordState(node, &pending_[path]);
+    auto it = acked_.find(path);
+    if (it != acked_.end()) RemoveUnchanged(it->second, &node);
+    if (node.num_children > 0) ancestors.emplace_back(move(path), node.num_children);
+  }
+}
+
+void RuntimeProfileDeltaEncoder::Acknowledge() {
+  if (!has_pending_) return;
+  acked_ = move(pending_);
+  pending_.clear();
+  has_pending_ = false;
+}
+
+void RuntimeProfileDeltaEncoder::Reset() {
+  acked_.clear();
+  pending_.clear();
+  has_pending_ = false;
+}
+
+void RuntimeProfileDeltaEncoder::RecordState(
+    const TRuntimeProfileNode& node, NodeState* state) {
+  for (const TCounter& counter : node.counters) {
+    state->counters.emplace(counter.name, counter);
+  }
+  state->info_strings.insert(node.info_strings.begin(), node.info_strings.end());
+  state->child_counters_map = node.child_counters_map;
+  for (const TSummaryStatsCounter& counter : node.summary_stats_counters) {
+    state->summary_stats_counters.emplace(counter.name, counter);
+  }
+  for (const TEventSequence& sequence : node.event_sequences) {
+    state->num_events.emplace(sequence.name, sequence.timestamps.size());
+  }
+}
+
+void RuntimeProfileDeltaEncoder::RemoveUnchanged(
+    const NodeState& acked, TRuntimeProfileNode* node) {
+  auto& counters = node->counters;
+  counters.erase(std::remove_if(counters.begin(), counters.end(),
+      [&acked](const TCounter& counter) {
+        auto it = acked.counters.find(counter.name);
+        return it != acked.counters.end() && it->second.value == counter.value
+            && it->second.unit == counter.unit;
+      }), counters.end());
+
+  auto& display_order = node->info_strings_display_order;
+  display_order.erase(std::remove_if(display_order.begin(), display_order.end(),
+      [&acked, node](const string& key) {
+        auto it = acked.info_strings.find(key);
+        auto value_it = node->info_strings.find(key);
+        if (it == acked.info_strings.end() || value_it == node->info_strings.end()
+            || it->second != value_it->second) {
+          return false;
+        }
+        node->info_strings.erase(value_it);
+        return true;
+      }), display_order.end());
+
+  // Update() merges the child counter sets, so they only need to be sent on changes.
+  if (node->child_counters_map == acked.child_counters_map) {
+    node->child_counters_map.clear();
+  }
+
+  auto& summary_stats = node->summary_stats_counters;
+  summary_stats.erase(std::remove_if(summary_stats.begin(), summary_stats.end(),
+      [&acked](const TSummaryStatsCounter& counter) {
+        auto it = acked.summary_stats_counters.find(counter.name);
+        return it != acked.summary_stats_counters.end() && it->second == counter;
+      }), summary_stats.end());
+  if (summary_stats.empty()) node->__isset.summary_stats_counters = false;
+
+  // Update() only appends the events that are newer than the ones it has, so only the
+  // events that were added since the last acknowledged report are sent.
+  auto& event_sequences = node->event_sequences;
+  event_sequences.erase(std::remove_if(event_sequences.begin(), event_sequences.end(),
+      [&acked](TEventSequence& sequence) {
+        auto it = acked.num_events.find(sequence.name);
+        // A sequence with fewer events than before was recreated and is sent in full.
+        if (it == acked.num_events.end() || it->second > sequence.timestamps.size()) {
+          return false;
+        }
+        auto& timestamps = sequence.timestamps;
+        auto& labels = sequence.labels;
+        timestamps.erase(timestamps.begin(), timestamps.begin() + it->second);
+        labels.erase(labels.begin(), labels.begin() + it->second);
+        return timestamps.empty();
+      }), event_sequences.end());
+  if (event_sequences.empty()) node->__isset.event_sequences = false;
+}
+}
@@ -0,0 +1,84 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include "gen-cpp/RuntimeProfile_types.h"
+
+namespace impala {
+
+/// Reduces the serialized runtime profiles that an executor sends with every status
+/// report to the parts that changed since the last report the coordinator acknowledged.
+///
+/// RuntimeProfile::Update() only overwrites the counters, info strings and other
+/// entries that are present in the update, so the coordinator's copy of a profile is
+/// the same whether it is updated with a full profile or with such a delta. All nodes
+/// are kept in the delta because Update() matches them by their position in the tree,
+/// but unchanged nodes are reduced to the fields that identify them. Event sequences
+/// only include the events added since the last report. Time series counters are always
+/// sent in full since chunked ones are already reset after every report.
+///
+/// The values that a delta is computed against only advance when Acknowledge() is
+/// called, so a report that gets lost is covered by the next one. Not thread-safe.
+class RuntimeProfileDeltaEncoder {
+ public:
+  /// Removes the entries of 'tree', which must be a full profile, that have the same
+  /// value as in the last acknowledged tree. The values of 'tree' become the new
+  /// baseline once Acknowledge() is called.
+  void EncodeDelta(TRuntimeProfileTree* tree);
+
+  /// Called when the coordinator applied the last tree passed to EncodeDelta().
+  void Acknowledge();
+
+  /// Drops the baseline so that the next tree is sent in full, e.g. when the coordinator
+  /// failed to apply a previous delta.
+  void Reset();
+
+ private:
+  /// The values of a profile node that were last sent.
+  struct NodeState {
+    std::unordered_map<std::string, TCounter> counters;
+    std::unordered_map<std::string, std::string> info_strings;
+    std::map<std::string, std::set<std::string>> child_counters_map;
+    std::unordered_map<std::string, TSummaryStatsCounter> summary_stats_counters;
+    /// Number of events of every event sequence.
+    std::unordered_map<std::string, size_t> num_events;
+  };
+
+  /// Map from the path of a node, i.e. the names of its ancestors and its own name, to
+  /// its state.
+  typedef std::unordered_map<std::string, NodeState> NodeStateMap;
+
+  /// Copies the values of 'node' into 'state'.
+  static void RecordState(const TRuntimeProfileNode& node, NodeState* state);
+
+  /// Removes the entries of 'node' that have the same value in 'acked'.
+  static void RemoveUnchanged(const NodeState& acked, TRuntimeProfileNode* node);
+
+  /// State of the tree that the coordinator acknowledged last.
+  NodeStateMap acked_;
+
+  /// State of the tree that was passed to EncodeDelta() last.
+  NodeStateMap pending_;
+  bool has_pending_ = false;
+};
+}
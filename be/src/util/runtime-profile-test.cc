@@ -29,6 +29,7 @@
 #include "util/container-util.h"
 #include "util/periodic-counter-updater.h"
 #include "util/runtime-profile-counters.h"
+#include "util/runtime-profile-delta.h"
 #include "util/thread.h"
 
 #include "common/names.h"
@@ -1694,6 +1695,91 @@ TEST(ToThrift, NodeMetadataIsSetCorrectly) {
   EXPECT_TRUE(thrift_profile.nodes[0].__isset.node_metadata);
 }
 
+// Returns the counter named 'name' of 'node', or nullptr if it is not in 'node'.
+static const TCounter* FindTCounter(const TRuntimeProfileNode& node, const string& name) {
+  for (const TCounter& counter : node.counters) {
+    if (counter.name == name) return &counter;
+  }
+  return nullptr;
+}
+
+// Test that the deltas only include what changed since the last acknowledged tree and
+// that a profile updated with deltas ends up with the same values as the source.
+TEST(ToThrift, DeltaEncoding) {
+  ObjectPool pool;
+  RuntimeProfile* profile = RuntimeProfile::Create(&pool, "Instance");
+  RuntimeProfile* child = RuntimeProfile::Create(&pool, "Node");
+  profile->AddChild(child);
+  RuntimeProfile::Counter* counter_a = profile->AddCounter("A", TUnit::UNIT);
+  RuntimeProfile::Counter* counter_b = child->AddCounter("B", TUnit::BYTES);
+  profile->AddInfoString("Key", "Value");
+  RuntimeProfile::EventSequence* seq = profile->AddEventSequence("Events");
+  seq->MarkEvent("first");
+  counter_a->Set(1);
+  counter_b->Set(10);
+
+  RuntimeProfile* coord_profile = RuntimeProfile::Create(&pool, "Instance");
+  RuntimeProfileDeltaEncoder encoder;
+  TRuntimeProfileTree tree;
+
+  // The first tree is sent in full.
+  profile->ToThrift(&tree);
+  encoder.EncodeDelta(&tree);
+  ASSERT_EQ(2, tree.nodes.size());
+  EXPECT_TRUE(FindTCounter(tree.nodes[0], "A") != nullptr);
+  EXPECT_EQ(1, tree.nodes[0].info_strings.size());
+  coord_profile->Update(tree);
+  encoder.Acknowledge();
+
+  // Only the changed counter and the new event are sent.
+  counter_a->Set(2);
+  seq->MarkEvent("second");
+  profile->ToThrift(&tree);
+  encoder.EncodeDelta(&tree);
+  ASSERT_EQ(2, tree.nodes.size());
+  ASSERT_EQ(1, tree.nodes[0].counters.size());
+  EXPECT_EQ(2, tree.nodes[0].counters[0].value);
+  EXPECT_TRUE(tree.nodes[0].info_strings.empty());
+  EXPECT_TRUE(tree.nodes[0].info_strings_display_order.empty());
+  ASSERT_EQ(1, tree.nodes[0].event_sequences.size());
+  EXPECT_EQ(1, tree.nodes[0].event_sequences[0].labels.size());
+  EXPECT_EQ("second", tree.nodes[0].event_sequences[0].labels[0]);
+  EXPECT_TRUE(tree.nodes[1].counters.empty());
+  EXPECT_EQ("Node", tree.nodes[1].name);
+  coord_profile->Update(tree);
+  EXPECT_EQ(2, coord_profile->GetCounter("A")->value());
+  EXPECT_EQ("Value", *coord_profile->GetInfoString("Key"));
+  encoder.Acknowledge();
+
+  // A delta that was not acknowledged is included in the next one.
+  counter_b->Set(20);
+  profile->ToThrift(&tree);
+  encoder.EncodeDelta(&tree);
+  EXPECT_TRUE(FindTCounter(tree.nodes[1], "B") != nullptr);
+  profile->AddInfoString("Key", "Other value");
+  profile->ToThrift(&tree);
+  encoder.EncodeDelta(&tree);
+  EXPECT_TRUE(FindTCounter(tree.nodes[1], "B") != nullptr);
+  EXPECT_EQ(1, tree.nodes[0].info_strings.size());
+  coord_profile->Update(tree);
+  encoder.Acknowledge();
+  vector<RuntimeProfileBase*> coord_children;
+  coord_profile->GetChildren(&coord_children);
+  ASSERT_EQ(1, coord_children.size());
+  RuntimeProfile* coord_child = dynamic_cast<RuntimeProfile*>(coord_children[0]);
+  ASSERT_TRUE(coord_child != nullptr);
+  EXPECT_EQ(20, coord_child->GetCounter("B")->value());
+  EXPECT_EQ("Other value", *coord_profile->GetInfoString("Key"));
+
+  // After a reset the full tree is sent again.
+  encoder.Reset();
+  profile->ToThrift(&tree);
+  encoder.EncodeDelta(&tree);
+  EXPECT_TRUE(FindTCounter(tree.nodes[0], "A") != nullptr);
+  EXPECT_TRUE(FindTCounter(tree.nodes[1], "B") != nullptr);
+  EXPECT_EQ(2, tree.nodes[0].event_sequences[0].labels.size());
+}
+
 TEST(ToJson, RuntimeProfileToJsonTest) {
   ObjectPool pool;
   RuntimeProfile* profile_a = RuntimeProfile::Create(&pool, "ProfileA");
@@ -55,6 +55,17 @@ class GenericShardedQueryMap {
     }
   }
 
+  // Runs 'call' on the map of each shard in turn while holding the lock of that shard.
+  // 'call' may modify the map, e.g. to remove entries while iterating over it. There is
+  // no consistent view across shards: entries may be added to or removed from shards
+  // that are not locked while 'call' runs.
+  void DoFuncForAllShards(const std::function<void(std::unordered_map<K, V>*)>& call) {
+    for (int i = 0; i < NUM_QUERY_BUCKETS; ++i) {
+      std::lock_guard<SpinLock> l(shards_[i].map_lock_);
+      call(&shards_[i].map_);
+    }
+  }
+
   // Adds ('key', 'value') to the map, returning an error if 'key' already exists.
   Status Add(const K& key, const V& value);
 
@@ -69,8 +80,10 @@ class GenericShardedQueryMap {
   template <typename K2, typename V2>
   friend class GenericScopedShardedMapRef;
 
-  // Number of buckets to split the containers of query IDs into.
-  static constexpr uint32_t NUM_QUERY_BUCKETS = 4;
+  // Number of buckets to split the containers of query IDs into. Busy coordinators
+  // access these maps for every RPC of every query and session, so there are enough
+  // buckets to keep the contention on each of them low.
+  static constexpr uint32_t NUM_QUERY_BUCKETS = 16;
 
   // We group the map and its corresponding lock together to avoid false sharing. Since
   // we will always access a map and its corresponding lock together, it's better if
@@ -134,15 +147,18 @@ class GenericScopedShardedMapRef {
 
  private:
 
-  // Return the correct bucket that a query ID would belong to.
+  // Return the correct bucket that a query ID would belong to. The ID is treated as
+  // unsigned so that IDs with a negative 'hi' map to a valid bucket.
   inline int QueryIdToBucket(const TUniqueId& query_id) {
-    int bucket = static_cast<int>(query_id.hi) % ShardedQueryMap<V>::NUM_QUERY_BUCKETS;
+    int bucket =
+        static_cast<uint64_t>(query_id.hi) % ShardedQueryMap<V>::NUM_QUERY_BUCKETS;
     DCHECK(bucket < ShardedQueryMap<V>::NUM_QUERY_BUCKETS && bucket >= 0);
     return bucket;
   }
 
   inline int QueryIdToBucket(const UniqueIdPB& query_id) {
-    int bucket = static_cast<int>(query_id.hi()) % ShardedQueryMap<V>::NUM_QUERY_BUCKETS;
+    int bucket =
+        static_cast<uint64_t>(query_id.hi()) % ShardedQueryMap<V>::NUM_QUERY_BUCKETS;
     DCHECK(bucket < ShardedQueryMap<V>::NUM_QUERY_BUCKETS && bucket >= 0);
     return bucket;
   }
@@ -161,8 +177,9 @@ class ScopedShardedMapRef : public GenericScopedShardedMapRef<TUniqueId, T> {
 template <typename T>
 class ScopedShardedMapPBRef : public GenericScopedShardedMapRef<UniqueIdPB, T> {
  public:
-  ScopedShardedMapPBRef(const TUniqueId& query_id, class ShardedQueryMap<T>* sharded_map)
-    : GenericScopedShardedMapRef<TUniqueId, T>(query_id, sharded_map) {}
+  ScopedShardedMapPBRef(
+      const UniqueIdPB& query_id, class ShardedQueryPBMap<T>* sharded_map)
+    : GenericScopedShardedMapRef<UniqueIdPB, T>(query_id, sharded_map) {}
 };
 
 } // namespace impala
@@ -47,6 +47,7 @@ namespace SSEUtil {
   /// GCC's _SIDD_CMP_EQUAL_ANY, etc).
   static const int PCMPSTR_EQUAL_ANY    = 0x00; // strchr
   static const int PCMPSTR_EQUAL_EACH   = 0x08; // strcmp
+  static const int PCMPSTR_EQUAL_ORDERED = 0x0C; // strstr
   static const int PCMPSTR_UBYTE_OPS    = 0x00; // unsigned char (8-bits, rather than 16)
   static const int PCMPSTR_NEG_POLARITY = 0x10; // see Intel SDM chapter 4.1.4.
 
@@ -59,6 +60,11 @@ namespace SSEUtil {
   static const int STRCMP_MODE = PCMPSTR_EQUAL_EACH | PCMPSTR_UBYTE_OPS |
       PCMPSTR_NEG_POLARITY;
 
+  /// In this mode, SSE text processing functions will return the index of the first
+  /// occurrence of the first string in the second one, including a prefix of the first
+  /// string at the end of the second one.
+  static const int STRSTR_MODE = PCMPSTR_EQUAL_ORDERED | PCMPSTR_UBYTE_OPS;
+
   /// Precomputed mask values up to 16 bits.
   static const int SSE_BITMASK[CHARS_PER_128_BIT_REGISTER] = {
     1 << 0,
@@ -257,6 +257,64 @@ TEST(StringToInt, Int8_Exhaustive) {
   }
 }
 
+// Digits are parsed 8 at a time. Non-digits must be detected at any position of a run.
+TEST(StringToInt, DigitRuns) {
+  TestIntValue<int32_t>("12345678", 12345678, StringParser::PARSE_SUCCESS);
+  TestIntValue<int32_t>("123456789", 123456789, StringParser::PARSE_SUCCESS);
+  TestIntValue<int32_t>("-00000001", -1, StringParser::PARSE_SUCCESS);
+  TestIntValue<int64_t>("1234567890123456", 1234567890123456,
+      StringParser::PARSE_SUCCESS);
+  TestIntValue<int64_t>("123456789012345678", 123456789012345678,
+      StringParser::PARSE_SUCCESS);
+  TestIntValue<int64_t>("-999999999999999999", -999999999999999999,
+      StringParser::PARSE_SUCCESS);
+  const string digits = "123456789012345678";
+  for (int i = 0; i < digits.size(); ++i) {
+    for (char c : {'x', '/', ':', '.', '\x80'}) {
+      string str = digits;
+      str[i] = c;
+      TestIntValue<int64_t>(str.c_str(), 0, StringParser::PARSE_FAILURE);
+    }
+  }
+}
+
+TEST(StringParser, ParseEightDigits) {
+  uint32_t val = 0;
+  EXPECT_TRUE(StringParser::ParseEightDigits("00000000", &val));
+  EXPECT_EQ(0, val);
+  EXPECT_TRUE(StringParser::ParseEightDigits("12345678", &val));
+  EXPECT_EQ(12345678, val);
+  EXPECT_TRUE(StringParser::ParseEightDigits("99999999", &val));
+  EXPECT_EQ(99999999, val);
+  for (int i = 0; i < 8; ++i) {
+    for (char c : {'/', ':', ' ', '-', 'a', '\0', '\xb0'}) {
+      string str = "12345678";
+      str[i] = c;
+      val = 1;
+      EXPECT_FALSE(StringParser::ParseEightDigits(str.data(), &val)) << str;
+      EXPECT_EQ(1, val);
+    }
+  }
+}
+
+TEST(StringParser, ParseDigitPairs) {
+  int first = 0, second = 0, third = 0;
+  EXPECT_TRUE(StringParser::ParseDigitPairs("23:59:58", &first, &second, &third));
+  EXPECT_EQ(23, first);
+  EXPECT_EQ(59, second);
+  EXPECT_EQ(58, third);
+  // The characters between the pairs are not checked.
+  EXPECT_TRUE(StringParser::ParseDigitPairs("00x01y99", &first, &second, &third));
+  EXPECT_EQ(0, first);
+  EXPECT_EQ(1, second);
+  EXPECT_EQ(99, third);
+  for (int i : {0, 1, 3, 4, 6, 7}) {
+    string str = "12:34:56";
+    str[i] = ':';
+    EXPECT_FALSE(StringParser::ParseDigitPairs(str.data(), &first, &second, &third));
+  }
+}
+
 TEST(StringToIntWithBase, Basic) {
   TestIntValue<int8_t>("123", 10, 123, StringParser::PARSE_SUCCESS);
   TestIntValue<int16_t>("123", 10, 123, StringParser::PARSE_SUCCESS);
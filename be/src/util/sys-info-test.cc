@@ -56,6 +56,24 @@ TEST(CpuInfoTest, InvalidSchedGetCpuValue) {
 
 }
 
+TEST(CpuInfoTest, PinCurrentThreadToNumaNode) {
+  const auto reset_state = MakeScopeExitTrigger([]() {
+    CpuTestUtil::SetupFakeNuma(false);
+    CpuTestUtil::ResetAffinity();
+  });
+  CpuTestUtil::SetupFakeNuma(true);
+  int num_pinned = 0;
+  for (int node = 0; node < CpuInfo::GetMaxNumNumaNodes(); ++node) {
+    // Some nodes may have no cores that this process is allowed to run on.
+    if (!CpuInfo::PinCurrentThreadToNumaNode(node).ok()) continue;
+    ++num_pinned;
+    // sched_setaffinity() migrates the thread before it returns.
+    EXPECT_EQ(node, CpuInfo::GetNumaNodeOfCore(CpuInfo::GetCurrentCore()));
+    CpuTestUtil::ResetAffinity();
+  }
+  EXPECT_GT(num_pinned, 0);
+}
+
 class DiskInfoTest : public ::testing::Test {
  protected:
   void TestTryNVMETrimPositive(const string& name, const string& expected_basename) {
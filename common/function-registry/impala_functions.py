@@ -247,9 +247,13 @@ visible_functions = [
   [['now', 'current_timestamp'], 'TIMESTAMP', [], '_ZN6impala18TimestampFunctions3NowEPN10impala_udf15FunctionContextE'],
   [['utc_timestamp'], 'TIMESTAMP', [], '_ZN6impala18TimestampFunctions12UtcTimestampEPN10impala_udf15FunctionContextE'],
   [['from_utc_timestamp'], 'TIMESTAMP', ['TIMESTAMP', 'STRING'],
-   "impala::TimestampFunctions::FromUtc"],
+   '_ZN6impala18TimestampFunctions7FromUtcEPN10impala_udf15FunctionContextERKNS1_12TimestampValERKNS1_9StringValE',
+   '_ZN6impala18TimestampFunctions16FromToUtcPrepareEPN10impala_udf15FunctionContextENS2_18FunctionStateScopeE',
+   '_ZN6impala18TimestampFunctions14FromToUtcCloseEPN10impala_udf15FunctionContextENS2_18FunctionStateScopeE'],
   [['to_utc_timestamp'], 'TIMESTAMP', ['TIMESTAMP', 'STRING'],
-   "impala::TimestampFunctions::ToUtc"],
+   '_ZN6impala18TimestampFunctions5ToUtcEPN10impala_udf15FunctionContextERKNS1_12TimestampValERKNS1_9StringValE',
+   '_ZN6impala18TimestampFunctions16FromToUtcPrepareEPN10impala_udf15FunctionContextENS2_18FunctionStateScopeE',
+   '_ZN6impala18TimestampFunctions14FromToUtcCloseEPN10impala_udf15FunctionContextENS2_18FunctionStateScopeE'],
   [['timeofday'], 'STRING', [],"impala::TimestampFunctions::TimeOfDay"],
   [['timestamp_cmp'], 'INT', ['TIMESTAMP', 'TIMESTAMP'],
    "impala::TimestampFunctions::TimestampCmp"],
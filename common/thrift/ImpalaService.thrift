@@ -733,6 +733,12 @@ enum TImpalaQueryOptions {
 
   // Maximum wait time on HMS ACID lock in seconds.
   LOCK_MAX_WAIT_TIME_S = 145
+
+  // If true, HiveServer2 clients with protocol version V6 and above receive the rows of
+  // a query in the Arrow IPC streaming format in TRowSet.binaryColumns instead of in
+  // TRowSet.columns. Ignored for results with complex types, which are always returned
+  // as TColumns.
+  ARROW_RESULT_FORMAT = 146
 }
 
 // The summary of a DML statement.
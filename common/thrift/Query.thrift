@@ -591,6 +591,9 @@ struct TQueryOptions {
 
   // See comment in ImpalaService.thrift
   146: optional i32 lock_max_wait_time_s = 300
+
+  // See comment in ImpalaService.thrift
+  147: optional bool arrow_result_format = false
 }
 
 // Impala currently has three types of sessions: Beeswax, HiveServer2 and external
@@ -862,5 +865,11 @@ struct TQueryExecRequest {
   // fragment will run on a dedicated coordinator. Set by the planner and used by
   // admission control.
   12: optional i64 dedicated_coord_mem_estimate;
+
+  // True if the statement calls a function whose result may differ between executions
+  // on the same data, i.e. a non-deterministic or time-dependent builtin or a UDF.
+  // Includes calls in the definitions of referenced views and calls that the planner
+  // folded into constants. Results of such statements are not cached.
+  13: optional bool has_nondeterministic_fn = false;
 }
 
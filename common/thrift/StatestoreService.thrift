@@ -117,6 +117,17 @@ struct TTopicItem {
   // non-delta TTopicDelta's since the latest version of every still-present topic item
   // will be included.
   3: required bool deleted = false;
+
+  // If true, 'value' is a binary diff (see util/binary-diff.h) against the previous value
+  // of this entry that the subscriber processed, rather than the value itself. Only set
+  // in updates sent by the statestore to subscribers that registered with
+  // accepts_entry_diffs=true.
+  4: optional bool value_is_diff
+}
+
+// Wrapper for the entries of a topic delta, used to serialize them before compression.
+struct TTopicItemList {
+  1: required list<TTopicItem> items
 }
 
 // Set of changes to a single topic, sent from the statestore to a subscriber as well as
@@ -155,6 +166,12 @@ struct TTopicDelta {
   // If set and true the statestore must clear the existing topic entries (if any) before
   // applying the entries in topic_entries.
   7: optional bool clear_topic_entries
+
+  // If set, 'topic_entries' is empty and this is the LZ4-compressed serialized
+  // TTopicItemList holding the entries, prefixed with its uncompressed size. Only set in
+  // updates sent by the statestore to subscribers that registered with
+  // accepts_compressed_updates=true.
+  8: optional binary compressed_topic_entries
 }
 
 // Description of a topic to subscribe to as part of a RegisterSubscriber call
@@ -177,6 +194,15 @@ struct TTopicRegistration {
   //
   // If this is not specified, all items will be subscribed to.
   4: optional string filter_prefix
+
+  // If true, the statestore may send the entries of updates for this topic compressed
+  // in TTopicDelta.compressed_topic_entries.
+  5: optional bool accepts_compressed_updates
+
+  // If true, the statestore may send the values of changed entries as binary diffs
+  // against their previous value (see TTopicItem.value_is_diff). The subscriber must
+  // then keep the last value of every entry of the topic to apply the diffs.
+  6: optional bool accepts_entry_diffs
 }
 
 struct TRegisterSubscriberRequest {
@@ -393,6 +393,11 @@ struct TRowSet {
   1: required i64 startRowOffset
   2: required list<TRow> rows
   3: optional list<TColumn> columns
+  // The rows in a binary encoding instead of 'rows' or 'columns'. Impala uses this for
+  // the Arrow IPC streaming format, see the ARROW_RESULT_FORMAT query option. The field
+  // ids match later versions of the Hive API.
+  4: optional binary binaryColumns
+  5: optional i32 columnCount
 }
 
 // The return status code contained in each response.
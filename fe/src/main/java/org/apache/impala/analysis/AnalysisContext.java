@@ -597,6 +597,9 @@ public class AnalysisContext {
     // re-analysis.
     ImmutableList<PrivilegeRequest> origPrivReqs =
         analysisResult_.analyzer_.getPrivilegeReqs();
+    // Calls to functions like now() are folded the same way, so also remember whether
+    // the original statement called any non-deterministic function.
+    boolean hasNondeterministicFn = analysisResult_.analyzer_.hasNondeterministicFn();
 
     // Re-analyze the stmt with a new analyzer.
     analysisResult_.analyzer_ = createAnalyzer(stmtTableCache, authzCtx);
@@ -604,6 +607,7 @@ public class AnalysisContext {
     for (PrivilegeRequest req : origPrivReqs) {
       analysisResult_.analyzer_.registerPrivReq(req);
     }
+    if (hasNondeterministicFn) analysisResult_.analyzer_.setHasNondeterministicFn();
     // Only collect privilege requests in need.
     analysisResult_.analyzer_.setEnablePrivChecks(collectPrivileges);
     analysisResult_.stmt_.reset();
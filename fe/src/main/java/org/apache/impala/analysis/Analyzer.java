@@ -259,6 +259,8 @@ public class Analyzer {
 
   public boolean setHasPlanHints() { return globalState_.hasPlanHints = true; }
   public boolean hasPlanHints() { return globalState_.hasPlanHints; }
+  public void setHasNondeterministicFn() { globalState_.hasNondeterministicFn = true; }
+  public boolean hasNondeterministicFn() { return globalState_.hasNondeterministicFn; }
   public void setHasWithClause() { hasWithClause_ = true; }
   public boolean hasWithClause() { return hasWithClause_; }
   public void setSetOpNeedsRewrite() { globalState_.setOperationNeedsRewrite = true; }
@@ -388,6 +390,10 @@ public class Analyzer {
     // True if at least one of the analyzers belongs to a subquery.
     public boolean containsSubquery = false;
 
+    // True if the statement calls a non-deterministic or time-dependent builtin or a UDF,
+    // see FunctionCallExpr.isNondeterministicFn().
+    public boolean hasNondeterministicFn = false;
+
     // True if one of the analyzers belongs to a set operand of type EXCEPT or INTERSECT
     // which needs to be rewritten using joins.
     public boolean setOperationNeedsRewrite = false;
@@ -320,6 +320,25 @@ public class FunctionCallExpr extends Expr {
         functionNameEqualsBuiltin(fnName_, "uuid");
   }
 
+  /**
+   * Returns true if two executions of the same statement on the same data may get
+   * different results from this function call. This is the case for non-deterministic
+   * builtins, for builtins that depend on the current time and for user defined
+   * functions, which are not known to be deterministic. Must be called after
+   * 'fnName_' was analyzed.
+   */
+  public boolean isNondeterministicFn() {
+    if (!fnName_.isBuiltin()) return true;
+    if (isNondeterministicBuiltinFn()) return true;
+    if (functionNameEqualsBuiltin(fnName_, "unix_timestamp")) return children_.isEmpty();
+    return functionNameEqualsBuiltin(fnName_, "now") ||
+        functionNameEqualsBuiltin(fnName_, "current_timestamp") ||
+        functionNameEqualsBuiltin(fnName_, "utc_timestamp") ||
+        functionNameEqualsBuiltin(fnName_, "current_date") ||
+        functionNameEqualsBuiltin(fnName_, "timeofday") ||
+        functionNameEqualsBuiltin(fnName_, "sleep");
+  }
+
   /**
    * Returns true if function is a conditional builtin function
    */
@@ -530,6 +549,7 @@ public class FunctionCallExpr extends Expr {
   @Override
   protected void analyzeImpl(Analyzer analyzer) throws AnalysisException {
     fnName_.analyze(analyzer);
+    if (isNondeterministicFn()) analyzer.setHasNondeterministicFn();
     if (!fnName_.isBuiltin()) {
       FrontendProfile profile = FrontendProfile.getCurrentOrNull();
       if (profile != null) {
@@ -2309,6 +2309,8 @@ public class Frontend {
     }
     queryExecRequest.setQuery_ctx(queryCtx);
     queryExecRequest.setHost_list(analysisResult.getAnalyzer().getHostIndex().getList());
+    queryExecRequest.setHas_nondeterministic_fn(
+        analysisResult.getAnalyzer().hasNondeterministicFn());
     return queryExecRequest;
   }
 
@@ -3330,4 +3330,46 @@ public class AnalyzeExprsTest extends AnalyzerTest {
     Assert.assertEquals(expected_str, select.getResultExprs().get(0).toSqlImpl());
   }
 
+  private boolean hasNondeterministicFn(String stmt) {
+    return ((StatementBase) AnalyzesOk(stmt)).getAnalyzer().hasNondeterministicFn();
+  }
+
+  /**
+   * Tests that the analyzer records calls to functions whose results may change between
+   * executions, which keeps the results of the statement out of the query result cache.
+   */
+  @Test
+  public void TestNondeterministicFns() {
+    assertFalse(hasNondeterministicFn("select int_col + 1 from functional.alltypes"));
+    // Function names in comments and string literals are not calls.
+    assertFalse(hasNondeterministicFn("select 'rand()', /* uuid() */ 1"));
+    assertFalse(hasNondeterministicFn(
+        "select unix_timestamp('2020-01-01 00:00:00') from functional.alltypes"));
+    assertTrue(hasNondeterministicFn("select rand() from functional.alltypes"));
+    assertTrue(hasNondeterministicFn("select count(*) from functional.alltypes " +
+        "where id in (select id from functional.alltypes where id > random())"));
+    assertTrue(hasNondeterministicFn("select uuid()"));
+    assertTrue(hasNondeterministicFn("select unix_timestamp()"));
+    // now() is folded into a literal by the expr rewrites.
+    assertTrue(hasNondeterministicFn("select * from functional.alltypes " +
+        "where timestamp_col < now()"));
+
+    // Calls in the definition of a view.
+    addTestDb("nondeterministic_fn_db", "Test DB for non-deterministic functions.");
+    addTestView("create view nondeterministic_fn_db.rand_view as " +
+        "select id, rand() r from functional.alltypes");
+    addTestView("create view nondeterministic_fn_db.now_view as " +
+        "select id from functional.alltypes where timestamp_col < now()");
+    addTestView("create view nondeterministic_fn_db.plain_view as " +
+        "select id from functional.alltypes");
+    assertTrue(hasNondeterministicFn("select r from nondeterministic_fn_db.rand_view"));
+    assertTrue(hasNondeterministicFn("select id from nondeterministic_fn_db.now_view"));
+    assertFalse(hasNondeterministicFn(
+        "select id from nondeterministic_fn_db.plain_view"));
+
+    // UDFs are not known to be deterministic.
+    addTestFunction("NondeterministicTestFn", Lists.newArrayList(Type.INT), false);
+    assertTrue(hasNondeterministicFn(
+        "select default.NondeterministicTestFn(int_col) from functional.alltypes"));
+  }
 }
@@ -35,6 +35,15 @@ class TestAvroSchemaResolution(ImpalaTestSuite):
   def test_avro_schema_resolution(self, vector, unique_database):
     self.run_test_case('QueryTest/avro-schema-resolution', vector, unique_database)
 
+  def test_avro_schema_evolution_codegen(self, vector, unique_database):
+    """Checks the results of scanning files whose schema differs from the table schema,
+    and whether the DecodeAvroData() codegen'd for the table schema was used for them.
+    """
+    vector.get_value('exec_option')['disable_codegen'] = False
+    vector.get_value('exec_option')['disable_codegen_rows_threshold'] = 0
+    self.run_test_case('QueryTest/avro-schema-evolution-codegen', vector,
+        unique_database)
+
   def test_avro_c_lib_unicode_nulls(self, vector):
     """Test for IMPALA-1136 and IMPALA-2161 and unicode characters in the
     schema that were not handled correctly by the Avro C library.